@@ -0,0 +1,607 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+//
+// Benchmarks for the hot paths of the inversion. All input is synthetic: a
+// Simbox with constant thickness and random FFT grids of size nx*ny*nz, so
+// no model file is needed. Each kernel is run nrep times, and the best time
+// is reported together with the throughput in cells/s and GB/s.
+//
+// Usage: cravabench [nx ny nz [ntheta [nrep]]]
+//
+// The kernels are
+//
+//   fft            3D real-to-complex FFT and back
+//   postsolve      the batched posterior solve, Crava::solveFrequencyRow
+//   simulation     noise, Cholesky factor times noise and inverse FFT
+//   faciesprob     facies densities, FaciesProb::packDensities and findDensities
+//   kriging        kriging to wells, CKrigingAdmin::KrigAll
+//   segyread       reading a SEG-Y cube and resampling to a regular grid
+//   stormwrite     writing a binary STORM cube
+//
+// The bytes counted are the grid values read and written by the kernel
+// (matrices for the posterior solve, file size for the file kernels).
+//
+// The kriging prints its progress while running, so the table is written
+// when all kernels are done.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "lib/timekit.hpp"
+#include "lib/lib_matrbatch.h"
+
+#include "nrlib/iotools/fileio.hpp"
+#include "nrlib/iotools/logkit.hpp"
+#include "nrlib/random/randomgenerator.hpp"
+#include "nrlib/segy/segy.hpp"
+
+#include "src/definitions.h"
+#include "src/fftgrid.h"
+#include "src/simbox.h"
+#include "src/crava.h"
+#include "src/faciesprob.h"
+#include "src/krigingadmin.h"
+#include "src/covgridseparated.h"
+#include "src/bwellpt.h"
+
+struct BenchResult
+{
+  std::string name;
+  double      seconds;         // Best time of one repetition
+  double      cells;           // Cells processed in one repetition
+  double      bytes;           // Bytes read and written in one repetition
+};
+
+static void
+reportResult(const BenchResult & result)
+{
+  double cellsPerSec = (result.seconds > 0.0 ? result.cells/result.seconds : 0.0);
+  double gbPerSec    = (result.seconds > 0.0 ? result.bytes/result.seconds/(1024.0*1024.0*1024.0) : 0.0);
+  printf("%-12s %12.4f %14.2f %10.3f\n", result.name.c_str(), result.seconds, cellsPerSec*1.0e-6, gbPerSec);
+  fflush(stdout);
+}
+
+static FFTGrid *
+makeRandomGrid(int                      nx,
+               int                      ny,
+               int                      nz,
+               int                      nxp,
+               int                      nyp,
+               int                      nzp,
+               NRLib::RandomGenerator & ranGen)
+{
+  FFTGrid * grid = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
+  grid->createRealGrid();
+  grid->setType(FFTGrid::PARAMETER);
+  grid->setAccessMode(FFTGrid::WRITE);
+  int rnxp = grid->getRNxp();
+  for(int k=0;k<nzp;k++)
+    for(int j=0;j<nyp;j++)
+      for(int i=0;i<rnxp;i++)
+        grid->setNextReal(static_cast<float>(ranGen.Norm01()));
+  grid->endAccess();
+  return(grid);
+}
+
+//--------------------------------------------------------------------
+static BenchResult
+benchFFT(int                      nx,
+         int                      ny,
+         int                      nz,
+         int                      nxp,
+         int                      nyp,
+         int                      nzp,
+         int                      nrep,
+         NRLib::RandomGenerator & ranGen)
+{
+  FFTGrid * grid = makeRandomGrid(nx, ny, nz, nxp, nyp, nzp, ranGen);
+
+  BenchResult result;
+  result.name    = "fft";
+  result.cells   = static_cast<double>(nxp)*nyp*nzp;
+  result.bytes   = 4.0*grid->getRNxp()*nyp*nzp*sizeof(fftw_real);  // Read and write, forward and back
+  result.seconds = 1.0e30;
+
+  for(int r=0;r<nrep;r++) {
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+    grid->fftInPlace();
+    grid->invFFTInPlace();
+    TimeKit::getTime(wall,cpu);
+    result.seconds = std::min(result.seconds, wall);
+  }
+  delete grid;
+  return(result);
+}
+
+//--------------------------------------------------------------------
+static void
+setBatchValue(lib_matrBatchCpx * mat, int i, int j, int c, float re, float im)
+{
+  mat->re[LIB_MATR_BATCH_INDEX(mat,i,j,c)] = re;
+  mat->im[LIB_MATR_BATCH_INDEX(mat,i,j,c)] = im;
+}
+
+static BenchResult
+benchPosteriorSolve(int                      cnxp,
+                    int                      nyp,
+                    int                      nzp,
+                    int                      ntheta,
+                    int                      nrep,
+                    NRLib::RandomGenerator & ranGen)
+{
+  //
+  // Crava::solveFrequencyRow for nyp*nzp rows of cnxp cells. The rows are
+  // filled and solved as in Crava::computePostMeanResidAndFFTCov. The prior
+  // covariance and the error variance are diagonally dominant, so all
+  // factorizations succeed.
+  //
+  std::vector<fftw_complex> planeK(3*ntheta);
+  for(size_t i=0;i<planeK.size();i++) {
+    planeK[i].re = static_cast<float>(ranGen.Norm01());
+    planeK[i].im = static_cast<float>(ranGen.Norm01());
+  }
+
+  std::vector<float> rowData(2*ntheta*cnxp);
+  std::vector<float> rowMean(6*cnxp);
+  for(size_t i=0;i<rowData.size();i++)
+    rowData[i] = static_cast<float>(ranGen.Norm01());
+  for(size_t i=0;i<rowMean.size();i++)
+    rowMean[i] = static_cast<float>(ranGen.Norm01());
+
+  int nRows = nyp*nzp;
+
+  BenchResult result;
+  result.name    = "postsolve";
+  result.cells   = static_cast<double>(cnxp)*nRows;
+  result.bytes   = result.cells*2.0*sizeof(fftw_complex)*(2*ntheta + 3 + 9 + ntheta*ntheta);
+  result.seconds = 1.0e30;
+
+  for(int r=0;r<nrep;r++) {
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      Crava::FrequencySolveBuffers buffers(ntheta);
+      Crava::FrequencyRowBuffers   row(ntheta, cnxp);
+      for(int l=0;l<ntheta;l++)
+        for(int m=0;m<3;m++)
+          buffers.K[l][m] = planeK[3*l+m];
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,16)
+#endif
+      for(int rr=0;rr<nRows;rr++) {
+        for(int c=0;c<cnxp;c++) {
+          for(int l=0;l<ntheta;l++) {
+            setBatchValue(row.data, l, 0, c, rowData[2*(l*cnxp+c)], rowData[2*(l*cnxp+c)+1]);
+            for(int m=0;m<ntheta;m++)
+              setBatchValue(row.errVar, l, m, c, (l == m ? 0.1f : 0.01f), 0.0f);
+          }
+          for(int l=0;l<3;l++) {
+            setBatchValue(row.mean, l, 0, c, rowMean[2*(l*cnxp+c)], rowMean[2*(l*cnxp+c)+1]);
+            for(int m=0;m<3;m++)
+              setBatchValue(row.parVar, l, m, c, (l == m ? 1.0f : 0.2f), 0.0f);
+          }
+        }
+        Crava::solveFrequencyRow(buffers, row);
+      }
+    }
+    TimeKit::getTime(wall,cpu);
+    result.seconds = std::min(result.seconds, wall);
+  }
+  return(result);
+}
+
+//--------------------------------------------------------------------
+static BenchResult
+benchSimulation(int                      nx,
+                int                      ny,
+                int                      nz,
+                int                      nxp,
+                int                      nyp,
+                int                      nzp,
+                int                      nrep,
+                NRLib::RandomGenerator & ranGen)
+{
+  //
+  // One realisation as in Crava::simulate with the factors of PostCovCholesky
+  // in memory: complex noise for three parameters, multiplication by the
+  // packed Cholesky factor of each cell, and inverse FFT.
+  //
+  int    cnxp    = nxp/2 + 1;
+  int    nRows   = nyp*nzp;
+  size_t rowSize = static_cast<size_t>(12*cnxp);
+
+  std::vector<float> factors(rowSize*nRows);
+  lib_matrBatchCpx * rowCov   = lib_matrBatchAllocCpx(3, 3, cnxp);
+  int              * cholFlag = new int[cnxp];
+  for(int r=0;r<nRows;r++) {
+    for(int c=0;c<cnxp;c++) {
+      float scale = static_cast<float>(1.0 + ranGen.Unif01());
+      for(int l=0;l<3;l++)
+        for(int m=0;m<3;m++)
+          setBatchValue(rowCov, l, m, c, scale*(l == m ? 1.0f : 0.3f), 0.0f);
+    }
+    lib_matrBatchCholCpx(rowCov, cholFlag);
+    float * rowRe = &factors[r*rowSize];
+    lib_matrBatchPackLowerCpx(rowCov, cholFlag, rowRe, rowRe + 6*cnxp);
+  }
+  lib_matrBatchFreeCpx(rowCov);
+  delete [] cholFlag;
+
+  std::vector<FFTGrid *> seed(3);
+  for(int l=0;l<3;l++) {
+    seed[l] = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
+    seed[l]->createComplexGrid();
+  }
+
+  BenchResult result;
+  result.name    = "simulation";
+  result.cells   = static_cast<double>(nxp)*nyp*nzp;
+  result.bytes   = 3.0*4.0*cnxp*nRows*sizeof(fftw_complex) + rowSize*nRows*sizeof(float);
+  result.seconds = 1.0e30;
+
+  fftw_complex       ijkSeed[3];
+  lib_matrBatchCpx * rowSeed = lib_matrBatchAllocCpx(3, 1, cnxp);
+
+  for(int rep=0;rep<nrep;rep++) {
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+    for(int l=0;l<3;l++)
+      seed[l]->fillInComplexNoise(ranGen);
+
+    for(int r=0;r<nRows;r++) {
+      for(int c=0;c<cnxp;c++) {
+        int index = r*cnxp + c;
+        for(int l=0;l<3;l++)
+          ijkSeed[l] = seed[l]->getComplexValue(index);
+        lib_matrBatchSetVecCpx(rowSeed, c, ijkSeed);
+      }
+      const float * rowRe = &factors[r*rowSize];
+      lib_matrBatchProdPackedCholVec(rowRe, rowRe + 6*cnxp, rowSeed);
+      for(int c=0;c<cnxp;c++) {
+        int index = r*cnxp + c;
+        lib_matrBatchGetVecCpx(rowSeed, c, ijkSeed);
+        for(int l=0;l<3;l++)
+          seed[l]->setComplexValue(index, ijkSeed[l]);
+      }
+    }
+
+    for(int l=0;l<3;l++)
+      seed[l]->invFFTInPlace();
+    TimeKit::getTime(wall,cpu);
+    result.seconds = std::min(result.seconds, wall);
+
+    // Back to the frequency domain for the next realisation.
+    for(int l=0;l<3;l++)
+      seed[l]->fftInPlace();
+  }
+
+  lib_matrBatchFreeCpx(rowSeed);
+  for(int l=0;l<3;l++)
+    delete seed[l];
+  return(result);
+}
+
+//--------------------------------------------------------------------
+static BenchResult
+benchFaciesProb(int                      nx,
+                int                      ny,
+                int                      nz,
+                int                      nrep,
+                NRLib::RandomGenerator & ranGen)
+{
+  //
+  // The density lookup of FaciesProb::calculateFaciesProb for three facies
+  // with Gaussian densities on a grid of nBins^3 nodes in (ln vp, ln vs, ln rho),
+  // followed by the normalisation with equal prior probabilities.
+  //
+  const int nFacies = 3;
+  const int nBins   = 64;
+
+  double mean[nFacies][3] = {{8.00, 7.30, 7.70}, {8.10, 7.45, 7.75}, {8.20, 7.60, 7.80}};
+  double stdDev[3]        = {0.05, 0.05, 0.02};
+  double vpMin  = 7.5, vpMax  = 8.7;
+  double vsMin  = 6.8, vsMax  = 8.1;
+  double rhoMin = 7.4, rhoMax = 8.1;
+  double dVp    = (vpMax - vpMin)/nBins;
+  double dVs    = (vsMax - vsMin)/nBins;
+  double dRho   = (rhoMax - rhoMin)/nBins;
+
+  // As FaciesProb::makeFaciesDens: alpha along x, beta along y and rho along z.
+  Surface rhoMinSurf(vpMin, vsMin, vpMax-vpMin, vsMax-vsMin, 2, 2, rhoMin);
+  std::vector<Simbox *> volume(1);
+  volume[0] = new Simbox(vpMin, vsMin, rhoMinSurf, vpMax-vpMin, vsMax-vsMin, rhoMax-rhoMin, 0, dVp, dVs, dRho);
+
+  std::vector<std::vector<FFTGrid *> > density(1, std::vector<FFTGrid *>(nFacies));
+  for(int f=0;f<nFacies;f++) {
+    FFTGrid * grid = new FFTGrid(nBins, nBins, nBins, nBins, nBins, nBins);
+    grid->createRealGrid(false);
+    grid->setType(FFTGrid::PARAMETER);
+    grid->setAccessMode(FFTGrid::WRITE);
+    int rnxp = grid->getRNxp();
+    for(int l=0;l<nBins;l++) {
+      for(int k=0;k<nBins;k++) {
+        for(int j=0;j<rnxp;j++) {
+          double u1 = (vpMin  + (j + 0.5)*dVp  - mean[f][0])/stdDev[0];
+          double u2 = (vsMin  + (k + 0.5)*dVs  - mean[f][1])/stdDev[1];
+          double u3 = (rhoMin + (l + 0.5)*dRho - mean[f][2])/stdDev[2];
+          grid->setNextReal(j < nBins ? static_cast<float>(exp(-0.5*(u1*u1 + u2*u2 + u3*u3))) : 0.0f);
+        }
+      }
+    }
+    grid->endAccess();
+    density[0][f] = grid;
+  }
+
+  size_t nCells = static_cast<size_t>(nx)*ny*nz;
+  std::vector<float> vp(nCells), vs(nCells), rho(nCells);
+  for(size_t i=0;i<nCells;i++) {
+    vp[i]  = static_cast<float>(8.10 + 0.10*ranGen.Norm01());
+    vs[i]  = static_cast<float>(7.45 + 0.10*ranGen.Norm01());
+    rho[i] = static_cast<float>(7.75 + 0.04*ranGen.Norm01());
+  }
+  std::vector<float> prob(nCells*nFacies);
+
+  BenchResult result;
+  result.name    = "faciesprob";
+  result.cells   = static_cast<double>(nCells);
+  result.bytes   = result.cells*(3 + nFacies)*sizeof(float);
+  result.seconds = 1.0e30;
+
+  for(int r=0;r<nrep;r++) {
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+    FaciesProb::DensityTable table;
+    FaciesProb::packDensities(density, volume, nFacies, table);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<float> t;
+      std::vector<float> work(nFacies);
+      float              dens[nFacies];
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+      for(int k=0;k<nz;k++) {
+        size_t first = static_cast<size_t>(k)*nx*ny;
+        for(size_t i=first;i<first+static_cast<size_t>(nx)*ny;i++) {
+          FaciesProb::findDensities(vp[i], vs[i], rho[i], table, volume, t, 0, nFacies, &work[0], dens);
+          float sum = 0.0f;
+          for(int f=0;f<nFacies;f++)
+            sum += dens[f];
+          for(int f=0;f<nFacies;f++)
+            prob[nFacies*i+f] = (sum > 0.0f ? dens[f]/sum : 1.0f/nFacies);
+        }
+      }
+    }
+    TimeKit::getTime(wall,cpu);
+    result.seconds = std::min(result.seconds, wall);
+  }
+
+  for(int f=0;f<nFacies;f++)
+    delete density[0][f];
+  delete volume[0];
+  return(result);
+}
+
+//--------------------------------------------------------------------
+static BenchResult
+benchKriging(int                      nx,
+             int                      ny,
+             int                      nz,
+             int                      nxp,
+             int                      nyp,
+             int                      nzp,
+             int                      nrep,
+             const Simbox           * simbox,
+             NRLib::RandomGenerator & ranGen)
+{
+  //
+  // CKrigingAdmin::KrigAll of (vp, vs, rho) to vertical wells on a regular
+  // pattern, with exponential covariances and no cross covariance. A new
+  // kriging object is made for each repetition, so the time includes finding
+  // the blocks and neighbourhoods and the Cholesky factorizations.
+  //
+  const int wellSpacing = 20;
+
+  std::vector<CBWellPt *> wellPts;
+  for(int j=wellSpacing/2;j<ny;j+=wellSpacing) {
+    for(int i=wellSpacing/2;i<nx;i+=wellSpacing) {
+      for(int k=0;k<nz;k++) {
+        CBWellPt * pt = new CBWellPt(i, j, k);
+        pt->AddLog(static_cast<float>(3000.0*exp(0.05*ranGen.Norm01())),
+                   static_cast<float>(1500.0*exp(0.05*ranGen.Norm01())),
+                   static_cast<float>(2.3*exp(0.02*ranGen.Norm01())));
+        pt->Divide();
+        wellPts.push_back(pt);
+      }
+    }
+  }
+
+  float dx = static_cast<float>(simbox->getdx());
+  float dy = static_cast<float>(simbox->getdy());
+  float dz = static_cast<float>(simbox->getdz());
+  CovGridSeparated covAlpha(nxp, nyp, nzp, dx, dy, dz, 1000.0f, 1000.0f, 40.0f, 1.0f);
+  CovGridSeparated covBeta (nxp, nyp, nzp, dx, dy, dz, 1000.0f, 1000.0f, 40.0f, 1.0f);
+  CovGridSeparated covRho  (nxp, nyp, nzp, dx, dy, dz, 1000.0f, 1000.0f, 40.0f, 1.0f);
+  CovGridSeparated covCrAlphaBeta(nxp, nyp, nzp);
+  CovGridSeparated covCrAlphaRho (nxp, nyp, nzp);
+  CovGridSeparated covCrBetaRho  (nxp, nyp, nzp);
+
+  std::vector<FFTGrid *> trend(3);
+  float trendValue[3] = {static_cast<float>(log(3000.0)), static_cast<float>(log(1500.0)), static_cast<float>(log(2.3))};
+
+  BenchResult result;
+  result.name    = "kriging";
+  result.cells   = 3.0*nx*ny*nz;
+  result.bytes   = 2.0*result.cells*sizeof(float);
+  result.seconds = 1.0e30;
+
+  for(int r=0;r<nrep;r++) {
+    for(int l=0;l<3;l++) {
+      trend[l] = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
+      trend[l]->createRealGrid();
+      trend[l]->setType(FFTGrid::PARAMETER);
+      trend[l]->fillInConstant(trendValue[l]);
+    }
+
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+    CKrigingAdmin kriging(*simbox, &wellPts[0], static_cast<int>(wellPts.size()),
+                          covAlpha, covBeta, covRho, covCrAlphaBeta, covCrAlphaRho, covCrBetaRho);
+    kriging.KrigAll(*trend[0], *trend[1], *trend[2]);
+    TimeKit::getTime(wall,cpu);
+    result.seconds = std::min(result.seconds, wall);
+
+    for(int l=0;l<3;l++)
+      delete trend[l];
+  }
+
+  for(size_t i=0;i<wellPts.size();i++)
+    delete wellPts[i];
+  return(result);
+}
+
+//--------------------------------------------------------------------
+static void
+benchFiles(int                        nx,
+           int                        ny,
+           int                        nz,
+           int                        nxp,
+           int                        nyp,
+           int                        nzp,
+           int                        nrep,
+           const Simbox             * simbox,
+           NRLib::RandomGenerator   & ranGen,
+           std::vector<BenchResult> & results)
+{
+  FFTGrid * grid = makeRandomGrid(nx, ny, nz, nxp, nyp, nzp, ranGen);
+
+  std::string baseName = "cravabench_tmp";
+  std::string stormName = baseName + IO::SuffixStormBinary();
+  std::string segyName  = baseName + IO::SuffixSegy();
+
+  BenchResult write;
+  write.name    = "stormwrite";
+  write.cells   = static_cast<double>(nx)*ny*nz;
+  write.seconds = 1.0e30;
+  for(int r=0;r<nrep;r++) {
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+    grid->writeStormFile(baseName, simbox, false, false, true);  // Flat, as the top and base surfaces are not written
+    TimeKit::getTime(wall,cpu);
+    write.seconds = std::min(write.seconds, wall);
+  }
+  write.bytes = static_cast<double>(NRLib::FindFileSize(stormName));
+
+  grid->writeSegyFile(baseName, simbox, 0.0f);
+  delete grid;
+
+  BenchResult read;
+  read.name    = "segyread";
+  read.cells   = static_cast<double>(nx)*ny*nz;
+  read.bytes   = static_cast<double>(NRLib::FindFileSize(segyName));
+  read.seconds = 1.0e30;
+  for(int r=0;r<nrep;r++) {
+    double wall=0.0, cpu=0.0;
+    TimeKit::getTime(wall,cpu);
+    SegY segy(segyName, 0.0f, TraceHeaderFormat(TraceHeaderFormat::SEISWORKS));
+    segy.ReadAllTraces(simbox, 0.0);
+    segy.CreateRegularGrid();
+    TimeKit::getTime(wall,cpu);
+    read.seconds = std::min(read.seconds, wall);
+  }
+
+  results.push_back(read);
+  results.push_back(write);
+
+  remove(stormName.c_str());
+  remove(segyName.c_str());
+}
+
+//--------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  if(argc != 1 && argc != 4 && argc != 5 && argc != 6) {
+    printf("Usage: %s [nx ny nz [ntheta [nrep]]]\n", argv[0]);
+    return(1);
+  }
+
+  int nx     = 100;
+  int ny     = 100;
+  int nz     = 100;
+  int ntheta = 3;
+  int nrep   = 3;
+  if(argc >= 4) {
+    nx = atoi(argv[1]);
+    ny = atoi(argv[2]);
+    nz = atoi(argv[3]);
+  }
+  if(argc >= 5)
+    ntheta = atoi(argv[4]);
+  if(argc >= 6)
+    nrep = atoi(argv[5]);
+
+  if(nx < 1 || ny < 1 || nz < 1 || ntheta < 1 || nrep < 1) {
+    printf("All sizes must be positive.\n");
+    return(1);
+  }
+
+  LogKit::SetScreenLog(LogKit::Error);
+
+  // Pad by 10% as the default padding of the inversion.
+  int nxp = FFTGrid::findClosestFactorableNumber(nx + static_cast<int>(ceil(0.1*nx)));
+  int nyp = FFTGrid::findClosestFactorableNumber(ny + static_cast<int>(ceil(0.1*ny)));
+  int nzp = FFTGrid::findClosestFactorableNumber(nz + static_cast<int>(ceil(0.1*nz)));
+  FFTGrid::setMaxAllowedGrids(1000);
+
+  double dx = 25.0;
+  double dy = 25.0;
+  double dz = 4.0;
+  Surface top(0.0, 0.0, nx*dx, ny*dy, 2, 2, 2000.0);
+  Simbox  simbox(0.0, 0.0, top, nx*dx, ny*dy, nz*dz, 0.0, dx, dy, dz);
+
+  NRLib::RandomGenerator ranGen;
+  ranGen.Initialize(1);
+
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+
+  std::vector<BenchResult> results;
+  results.push_back(benchFFT(nx, ny, nz, nxp, nyp, nzp, nrep, ranGen));
+  results.push_back(benchPosteriorSolve(nxp/2 + 1, nyp, nzp, ntheta, nrep, ranGen));
+  results.push_back(benchSimulation(nx, ny, nz, nxp, nyp, nzp, nrep, ranGen));
+  results.push_back(benchFaciesProb(nx, ny, nz, nrep, ranGen));
+  results.push_back(benchKriging(nx, ny, nz, nxp, nyp, nzp, nrep, &simbox, ranGen));
+  benchFiles(nx, ny, nz, nxp, nyp, nzp, nrep, &simbox, ranGen, results);
+
+  printf("\nGrid %d x %d x %d, padded %d x %d x %d, %d angles, %d repetitions, %d threads\n\n",
+         nx, ny, nz, nxp, nyp, nzp, ntheta, nrep, nThreads);
+  printf("%-12s %12s %14s %10s\n", "Kernel", "Time (s)", "Mcells/s", "GB/s");
+  printf("---------------------------------------------------\n");
+  for(size_t i=0;i<results.size();i++)
+    reportResult(results[i]);
+  printf("\n");
+
+  LogKit::EndLog();
+  return(0);
+}
@@ -0,0 +1,38 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+/* rfftw_threads.h -- thread parallel multi-dimensional real transforms */
+#ifndef RFFTW_THREADS_H
+#define RFFTW_THREADS_H
+
+#include <rfftw.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif				/* __cplusplus */
+
+/*
+ * Same interface as in the FFTW 2 threads library, but using OpenMP. The
+ * transform is split in slabs along the first dimension and in blocks of
+ * columns for the first dimension transforms. Each one dimensional
+ * transform is done exactly as by rfftwnd_one_real_to_complex() and
+ * rfftwnd_one_complex_to_real(), so the result does not depend on the
+ * number of threads. Plans of rank < 3, and builds without OpenMP, use
+ * the serial routines.
+ *
+ * Each thread uses its own work array, so plans may be created with
+ * FFTW_THREADSAFE, and the same plan may be used by several callers.
+ */
+extern void rfftwnd_threads_one_real_to_complex(int nthreads, fftwnd_plan p,
+						fftw_real *in,
+						fftw_complex *out);
+extern void rfftwnd_threads_one_complex_to_real(int nthreads, fftwnd_plan p,
+						fftw_complex *in,
+						fftw_real *out);
+
+#ifdef __cplusplus
+}				/* extern "C" */
+#endif				/* __cplusplus */
+
+#endif				/* RFFTW_THREADS_H */
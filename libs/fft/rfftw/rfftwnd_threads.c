@@ -0,0 +1,137 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <fftw-int.h>
+#include <rfftw.h>
+#include <rfftw_threads.h>
+
+/*************** prototypes for the rfftwnd recursion routines ***************/
+
+extern void rfftwnd_real2c_aux(fftwnd_plan p, int cur_dim,
+			       fftw_real *in, int istride,
+			       fftw_complex *out, int ostride,
+			       fftw_real *work);
+extern void rfftwnd_c2real_aux(fftwnd_plan p, int cur_dim,
+			       fftw_complex *in, int istride,
+			       fftw_real *out, int ostride,
+			       fftw_real *work);
+
+/* Number of columns in each block of first dimension transforms. */
+#define COLUMN_BLOCK 64
+
+#ifdef _OPENMP
+
+/*
+ * Do the first dimension transforms of the n_after columns starting at
+ * 'data', in blocks of columns distributed over the threads. Must be
+ * called by all threads of the enclosing parallel region, each with its
+ * own work array of at least p->n[0] elements.
+ */
+static void first_dim_threads(fftwnd_plan p, fftw_complex *data,
+			      fftw_complex *work)
+{
+     int n_after = p->n_after[0];
+     int nblocks = (n_after + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+     int b;
+
+#pragma omp for schedule(static)
+     for (b = 0; b < nblocks; ++b) {
+	  int start = b * COLUMN_BLOCK;
+	  int count = n_after - start < COLUMN_BLOCK ? n_after - start : COLUMN_BLOCK;
+
+	  fftw(p->plans[0], count,
+	       data + start, n_after, 1,
+	       work, 1, 0);
+     }
+}
+
+#endif
+
+void rfftwnd_threads_one_real_to_complex(int nthreads, fftwnd_plan p,
+					 fftw_real *in, fftw_complex *out)
+{
+#ifdef _OPENMP
+     if (p->dir != FFTW_REAL_TO_COMPLEX)
+	  fftw_die("rfftwnd_threads_one_real_to_complex with complex-to-real plan");
+
+     if (nthreads > 1 && p->rank >= 3) {
+	  int n = p->n[0];
+	  int n_after = p->n_after[0];
+	  int nr = p->plans[p->rank - 1]->n;
+	  int n_after_r;
+
+	  if (p->is_in_place) {
+	       out = (fftw_complex *) in;
+	       n_after_r = n_after * 2;
+	  } else
+	       n_after_r = nr * (n_after / (nr / 2 + 1));
+
+#pragma omp parallel num_threads(nthreads)
+	  {
+	       int i;
+	       fftw_complex *work = (fftw_complex *)
+		   fftw_malloc(sizeof(fftw_complex) * p->nwork);
+
+	       /* the remaining dimensions, one slab at a time: */
+#pragma omp for schedule(static)
+	       for (i = 0; i < n; ++i)
+		    rfftwnd_real2c_aux(p, 1,
+				       in + i * n_after_r, 1,
+				       out + i * n_after, 1,
+				       (fftw_real *) work);
+
+	       /* the first dimension (in-place): */
+	       first_dim_threads(p, out, work);
+	       fftw_free(work);
+	  }
+	  return;
+     }
+#endif
+     (void) nthreads;
+     rfftwnd_one_real_to_complex(p, in, out);
+}
+
+void rfftwnd_threads_one_complex_to_real(int nthreads, fftwnd_plan p,
+					 fftw_complex *in, fftw_real *out)
+{
+#ifdef _OPENMP
+     if (p->dir != FFTW_COMPLEX_TO_REAL)
+	  fftw_die("rfftwnd_threads_one_complex_to_real with real-to-complex plan");
+
+     if (nthreads > 1 && p->rank >= 3) {
+	  int n = p->n[0];
+	  int n_after = p->n_after[0];
+	  int nr = p->plans[p->rank - 1]->n;
+	  int n_after_r;
+
+	  if (p->is_in_place) {
+	       out = (fftw_real *) in;
+	       n_after_r = n_after * 2;
+	  } else
+	       n_after_r = nr * (n_after / (nr / 2 + 1));
+
+#pragma omp parallel num_threads(nthreads)
+	  {
+	       int i;
+	       fftw_complex *work = (fftw_complex *)
+		   fftw_malloc(sizeof(fftw_complex) * p->nwork);
+
+	       /* the first dimension (in-place): */
+	       first_dim_threads(p, in, work);
+
+	       /* the remaining dimensions, one slab at a time: */
+#pragma omp for schedule(static)
+	       for (i = 0; i < n; ++i)
+		    rfftwnd_c2real_aux(p, 1,
+				       in + i * n_after, 1,
+				       out + i * n_after_r, 1,
+				       (fftw_real *) work);
+	       fftw_free(work);
+	  }
+	  return;
+     }
+#endif
+     (void) nthreads;
+     rfftwnd_one_complex_to_real(p, in, out);
+}
@@ -0,0 +1,649 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "lib/lib_matrbatch.h"
+
+/*
+The cell loops are marked for vectorisation. With OpenMP 4.0 this is done
+with 'omp simd', otherwise we tell gcc that the iterations are independent.
+
+On x86-64 Linux the kernels are compiled for AVX-512, AVX2 and the default
+instruction set, and the best version is selected at run time. AVX-512
+implies fused multiply-add, which must not be used here: contracting
+a*b + c changes the rounding, and the results would no longer be identical
+to the scalar code in lib_matr.
+*/
+#if defined(_OPENMP) && (_OPENMP >= 201307)
+# define LIB_MATR_BATCH_SIMD _Pragma("omp simd")
+#elif defined(__GNUC__)
+# define LIB_MATR_BATCH_SIMD _Pragma("GCC ivdep")
+#else
+# define LIB_MATR_BATCH_SIMD
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 6) && defined(__x86_64__) && defined(__linux__)
+# define LIB_MATR_BATCH_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+# pragma GCC optimize ("fp-contract=off")
+#else
+# define LIB_MATR_BATCH_CLONES
+#endif
+
+# define TOL 1e-20
+
+#define ELEM(mat,i,j) (((i)*(mat)->n2 + (j))*(mat)->nbatch)
+
+
+lib_matrBatchCpx * lib_matrBatchAllocCpx(int n1, int n2, int nbatch)
+{
+  lib_matrBatchCpx * mat = (lib_matrBatchCpx *) malloc(sizeof(lib_matrBatchCpx));
+  mat->n1     = n1;
+  mat->n2     = n2;
+  mat->nbatch = nbatch;
+  mat->re     = (float *) malloc(sizeof(float)*n1*n2*nbatch);
+  mat->im     = (float *) malloc(sizeof(float)*n1*n2*nbatch);
+  mat->work   = (float *) malloc(sizeof(float)*3*nbatch);
+  return(mat);
+}
+
+void lib_matrBatchFreeCpx(lib_matrBatchCpx * mat)
+{
+  if(mat != NULL) {
+    free(mat->re);
+    free(mat->im);
+    free(mat->work);
+    free(mat);
+  }
+}
+
+/*
+Copy the n1 x n2 matrix value into cell c of the batch, and back.
+*/
+void lib_matrBatchSetCpx(lib_matrBatchCpx * mat, int c, fftw_complex ** value)
+{
+  int i, j;
+  for(i=0;i<mat->n1;i++)
+    for(j=0;j<mat->n2;j++)
+    {
+      mat->re[ELEM(mat,i,j) + c] = value[i][j].re;
+      mat->im[ELEM(mat,i,j) + c] = value[i][j].im;
+    }
+}
+
+void lib_matrBatchGetCpx(const lib_matrBatchCpx * mat, int c, fftw_complex ** value)
+{
+  int i, j;
+  for(i=0;i<mat->n1;i++)
+    for(j=0;j<mat->n2;j++)
+    {
+      value[i][j].re = mat->re[ELEM(mat,i,j) + c];
+      value[i][j].im = mat->im[ELEM(mat,i,j) + c];
+    }
+}
+
+/*
+As above, for a batch of n1 x 1 vectors.
+*/
+void lib_matrBatchSetVecCpx(lib_matrBatchCpx * vec, int c, const fftw_complex * value)
+{
+  int i;
+  for(i=0;i<vec->n1;i++)
+  {
+    vec->re[i*vec->nbatch + c] = value[i].re;
+    vec->im[i*vec->nbatch + c] = value[i].im;
+  }
+}
+
+void lib_matrBatchGetVecCpx(const lib_matrBatchCpx * vec, int c, fftw_complex * value)
+{
+  int i;
+  for(i=0;i<vec->n1;i++)
+  {
+    value[i].re = vec->re[i*vec->nbatch + c];
+    value[i].im = vec->im[i*vec->nbatch + c];
+  }
+}
+
+void lib_matrBatchCopyCpx(const lib_matrBatchCpx * mat, lib_matrBatchCpx * outmat)
+{
+  int c;
+  int n = mat->n1*mat->n2*mat->nbatch;
+  LIB_MATR_BATCH_SIMD
+  for(c=0;c<n;c++)
+  {
+    outmat->re[c] = mat->re[c];
+    outmat->im[c] = mat->im[c];
+  }
+}
+
+/*FUNC********************************************************************
+
+DESCRIPTION:
+
+Batched version of lib_matrCholCpx. Factorizes the positive definite,
+hermitian complex matrix of every cell into L * L(adjoint). L is stored in
+the lower part of 'x_mat' on output.
+
+All cells are processed, also those that fail. flag[c] is set to 0 if the
+factorization of cell c is O.K. and to 1 if the matrix is illegal. The
+content of 'x_mat' for failed cells is undefined.
+
+RETURN VALUE: The number of failed cells.
+
+************************************************************************/
+LIB_MATR_BATCH_CLONES
+int lib_matrBatchCholCpx(lib_matrBatchCpx * x_mat, int * flag)
+{
+  int     l_i, l_j, l_k, c, n_fail;
+  int     i_dim  = x_mat->n1;
+  int     nb     = x_mat->nbatch;
+  float * re     = x_mat->re;
+  float * im     = x_mat->im;
+  float * factor = x_mat->work;
+  float * l_r_re = x_mat->work + nb;
+  float * l_r_im = x_mat->work + 2*nb;
+
+  LIB_MATR_BATCH_SIMD
+  for(c=0;c<nb;c++)
+  {
+    factor[c] = re[c];
+    flag[c]   = (factor[c] <= 0);
+  }
+
+  for(l_i=0;l_i<i_dim*i_dim;l_i++)
+  {
+    float * e_re = re + l_i*nb;
+    float * e_im = im + l_i*nb;
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      e_re[c] = e_re[c]/factor[c];
+      e_im[c] = e_im[c]/factor[c];
+    }
+  }
+
+  for (l_i=0; l_i < i_dim; l_i++) {
+    float * ii_re = re + ELEM(x_mat,l_i,l_i);
+    float * ii_im = im + ELEM(x_mat,l_i,l_i);
+
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+      flag[c] |= (ii_re[c] <= TOL);
+
+    for (l_j=0; l_j < l_i; l_j++) {
+      float * ij_re = re + ELEM(x_mat,l_i,l_j);
+      float * ij_im = im + ELEM(x_mat,l_i,l_j);
+      float * jj_re = re + ELEM(x_mat,l_j,l_j);
+      float * jj_im = im + ELEM(x_mat,l_j,l_j);
+
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        l_r_re[c] = 0.0;
+        l_r_im[c] = 0.0;
+      }
+      for (l_k = 0; l_k < l_j; l_k++) {
+        float * ik_re = re + ELEM(x_mat,l_i,l_k);
+        float * ik_im = im + ELEM(x_mat,l_i,l_k);
+        float * jk_re = re + ELEM(x_mat,l_j,l_k);
+        float * jk_im = im + ELEM(x_mat,l_j,l_k);
+        LIB_MATR_BATCH_SIMD
+        for(c=0;c<nb;c++)
+        {
+          l_r_re[c] += (ik_re[c] * jk_re[c])+(ik_im[c] * jk_im[c]);
+          l_r_im[c] += -(ik_re[c] * jk_im[c])+(ik_im[c] * jk_re[c]);
+        }
+      }
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        float help = jj_re[c]*jj_re[c] + jj_im[c]*jj_im[c];
+        /* The imaginary part uses the updated real part, as in lib_matrCholCpx. */
+        ij_re[c] = ((ij_re[c] - l_r_re[c])*jj_re[c]
+          +(ij_im[c] - l_r_im[c])*jj_im[c])/help;
+
+        ij_im[c] = ((ij_im[c] - l_r_im[c])*jj_re[c]
+          -(ij_re[c] - l_r_re[c])*jj_im[c])/help;
+      }
+    }
+
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+      l_r_re[c] = 0.0;
+    for (l_k=0; l_k < l_i; l_k++) {
+      float * ik_re = re + ELEM(x_mat,l_i,l_k);
+      float * ik_im = im + ELEM(x_mat,l_i,l_k);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+        l_r_re[c] += (ik_re[c] * ik_re[c]) + (ik_im[c] * ik_im[c]);
+    }
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      float diag = ii_re[c] - l_r_re[c];
+      flag[c] |= (diag <= TOL);
+      ii_re[c] = (float) (sqrt(diag));
+      ii_im[c] = 0.0;
+    }
+  }
+
+  LIB_MATR_BATCH_SIMD
+  for(c=0;c<nb;c++)
+    factor[c] = (float) (sqrt(factor[c]));
+
+  for(l_i=0;l_i<i_dim;l_i++)
+    for(l_j=0;l_j<=l_i;l_j++)
+    {
+      float * e_re = re + ELEM(x_mat,l_i,l_j);
+      float * e_im = im + ELEM(x_mat,l_i,l_j);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        e_re[c] *= factor[c];
+        e_im[c] *= factor[c];
+      }
+    }
+
+  n_fail = 0;
+  for(c=0;c<nb;c++)
+    n_fail += flag[c];
+
+  return(n_fail);
+}
+
+/*
+Batched version of lib_matrAXeqBMatCpx. Solves A * X = B for every cell,
+where 'i_mat' holds the Cholesky factor of A from lib_matrBatchCholCpx. B is
+i_dim x n and is replaced by X on output.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchAXeqBMatCpx(const lib_matrBatchCpx * i_mat, lib_matrBatchCpx * x_mat)
+{
+  int     l_i, l_j, i, c;
+  int     i_dim  = i_mat->n1;
+  int     nb     = x_mat->nbatch;
+  float * l_x_re = x_mat->work;
+  float * l_x_im = x_mat->work + nb;
+
+  for(i=0;i<x_mat->n2;i++)
+  {
+    for (l_i = 0; l_i < i_dim; l_i++) {
+      float * x_re  = x_mat->re + ELEM(x_mat,l_i,i);
+      float * x_im  = x_mat->im + ELEM(x_mat,l_i,i);
+      float * ii_re = i_mat->re + ELEM(i_mat,l_i,l_i);
+      float * ii_im = i_mat->im + ELEM(i_mat,l_i,l_i);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        l_x_re[c] = x_re[c];
+        l_x_im[c] = x_im[c];
+      }
+      for (l_j = 0; l_j < l_i; l_j++) {
+        float * xj_re = x_mat->re + ELEM(x_mat,l_j,i);
+        float * xj_im = x_mat->im + ELEM(x_mat,l_j,i);
+        float * ij_re = i_mat->re + ELEM(i_mat,l_i,l_j);
+        float * ij_im = i_mat->im + ELEM(i_mat,l_i,l_j);
+        LIB_MATR_BATCH_SIMD
+        for(c=0;c<nb;c++)
+        {
+          l_x_re[c] -= (xj_re[c] * ij_re[c] - xj_im[c] * ij_im[c]);
+          l_x_im[c] -= (xj_im[c] * ij_re[c] + xj_re[c] * ij_im[c]);
+        }
+      }
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        float help = (ii_re[c]*ii_re[c]+ii_im[c]*ii_im[c]);
+        x_re[c] = (l_x_re[c]*ii_re[c]+l_x_im[c]*ii_im[c])/help;
+        x_im[c] = (l_x_im[c]*ii_re[c]-l_x_re[c]*ii_im[c])/help;
+      }
+    }
+
+    for (l_i = i_dim - 1; l_i >= 0; l_i--) {
+      float * x_re  = x_mat->re + ELEM(x_mat,l_i,i);
+      float * x_im  = x_mat->im + ELEM(x_mat,l_i,i);
+      float * ii_re = i_mat->re + ELEM(i_mat,l_i,l_i);
+      float * ii_im = i_mat->im + ELEM(i_mat,l_i,l_i);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        l_x_re[c] = x_re[c];
+        l_x_im[c] = x_im[c];
+      }
+      for (l_j = i_dim - 1; l_j > l_i; l_j--) {
+        float * xj_re = x_mat->re + ELEM(x_mat,l_j,i);
+        float * xj_im = x_mat->im + ELEM(x_mat,l_j,i);
+        float * ji_re = i_mat->re + ELEM(i_mat,l_j,l_i);
+        float * ji_im = i_mat->im + ELEM(i_mat,l_j,l_i);
+        LIB_MATR_BATCH_SIMD
+        for(c=0;c<nb;c++)
+        {
+          l_x_re[c] = l_x_re[c] - (xj_re[c] * ji_re[c] + xj_im[c] * ji_im[c]);
+          l_x_im[c] = l_x_im[c] - (-xj_re[c] * ji_im[c] + xj_im[c] * ji_re[c]);
+        }
+      }
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        float help = (ii_re[c]*ii_re[c]+ii_im[c]*ii_im[c]);
+        x_re[c] = (l_x_re[c]*ii_re[c]-l_x_im[c]*ii_im[c])/help;
+        x_im[c] = (l_x_im[c]*ii_re[c]+l_x_re[c]*ii_im[c])/help;
+      }
+    }
+  }
+}
+
+/*
+Batched version of lib_matrProdCholVec. Multiplies the lower triangular
+part of 'mat' with 'vec' for every cell, and returns the result in 'vec'.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchProdCholVec(const lib_matrBatchCpx * mat, lib_matrBatchCpx * vec)
+{
+  int     i, j, c;
+  int     nb   = vec->nbatch;
+  float * v_re = vec->work;
+  float * v_im = vec->work + nb;
+
+  /* Row i only needs elements 0..i of the input, so go backwards in place. */
+  for(i=mat->n1-1; i >= 0; i--)
+  {
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      v_re[c] = 0.0;
+      v_im[c] = 0.0;
+    }
+    for(j=0; j < i+1 ; j++)
+    {
+      const float * m_re = mat->re + ELEM(mat,i,j);
+      const float * m_im = mat->im + ELEM(mat,i,j);
+      const float * s_re = vec->re + j*nb;
+      const float * s_im = vec->im + j*nb;
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        v_re[c] += m_re[c] * s_re[c] - m_im[c] * s_im[c];
+        v_im[c] += m_re[c] * s_im[c] + m_im[c] * s_re[c];
+      }
+    }
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      vec->re[i*nb + c] = v_re[c];
+      vec->im[i*nb + c] = v_im[c];
+    }
+  }
+}
+
+/*
+Stores the lower triangle of the square matrix 'mat' row by row in 're' and
+'im'. Element (i,j), j <= i, of cell c is found at (i*(i+1)/2 + j)*nbatch + c.
+Cells with a nonzero 'flag' get a zero matrix. 'flag' may be NULL.
+*/
+void lib_matrBatchPackLowerCpx(const lib_matrBatchCpx * mat, const int * flag, float * re, float * im)
+{
+  int i, j, c;
+  int nb = mat->nbatch;
+  int t  = 0;
+
+  for(i=0; i < mat->n1; i++)
+    for(j=0; j < i+1; j++)
+    {
+      const float * m_re = mat->re + ELEM(mat,i,j);
+      const float * m_im = mat->im + ELEM(mat,i,j);
+      for(c=0;c<nb;c++)
+      {
+        if(flag == NULL || flag[c] == 0)
+        {
+          re[t*nb + c] = m_re[c];
+          im[t*nb + c] = m_im[c];
+        }
+        else
+        {
+          re[t*nb + c] = 0.0;
+          im[t*nb + c] = 0.0;
+        }
+      }
+      t++;
+    }
+}
+
+/*
+Same as lib_matrBatchProdCholVec, with the lower triangular matrix packed by
+lib_matrBatchPackLowerCpx. A zero matrix gives a zero vector.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchProdPackedCholVec(const float * re, const float * im, lib_matrBatchCpx * vec)
+{
+  int     i, j, c;
+  int     nb   = vec->nbatch;
+  float * v_re = vec->work;
+  float * v_im = vec->work + nb;
+
+  for(i=vec->n1-1; i >= 0; i--)
+  {
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      v_re[c] = 0.0;
+      v_im[c] = 0.0;
+    }
+    for(j=0; j < i+1 ; j++)
+    {
+      const float * m_re = re + (i*(i+1)/2 + j)*nb;
+      const float * m_im = im + (i*(i+1)/2 + j)*nb;
+      const float * s_re = vec->re + j*nb;
+      const float * s_im = vec->im + j*nb;
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        v_re[c] += m_re[c] * s_re[c] - m_im[c] * s_im[c];
+        v_im[c] += m_re[c] * s_im[c] + m_im[c] * s_re[c];
+      }
+    }
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      vec->re[i*nb + c] = v_re[c];
+      vec->im[i*nb + c] = v_im[c];
+    }
+  }
+}
+
+/*
+Calculate matrix product of a n1 x n2 and n2 x n3 complex matrix for every cell.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchProdCpx(const lib_matrBatchCpx * mat1, const lib_matrBatchCpx * mat2, lib_matrBatchCpx * outmat)
+{
+  int i, j, k, c;
+  int nb = outmat->nbatch;
+  for(i=0;i<mat1->n1;i++)
+    for(j=0;j<mat2->n2;j++)
+    {
+      float * x_re = outmat->re + ELEM(outmat,i,j);
+      float * x_im = outmat->im + ELEM(outmat,i,j);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        x_re[c] = 0.0;
+        x_im[c] = 0.0;
+      }
+      for(k=0;k<mat1->n2;k++)
+      {
+        const float * a_re = mat1->re + ELEM(mat1,i,k);
+        const float * a_im = mat1->im + ELEM(mat1,i,k);
+        const float * b_re = mat2->re + ELEM(mat2,k,j);
+        const float * b_im = mat2->im + ELEM(mat2,k,j);
+        LIB_MATR_BATCH_SIMD
+        for(c=0;c<nb;c++)
+        {
+          x_re[c] += a_re[c]*b_re[c] - a_im[c]*b_im[c];
+          x_im[c] += a_im[c]*b_re[c] + a_re[c]*b_im[c];
+        }
+      }
+    }
+}
+
+/*
+Calculate matrix product of a n1 x n2 complex matrix shared by all cells and
+a batch of n2 x n3 complex matrices. With n3 = 1 this is lib_matrProdMatVecCpx.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchProdSharedCpx(fftw_complex ** mat1, const lib_matrBatchCpx * mat2, lib_matrBatchCpx * outmat)
+{
+  int i, j, k, c;
+  int nb = outmat->nbatch;
+  for(i=0;i<outmat->n1;i++)
+    for(j=0;j<outmat->n2;j++)
+    {
+      float * x_re = outmat->re + ELEM(outmat,i,j);
+      float * x_im = outmat->im + ELEM(outmat,i,j);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        x_re[c] = 0.0;
+        x_im[c] = 0.0;
+      }
+      for(k=0;k<mat2->n1;k++)
+      {
+        float         a_re = mat1[i][k].re;
+        float         a_im = mat1[i][k].im;
+        const float * b_re = mat2->re + ELEM(mat2,k,j);
+        const float * b_im = mat2->im + ELEM(mat2,k,j);
+        LIB_MATR_BATCH_SIMD
+        for(c=0;c<nb;c++)
+        {
+          x_re[c] += a_re*b_re[c] - a_im*b_im[c];
+          x_im[c] += a_im*b_re[c] + a_re*b_im[c];
+        }
+      }
+    }
+}
+
+/*
+Calculate the product of a batch of n1 x n2 complex matrices and the adjoint
+of a n3 x n2 complex matrix shared by all cells, as lib_matrProdAdjointCpx.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchProdAdjointSharedCpx(const lib_matrBatchCpx * mat1, fftw_complex ** mat2, lib_matrBatchCpx * outmat)
+{
+  int i, j, k, c;
+  int nb = outmat->nbatch;
+  for(i=0;i<outmat->n1;i++)
+    for(j=0;j<outmat->n2;j++)
+    {
+      float * x_re = outmat->re + ELEM(outmat,i,j);
+      float * x_im = outmat->im + ELEM(outmat,i,j);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        x_re[c] = 0.0;
+        x_im[c] = 0.0;
+      }
+      for(k=0;k<mat1->n2;k++)
+      {
+        const float * a_re = mat1->re + ELEM(mat1,i,k);
+        const float * a_im = mat1->im + ELEM(mat1,i,k);
+        float         b_re = mat2[j][k].re;
+        float         b_im = mat2[j][k].im;
+        LIB_MATR_BATCH_SIMD
+        for(c=0;c<nb;c++)
+        {
+          x_re[c] += a_re[c]*b_re + a_im[c]*b_im;
+          x_im[c] += a_im[c]*b_re - a_re[c]*b_im;
+        }
+      }
+    }
+}
+
+/*
+Calculate the product of the adjoint of a n2 x n1 complex matrix and a n2 x 1
+complex vector for every cell, as lib_matrProdAdjointMatVecCpx.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchProdAdjointMatVecCpx(const lib_matrBatchCpx * mat, const lib_matrBatchCpx * vec, lib_matrBatchCpx * outvec)
+{
+  int i, j, c;
+  int nb = outvec->nbatch;
+  for(i=0;i<mat->n2;i++)
+  {
+    float * x_re = outvec->re + i*nb;
+    float * x_im = outvec->im + i*nb;
+    LIB_MATR_BATCH_SIMD
+    for(c=0;c<nb;c++)
+    {
+      x_re[c] = 0.0;
+      x_im[c] = 0.0;
+    }
+    for(j=0;j<mat->n1;j++)
+    {
+      const float * m_re = mat->re + ELEM(mat,j,i);
+      const float * m_im = mat->im + ELEM(mat,j,i);
+      const float * v_re = vec->re + j*nb;
+      const float * v_im = vec->im + j*nb;
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        x_re[c] += m_re[c]*v_re[c] + m_im[c]*v_im[c];
+        x_im[c] += -m_im[c]*v_re[c] + m_re[c]*v_im[c];
+      }
+    }
+  }
+}
+
+/*
+Addition and subtraction of two batches x and y. Result returned in y.
+Also used for vectors, which are batches of n1 x 1 matrices.
+*/
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchAddMatCpx(const lib_matrBatchCpx * x, lib_matrBatchCpx * y)
+{
+  int c;
+  int n = x->n1*x->n2*x->nbatch;
+  LIB_MATR_BATCH_SIMD
+  for(c=0;c<n;c++)
+  {
+    y->re[c] += x->re[c];
+    y->im[c] += x->im[c];
+  }
+}
+
+LIB_MATR_BATCH_CLONES
+void lib_matrBatchSubtMatCpx(const lib_matrBatchCpx * x, lib_matrBatchCpx * y)
+{
+  int c;
+  int n = x->n1*x->n2*x->nbatch;
+  LIB_MATR_BATCH_SIMD
+  for(c=0;c<n;c++)
+  {
+    y->re[c] -= x->re[c];
+    y->im[c] -= x->im[c];
+  }
+}
+
+/*
+Find the adjoint(=conjungate transpose) of every cell and return in outmat
+*/
+void lib_matrBatchAdjoint(const lib_matrBatchCpx * mat, lib_matrBatchCpx * outmat)
+{
+  int i, j, c;
+  int nb = mat->nbatch;
+  for(i = 0; i < mat->n1; i++)
+    for(j = 0; j < mat->n2; j++)
+    {
+      const float * m_re = mat->re + ELEM(mat,i,j);
+      const float * m_im = mat->im + ELEM(mat,i,j);
+      float       * o_re = outmat->re + ELEM(outmat,j,i);
+      float       * o_im = outmat->im + ELEM(outmat,j,i);
+      LIB_MATR_BATCH_SIMD
+      for(c=0;c<nb;c++)
+      {
+        o_re[c] = m_re[c];
+        o_im[c] = -m_im[c];
+      }
+    }
+}
@@ -0,0 +1,70 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef LIB_MATRBATCH_H
+#define LIB_MATRBATCH_H
+
+#include "fftw.h"
+
+/*
+Batched versions of the small complex matrix routines in lib_matr. A batch
+holds the same n1 x n2 matrix for nbatch independent cells, stored as
+structure of arrays: the real part of element (i,j) of cell c is
+
+   re[(i*n2 + j)*nbatch + c]
+
+and likewise for im. All loops run over the cells innermost, so they are
+vectorised across the batch. Each cell gets exactly the same sequence of
+floating point operations as the corresponding lib_matr routine, hence
+the results are identical to calling lib_matr cell by cell.
+
+Matrices shared by all cells (like the K = WDA matrix of a frequency
+plane) are given as ordinary fftw_complex ** arrays.
+*/
+
+typedef struct
+{
+  int     n1;      /* Number of rows                */
+  int     n2;      /* Number of columns             */
+  int     nbatch;  /* Number of cells in the batch  */
+  float * re;
+  float * im;
+  float * work;    /* nbatch floats of scratch      */
+} lib_matrBatchCpx;
+
+#define LIB_MATR_BATCH_INDEX(mat,i,j,c) (((i)*(mat)->n2 + (j))*(mat)->nbatch + (c))
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+  extern lib_matrBatchCpx * lib_matrBatchAllocCpx(int n1, int n2, int nbatch);
+  extern void lib_matrBatchFreeCpx(lib_matrBatchCpx * mat);
+
+  extern void lib_matrBatchSetCpx(lib_matrBatchCpx * mat, int c, fftw_complex ** value);
+  extern void lib_matrBatchGetCpx(const lib_matrBatchCpx * mat, int c, fftw_complex ** value);
+  extern void lib_matrBatchSetVecCpx(lib_matrBatchCpx * vec, int c, const fftw_complex * value);
+  extern void lib_matrBatchGetVecCpx(const lib_matrBatchCpx * vec, int c, fftw_complex * value);
+  extern void lib_matrBatchCopyCpx(const lib_matrBatchCpx * mat, lib_matrBatchCpx * outmat);
+
+  extern int  lib_matrBatchCholCpx(lib_matrBatchCpx * x_mat, int * flag);
+  extern void lib_matrBatchAXeqBMatCpx(const lib_matrBatchCpx * i_mat, lib_matrBatchCpx * x_mat);
+  extern void lib_matrBatchProdCholVec(const lib_matrBatchCpx * mat, lib_matrBatchCpx * vec);
+  extern void lib_matrBatchPackLowerCpx(const lib_matrBatchCpx * mat, const int * flag, float * re, float * im);
+  extern void lib_matrBatchProdPackedCholVec(const float * re, const float * im, lib_matrBatchCpx * vec);
+
+  extern void lib_matrBatchProdCpx(const lib_matrBatchCpx * mat1, const lib_matrBatchCpx * mat2, lib_matrBatchCpx * outmat);
+  extern void lib_matrBatchProdSharedCpx(fftw_complex ** mat1, const lib_matrBatchCpx * mat2, lib_matrBatchCpx * outmat);
+  extern void lib_matrBatchProdAdjointSharedCpx(const lib_matrBatchCpx * mat1, fftw_complex ** mat2, lib_matrBatchCpx * outmat);
+  extern void lib_matrBatchProdAdjointMatVecCpx(const lib_matrBatchCpx * mat, const lib_matrBatchCpx * vec, lib_matrBatchCpx * outvec);
+
+  extern void lib_matrBatchAddMatCpx(const lib_matrBatchCpx * x, lib_matrBatchCpx * y);
+  extern void lib_matrBatchSubtMatCpx(const lib_matrBatchCpx * x, lib_matrBatchCpx * y);
+  extern void lib_matrBatchAdjoint(const lib_matrBatchCpx * mat, lib_matrBatchCpx * outmat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,15 +4,26 @@
 
 #include <iostream>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "lib/timekit.hpp"
 
 void
 TimeKit::getTime(double& wall, double& cpu)
 {
+  // Use the OpenMP wall clock when available, as time() only has a resolution of seconds.
+#ifdef _OPENMP
+  double  tmpwall = omp_get_wtime();
+#else
   time_t  tmpwall = time(NULL);
+#endif
   clock_t tmpcpu  = clock();
 
+#ifndef _OPENMP
   if (tmpwall == static_cast<time_t>(-1))  std::cerr << "Unable to get time()\n";
+#endif
   if (tmpcpu  == static_cast<clock_t>(-1)) std::cerr << "Unable to get clock()\n";
 
   if (wall==0 && cpu==0)
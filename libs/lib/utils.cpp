@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <string.h>
+#include <map>
 
 #include "lib/utils.h"
 #include "src/definitions.h"
@@ -15,6 +16,10 @@
 
 #include "nrlib/iotools/logkit.hpp"
 
+typedef std::map<std::pair<int, int>, rfftwnd_plan> FFTPlanCache1D;
+
+static FFTPlanCache1D fftPlans1D; // 1D plans, keyed by (nt, direction)
+
 //------------------------------------------------------------
 void
 Utils::writeTitler(const std::string & text)
@@ -145,22 +150,80 @@ Utils::writeMatrix(double ** matrix,
 void
 Utils::fft(fftw_real* rAmp,fftw_complex* cAmp,int nt)
 {
-  rfftwnd_plan p1 = rfftwnd_create_plan(1, &nt, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
+  rfftwnd_plan p1 = getFFTPlan1D(nt, FFTW_REAL_TO_COMPLEX);
   rfftwnd_one_real_to_complex(p1, rAmp, cAmp);
-  fftwnd_destroy_plan(p1);
 }
 
 //------------------------------------------------------------
 void
 Utils::fftInv(fftw_complex* cAmp,fftw_real* rAmp,int nt)
 {
-  rfftwnd_plan p2 = rfftwnd_create_plan(1, &nt, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
+  rfftwnd_plan p2 = getFFTPlan1D(nt, FFTW_COMPLEX_TO_REAL);
   rfftwnd_one_complex_to_real(p2, cAmp, rAmp);
-  fftwnd_destroy_plan(p2);
   double sf = 1.0/double(nt);
   for(int i=0;i<nt;i++)
     rAmp[i]*=fftw_real(sf);
 }
+
+//------------------------------------------------------------
+void
+Utils::fft(fftw_real* rAmp,int nt,int nTraces)
+{
+  int rnt = 2*(nt/2+1);
+  rfftwnd_plan p1 = getFFTPlan1D(nt, FFTW_REAL_TO_COMPLEX);
+  rfftwnd_real_to_complex(p1, nTraces, rAmp, 1, rnt, NULL, 1, rnt/2);
+}
+
+//------------------------------------------------------------
+void
+Utils::fftInv(fftw_complex* cAmp,int nt,int nTraces)
+{
+  int cnt = nt/2+1;
+  rfftwnd_plan p2 = getFFTPlan1D(nt, FFTW_COMPLEX_TO_REAL);
+  rfftwnd_complex_to_real(p2, nTraces, cAmp, 1, cnt, NULL, 1, 2*cnt);
+  double      sf   = 1.0/double(nt);
+  fftw_real * rAmp = reinterpret_cast<fftw_real*>(cAmp);
+  for(int j=0;j<nTraces;j++) {
+    for(int i=0;i<nt;i++)
+      rAmp[i] = static_cast<fftw_real>(rAmp[i]*sf);
+    rAmp += 2*cnt;
+  }
+}
+
+//------------------------------------------------------------
+rfftwnd_plan
+Utils::getFFTPlan1D(int nt, fftw_direction dir)
+{
+  //
+  // FFTW plan creation is not thread safe, so plans are made in the same
+  // critical section as the plans of FFTGrid.
+  //
+  rfftwnd_plan plan;
+#ifdef _OPENMP
+#pragma omp critical(fftgrid_plan_cache)
+#endif
+  {
+    std::pair<int, int> key(nt, static_cast<int>(dir));
+    FFTPlanCache1D::iterator it = fftPlans1D.find(key);
+    if(it == fftPlans1D.end()) {
+      plan = rfftwnd_create_plan(1, &nt, dir, FFTW_ESTIMATE | FFTW_IN_PLACE | FFTW_THREADSAFE);
+      fftPlans1D[key] = plan;
+    }
+    else
+      plan = it->second;
+  }
+  return(plan);
+}
+
+//------------------------------------------------------------
+void
+Utils::clearFFTPlanCache1D()
+{
+  for(FFTPlanCache1D::iterator it = fftPlans1D.begin(); it != fftPlans1D.end(); it++)
+    rfftwnd_destroy_plan(it->second);
+  fftPlans1D.clear();
+}
+
 //-----------------------------------------------------------
 int
 Utils::findEnd(std::string & seek, int start, std::string & find)
@@ -8,7 +8,7 @@
 
 #include "src/definitions.h"
 #include "nrlib/iotools/logkit.hpp"
-#include "fftw.h"
+#include "rfftw.h"
 
 
 class Utils
@@ -53,6 +53,24 @@ public:
                         fftw_real    * rAmp,
                         int            nt);
 
+  // Batched versions of fft and fftInv. The nTraces traces are stored one after
+  // another, each trace taking 2*(nt/2+1) reals, and are transformed in place
+  // with one call using a single plan.
+  static void    fft(fftw_real    * rAmp,
+                     int            nt,
+                     int            nTraces);
+
+  static void    fftInv(fftw_complex * cAmp,
+                        int            nt,
+                        int            nTraces);
+
+  // In place 1D plans of length nt, kept in a cache shared by all threads. The
+  // plans are thread safe, so a plan may be used by several threads at once.
+  static rfftwnd_plan getFFTPlan1D(int            nt,
+                                   fftw_direction dir);
+
+  static void    clearFFTPlanCache1D();
+
   static  void   readUntilStop(int           pos,
                                std::string & in,
                                std::string & out,
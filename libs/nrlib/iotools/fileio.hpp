@@ -352,6 +352,14 @@ bool IgnoreComment(std::ifstream& file,
   /// Parse IEEE double-precision float from big-endian buffer.
   inline void ParseIBMFloatBE(const char* buffer, float& f);
 
+  /// Parse n IEEE single-precision floats from big-endian buffer.
+  inline void ParseIEEEFloatArrayBE(const char* buffer, float* f, size_t n);
+
+  /// Parse n IBM single-precision floats from big-endian buffer.
+  /// Gives the same values as ParseIBMFloatBE, but without table lookups
+  /// so that the compiler can vectorise the loop.
+  inline void ParseIBMFloatArrayBE(const char* buffer, float* f, size_t n);
+
 namespace NRLibPrivate {
   /// \todo Use stdint.h if available.
   // typedef unsigned int uint32_t;
@@ -1006,6 +1014,18 @@ void NRLib::ParseIEEEFloatBE(const char* buffer, float& f)
   f = tmp.f;
 }
 
+// Big endian number representation.
+void NRLib::ParseIEEEFloatArrayBE(const char* buffer, float* f, size_t n)
+{
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(buffer);
+  for (size_t i = 0; i < n; ++i) {
+    NRLibPrivate::FloatAsInt tmp;
+    tmp.ui = (static_cast<unsigned int>(b[4*i]) << 24) | (static_cast<unsigned int>(b[4*i+1]) << 16)
+           | (static_cast<unsigned int>(b[4*i+2]) << 8) | static_cast<unsigned int>(b[4*i+3]);
+    f[i]   = tmp.f;
+  }
+}
+
 // Little endian number representation.
 void NRLib::NRLibPrivate::ParseIEEEFloatLE(const char* buffer, float& f)
 {
@@ -1158,6 +1178,29 @@ void NRLib::ParseIBMFloatBE(const char* buffer, float& f)
 }
 
 
+// Big endian number representation.
+void NRLib::ParseIBMFloatArrayBE(const char* buffer, float* f, size_t n)
+{
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(buffer);
+  for (size_t i = 0; i < n; ++i) {
+    NRLibPrivate::FloatAsInt tmp;
+    tmp.ui = (static_cast<unsigned int>(b[4*i]) << 24) | (static_cast<unsigned int>(b[4*i+1]) << 16)
+           | (static_cast<unsigned int>(b[4*i+2]) << 8) | static_cast<unsigned int>(b[4*i+3]);
+
+    // As Ibm2Ieee, where mt[ix] = 1 << s and it[ix] = 0x20c00000 + (s << 22).
+    unsigned int manthi = tmp.ui & 0x00ffffff;
+    unsigned int ix     = manthi >> 21;
+    unsigned int s      = (ix < 1) + (ix < 2) + (ix < 4);
+    unsigned int iexp   = ( ( tmp.ui & 0x7f000000 ) - ( 0x20c00000 + (s << 22) ) ) << 1;
+    unsigned int inabs  = tmp.ui & 0x7fffffff;
+    manthi = (manthi << s) + iexp;
+    manthi = ( inabs > IEMAXIB ? IEEEMAX : manthi ) | ( tmp.ui & 0x80000000 );
+    tmp.ui = ( inabs < IEMINIB ) ? 0 : manthi;
+    f[i]   = tmp.f;
+  }
+}
+
+
 // Little endian number representation.
 void NRLib::NRLibPrivate::ParseIBMFloatLE(const char* buffer, float& f)
 {
@@ -124,22 +124,36 @@ LogKit::SetScreenLog(const std::vector<int> & levels, bool ignore_general) {
 
 void
 LogKit::LogMessage(int level, const std::string & message) {
-  unsigned int i;
-  n_messages_[level]++;
-  std::string new_message = prefix_[level] + message;
-  for (i=0;i<logstreams_.size();i++)
-    logstreams_[i]->LogMessage(level, new_message);
-  SendToBuffer(level,-1,new_message);
+  // Messages may come from several threads, e.g. when output is written
+  // while other threads compute.
+#ifdef _OPENMP
+#pragma omp critical(nrlib_logkit)
+#endif
+  {
+    unsigned int i;
+    n_messages_[level]++;
+    std::string new_message = prefix_[level] + message;
+    for (i=0;i<logstreams_.size();i++)
+      logstreams_[i]->LogMessage(level, new_message);
+    SendToBuffer(level,-1,new_message);
+  }
 }
 
 void
 LogKit::LogMessage(int level, int phase, const std::string & message) {
-  unsigned int i;
-  n_messages_[level]++;
-  std::string new_message = prefix_[level] + message;
-  for (i=0;i<logstreams_.size();i++)
-    logstreams_[i]->LogMessage(level, phase, new_message);
-  SendToBuffer(level,phase,new_message);
+  // Messages may come from several threads, e.g. when output is written
+  // while other threads compute.
+#ifdef _OPENMP
+#pragma omp critical(nrlib_logkit)
+#endif
+  {
+    unsigned int i;
+    n_messages_[level]++;
+    std::string new_message = prefix_[level] + message;
+    for (i=0;i<logstreams_.size();i++)
+      logstreams_[i]->LogMessage(level, phase, new_message);
+    SendToBuffer(level,phase,new_message);
+  }
 }
 
 void
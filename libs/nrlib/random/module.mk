@@ -6,6 +6,7 @@ SRC +=	$(NRLIB_BASE_DIR)random/binomial.cpp  \
 	$(NRLIB_BASE_DIR)random/normal.cpp \
 	$(NRLIB_BASE_DIR)random/delta.cpp \
 	$(NRLIB_BASE_DIR)random/random.cpp \
+	$(NRLIB_BASE_DIR)random/randomgenerator.cpp \
 	$(NRLIB_BASE_DIR)random/triangular.cpp \
 	$(NRLIB_BASE_DIR)random/uniform.cpp \
 	$(NRLIB_BASE_DIR)random/beta.cpp \
@@ -2,4 +2,5 @@ SRC += $(NRLIB_BASE_DIR)segy/commonheaders.cpp \
        $(NRLIB_BASE_DIR)segy/segy.cpp \
        $(NRLIB_BASE_DIR)segy/traceheader.cpp \
        $(NRLIB_BASE_DIR)segy/segytrace.cpp \
-       $(NRLIB_BASE_DIR)segy/segygeometry.cpp
+       $(NRLIB_BASE_DIR)segy/segygeometry.cpp \
+       $(NRLIB_BASE_DIR)segy/segytraceindex.cpp
@@ -35,6 +35,7 @@
 #include <map>
 
 #include "segy.hpp"
+#include "segytraceindex.hpp"
 #include "commonheaders.hpp"
 #include "traceheader.hpp"
 
@@ -49,6 +50,8 @@ const float segyRMISSING = -99999.000;
 
 using namespace NRLib;
 
+bool SegY::use_trace_index_ = false;
+
 
 SegY::SegY(const std::string       & fileName,
            float                     z0,
@@ -523,14 +526,82 @@ SegY::ReadAllTraces(const Volume * volume,
   single_trace_ = false;
   traces_.resize(n_traces_);
 
+  SegYTraceIndex index;
+  bool useIndex  = (use_trace_index_ && ReadIndex(index));
+  bool makeIndex = (use_trace_index_ && !useIndex);
+
   LogKit::LogMessage(LogKit::Low,"\nReading SEGY file " );
   LogKit::LogMessage(LogKit::Low, file_name_);
 
+  double outsideTopMax[6]; //Largest lack of data top
+  double outsideBotMax[6]; //Largest lack of data bot
+
+  LogKit::LogMessage(LogKit::Low,"\n  0%        20%      40%       60%       80%       100%");
+  LogKit::LogMessage(LogKit::Low,"\n  |    |    |    |    |    |    |    |    |    |    |  ");
+  LogKit::LogMessage(LogKit::Low,"\n  ^");
+
+  if (useIndex) {
+    ReadAllTracesFromIndex(index,
+                           volume,
+                           zPad,
+                           onlyVolume,
+                           relative_padding,
+                           outsideTopMax,
+                           outsideBotMax);
+  }
+  else {
+    bool blocksRead = ReadAllTracesInBlocks(volume,
+                                            zPad,
+                                            onlyVolume,
+                                            relative_padding,
+                                            outsideTopMax,
+                                            outsideBotMax,
+                                            (makeIndex ? &index : NULL));
+    if (blocksRead == false) {
+      makeIndex = false;
+      ReadAllTracesSequentially(volume,
+                                zPad,
+                                onlyVolume,
+                                relative_padding,
+                                outsideTopMax,
+                                outsideBotMax);
+    }
+  }
+
+  LogKit::LogMessage(LogKit::Low,"^\n");
+
+  if (useIndex)
+    LogKit::LogMessage(LogKit::Medium,"  Trace positions taken from index " + SegYTraceIndex::FileName(file_name_) + "\n");
+  if (makeIndex)
+    WriteIndex(index);
+
+  CheckTopBotError(outsideTopMax, outsideBotMax); //Throws exception if > 0.
+
+  int count = 0;
+  for (unsigned int i=1 ; i<traces_.size() ; i++)
+    if (traces_[i] != NULL)
+      count++;
+  if (count == 0)
+  {
+    std::string text;
+    text += " No valid traces found. The specified time surfaces do not cover any part of the\n";
+    text += " seismic data. The reason can be that you have given an incorrect SEGY trace header\n";
+    text += " format, or that you need to bypass the coordinate scaling.";
+    throw Exception(text);
+  }
+}
+
+void
+SegY::ReadAllTracesSequentially(const Volume * volume,
+                                double         zPad,
+                                bool           onlyVolume,
+                                bool           relative_padding,
+                                double       * outsideTopMax,
+                                double       * outsideBotMax)
+{
   bool outsideSurface = false;
   bool duplicateHeader; // Needed for memory allocations.
   double outsideTopBot[6];
-  double outsideTopMax[6]; //Largest lack of data top
-  double outsideBotMax[6]; //Largest lack of data bot
 
   traces_[0] = ReadTrace(volume,
                          zPad,
@@ -547,9 +618,6 @@ SegY::ReadAllTraces(const Volume * volume,
   }
   double writeInterval = 0.02;
   double nextWrite = writeInterval;
-  LogKit::LogMessage(LogKit::Low,"\n  0%        20%      40%       60%       80%       100%");
-  LogKit::LogMessage(LogKit::Low,"\n  |    |    |    |    |    |    |    |    |    |    |  ");
-  LogKit::LogMessage(LogKit::Low,"\n  ^");
   size_t traceSize = datasize_ * nz_ + 240;
   size_t fSize = 3600 + n_traces_ * traceSize;
   long long bytesRead = 3600+traceSize;
@@ -587,7 +655,6 @@ SegY::ReadAllTraces(const Volume * volume,
     if (duplicateHeader)
       bytesRead += 3600;
   }
-  LogKit::LogMessage(LogKit::Low,"^\n");
   n_traces_ = traces_.size();
 
   if (outsideTopBot[0] > outsideTopMax[0])
@@ -596,20 +663,396 @@ SegY::ReadAllTraces(const Volume * volume,
   if (outsideTopBot[1] > outsideBotMax[1])
     for (k=0;k<6;k++)
       outsideBotMax[k] = outsideTopBot[k];
+}
 
-  CheckTopBotError(outsideTopMax, outsideBotMax); //Throws exception if > 0.
+bool
+SegY::ReadAllTracesInBlocks(const Volume * volume,
+                            double         zPad,
+                            bool           onlyVolume,
+                            bool           relative_padding,
+                            double       * outsideTopMax,
+                            double       * outsideBotMax,
+                            SegYTraceIndex * index)
+{
+  //
+  // Reads many traces with one large read, and then parses the headers and
+  // decodes the samples of these traces in parallel. The samples of each
+  // block are stored in a vector of their own in trace_store_, so that the
+  // samples already read are never copied. The traces are handled exactly as
+  // in ReadTrace().
+  //
+  // If an index is given, all samples of all traces are decoded to find
+  // the smallest and largest value of each trace for the index.
+  //
+  // This requires a file that holds nothing but traces after the file header.
+  // If not, or if a repeated file header is found, nothing is read and false
+  // is returned, and the traces must be read one by one.
+  //
+  int                format    = binary_header_->GetFormat();
+  size_t             traceSize = datasize_*nz_ + 240;
+  unsigned long long fSize     = FindFileSize(file_name_);
 
-  int count = 0;
-  for (unsigned int i=1 ; i<traces_.size() ; i++)
-    if (traces_[i] != NULL)
-      count++;
-  if (count == 0)
+  if (n_traces_ == 0 || fSize != 3600 + n_traces_*static_cast<unsigned long long>(traceSize))
+    return(false);
+  if (format != 1 && format != 2 && format != 3 && format != 5)
+    return(false);
+  if (file_.tellg() != std::streampos(3600))
+    return(false);
+
+  const size_t blockSize      = 64*1024*1024;
+  size_t       tracesPerBlock = std::min(n_traces_, std::max(static_cast<size_t>(1), blockSize/traceSize));
+
+  std::vector<char>        buffer(tracesPerBlock*traceSize);
+  std::vector<TraceHeader> headers(tracesPerBlock, TraceHeader(trace_header_format_));
+  std::vector<double>      outsideTopBot(6*tracesPerBlock);
+  std::vector<size_t>      j0(tracesPerBlock);
+  std::vector<size_t>      j1(tracesPerBlock);
+  std::vector<size_t>      offset(tracesPerBlock);
+  std::vector<int>         status(tracesPerBlock);     // 0 = read, 1 = not read, 2 = error
+  std::vector<std::string> errors(tracesPerBlock);
+
+  trace_store_.clear();
+  if (index != NULL)
+    index->Resize(n_traces_);
+
+  double writeInterval = 0.02;
+  double nextWrite     = writeInterval;
+  int    lino          = binary_header_->GetLino();
+
+  for (size_t first = 0 ; first < n_traces_ ; first += tracesPerBlock)
   {
-    std::string text;
-    text += " No valid traces found. The specified time surfaces do not cover any part of the\n";
-    text += " seismic data. The reason can be that you have given an incorrect SEGY trace header\n";
-    text += " format, or that you need to bypass the coordinate scaling.";
-    throw Exception(text);
+    int nBlock = static_cast<int>(std::min(tracesPerBlock, n_traces_ - first));
+    if (!file_.read(&buffer[0], static_cast<std::streamsize>(nBlock*traceSize)))
+      throw Exception("Error reading traces "+ToString(first)+" to "+ToString(first+nBlock-1)+" of SegY file "+file_name_+".\n");
+
+    int nEbcdic = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:nEbcdic)
+#endif
+    for (int i = 0 ; i < nBlock ; i++) {
+      const char * header = &buffer[i*traceSize];
+      if (TraceHeader::IsEbcdicHeader(header))
+        nEbcdic++;
+      else
+        headers[i].Parse(header, lino);
+    }
+
+    if (nEbcdic > 0) {
+      for (size_t i = 0 ; i < first ; i++) {
+        delete traces_[i];
+        traces_[i] = NULL;
+      }
+      trace_store_.clear();
+      file_.clear();
+      file_.seekg(3600);
+      return(false);
+    }
+
+    for (int i = 0 ; i < nBlock ; i++)
+      CheckSampleInterval(headers[i]);
+    if (first == 0)
+      headers[0].WriteValues();
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+    for (int i = 0 ; i < nBlock ; i++) {
+      double * tracePos = &outsideTopBot[6*i];
+      for (int k = 0 ; k < 6 ; k++)
+        tracePos[k] = 0.0;
+      bool outsideSurface = false;
+      try {
+        float x, y;
+        FindTraceXY(headers[i].GetUtmx(), headers[i].GetUtmy(), headers[i].GetInline(), headers[i].GetCrossline(), x, y);
+        bool read = FindTraceRange(volume, zPad, onlyVolume, outsideSurface, tracePos,
+                                   relative_padding, x, y, j0[i], j1[i]);
+        status[i] = (read ? 0 : 1);
+      }
+      catch (NRLib::Exception & e) {
+        status[i] = 2;
+        errors[i] = e.what();
+      }
+    }
+
+    size_t storeSize = 0;
+    for (int i = 0 ; i < nBlock ; i++) {
+      if (status[i] == 2)
+        throw Exception(errors[i]);
+
+      const double * tracePos = &outsideTopBot[6*i];
+      if (first + i == 0) {
+        for (int k = 0 ; k < 6 ; k++) {
+          outsideTopMax[k] = tracePos[k];
+          outsideBotMax[k] = tracePos[k];
+        }
+      }
+      if (tracePos[0] > outsideTopMax[0])
+        for (int k = 0 ; k < 6 ; k++)
+          outsideTopMax[k] = tracePos[k];
+      if (tracePos[1] > outsideBotMax[1])
+        for (int k = 0 ; k < 6 ; k++)
+          outsideBotMax[k] = tracePos[k];
+
+      if (status[i] == 0) {
+        offset[i]  = storeSize;
+        storeSize += j1[i] - j0[i] + 1;
+      }
+    }
+    trace_store_.push_back(std::vector<float>(storeSize));
+    std::vector<float> & store = trace_store_.back();
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<float> samples(index != NULL ? nz_ : 0);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+      for (int i = 0 ; i < nBlock ; i++) {
+        const char * data = &buffer[i*traceSize + 240];
+        if (index != NULL) {
+          DecodeSamples(data, &samples[0], nz_);
+          float minValue = *std::min_element(samples.begin(), samples.end());
+          float maxValue = *std::max_element(samples.begin(), samples.end());
+          index->SetTrace(first + i, 3600 + (first + i)*static_cast<unsigned long long>(traceSize),
+                          headers[i].GetUtmx(), headers[i].GetUtmy(), headers[i].GetInline(), headers[i].GetCrossline(),
+                          minValue, maxValue);
+          if (status[i] == 0)
+            std::copy(samples.begin() + j0[i], samples.begin() + j1[i] + 1, store.begin() + offset[i]);
+        }
+        else if (status[i] == 0) {
+          DecodeSamples(data + datasize_*j0[i], &store[offset[i]], j1[i] - j0[i] + 1);
+        }
+      }
+    }
+
+    for (int i = 0 ; i < nBlock ; i++) {
+      if (status[i] == 0)
+        traces_[first + i] = new SegYTrace(store, offset[i], j0[i], j1[i], headers[i]);
+      else
+        traces_[first + i] = NULL;
+    }
+
+    double percentDone = (3600.0 + (first + nBlock)*static_cast<double>(traceSize))/static_cast<double>(fSize);
+    while (percentDone > nextWrite) {
+      LogKit::LogMessage(LogKit::Low,"^");
+      nextWrite += writeInterval;
+    }
+  }
+  if (index != NULL)
+    index->SetDz(dz_);
+  return(true);
+}
+
+void
+SegY::ReadAllTracesFromIndex(const SegYTraceIndex & index,
+                             const Volume         * volume,
+                             double                 zPad,
+                             bool                   onlyVolume,
+                             bool                   relative_padding,
+                             double               * outsideTopMax,
+                             double               * outsideBotMax)
+{
+  //
+  // The trace headers are not read. The index gives the position of each
+  // trace, so we only read the samples needed for the traces inside the
+  // volume. Traces where all samples have the same value are not read at all.
+  //
+  dz_ = index.GetDz();
+
+  size_t nTraces = index.GetNTraces();
+
+  std::vector<double>      outsideTopBot(6*nTraces);
+  std::vector<float>       x(nTraces);
+  std::vector<float>       y(nTraces);
+  std::vector<size_t>      j0(nTraces);
+  std::vector<size_t>      j1(nTraces);
+  std::vector<size_t>      offset(nTraces);
+  std::vector<int>         status(nTraces);     // 0 = read, 1 = not read, 2 = error
+  std::vector<std::string> errors(nTraces);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,256)
+#endif
+  for (int i = 0 ; i < static_cast<int>(nTraces) ; i++) {
+    double * tracePos = &outsideTopBot[6*i];
+    for (int k = 0 ; k < 6 ; k++)
+      tracePos[k] = 0.0;
+    bool outsideSurface = false;
+    try {
+      FindTraceXY(index.GetUtmx(i), index.GetUtmy(i), index.GetInline(i), index.GetCrossline(i), x[i], y[i]);
+      bool read = FindTraceRange(volume, zPad, onlyVolume, outsideSurface, tracePos,
+                                 relative_padding, x[i], y[i], j0[i], j1[i]);
+      status[i] = (read ? 0 : 1);
+    }
+    catch (NRLib::Exception & e) {
+      status[i] = 2;
+      errors[i] = e.what();
+    }
+  }
+
+  size_t storeSize = 0;
+  for (size_t i = 0 ; i < nTraces ; i++) {
+    if (status[i] == 2)
+      throw Exception(errors[i]);
+
+    const double * tracePos = &outsideTopBot[6*i];
+    if (i == 0) {
+      for (int k = 0 ; k < 6 ; k++) {
+        outsideTopMax[k] = tracePos[k];
+        outsideBotMax[k] = tracePos[k];
+      }
+    }
+    if (tracePos[0] > outsideTopMax[0])
+      for (int k = 0 ; k < 6 ; k++)
+        outsideTopMax[k] = tracePos[k];
+    if (tracePos[1] > outsideBotMax[1])
+      for (int k = 0 ; k < 6 ; k++)
+        outsideBotMax[k] = tracePos[k];
+
+    if (status[i] == 0) {
+      offset[i]  = storeSize;
+      storeSize += j1[i] - j0[i] + 1;
+    }
+  }
+  trace_store_.clear();
+  trace_store_.push_back(std::vector<float>(storeSize));
+  std::vector<float> & store = trace_store_.back();
+
+  const size_t        blockSize     = 64*1024*1024;
+  double              writeInterval = 0.02;
+  double              nextWrite     = writeInterval;
+  std::vector<char>   buffer;
+  std::vector<size_t> blockTraces;
+  std::vector<size_t> bufferPos;
+
+  size_t next = 0;
+  while (next < nTraces)
+  {
+    blockTraces.clear();
+    bufferPos.clear();
+    size_t bufferSize = 0;
+    for ( ; next < nTraces && bufferSize < blockSize ; next++) {
+      if (status[next] == 0) {
+        if (index.IsConstant(next)) {
+          std::fill(store.begin() + offset[next],
+                    store.begin() + offset[next] + j1[next] - j0[next] + 1,
+                    index.GetMinValue(next));
+        }
+        else {
+          blockTraces.push_back(next);
+          bufferPos.push_back(bufferSize);
+          bufferSize += datasize_*(j1[next] - j0[next] + 1);
+        }
+      }
+    }
+
+    buffer.resize(bufferSize);
+    for (size_t k = 0 ; k < blockTraces.size() ; k++) {
+      size_t             i     = blockTraces[k];
+      unsigned long long start = index.GetFilePos(i) + 240 + datasize_*j0[i];
+      file_.seekg(static_cast<std::streamoff>(start), std::ios_base::beg);
+      if (!file_.read(&buffer[bufferPos[k]], static_cast<std::streamsize>(datasize_*(j1[i] - j0[i] + 1))))
+        throw Exception("Error reading trace "+ToString(i)+" of SegY file "+file_name_+". The trace index "
+                        +SegYTraceIndex::FileName(file_name_)+" may be invalid, and should be deleted.\n");
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+    for (int k = 0 ; k < static_cast<int>(blockTraces.size()) ; k++) {
+      size_t i = blockTraces[k];
+      DecodeSamples(&buffer[bufferPos[k]], &store[offset[i]], j1[i] - j0[i] + 1);
+    }
+
+    double percentDone = next/static_cast<double>(nTraces);
+    while (percentDone > nextWrite) {
+      LogKit::LogMessage(LogKit::Low,"^");
+      nextWrite += writeInterval;
+    }
+  }
+
+  for (size_t i = 0 ; i < nTraces ; i++) {
+    if (status[i] == 0)
+      traces_[i] = new SegYTrace(&store, offset[i], j0[i], j1[i],
+                                 index.GetUtmx(i), index.GetUtmy(i), index.GetInline(i), index.GetCrossline(i),
+                                 x[i], y[i]);
+    else
+      traces_[i] = NULL;
+  }
+}
+
+bool
+SegY::ReadIndex(SegYTraceIndex & index) const
+{
+  if (index.Read(file_name_, trace_header_format_, binary_header_->GetFormat(), nz_) == false)
+    return(false);
+  return(index.GetNTraces() == n_traces_);
+}
+
+void
+SegY::WriteIndex(const SegYTraceIndex & index) const
+{
+  try {
+    index.Write(file_name_, trace_header_format_, binary_header_->GetFormat(), nz_);
+    LogKit::LogMessage(LogKit::Medium,"  Trace index written to " + SegYTraceIndex::FileName(file_name_) + "\n");
+  }
+  catch (NRLib::Exception & e) {
+    LogKit::LogMessage(LogKit::Medium,"  Trace index not written: " + std::string(e.what()) + "\n");
+  }
+}
+
+void
+SegY::DecodeSamples(const char * buffer,
+                    float      * samples,
+                    size_t       n) const
+{
+  switch(binary_header_->GetFormat()) {
+    case 1:
+      ParseIBMFloatArrayBE(buffer, samples, n);
+      break;
+    case 2:
+      for (size_t j = 0 ; j < n ; j++) {
+        int value;
+        ParseInt32BE(&buffer[4*j], value);
+        samples[j] = static_cast<float>(value);
+      }
+      break;
+    case 3:
+      for (size_t j = 0 ; j < n ; j++) {
+        short value;
+        ParseInt16BE(&buffer[2*j], value);
+        samples[j] = static_cast<float>(value);
+      }
+      break;
+    case 5:
+      ParseIEEEFloatArrayBE(buffer, samples, n);
+      break;
+    default:
+      assert(0); //We should catch this much earlier.
+  }
+}
+
+void
+SegY::FindTraceXY(float   utmx,
+                  float   utmy,
+                  int     inLine,
+                  int     crossLine,
+                  float & x,
+                  float & y) const
+{
+  if (trace_header_format_.GetCoordSys() == TraceHeaderFormat::UTM) {
+    x = utmx;
+    y = utmy;
+  }
+  else if (trace_header_format_.GetCoordSys() == TraceHeaderFormat::ILXL) {
+    x = static_cast<float>(inLine);
+    y = static_cast<float>(crossLine);
+  }
+  else {
+   throw Exception("Invalid coordinate system number ("
+                   +ToString(trace_header_format_.GetCoordSys())+")");
   }
 }
 
@@ -651,42 +1094,67 @@ SegY::ReadTrace(const Volume * volume,
   if (writevalues == 1)
     traceHeader.WriteValues();
 
-  if (outsideTopBot != NULL) {
-    outsideTopBot[0] = 0; // > 0 indicates top error
-    outsideTopBot[1] = 0; // > 0 indicates bot error
-  }
   float x, y;
-  if (trace_header_format_.GetCoordSys() == TraceHeaderFormat::UTM) {
-    x = traceHeader.GetUtmx();
-    y = traceHeader.GetUtmy();
+  FindTraceXY(traceHeader.GetUtmx(), traceHeader.GetUtmy(), traceHeader.GetInline(), traceHeader.GetCrossline(), x, y);
+
+  size_t j0, j1;
+  bool   read = FindTraceRange(volume,
+                               zPad,
+                               onlyVolume,
+                               outsideSurface,
+                               outsideTopBot,
+                               relative_padding,
+                               x,
+                               y,
+                               j0,
+                               j1);
+  if (read == false) {
+    ReadDummyTrace(file_,binary_header_->GetFormat(),nz_);
+    return(NULL);
   }
-  else if (trace_header_format_.GetCoordSys() == TraceHeaderFormat::ILXL) {
-    x = static_cast<float>(traceHeader.GetInline());
-    y = static_cast<float>(traceHeader.GetCrossline());
+
+  SegYTrace * trace = NULL;
+  if (file_.eof() == false)
+  {
+    // Copy elements from j0 til j1.
+    trace = new SegYTrace(file_, j0, j1,
+                          binary_header_->GetFormat(), nz_,
+                          &traceHeader);
   }
-  else {
-   throw Exception("Invalid coordinate system number ("
-                   +ToString(trace_header_format_.GetCoordSys())+")");
+  return trace;
+}
+
+bool
+SegY::FindTraceRange(const Volume      * volume,
+                     double              zPad,
+                     bool                onlyVolume,
+                     bool              & outsideSurface,
+                     double            * outsideTopBot,
+                     bool                relative_padding,
+                     float               x,
+                     float               y,
+                     size_t            & j0,
+                     size_t            & j1) const
+{
+  if (outsideTopBot != NULL) {
+    outsideTopBot[0] = 0; // > 0 indicates top error
+    outsideTopBot[1] = 0; // > 0 indicates bot error
   }
 
-  size_t j0 = 0;
-  size_t j1 = nz_-1;
+  j0 = 0;
+  j1 = nz_-1;
   float zTop, zBot;
   if (volume != NULL)
   {
     if (onlyVolume && !volume->IsInside(x,y))
-    {
-      ReadDummyTrace(file_,binary_header_->GetFormat(),nz_);
-      return(NULL);
-    }
+      return(false);
 
     try {
       zTop = static_cast<float>(volume->GetTopSurface().GetZ(x,y));
     }
     catch (NRLib::Exception & ) {
       outsideSurface = true;
-      ReadDummyTrace(file_,binary_header_->GetFormat(),nz_);
-      return(NULL);
+      return(false);
     }
 
     try {
@@ -694,14 +1162,12 @@ SegY::ReadTrace(const Volume * volume,
     }
     catch (NRLib::Exception & ) {
       outsideSurface = true;
-      ReadDummyTrace(file_,binary_header_->GetFormat(),nz_);
-      return(NULL);
+      return(false);
     }
 
     if (volume->GetTopSurface().IsMissing(zTop) || volume->GetBotSurface().IsMissing(zBot))
     {
-      ReadDummyTrace(file_,binary_header_->GetFormat(),nz_);
-      return(NULL);
+      return(false);
     }
   }
   else {
@@ -743,8 +1209,7 @@ SegY::ReadTrace(const Volume * volume,
     }
   }
   if (outsideTopBot != NULL && (outsideTopBot[0] > 0.0 || outsideTopBot[1] > 0.0)) {
-    ReadDummyTrace(file_,binary_header_->GetFormat(),nz_);
-    return(NULL);
+    return(false);
   }
 
   float pad;
@@ -766,15 +1231,7 @@ SegY::ReadTrace(const Volume * volume,
   if (j0 > j1)
     throw Exception(" Lower horizon above SegY region or upper horizon below SegY region");
 
-  SegYTrace * trace = NULL;
-  if (file_.eof() == false)
-  {
-    // Copy elements from j0 til j1.
-    trace = new SegYTrace(file_, j0, j1,
-                          binary_header_->GetFormat(), nz_,
-                          &traceHeader);
-  }
-  return trace;
+  return(true);
 }
 
 bool
@@ -792,6 +1249,13 @@ SegY::ReadHeader(TraceHeader & header)
     duplicateHeader = false;
     break;
   }
+  CheckSampleInterval(header);
+  return duplicateHeader;
+}
+
+void
+SegY::CheckSampleInterval(TraceHeader & header)
+{
   if (header.GetDt()/1000 != dz_) {
     if(dz_ == 0)
       dz_ = static_cast<float>(header.GetDt()/1000.0);
@@ -804,7 +1268,6 @@ SegY::ReadHeader(TraceHeader & header)
       throw(Exception(error));
     }
   }
-  return duplicateHeader;
 }
 
 void
@@ -875,7 +1338,8 @@ SegY::GetNearestTrace(std::vector<float> & trace_data,
   size_t i = geometry_->FindIndex(x, y);
 
   if (traces_[i] != NULL) {
-    trace_data = traces_[i]->GetTrace();
+    const float * data = traces_[i]->GetData();
+    trace_data.assign(data, data + traces_[i]->GetEnd() - traces_[i]->GetStart() + 1);
     // NBNB: The 0.5f below is a shift we have introduced when reading
     // in seismic data to get data values in centre of grid cells rather
     // than on their borders. This choice and its implications need to
@@ -1301,6 +1765,10 @@ SegY::FindNumberOfTraces(void)
   n_traces_ = static_cast<size_t>(ceil( (static_cast<double>(fSize)-3600.0)/
                                         static_cast<double>(datasize_*nz_+240.0)));
 
+  SegYTraceIndex index;
+  if (use_trace_index_ && ReadIndex(index))
+    return(index.GetNTraces());
+
   TraceHeader traceHeader(trace_header_format_);
   ReadHeader(traceHeader);
 
@@ -1364,35 +1832,81 @@ SegY::FindGridGeometry(bool only_ilxl, bool keep_header)
   if(file_.tellg() != static_cast<std::streampos>(3600))
     throw(Exception("Can not find SegY geometry for a file where traces have already been read.\n"));
 
-  TraceHeader traceHeader(trace_header_format_);
-
-  std::streampos pos  = 3840;
-  std::streampos step = static_cast<std::streampos>(nz_*datasize_+240);
-
   size_t i;
   traces_.resize(n_traces_);
-  char * buffer = new char[nz_*datasize_];
-  for (i = 0; i < n_traces_; i++)
-  {
-    try {
-      if (file_.eof()==false)
-      {
-        bool extra_header = ReadHeader(traceHeader);
-        traces_[i] = new SegYTrace(traceHeader,keep_header);
-        file_.read(buffer, static_cast<std::streamsize>(nz_*datasize_));
-        if(only_ilxl == true)
-          traces_[i]->RemoveXY();
-        traces_[i]->SetFilePos(pos);
-        pos += step;
-        if(extra_header == true)
-          pos += 3600;
+
+  //
+  // Without trace headers to keep, the traces can be taken from the index.
+  //
+  SegYTraceIndex index;
+  bool haveIndex = (use_trace_index_ && ReadIndex(index));
+  bool useIndex  = (haveIndex && keep_header == false);
+  bool makeIndex = (use_trace_index_ && haveIndex == false);
+
+  if (useIndex) {
+    dz_ = index.GetDz();
+    for (i = 0; i < n_traces_; i++)
+    {
+      float x, y;
+      FindTraceXY(index.GetUtmx(i), index.GetUtmy(i), index.GetInline(i), index.GetCrossline(i), x, y);
+      traces_[i] = new SegYTrace(NULL, 0, 1, 0,
+                                 index.GetUtmx(i), index.GetUtmy(i), index.GetInline(i), index.GetCrossline(i),
+                                 x, y);
+      if(only_ilxl == true)
+        traces_[i]->RemoveXY();
+      traces_[i]->SetFilePos(static_cast<std::streamoff>(index.GetFilePos(i) + 240));
+    }
+  }
+  else {
+    TraceHeader traceHeader(trace_header_format_);
+
+    std::streampos pos  = 3840;
+    std::streampos step = static_cast<std::streampos>(nz_*datasize_+240);
+
+    unsigned long long fSize = FindFileSize(file_name_);
+    if (fSize != 3600 + n_traces_*static_cast<unsigned long long>(nz_*datasize_+240))
+      makeIndex = false;
+    if (makeIndex)
+      index.Resize(n_traces_);
+
+    char * buffer = new char[nz_*datasize_];
+    std::vector<float> samples(makeIndex ? nz_ : 0);
+    for (i = 0; i < n_traces_; i++)
+    {
+      try {
+        if (file_.eof()==false)
+        {
+          bool extra_header = ReadHeader(traceHeader);
+          traces_[i] = new SegYTrace(traceHeader,keep_header);
+          file_.read(buffer, static_cast<std::streamsize>(nz_*datasize_));
+          if(extra_header == true)
+            makeIndex = false;
+          if(makeIndex == true) {
+            DecodeSamples(buffer, &samples[0], nz_);
+            index.SetTrace(i, static_cast<unsigned long long>(static_cast<std::streamoff>(pos)) - 240,
+                           traceHeader.GetUtmx(), traceHeader.GetUtmy(), traceHeader.GetInline(), traceHeader.GetCrossline(),
+                           *std::min_element(samples.begin(), samples.end()),
+                           *std::max_element(samples.begin(), samples.end()));
+          }
+          if(only_ilxl == true)
+            traces_[i]->RemoveXY();
+          traces_[i]->SetFilePos(pos);
+          pos += step;
+          if(extra_header == true)
+            pos += 3600;
+        }
+      }
+      catch(Exception & e) {
+        throw(Exception("In trace number " + ToString(i) + ":\n" + e.what()));
       }
     }
-    catch(Exception & e) {
-      throw(Exception("In trace number " + ToString(i) + ":\n" + e.what()));
+    delete [] buffer;
+
+    if (makeIndex) {
+      index.SetDz(dz_);
+      WriteIndex(index);
     }
   }
-  delete [] buffer;
 
 
   SetBogusILXLUndefined(traces_);
@@ -23,6 +23,7 @@
 #define SEGY_HPP
 
 #include <fstream>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,7 @@ namespace NRLib {
 
 const int segyIMISSING = -99999;
 class SegYTrace;
+class SegYTraceIndex;
 class SegyGeometry;
 class BinaryHeader;
 class TextualHeader;
@@ -174,9 +176,57 @@ public:
   TraceHeaderFormat         GetTraceHeaderFormat(){return trace_header_format_;};
   static TraceHeaderFormat  FindTraceHeaderFormat(const std::string & fileName);
 
+  /// Use a SegYTraceIndex stored next to the SegY file to find the traces and their
+  /// geometry without scanning the file, and write the index when the file is scanned.
+  /// Used by ReadAllTraces, FindGridGeometry and FindNumberOfTraces. Off by default.
+  static void               SetUseTraceIndex(bool useTraceIndex) { use_trace_index_ = useTraceIndex ;}
+  static bool               GetUseTraceIndex(void)               { return use_trace_index_        ;}
+
 private:
   //void                      ebcdicHeader(std::string& outstring);               ///<
   bool                      ReadHeader(TraceHeader & header);                   ///< Trace header
+  void                      CheckSampleInterval(TraceHeader & header);          ///< Sets dz_ from first trace, checks the rest
+  void                      ReadAllTracesSequentially(const NRLib::Volume * volume,
+                                                      double                zPad,
+                                                      bool                  onlyVolume,
+                                                      bool                  relative_padding,
+                                                      double              * outsideTopMax,
+                                                      double              * outsideBotMax);  ///< Read one trace at a time
+  bool                      ReadAllTracesInBlocks(const NRLib::Volume * volume,
+                                                  double                zPad,
+                                                  bool                  onlyVolume,
+                                                  bool                  relative_padding,
+                                                  double              * outsideTopMax,
+                                                  double              * outsideBotMax,
+                                                  SegYTraceIndex      * index);              ///< Read many traces at a time, decode in parallel. Fills index if not NULL.
+  void                      ReadAllTracesFromIndex(const SegYTraceIndex & index,
+                                                   const NRLib::Volume  * volume,
+                                                   double                 zPad,
+                                                   bool                   onlyVolume,
+                                                   bool                   relative_padding,
+                                                   double               * outsideTopMax,
+                                                   double               * outsideBotMax);     ///< Read only the samples needed, using the trace positions in index
+  bool                      ReadIndex(SegYTraceIndex & index) const;            ///< False if there is no valid index for the file
+  void                      WriteIndex(const SegYTraceIndex & index) const;     ///< Logs, but does not throw, if index can not be written
+  void                      DecodeSamples(const char * buffer,
+                                          float      * samples,
+                                          size_t       n) const;               ///< Convert n samples in file format to float
+  void                      FindTraceXY(float   utmx,
+                                        float   utmy,
+                                        int     inLine,
+                                        int     crossLine,
+                                        float & x,
+                                        float & y) const;                       ///< Trace coordinates in the coordinate system of the header format
+  bool                      FindTraceRange(const NRLib::Volume * volume,
+                                           double                zPad,
+                                           bool                  onlyVolume,
+                                           bool                & outsideSurface,
+                                           double              * outsideTopBot,
+                                           bool                  relative_padding,
+                                           float                 x,
+                                           float                 y,
+                                           size_t              & j0,
+                                           size_t              & j1) const;      ///< Samples to read, false if trace is not used
   SegYTrace               * ReadTrace(const NRLib::Volume * volume,
                                       double                zPad,
                                       bool                & duplicateHeader,
@@ -210,6 +260,7 @@ private:
   bool                      check_simbox_;          ///<
 
   std::vector<SegYTrace*>   traces_;               ///< All traces
+  std::list<std::vector<float> > trace_store_;    ///< Samples of the traces read by ReadAllTraces, one vector per block read, see SegYTrace
   size_t                    n_traces_;              ///< Holds the number of traces. May be an estimate if not all read.
 
   int                       datasize_;             ///< Bytes per datapoint in file.
@@ -224,6 +275,7 @@ private:
 
   float                     rmissing_;
 
+  static bool               use_trace_index_;     ///< See SetUseTraceIndex
 };
 
 
@@ -57,6 +57,8 @@ SegYTrace::SegYTrace(std::fstream & file, size_t jStart, size_t jEnd, int format
   trace_header_  = new TraceHeader(*trace_header);
   table_index_   = 0;
   file_position_ = 0;
+  store_         = NULL;
+  store_offset_  = 0;
 
   size_t nData = jEnd - jStart + 1;
   size_t i;
@@ -124,6 +126,57 @@ SegYTrace::SegYTrace(std::fstream & file, size_t jStart, size_t jEnd, int format
   }
 }
 
+SegYTrace::SegYTrace(const std::vector<float> & store,
+                     size_t                     offset,
+                     size_t                     jStart,
+                     size_t                     jEnd,
+                     const TraceHeader        & trace_header)
+{
+  rmissing_      = segyRMISSING;
+  imissing_      = segyIMISSING;
+  j_start_       = jStart;
+  j_end_         = jEnd;
+  x_             = trace_header.GetUtmx();
+  y_             = trace_header.GetUtmy();
+  in_line_       = trace_header.GetInline();
+  cross_line_    = trace_header.GetCrossline();
+  coord1_        = trace_header.GetCoord1();
+  coord2_        = trace_header.GetCoord2();
+  trace_header_  = new TraceHeader(trace_header);
+  table_index_   = 0;
+  file_position_ = 0;
+  store_         = &store;
+  store_offset_  = offset;
+}
+
+SegYTrace::SegYTrace(const std::vector<float> * store,
+                     size_t                     offset,
+                     size_t                     jStart,
+                     size_t                     jEnd,
+                     float                      x,
+                     float                      y,
+                     int                        inLine,
+                     int                        crossLine,
+                     float                      coord1,
+                     float                      coord2)
+{
+  rmissing_      = segyRMISSING;
+  imissing_      = segyIMISSING;
+  j_start_       = jStart;
+  j_end_         = jEnd;
+  x_             = x;
+  y_             = y;
+  in_line_       = inLine;
+  cross_line_    = crossLine;
+  coord1_        = coord1;
+  coord2_        = coord2;
+  trace_header_  = NULL;
+  table_index_   = 0;
+  file_position_ = 0;
+  store_         = store;
+  store_offset_  = offset;
+}
+
 SegYTrace::SegYTrace(std::vector<float> indata, size_t jStart, size_t jEnd, float x, float y, int inLine, int crossLine)
 {
   rmissing_   = segyRMISSING;
@@ -145,6 +198,8 @@ SegYTrace::SegYTrace(std::vector<float> indata, size_t jStart, size_t jEnd, floa
   table_index_   = 0;
   file_position_ = 0;
   trace_header_  = NULL;
+  store_         = NULL;
+  store_offset_  = 0;
 }
 
 SegYTrace::SegYTrace(const TraceHeader& trace_header, bool keep_header)
@@ -161,6 +216,8 @@ SegYTrace::SegYTrace(const TraceHeader& trace_header, bool keep_header)
   coord2_        = trace_header.GetCoord2();
   table_index_   = 0;
   file_position_ = 0;
+  store_         = NULL;
+  store_offset_  = 0;
 
   if(keep_header == true)
     trace_header_ = new TraceHeader(trace_header);
@@ -181,10 +238,21 @@ SegYTrace::GetValue(size_t j)const
   if (j < j_start_ || j > j_end_)
     value = rmissing_;
   else
-    value = data_[j - j_start_];
+    value = GetData()[j - j_start_];
   return(value);
 }
 
+const float *
+SegYTrace::GetData(void) const
+{
+  if (store_ != NULL)
+    return(&(*store_)[store_offset_]);
+  else if (data_.size() > 0)
+    return(&data_[0]);
+  else
+    return(NULL);
+}
+
 size_t
 SegYTrace::GetLegalIndex(size_t index) const
 {
@@ -53,6 +53,23 @@ public:
             size_t              nz,
             const TraceHeader * trace_header = NULL);                                     ///< Standard reading constructor.
 
+  SegYTrace(const std::vector<float> & store,
+            size_t                     offset,
+            size_t                     jStart,
+            size_t                     jEnd,
+            const TraceHeader        & trace_header);                                     ///< Trace with data in store, from offset. Used by SegY::ReadAllTraces.
+
+  SegYTrace(const std::vector<float> * store,
+            size_t                     offset,
+            size_t                     jStart,
+            size_t                     jEnd,
+            float                      x,
+            float                      y,
+            int                        inLine,
+            int                        crossLine,
+            float                      coord1,
+            float                      coord2);                                           ///< Trace without header, as found from a SegYTraceIndex. No data if store is NULL.
+
   SegYTrace(std::vector<float> indata,
             size_t             jStart,
             size_t             jEnd,
@@ -68,7 +85,7 @@ public:
 
   void SetTableIndex(size_t index) {table_index_ = index;}                                ///< Set table index
 
-  const std::vector<float> & GetTrace(void)              const { return data_       ;}
+  const float              * GetData(void)               const;                           ///< Data from start to end index
   float                      GetValue(size_t j)          const;                           ///< get trace value at index j
   size_t                     GetLegalIndex(size_t index) const;
   size_t                     GetStart()                  const { return j_start_    ;}    ///< Get start index
@@ -101,7 +118,9 @@ private:
   ///(note that this class can live without trace_header, hence duplicates of information
   ///that may also be stored there.)
 
-  std::vector<float> data_;         ///< Data in trace
+  std::vector<float> data_;         ///< Data in trace, unless store_ is given
+  const std::vector<float> * store_;///< Data of many traces, where this trace starts at store_offset_
+  size_t             store_offset_; ///< Start of trace in store_
   size_t             j_start_;      ///< Start index
   size_t             j_end_;        ///< End index
   float              x_;            ///< UTM x coord
@@ -0,0 +1,199 @@
+// Copyright (c)  2011, Norwegian Computing Center
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//   Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//   Redistributions in binary form must reproduce the above copyright notice, this list of
+//    conditions and the following disclaimer in the documentation and/or other materials
+//    provided with the distribution.
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "segytraceindex.hpp"
+#include "traceheader.hpp"
+
+#include "../exception/exception.hpp"
+#include "../iotools/fileio.hpp"
+
+using namespace NRLib;
+
+const std::string SegYTraceIndex::magic_ = "NRLib SegY trace index, version 1";
+
+SegYTraceIndex::SegYTraceIndex(void)
+  : dz_(0.0f)
+{
+}
+
+bool
+SegYTraceIndex::Read(const std::string       & segy_file,
+                     const TraceHeaderFormat & trace_header_format,
+                     int                       data_format,
+                     size_t                    nz)
+{
+  std::string file_name = FileName(segy_file);
+  if (!boost::filesystem::exists(file_name))
+    return(false);
+
+  std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+  if (!file)
+    return(false);
+
+  try {
+    std::string line;
+    std::getline(file, line);
+    if (line != magic_)
+      return(false);
+
+    double file_size, file_time;
+    FindFileStamp(segy_file, file_size, file_time);
+    if (ReadBinaryDouble(file) != file_size || ReadBinaryDouble(file) != file_time)
+      return(false);
+
+    std::vector<int> format(8);
+    ReadBinaryIntArray(file, format.begin(), format.size());
+    if (format[0] != data_format                               ||
+        format[1] != static_cast<int>(nz)                      ||
+        format[2] != trace_header_format.GetScalCoLoc()        ||
+        format[3] != trace_header_format.GetUtmxLoc()          ||
+        format[4] != trace_header_format.GetUtmyLoc()          ||
+        format[5] != trace_header_format.GetInlineLoc()        ||
+        format[6] != trace_header_format.GetCrosslineLoc()     ||
+        format[7] != static_cast<int>(trace_header_format.GetCoordSys()))
+      return(false);
+
+    dz_ = ReadBinaryFloat(file);
+    size_t n_traces = static_cast<size_t>(ReadBinaryInt(file));
+    if (n_traces == 0)
+      return(false);
+
+    Resize(n_traces);
+    std::vector<double> file_pos(n_traces);
+    ReadBinaryDoubleArray(file, file_pos.begin(), n_traces);
+    for (size_t i = 0 ; i < n_traces ; i++)
+      file_pos_[i] = static_cast<unsigned long long>(file_pos[i]);
+    ReadBinaryFloatArray(file, utmx_.begin()      , n_traces);
+    ReadBinaryFloatArray(file, utmy_.begin()      , n_traces);
+    ReadBinaryIntArray  (file, in_line_.begin()   , n_traces);
+    ReadBinaryIntArray  (file, cross_line_.begin(), n_traces);
+    ReadBinaryFloatArray(file, min_value_.begin() , n_traces);
+    ReadBinaryFloatArray(file, max_value_.begin() , n_traces);
+  }
+  catch (NRLib::Exception & ) {
+    Resize(0);
+    return(false);
+  }
+  return(true);
+}
+
+void
+SegYTraceIndex::Write(const std::string       & segy_file,
+                      const TraceHeaderFormat & trace_header_format,
+                      int                       data_format,
+                      size_t                    nz) const
+{
+  //
+  // Write to a temporary file first, so that an interrupted write never
+  // leaves an index that looks complete.
+  //
+  std::string file_name = FileName(segy_file);
+  std::string temp_name = file_name + ".tmp";
+
+  double file_size, file_time;
+  FindFileStamp(segy_file, file_size, file_time);
+
+  std::ofstream file;
+  OpenWrite(file, temp_name, std::ios::out | std::ios::binary, false);
+  file << magic_ << "\n";
+
+  WriteBinaryDouble(file, file_size);
+  WriteBinaryDouble(file, file_time);
+
+  std::vector<int> format(8);
+  format[0] = data_format;
+  format[1] = static_cast<int>(nz);
+  format[2] = trace_header_format.GetScalCoLoc();
+  format[3] = trace_header_format.GetUtmxLoc();
+  format[4] = trace_header_format.GetUtmyLoc();
+  format[5] = trace_header_format.GetInlineLoc();
+  format[6] = trace_header_format.GetCrosslineLoc();
+  format[7] = static_cast<int>(trace_header_format.GetCoordSys());
+  WriteBinaryIntArray(file, format.begin(), format.end());
+
+  WriteBinaryFloat(file, dz_);
+  WriteBinaryInt(file, static_cast<int>(GetNTraces()));
+
+  std::vector<double> file_pos(file_pos_.begin(), file_pos_.end());
+  WriteBinaryDoubleArray(file, file_pos.begin()   , file_pos.end());
+  WriteBinaryFloatArray (file, utmx_.begin()      , utmx_.end());
+  WriteBinaryFloatArray (file, utmy_.begin()      , utmy_.end());
+  WriteBinaryIntArray   (file, in_line_.begin()   , in_line_.end());
+  WriteBinaryIntArray   (file, cross_line_.begin(), cross_line_.end());
+  WriteBinaryFloatArray (file, min_value_.begin() , min_value_.end());
+  WriteBinaryFloatArray (file, max_value_.begin() , max_value_.end());
+
+  file.close();
+  if (!file)
+    throw IOError("Error writing SegY trace index " + temp_name + ".");
+
+  try {
+    if (boost::filesystem::exists(file_name))
+      boost::filesystem::remove(file_name);
+    boost::filesystem::rename(temp_name, file_name);
+  }
+  catch (boost::filesystem::filesystem_error & e) {
+    throw IOError("Error writing SegY trace index " + file_name + ": " + e.what());
+  }
+}
+
+void
+SegYTraceIndex::Resize(size_t n_traces)
+{
+  file_pos_  .resize(n_traces);
+  utmx_      .resize(n_traces);
+  utmy_      .resize(n_traces);
+  in_line_   .resize(n_traces);
+  cross_line_.resize(n_traces);
+  min_value_ .resize(n_traces);
+  max_value_ .resize(n_traces);
+}
+
+void
+SegYTraceIndex::SetTrace(size_t             i,
+                         unsigned long long file_pos,
+                         float              utmx,
+                         float              utmy,
+                         int                in_line,
+                         int                cross_line,
+                         float              min_value,
+                         float              max_value)
+{
+  file_pos_[i]   = file_pos;
+  utmx_[i]       = utmx;
+  utmy_[i]       = utmy;
+  in_line_[i]    = in_line;
+  cross_line_[i] = cross_line;
+  min_value_[i]  = min_value;
+  max_value_[i]  = max_value;
+}
+
+void
+SegYTraceIndex::FindFileStamp(const std::string & segy_file,
+                              double            & file_size,
+                              double            & file_time)
+{
+  file_size = static_cast<double>(FindFileSize(segy_file));
+  file_time = static_cast<double>(boost::filesystem::last_write_time(segy_file));
+}
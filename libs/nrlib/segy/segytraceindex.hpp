@@ -0,0 +1,102 @@
+// Copyright (c)  2011, Norwegian Computing Center
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//   Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//   Redistributions in binary form must reproduce the above copyright notice, this list of
+//    conditions and the following disclaimer in the documentation and/or other materials
+//    provided with the distribution.
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SEGYTRACEINDEX_HPP
+#define SEGYTRACEINDEX_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "traceheader.hpp"
+
+namespace NRLib
+{
+
+/// Index of the traces in a SegY file, stored in a file next to the SegY file.
+///
+/// For each trace the index holds the file position, the coordinates and the
+/// inline/crossline numbers from the trace header, and the smallest and largest
+/// sample value. The index also holds the size and modification time of the
+/// SegY file, the trace header format and the sampling. An index is only used
+/// if all of these match the SegY file, so an index that is out of date is
+/// rebuilt rather than used.
+class SegYTraceIndex
+{
+public:
+  SegYTraceIndex(void);
+
+  /// Reads the index of the given SegY file.
+  /// \return false if there is no index, or if it does not match the SegY file.
+  bool   Read(const std::string       & segy_file,
+              const TraceHeaderFormat & trace_header_format,
+              int                       data_format,
+              size_t                    nz);
+
+  /// Writes the index of the given SegY file.
+  /// \throw IOError if the file can not be written.
+  void   Write(const std::string       & segy_file,
+               const TraceHeaderFormat & trace_header_format,
+               int                       data_format,
+               size_t                    nz) const;
+
+  void   Resize(size_t n_traces);
+  void   SetTrace(size_t             i,
+                  unsigned long long file_pos,
+                  float              utmx,
+                  float              utmy,
+                  int                in_line,
+                  int                cross_line,
+                  float              min_value,
+                  float              max_value);
+  void   SetDz(float dz)                           { dz_ = dz                   ;}
+
+  size_t             GetNTraces(void)        const { return file_pos_.size()    ;}
+  float              GetDz(void)             const { return dz_                 ;}
+  unsigned long long GetFilePos(size_t i)    const { return file_pos_[i]        ;} ///< Start of trace header
+  float              GetUtmx(size_t i)       const { return utmx_[i]            ;}
+  float              GetUtmy(size_t i)       const { return utmy_[i]            ;}
+  int                GetInline(size_t i)     const { return in_line_[i]         ;}
+  int                GetCrossline(size_t i)  const { return cross_line_[i]      ;}
+  float              GetMinValue(size_t i)   const { return min_value_[i]       ;}
+  float              GetMaxValue(size_t i)   const { return max_value_[i]       ;}
+  bool               IsConstant(size_t i)    const { return min_value_[i] == max_value_[i] ;} ///< All samples have the same value
+
+  static std::string FileName(const std::string & segy_file) { return segy_file + ".index" ;}
+
+private:
+  static void        FindFileStamp(const std::string & segy_file,
+                                   double            & file_size,
+                                   double            & file_time);
+
+  float                           dz_;         ///< Sampling density in time, from the trace headers
+  std::vector<unsigned long long> file_pos_;   ///< Position of trace header in file
+  std::vector<float>              utmx_;       ///< UTM x coord, scaled
+  std::vector<float>              utmy_;       ///< UTM y coord, scaled
+  std::vector<int>                in_line_;    ///< Inline number
+  std::vector<int>                cross_line_; ///< Crossline number
+  std::vector<float>              min_value_;  ///< Smallest sample in trace
+  std::vector<float>              max_value_;  ///< Largest sample in trace
+
+  static const std::string        magic_;      ///< First line of index file
+};
+
+} // namespace NRLib
+
+#endif
@@ -389,8 +389,7 @@ void TraceHeader::Read(std::istream& inFile, int lineNo)
     throw EndOfFile();
   }
 
-  if (buffer_[0] == '' && buffer_[1] == '@' && buffer_[2] == ''
-      && buffer_[80] == '' && buffer_[160] == '')
+  if (IsEbcdicHeader(buffer_))
   {
     // This is not a trace header, but the start of an EDBDIC-header.
     // Set file pointer at end of EDBDIC header.
@@ -400,53 +399,66 @@ void TraceHeader::Read(std::istream& inFile, int lineNo)
     return;
   }
 
-  std::string buf_string(buffer_,240);
-  std::istringstream header(buf_string, std::ios::in | std::ios::binary);
+  Parse(buffer_, lineNo);
+}
+
+bool TraceHeader::IsEbcdicHeader(const char* buffer)
+{
+  return(buffer[0] == '' && buffer[1] == '@' && buffer[2] == ''
+      && buffer[80] == '' && buffer[160] == '');
+}
+
+void TraceHeader::Parse(const char* buffer, int lineNo)
+{
+  if (buffer != buffer_)
+    memcpy(buffer_, buffer, 240);
 
   int i = 0;
   while (i < 240)
   {
     if (i==(format_.GetScalCoLoc()-1))
     {
-      scalcoinitial_ = ReadBinaryShort(header);
+      ParseInt16BE(&buffer_[i], scalcoinitial_);
       i=i+2;
     }
     else if (i==(format_.GetUtmxLoc()-1))
     {
-      utmx_ = float(ReadBinaryInt(header));
+      int utmx;
+      ParseInt32BE(&buffer_[i], utmx);
+      utmx_ = float(utmx);
       i=i+4;
     }
     else if (i==(format_.GetUtmyLoc()-1))
     {
-      utmy_ = float(ReadBinaryInt(header));
+      int utmy;
+      ParseInt32BE(&buffer_[i], utmy);
+      utmy_ = float(utmy);
       i=i+4;
     }
     else if (i==(NS_LOC-1))
     {
-      ns_ = ReadBinaryShort(header);
+      ParseInt16BE(&buffer_[i], ns_);
       i=i+2;
     }
     else if (i==(DT_LOC-1))
     {
-      dt_ = ReadBinaryShort(header);
+      ParseInt16BE(&buffer_[i], dt_);
       i=i+2;
     }
     else if (i==(format_.GetInlineLoc()-1))
     {
-      inline_ = ReadBinaryInt(header);
+      ParseInt32BE(&buffer_[i], inline_);
       i=i+4;
     }
     else if (i==(format_.GetCrosslineLoc()-1))
     {
-      crossline_ = ReadBinaryInt(header);
+      ParseInt32BE(&buffer_[i], crossline_);
       i=i+4;
     }
     else
     {
-      ReadBinaryShort(header);
       i=i+2;
     }
-
   }
 
  // swapBuffer();
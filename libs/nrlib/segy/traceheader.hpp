@@ -168,6 +168,15 @@ public:
   void Read(std::istream& inFile,
             int lineNo = -1);
 
+  /// Parse a header from the 240 bytes read from file.
+  /// \param[in] buffer  header as read from file.
+  /// \param[in] lineNo  line number. (from binary header.) -1 if not used.
+  void Parse(const char* buffer,
+             int lineNo = -1);
+
+  /// Check if 240 bytes read from file are the start of an EBCDIC header rather than a trace header.
+  static bool IsEbcdicHeader(const char* buffer);
+
   /// Write header to file.
   /// \param[in]  outFile output file.
   int Write(std::ostream& outFile);
@@ -6,6 +6,9 @@
 #include <stdio.h>
 #include <time.h>
 #include <assert.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #if defined(COMPILE_STORM_MODULES_FOR_RMS)
 #include <util/precompile.h>
@@ -35,10 +38,12 @@
 #include "src/wavelet.h"
 #include "src/crava.h"
 #include "src/fftgrid.h"
+#include "src/fftfilegrid.h"
 #include "src/gridmapping.h"
 #include "src/simbox.h"
 #include "src/welldata.h"
 #include "src/timings.h"
+#include "src/profiler.h"
 #include "src/spatialwellfilter.h"
 #include "src/tasklist.h"
 
@@ -184,6 +189,14 @@ int main(int argc, char** argv)
     ModelGravityStatic * modelGravityStatic = NULL;
     NRLib::Random::Initialize();
 
+#ifdef _OPENMP
+    if (modelSettings->getNumberOfThreads() > 0)
+      omp_set_num_threads(modelSettings->getNumberOfThreads());
+#endif
+
+    Profiler::setEnabled(modelSettings->getProfileFlag());
+    NRLib::SegY::SetUseTraceIndex(modelSettings->getUseSegyTraceIndex());
+
 
     if (modelFile.getParsingFailed()) {
       LogKit::SetFileLog(IO::FileLog()+IO::SuffixTextFiles(), modelSettings->getLogLevel());
@@ -331,6 +344,11 @@ int main(int argc, char** argv)
     Timings::setTimeTotal(wall,cpu);
     Timings::reportAll(LogKit::Medium);
 
+    if (Profiler::isEnabled()) {
+      Profiler::report(LogKit::Medium);
+      Profiler::writeReport(IO::makeFullFileName("",IO::FileProfile()));
+    }
+
     TaskList::viewAllTasks(modelSettings->getTaskFileFlag());
 
     delete modelAVOstatic;
@@ -338,6 +356,11 @@ int main(int argc, char** argv)
     delete modelSettings;
     delete inputFiles;
 
+    FFTGrid::clearFFTPlanCache();
+    Utils::clearFFTPlanCache1D();
+    FFTFileGrid::reportPagingTraffic(LogKit::Medium);
+    Profiler::clear();
+
     Timings::reportTotal();
     LogKit::LogFormatted(LogKit::Low,"\n*** CRAVA closing  ***\n");
     LogKit::LogFormatted(LogKit::Low,"\n*** CRAVA finished ***\n");
@@ -7,12 +7,11 @@
 #include <numeric>
 #include <cmath>
 
-static DEM* global_dem;
-
-static std::vector<double> WrapperGEQDEMYPrime(std::vector<double>&       y,
-                                               double                     t) {
-  return global_dem->GEQDEMYPrime(y, t);
-}
+// The last integration and its result. Rock models with fixed inclusion
+// properties give the same integration for every sample.
+static std::vector<double> cached_key;
+static double              cached_bulk_modulus  = 0.0;
+static double              cached_shear_modulus = 0.0;
 
 
 DEM::DEM(const std::vector<double>&       bulk_modulus,
@@ -28,8 +27,6 @@ DEM::DEM(const std::vector<double>&       bulk_modulus,
   aspect_ratio_(aspect_ratio),
   concentration_(concentration) {
 
-  global_dem = this;
-
 }
 
 DEM::~DEM() {
@@ -73,61 +70,56 @@ DEM::CalcEffectiveModulus(double&                    effective_bulk_modulus,
 
   }
   else {
-    std::vector<double>           y0;
-    std::vector<double>                 tout;
-    std::vector< std::vector<double> >  yout;
-
-    double tfinal = sum_conc;
-    y0.resize(2);
-    y0[0] = bulk_modulus_bg_;
-    y0[1] = shear_modulus_bg_;
-
-    OrdDiffEqSolver::
-    Ode45(&WrapperGEQDEMYPrime,
-          0.0,
-          tfinal,
-          y0,
-          tout,
-          yout,
-          1e-5);
-
-    if (!yout.empty())
-      effective_bulk_modulus  = (yout.back())[0];
-    if (!yout.empty())
-      effective_shear_modulus = (yout.back())[1];
+    size_t ninclusions = aspect_ratio_.size();
+
+    std::vector<double> key(2 + 4*ninclusions);
+    key[0] = bulk_modulus_bg_;
+    key[1] = shear_modulus_bg_;
+    for (size_t index = 0; index < ninclusions; index++) {
+      key[2 + 4*index]     = bulk_modulus_[index];
+      key[2 + 4*index + 1] = shear_modulus_[index];
+      key[2 + 4*index + 2] = aspect_ratio_[index];
+      key[2 + 4*index + 3] = concentration_[index];
+    }
+
+    if (FindCachedModulus(key, effective_bulk_modulus, effective_shear_modulus) == false) {
+      SetupInclusionTerms();
+
+      double tfinal = sum_conc;
+      std::vector<double> y(2);
+      y[0] = bulk_modulus_bg_;
+      y[1] = shear_modulus_bg_;
 
+      OrdDiffEqSolver::
+      Ode45(*this,
+            0.0,
+            tfinal,
+            y,
+            1e-5);
+
+      effective_bulk_modulus  = y[0];
+      effective_shear_modulus = y[1];
+
+      StoreCachedModulus(key, effective_bulk_modulus, effective_shear_modulus);
+    }
   }
 
 }
 
-std::vector<double>
-DEM::GEQDEMYPrime(std::vector<double>&       y,
-                  double                     t) {
+void
+DEM::SetupInclusionTerms() {
 
   size_t ninclusions = aspect_ratio_.size();
-
-  double krhs = 0;
-  double murhs = 0;
   double sum_conc = std::accumulate(concentration_.begin(), concentration_.end(), 0.0);
 
-  std::vector<double> yprime(2, 0.0);
+  relative_conc_.resize(ninclusions);
+  theta_.resize(ninclusions);
+  fn_.resize(ninclusions);
 
   for (size_t index = 0; index < ninclusions; index++) {
-    double k2 = bulk_modulus_[index];
-    double mu2 = shear_modulus_[index];
     double asp = aspect_ratio_[index];
 
-    double conc = concentration_[index]/sum_conc;
-
-    //double krc = bulk_modulus_bg_*k2/((1 - phic_)*k2 + phic_*bulk_modulus_bg_); //Not used
-    //double murc = shear_modulus_bg_*mu2/((1 - phic_)*mu2 + phic_*shear_modulus_bg_); //Not used
-
-    double ka = k2;
-    double mua = mu2;
-
-
-    double k = y[0];
-    double mu = y[1];
+    relative_conc_[index] = concentration_[index]/sum_conc;
 
     // truncation
     if (asp == 1.0)
@@ -143,12 +135,71 @@ DEM::GEQDEMYPrime(std::vector<double>&       y,
     }
     else {
       //theta = (asp/(pow((asp*asp - 1), 3.0/2.0)))*(asp*sqrt(asp*asp-1)-acosh(asp)); //bug in original code???
-      fn=((asp*asp)/(asp*asp - 1))*(2-3*theta);
+      //fn=((asp*asp)/(asp*asp - 1))*(2-3*theta);
       throw NRLib::Exception("DEM: asp > 1 not supported.");
     }
 
-    double nu = (3*k - 2*mu)/(2*(3*k + mu));
-    double r = (1 - 2*nu)/(2*(1 - nu));
+    theta_[index] = theta;
+    fn_[index]    = fn;
+  }
+}
+
+bool
+DEM::FindCachedModulus(const std::vector<double> & key,
+                       double                    & effective_bulk_modulus,
+                       double                    & effective_shear_modulus) {
+  bool found = false;
+#ifdef _OPENMP
+#pragma omp critical(dem_modulus_cache)
+#endif
+  {
+    if (key == cached_key) {
+      effective_bulk_modulus  = cached_bulk_modulus;
+      effective_shear_modulus = cached_shear_modulus;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void
+DEM::StoreCachedModulus(const std::vector<double> & key,
+                        double                      effective_bulk_modulus,
+                        double                      effective_shear_modulus) {
+#ifdef _OPENMP
+#pragma omp critical(dem_modulus_cache)
+#endif
+  {
+    cached_key           = key;
+    cached_bulk_modulus  = effective_bulk_modulus;
+    cached_shear_modulus = effective_shear_modulus;
+  }
+}
+
+void
+DEM::Evaluate(const std::vector<double> & y,
+              double                      t,
+              std::vector<double>       & yprime) const {
+
+  size_t ninclusions = aspect_ratio_.size();
+
+  double krhs = 0;
+  double murhs = 0;
+
+  double k = y[0];
+  double mu = y[1];
+
+  double nu = (3*k - 2*mu)/(2*(3*k + mu));
+  double r = (1 - 2*nu)/(2*(1 - nu));
+
+  for (size_t index = 0; index < ninclusions; index++) {
+    double ka = bulk_modulus_[index];
+    double mua = shear_modulus_[index];
+
+    double conc = relative_conc_[index];
+    double theta = theta_[index];
+    double fn = fn_[index];
+
     double a = mua/mu - 1;
     double b = (1.0/3.0)*(ka/k - mua/mu);
 
@@ -184,10 +235,4 @@ DEM::GEQDEMYPrime(std::vector<double>&       y,
   yprime[0] = krhs/(1 - t);
   yprime[1] = murhs/(1 - t);
 
-  return yprime;
-
 }
-
-
-
-
@@ -3,7 +3,9 @@
 
 #include <vector>
 
-class DEM {
+#include "rplib/orddiffeqsolver.h"
+
+class DEM : public OrdDiffEqFunction {
 public:
   DEM(const std::vector<double>&       bulk_modulus,
       const std::vector<double>&       shear_modulus,
@@ -39,16 +41,33 @@ public:
   void CalcEffectiveModulus(double&                    effective_bulk_modulus,
                             double&                    effective_shear_modulus);
 
-  std::vector<double> GEQDEMYPrime(std::vector<double>&       y,
-                                   double                     t);
+  // Right hand side of the DEM equations for y = (K, Mu) at concentration t.
+  virtual void Evaluate(const std::vector<double> & y,
+                        double                      t,
+                        std::vector<double>       & yprime) const;
 
 private:
+  void SetupInclusionTerms();
+
+  static bool FindCachedModulus(const std::vector<double> & key,
+                                double                    & effective_bulk_modulus,
+                                double                    & effective_shear_modulus);
+
+  static void StoreCachedModulus(const std::vector<double> & key,
+                                 double                      effective_bulk_modulus,
+                                 double                      effective_shear_modulus);
+
   double                           bulk_modulus_bg_;
   double                           shear_modulus_bg_;
   const std::vector<double>&       bulk_modulus_;
   const std::vector<double>&       shear_modulus_;
   const std::vector<double>&       aspect_ratio_;
   std::vector<double>&             concentration_;
+
+  // Terms of the right hand side that do not depend on (K, Mu), one per inclusion
+  std::vector<double>              relative_conc_;      // Concentration relative to sum of concentrations
+  std::vector<double>              theta_;
+  std::vector<double>              fn_;
 };
 
 
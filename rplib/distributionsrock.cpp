@@ -4,9 +4,7 @@
 #include "nrlib/surface/regularsurface.hpp"
 #include "nrlib/iotools/logkit.hpp"
 #include "nrlib/grid/grid2d.hpp"
-#include "nrlib/statistics/statistics.hpp"
 #include "nrlib/random/random.hpp"
-#include <nrlib/flens/nrlib_flens.hpp>
 
 //--------------------------------------------------------------//
 Rock * DistributionsRock::GenerateSampleAndReservoirVariables(const std::vector<double> & trend_params, std::vector<double> &resVar )
@@ -118,41 +116,49 @@ void  DistributionsRock::SetupExpectationAndCovariances(std::string & errTxt)
                  tabulated_s0_,
                  tabulated_s1_);
 
-  NRLib::Grid2D<double> cov(3,3);
-  std::vector<double>   mean(3);
-
   unsigned int seed = NRLib::Random::DrawUint32();
 
   bool failed = false;
 
+  // Every node is sampled with the same seed, so that the tabulated moments
+  // vary smoothly with the trend parameters. The moments of log(vp,vs,rho)
+  // are accumulated while sampling, with mean and co-moment updates as in
+  // Welford's algorithm, so the samples themselves are not stored.
+
+  double log_sample[3];
+  double delta[3];
+  double mean[3];
+  double co_moment[3][3];
+
   for (int i = 0 ; i < mi ; i++) {
     for (int j = 0 ; j < mj ; j++) {
 
-      std::vector<double>   expectation_small(3, 0.0);
-      NRLib::Grid2D<double> covariance_small(3, 3, 0.0);
+      std::vector<double>   & expectation_small = expectation_(i,j);
+      NRLib::Grid2D<double> & covariance_small  = covariance_(i,j);
+
+      expectation_small.assign(3, 0.0);
+      covariance_small.Resize(3, 3, 0.0);
 
       if(failed == false) {
 
         NRLib::Random::Initialize(seed);
         const std::vector<double> & tp = trend_params(i,j); // trend_params = two-dimensional
 
-        NRLib::Vector log_vp(n);
-        NRLib::Vector log_vs(n);
-        NRLib::Vector log_rho(n);
+        for (int k = 0 ; k < 3 ; k++) {
+          mean[k] = 0.0;
+          for (int l = 0 ; l < 3 ; l++)
+            co_moment[k][l] = 0.0;
+        }
 
         double vp;
         double vs;
         double rho;
 
-        for (int k = 0 ; k < n ; k++) {
+        for (int s = 0 ; s < n ; s++) {
           Rock * rock = GenerateSample(tp);
 
           rock->GetSeismicParams(vp, vs, rho);
 
-          log_vp(k) = std::log(vp);
-          log_vs(k) = std::log(vs);
-          log_rho(k) = std::log(rho);
-
           delete rock;
 
           if(vp <= 0 || vs < 0 || rho <=0) {
@@ -167,28 +173,32 @@ void  DistributionsRock::SetupExpectationAndCovariances(std::string & errTxt)
             failed = true;
             break;
           }
-        }
 
-        if(failed == false) {
-
-          std::vector<NRLib::Vector> m(3);
+          log_sample[0] = std::log(vp);
+          log_sample[1] = std::log(vs);
+          log_sample[2] = std::log(rho);
 
-          m[0] = log_vp;
-          m[1] = log_vs;
-          m[2] = log_rho;
+          double inv_count = 1.0/static_cast<double>(s + 1);
+          for (int k = 0 ; k < 3 ; k++) {
+            delta[k]  = log_sample[k] - mean[k];
+            mean[k]  += delta[k]*inv_count;
+          }
+          for (int k = 0 ; k < 3 ; k++) {
+            for (int l = k ; l < 3 ; l++)
+              co_moment[k][l] += delta[k]*(log_sample[l] - mean[l]);
+          }
+        }
 
+        if(failed == false) {
           for (int k = 0; k < 3; k++) {
-            expectation_small[k] = NRLib::Mean(m[k]);
+            expectation_small[k] = mean[k];
             for (int l = k; l < 3; l++) {
-              covariance_small(k,l) = NRLib::Cov(m[k], m[l]);
+              covariance_small(k,l) = co_moment[k][l]/static_cast<double>(n - 1);
               covariance_small(l,k) = covariance_small(k,l);
             }
           }
         }
       }
-
-      expectation_(i,j) = expectation_small;
-      covariance_(i,j) = covariance_small;
     }
   }
 
@@ -199,8 +209,8 @@ void  DistributionsRock::SetupExpectationAndCovariances(std::string & errTxt)
     for(int i = 0 ; i < mi ; i++) {
       for(int j = 0 ; j < mj ; j++) {
 
-        std::vector<double>   this_expectation = expectation_(i,j);
-        NRLib::Grid2D<double> this_covariance  = covariance_(i,j);
+        const std::vector<double>   & this_expectation = expectation_(i,j);
+        const NRLib::Grid2D<double> & this_covariance  = covariance_(i,j);
 
         for(int k=0; k<3; k++)
           mean_log_expectation_[k] += this_expectation[k];
@@ -4,23 +4,33 @@
 #include <cstring>
 #include <vector>
 
+// Right hand side f(y,t) of the system y' = f(y,t). The function must not
+// keep state between calls, so that a solver may be run from several threads.
+class OrdDiffEqFunction {
+ public:
+   virtual ~OrdDiffEqFunction() {}
+
+   virtual void Evaluate(const std::vector<double> & y,
+                         double                      t,
+                         std::vector<double>       & yprime) const = 0;
+};
+
 class OrdDiffEqSolver {
  public:
    OrdDiffEqSolver();
    ~OrdDiffEqSolver();
 
  //ODE45 integrates a system of ordinary differential equations using
- //4th and 5th order Runge-Kutta formulas.
- static void Ode45(std::vector<double>                 (func_ptr)(std::vector<double>&, double),
+ //4th and 5th order Runge-Kutta formulas. On return y holds the solution
+ //at tfinal. All work space is local to the call.
+ static void Ode45(const OrdDiffEqFunction &            func,
                    double                               t0,
                    double                               tfinal,
-                   std::vector<double>&                 y0,
-                   std::vector<double>&                 tout,
-                   std::vector< std::vector<double> >&  yout,
+                   std::vector<double>&                 y,
                    double                               tol = 1.e-6);
 
 private:
-static void CalcVector(const std::vector< std::vector<double> >& matrix,
+static void CalcVector(const double                              matrix[][6],
                        const std::vector< std::vector<double> >& f,
                        double                                    h,
                        size_t                                    row,
@@ -1538,30 +1538,45 @@ Background::makeKrigedBackground(const std::vector<KrigingData2D> & krigingData,
   bgGrid->setType(FFTGrid::PARAMETER);
   bgGrid->setAccessMode(FFTGrid::WRITE);
 
-  for (int k=0 ; k<nzp ; k++)
+  //
+  // Consecutive layers with data in the same locations are kriged together
+  //
+  std::vector<Surface>  surfaces(std::min(maxKrigingLayers_, nzp), surface);
+  std::vector<Grid2D *> trends;
+
+  int k = 0;
+  while (k < nzp)
   {
-    // Set trend for layer
-    surface.Assign(trend[k]);
+    int nLayers = Kriging2D::findNumberOfEqualLayers(krigingData, k, maxKrigingLayers_);
 
-    // Kriging of layer
-    Kriging2D::krigSurface(surface, krigingData[k], covGrid2D);
+    // Set trend for layers
+    trends.resize(nLayers);
+    for (int m=0 ; m<nLayers ; m++) {
+      surfaces[m].Assign(trend[k+m]);
+      trends[m] = &surfaces[m];
+    }
 
-    // Set layer in background model from surface
-    for(int j=0 ; j<nyp ; j++) {
-      for(int i=0 ; i<rnxp ; i++) {
-        if(i<nxp)
-          bgGrid->setNextReal(float(surface(i,j)));
-        else
-          bgGrid->setNextReal(0);  //dummy in padding (but there is no padding)
+    // Kriging of layers
+    Kriging2D::krigSurfaces(trends, krigingData, k, covGrid2D);
+
+    for (int m=0 ; m<nLayers ; m++, k++) {
+      // Set layer in background model from surface
+      for(int j=0 ; j<nyp ; j++) {
+        for(int i=0 ; i<rnxp ; i++) {
+          if(i<nxp)
+            bgGrid->setNextReal(float(surfaces[m](i,j)));
+          else
+            bgGrid->setNextReal(0);  //dummy in padding (but there is no padding)
+        }
       }
-    }
 
-    // Log progress
-    if (k+1 >= static_cast<int>(nextMonitor))
-    {
-      nextMonitor += monitorSize;
-      std::cout << "^";
-      fflush(stdout);
+      // Log progress
+      if (k+1 >= static_cast<int>(nextMonitor))
+      {
+        nextMonitor += monitorSize;
+        std::cout << "^";
+        fflush(stdout);
+      }
     }
   }
   bgGrid->endAccess();
@@ -1616,18 +1631,33 @@ Background::makeKrigedZone(const std::vector<KrigingData2D> & krigingData,
   // Template surface to be kriged
   //
   Surface surface(x0, y0, lx, ly, nx, ny, RMISSING);
-  for (size_t k=0; k<nz; k++) {
 
-    // Set trend for layer
-    surface.Assign(trend[k]);
+  //
+  // Consecutive layers with data in the same locations are kriged together
+  //
+  std::vector<Surface>  surfaces(std::min(maxKrigingLayers_, static_cast<int>(nz)), surface);
+  std::vector<Grid2D *> trends;
+
+  size_t k = 0;
+  while (k < nz) {
+    int nLayers = Kriging2D::findNumberOfEqualLayers(krigingData, static_cast<int>(k), maxKrigingLayers_);
+
+    // Set trend for layers
+    trends.resize(nLayers);
+    for (int m=0 ; m<nLayers ; m++) {
+      surfaces[m].Assign(trend[k+m]);
+      trends[m] = &surfaces[m];
+    }
 
-    // Kriging of layer
-    Kriging2D::krigSurface(surface, krigingData[k], covGrid2D);
+    // Kriging of layers
+    Kriging2D::krigSurfaces(trends, krigingData, static_cast<int>(k), covGrid2D);
 
-    // Set layer in background model from surface
-    for(size_t j=0 ; j<ny; j++) {
-      for(size_t i=0 ; i<nx; i++)
-        kriged_zone(i,j,k) = float(surface(i,j));
+    // Set layers in background model from surfaces
+    for (int m=0 ; m<nLayers ; m++, k++) {
+      for(size_t j=0 ; j<ny; j++) {
+        for(size_t i=0 ; i<nx; i++)
+          kriged_zone(i,j,k) = float(surfaces[m](i,j));
+      }
     }
   }
 }
@@ -2536,3 +2566,5 @@ Background::ErodeSurface(Surface       *& surface,
 
   surface = new Surface(x0, y0, lx, ly, eroded_surface);
 }
+
+const int Background::maxKrigingLayers_ = 32;
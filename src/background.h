@@ -306,6 +306,8 @@ private:
   FFTGrid    * backModel_[3];       // Cubes for background model files.
   int          DataTarget_;         // Number of data requested in a kriging block
   double       vsvp_;               // Average ratio between vs and vp.
+
+  static const int maxKrigingLayers_; // Largest number of layers kriged together
 };
 
 #endif
@@ -27,14 +27,18 @@
 #include "src/qualitygrid.h"
 #include "src/io.h"
 #include "src/tasklist.h"
+#include "src/postcovcholesky.h"
+#include "src/profiler.h"
 
 #include "lib/timekit.hpp"
 #include "lib/random.h"
+#include "lib/utils.h"
 #include "lib/lib_matr.h"
 
 #include "nrlib/iotools/logkit.hpp"
 #include "nrlib/stormgrid/stormcontgrid.hpp"
 #include "nrlib/grid/grid2d.hpp"
+#include "nrlib/random/randomgenerator.hpp"
 #include "rplib/distributionsstoragekit.h"
 #include "rplib/distributionsrock.h"
 
@@ -45,6 +49,12 @@
 #include <assert.h>
 #include <time.h>
 #include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 Crava::Crava(ModelSettings           * modelSettings,
              ModelGeneral            * modelGeneral,
@@ -113,6 +123,8 @@ Crava::Crava(ModelSettings           * modelSettings,
   errThetaCov_       = new double*[ntheta_];
   sigmamdnew_        = NULL;
   errCorr_           = NULL;
+  krigingAdmin_      = NULL;
+  krigingData_       = NULL;
 
   for(int i=0;i<ntheta_;i++) {
     errThetaCov_[i]  = new double[ntheta_];
@@ -133,13 +145,13 @@ Crava::Crava(ModelSettings           * modelSettings,
     if (modelSettings->getDoInversion() && spatwellfilter == NULL) {
       spatwellfilter = new SpatialWellFilter(modelSettings->getNumberOfWells());
 
-      FFTGrid * alphaCov = seismicParameters.GetCovAlpha();
-      alphaCov->setAccessMode(FFTGrid::RANDOMACCESS);
+      FFTGrid * priorCorr = seismicParameters.GetPriorCorr();
+      priorCorr->setAccessMode(FFTGrid::RANDOMACCESS);
 
       for(int i=0; i<nWells_; i++)
-        spatwellfilter->setPriorSpatialCorr(alphaCov, wells_[i], i);
+        spatwellfilter->setPriorSpatialCorr(priorCorr, wells_[i], i);
 
-      alphaCov->endAccess();
+      priorCorr->endAccess();
     }
 
     float corrGradI, corrGradJ;
@@ -295,6 +307,11 @@ Crava::~Crava()
   if(errCorr_ != NULL)
     delete errCorr_;
 
+  delete krigingAdmin_;
+  delete krigingData_;
+  for(size_t i = 0;i<krigingCovGrids_.size();i++)
+    delete krigingCovGrids_[i];
+
   for(int i = 0;i<ntheta_;i++)
     delete[] errThetaCov_[i];
   delete [] errThetaCov_;
@@ -824,7 +841,6 @@ Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
   fftw_real*    rData;
   fftw_real     tmp;
   fftw_complex* cData;
-  fftw_complex scaleWVal;
   rfftwnd_plan plan1,plan2;
 
   rData  = static_cast<fftw_real*>(fftw_malloc(2*(nzp_/2+1)*sizeof(fftw_real)));
@@ -836,6 +852,11 @@ Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
 
   Wavelet1D* localWavelet;
 
+  int                   cnzp = nzp_/2 + 1;
+  std::vector<float>    wRe(cnzp);
+  std::vector<float>    wIm(cnzp);
+  Wavelet::StretchTable stretch;
+
   for(l=0 ; l< ntheta_ ; l++ )
   {
     seisData_[l]->setAccessMode(FFTGrid::RANDOMACCESS);
@@ -853,15 +874,16 @@ Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
 
         rfftwnd_one_real_to_complex(plan1,rData ,cData);
         localWavelet = seisWavelet_[l]->createLocalWavelet1D(i,j);
+        if(stretch.n == 0 || sf != stretch.scale)
+          localWavelet->fillStretchTable(sf, stretch);
+        localWavelet->getCAmpStretched(stretch, &wRe[0], &wIm[0]);
 
-        for(k=0;k < (nzp_/2 +1);k++) // all complex values
+        for(k=0;k < cnzp;k++) // all complex values
         {
-            scaleWVal    =  localWavelet->getCAmp(k,sf);    // NBNB change here
-          //scaleWVal    =  localWavelet->getCAmp(k);
-          // note scaleWVal is acctually the value of the complex conjugate
+          // note wRe, wIm is acctually the value of the complex conjugate
           // (see definition of getCAmp)
-          tmp           = cData[k].re * scaleWVal.re + cData[k].im * scaleWVal.im;
-          cData[k].im   = cData[k].im * scaleWVal.re - cData[k].re * scaleWVal.im;
+          tmp           = cData[k].re * wRe[k] + cData[k].im * wIm[k];
+          cData[k].im   = cData[k].im * wRe[k] - cData[k].re * wIm[k];
           cData[k].re   = tmp;
         }
         delete localWavelet;
@@ -888,52 +910,12 @@ int
 Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
                                      SeismicParametersHolder & seismicParameters)
 {
+  ProfileScope profile("Crava::computePostMeanResidAndFFTCov");
   LogKit::WriteHeader("Posterior model / Performing Inversion");
 
   double wall=0.0, cpu=0.0;
   TimeKit::getTime(wall,cpu);
-  int i,j,k,l;
-
-  fftw_complex * kW          = new fftw_complex[ntheta_];
-
-  fftw_complex * errMult1    = new fftw_complex[ntheta_];
-  fftw_complex * errMult2    = new fftw_complex[ntheta_];
-  fftw_complex * errMult3    = new fftw_complex[ntheta_];
-
-  fftw_complex * ijkData     = new fftw_complex[ntheta_];
-  fftw_complex * ijkDataMean = new fftw_complex[ntheta_];
-  fftw_complex * ijkRes      = new fftw_complex[ntheta_];
-  fftw_complex * ijkMean     = new fftw_complex[3];
-  fftw_complex * ijkAns      = new fftw_complex[3];
-  fftw_complex   kD,kD3;
-
-  fftw_complex**  K  = new fftw_complex*[ntheta_];
-  for(i = 0; i < ntheta_; i++)
-    K[i] = new fftw_complex[3];
-
-  fftw_complex**  KS  = new fftw_complex*[ntheta_];
-  for(i = 0; i < ntheta_; i++)
-    KS[i] = new fftw_complex[3];
-
-  fftw_complex**  KScc  = new fftw_complex*[3]; // cc - complex conjugate (and transposed)
-  for(i = 0; i < 3; i++)
-    KScc[i] = new fftw_complex[ntheta_];
-
-  fftw_complex**  parVar = new fftw_complex*[3];
-  for(i = 0; i < 3; i++)
-    parVar[i] = new fftw_complex[3];
-
-  fftw_complex**  margVar = new fftw_complex*[ntheta_];
-  for(i = 0; i < ntheta_; i++)
-    margVar[i] = new fftw_complex[ntheta_];
-
-  fftw_complex**  errVar = new fftw_complex*[ntheta_];
-  for(i = 0; i < ntheta_; i++)
-    errVar[i] = new fftw_complex[ntheta_];
-
-  fftw_complex** reduceVar = new fftw_complex*[3];
-  for(i = 0; i < 3; i++)
-    reduceVar[i]= new fftw_complex[3];
+  int l;
 
   Wavelet1D * diff1Operator = new Wavelet1D(Wavelet::FIRSTORDERFORWARDDIFF,nz_,nzp_);
   Wavelet1D * diff2Operator = new Wavelet1D(diff1Operator,Wavelet::FIRSTORDERBACKWARDDIFF);
@@ -947,8 +929,6 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   Wavelet1D ** errorSmooth2 = new Wavelet1D*[ntheta_];
   Wavelet1D ** errorSmooth3 = new Wavelet1D*[ntheta_];
 
-  int cnxp  = nxp_/2+1;
-
   for(l = 0; l < ntheta_ ; l++)
   {
     std::string angle = NRLib::ToString(thetaDeg_[l], 1);
@@ -982,26 +962,30 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   meanBeta_ ->setAccessMode(FFTGrid::READANDWRITE);
   meanRho_  ->setAccessMode(FFTGrid::READANDWRITE);
 
-  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
-  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
-  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
-  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
-  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
-  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
-
   if(modelGeneral->getIs4DActive() == true) {
     std::vector<FFTGrid *> sigma(6);
-    sigma[0] = postCovAlpha;
-    sigma[1] = postCrCovAlphaBeta;
-    sigma[2] = postCrCovAlphaRho;
-    sigma[3] = postCovBeta;
-    sigma[4] = postCrCovBetaRho;
-    sigma[5] = postCovRho;
+    sigma[0] = seismicParameters.GetCovAlpha();
+    sigma[1] = seismicParameters.GetCrCovAlphaBeta();
+    sigma[2] = seismicParameters.GetCrCovAlphaRho();
+    sigma[3] = seismicParameters.GetCovBeta();
+    sigma[4] = seismicParameters.GetCrCovBetaRho();
+    sigma[5] = seismicParameters.GetCovRho();
     modelGeneral->mergeCovariance(sigma); //To avoid a second FFT of these.
   }
   else
     seismicParameters.FFTCovGrids();
 
+  // With a separable prior the prior is read from a single correlation grid,
+  // and the posterior covariance grids are allocated here.
+  seismicParameters.createPostCovGrids();
+
+  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
+  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
+  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
+  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
+  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
+  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
+
   postCovAlpha      ->setAccessMode(FFTGrid::READ);
   postCovBeta       ->setAccessMode(FFTGrid::READ);
   postCovRho        ->setAccessMode(FFTGrid::READ);
@@ -1014,12 +998,6 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
 
   // Computes the posterior mean first  below the covariance is computed
   // To avoid to many grids in mind at the same time
-  double priorVarVp,justfactor;
-
-  int cholFlag;
-  //   long int timestart, timeend;
-  //   time(&timestart);
-  float realFrequency;
 
   Wavelet1D** seisWaveletForNorm = new Wavelet1D*[ntheta_];
   for(l = 0; l < ntheta_; l++)
@@ -1039,129 +1017,163 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
     << "\n  |    |    |    |    |    |    |    |    |    |    |  "
     << "\n  ^";
 
-  for(k = 0; k < nzp_; k++)
+  int cnxp = nxp_/2+1;
+
+  if(fileGrid_)
   {
-    realFrequency = static_cast<float>((nz_*1000.0f)/(simbox_->getlz()*nzp_)*std::min(k,nzp_-k)); // the physical frequency
-    kD = diff1Operator->getCAmp(k);                      // defines content of kD
-    if(simbox_->getIsConstantThick())
+    //
+    // Grids are on file and can only be streamed in storage order.
+    //
+    FrequencySolveBuffers buffers(ntheta_);
+
+    for(int k = 0; k < nzp_; k++)
     {
-      // defines content of K=WDA
-      fillkW(k, kW, seisWavelet_);
+      bool invert_frequency = setupFrequencyPlane(k, diff1Operator, diff3Operator, errorSmooth3, seisWaveletForNorm, buffers);
 
-      lib_matrProdScalVecCpx(kD, kW, ntheta_);
-      lib_matrProdDiagCpxR(kW, A_, ntheta_, 3, K); // defines content of (WDA) K
+      for(int j = 0; j < nyp_; j++) {
+        for(int i = 0; i < cnxp; i++) {
+          buffers.ijkMean[0] = meanAlpha_->getNextComplex();
+          buffers.ijkMean[1] = meanBeta_ ->getNextComplex();
+          buffers.ijkMean[2] = meanRho_  ->getNextComplex();
 
-      // defines error-term multipliers
-      fillkWNorm(k,errMult1,seisWaveletForNorm);         // defines input of  (kWNorm) errMult1
-      fillkWNorm(k,errMult2,errorSmooth3);               // defines input of  (kWD3Norm) errMult2
-      lib_matrFillOnesVecCpx(errMult3,ntheta_);          // defines content of errMult3
-    }
-    else
-    {
-      kD3 = diff3Operator->getCAmp(k);                   // defines  kD3
+          for(l = 0; l < ntheta_; l++)
+            buffers.ijkData[l] = seisData_[l]->getNextComplex();
 
-      // defines content of K = DA
-      lib_matrFillValueVecCpx(kD, errMult1, ntheta_);    // errMult1 used as dummy
-      lib_matrProdDiagCpxR(errMult1, A_, ntheta_, 3, K); // defines content of ( K = DA )
+          seismicParameters.getNextParameterCovariance(buffers.parVar);
 
-      // defines error-term multipliers
-      lib_matrFillOnesVecCpx(errMult1,ntheta_);          // defines content of errMult1
-      for(l=0; l < ntheta_; l++)
-      {
-        errMult1[l].re /= seisWavelet_[l]->getNorm();    // defines content of errMult1
-      }
+          solveFrequencyCell(errCorr_->getNextComplex(), invert_frequency, buffers);
+
+          postAlpha_->setNextComplex(buffers.ijkMean[0]);
+          postBeta_ ->setNextComplex(buffers.ijkMean[1]);
+          postRho_  ->setNextComplex(buffers.ijkMean[2]);
+          postCovAlpha->setNextComplex(buffers.parVar[0][0]);
+          postCovBeta ->setNextComplex(buffers.parVar[1][1]);
+          postCovRho  ->setNextComplex(buffers.parVar[2][2]);
+          postCrCovAlphaBeta->setNextComplex(buffers.parVar[0][1]);
+          postCrCovAlphaRho ->setNextComplex(buffers.parVar[0][2]);
+          postCrCovBetaRho  ->setNextComplex(buffers.parVar[1][2]);
 
-      lib_matrFillValueVecCpx(kD3,errMult2,ntheta_);     // defines content of errMult2
-      for(l=0; l < ntheta_; l++)
+          for(l=0;l<ntheta_;l++)
+            seisData_[l]->setNextComplex(buffers.ijkRes[l]);
+        }
+      }
+      // Log progress
+      if (k+1 >= static_cast<int>(nextMonitor))
       {
-        //float errorSmoothMult =  1.0f/errorSmooth3[l]->findNormWithinFrequencyBand(lowCut_,highCut_); // defines scaleFactor;
-        float errorSmoothMult =  1.0f/errorSmooth3[l]->getNorm(); // defines scaleFactor;
-        errMult2[l].re  *= errorSmoothMult; // defines content of errMult2
-        errMult2[l].im  *= errorSmoothMult; // defines content of errMult2
+        nextMonitor += monitorSize;
+        std::cout << "^";
+        fflush(stdout);
       }
-      fillInverseAbskWRobust(k,errMult3,seisWaveletForNorm);// defines content of errMult3
     }
+  }
+  else
+  {
+    //
+    // Grids are in memory. Each frequency cell is independent, so the k-planes are
+    // distributed over the threads. Cells are addressed directly by index, and each
+    // thread has its own work buffers. The per-cell arithmetic is identical to the
+    // file grid case above, so the result does not depend on the number of threads.
+    // The batched lib_matr routines used for the rows give the same result as the
+    // single cell routines.
+    //
+    int planeSize    = cnxp*nyp_;
+    int planesDone   = 0;
 
-    for( j = 0; j < nyp_; j++) {
-      for( i = 0; i < cnxp; i++) {
-        ijkMean[0] = meanAlpha_->getNextComplex();
-        ijkMean[1] = meanBeta_ ->getNextComplex();
-        ijkMean[2] = meanRho_  ->getNextComplex();
-
-        for(l = 0; l < ntheta_; l++ )
-        {
-          ijkData[l] = seisData_[l]->getNextComplex();
-          ijkRes[l]  = ijkData[l];
-        }
-
-        seismicParameters.getNextParameterCovariance(parVar);
-        bool invert_frequency = realFrequency > lowCut_*simbox_->getMinRelThick() &&  realFrequency < highCut_;
-
-        priorVarVp = parVar[0][0].re;
-
-        getNextErrorVariance(errVar, errMult1, errMult2, errMult3, ntheta_, wnc_, errThetaCov_, invert_frequency);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      FrequencySolveBuffers buffers(ntheta_);
+      FrequencyRowBuffers   row(ntheta_, cnxp);
 
-        if(invert_frequency){
-          lib_matrProdCpx(K, parVar , ntheta_, 3 ,3, KS);              //  KS is defined here
-          lib_matrProdAdjointCpx(KS, K, ntheta_, 3 ,ntheta_, margVar); // margVar = (K)S(K)' is defined here
-          lib_matrAddMatCpx(errVar, ntheta_,ntheta_, margVar);         // errVar  is added to margVar = (WDA)S(WDA)'  + errVar
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+      for(int k = 0; k < nzp_; k++)
+      {
+        bool invert_frequency = setupFrequencyPlane(k, diff1Operator, diff3Operator, errorSmooth3, seisWaveletForNorm, buffers);
+
+        for(int j = 0; j < nyp_; j++) {
+          //
+          // The cells of a row share K, and are solved together as a batch.
+          //
+          if(invert_frequency) {
+            for(int i = 0; i < cnxp; i++) {
+              int index = i + j*cnxp + k*planeSize;
+
+              buffers.ijkMean[0] = meanAlpha_->getComplexValue(index);
+              buffers.ijkMean[1] = meanBeta_ ->getComplexValue(index);
+              buffers.ijkMean[2] = meanRho_  ->getComplexValue(index);
+              lib_matrBatchSetVecCpx(row.mean, i, buffers.ijkMean);
+
+              for(int m = 0; m < ntheta_; m++)
+                buffers.ijkData[m] = seisData_[m]->getComplexValue(index);
+              lib_matrBatchSetVecCpx(row.data, i, buffers.ijkData);
+
+              seismicParameters.getParameterCovariance(index, buffers.parVar);
+              lib_matrBatchSetCpx(row.parVar, i, buffers.parVar);
+
+              getErrorVariance(buffers.errVar, errCorr_->getComplexValue(index), buffers.errMult1, buffers.errMult2, buffers.errMult3, ntheta_, wnc_, errThetaCov_, invert_frequency);
+              lib_matrBatchSetCpx(row.errVar, i, buffers.errVar);
+            }
+            solveFrequencyRow(buffers, row);
+          }
 
-          cholFlag=lib_matrCholCpx(ntheta_,margVar);                   // Choleskey factor of margVar is Defined
+          for(int i = 0; i < cnxp; i++) {
+            int index = i + j*cnxp + k*planeSize;
 
-          if(cholFlag==0)
-          { // then it is ok else posterior is identical to prior
+            if(invert_frequency && row.cholFlag[i] == 0) {
+              lib_matrBatchGetVecCpx(row.mean, i, buffers.ijkMean);
+              lib_matrBatchGetVecCpx(row.res, i, buffers.ijkRes);
+              lib_matrBatchGetCpx(row.parVar, i, buffers.parVar);
+            }
+            else {
+              // Frequency not inverted or illegal marginal covariance. The cell
+              // solver leaves the posterior identical to the prior.
+              buffers.ijkMean[0] = meanAlpha_->getComplexValue(index);
+              buffers.ijkMean[1] = meanBeta_ ->getComplexValue(index);
+              buffers.ijkMean[2] = meanRho_  ->getComplexValue(index);
 
-            lib_matrAdjoint(KS,ntheta_,3,KScc);                        //  WDAScc is adjoint of WDAS
-            lib_matrAXeqBMatCpx(ntheta_, margVar, KS, 3);              // redefines WDAS
-            lib_matrProdCpx(KScc,KS,3,ntheta_,3,reduceVar);            // defines reduceVar
-            //double hj=1000000.0;
-            //if(reduceVar[0][0].im!=0)
-            // hj = MAXIM(reduceVar[0][0].re/reduceVar[0][0].im,-reduceVar[0][0].re/reduceVar[0][0].im); //NBNB DEBUG
-            lib_matrSubtMatCpx(reduceVar,3,3,parVar);                  // redefines parVar as the posterior solution
+              for(int m = 0; m < ntheta_; m++)
+                buffers.ijkData[m] = seisData_[m]->getComplexValue(index);
 
-            lib_matrProdMatVecCpx(K,ijkMean, ntheta_, 3, ijkDataMean); //  defines content of ijkDataMean
-            lib_matrSubtVecCpx(ijkDataMean, ntheta_, ijkData);         //  redefines content of ijkData
+              seismicParameters.getParameterCovariance(index, buffers.parVar);
 
-            lib_matrProdAdjointMatVecCpx(KS,ijkData,3,ntheta_,ijkAns); // defines ijkAns
+              solveFrequencyCell(errCorr_->getComplexValue(index), invert_frequency, buffers);
+            }
 
-            lib_matrAddVecCpx(ijkAns, 3,ijkMean);                      // redefines ijkMean
-            lib_matrProdMatVecCpx(K,ijkMean, ntheta_, 3, ijkData);     // redefines ijkData
-            lib_matrSubtVecCpx(ijkData, ntheta_,ijkRes);               // redefines ijkRes
+            postAlpha_->setComplexValue(index, buffers.ijkMean[0]);
+            postBeta_ ->setComplexValue(index, buffers.ijkMean[1]);
+            postRho_  ->setComplexValue(index, buffers.ijkMean[2]);
+            postCovAlpha->setComplexValue(index, buffers.parVar[0][0]);
+            postCovBeta ->setComplexValue(index, buffers.parVar[1][1]);
+            postCovRho  ->setComplexValue(index, buffers.parVar[2][2]);
+            postCrCovAlphaBeta->setComplexValue(index, buffers.parVar[0][1]);
+            postCrCovAlphaRho ->setComplexValue(index, buffers.parVar[0][2]);
+            postCrCovBetaRho  ->setComplexValue(index, buffers.parVar[1][2]);
+
+            for(int m = 0; m < ntheta_; m++)
+              seisData_[m]->setComplexValue(index, buffers.ijkRes[m]);
           }
-
-          // quality control DEBUG
-          if(priorVarVp*4 < ijkAns[0].re*ijkAns[0].re + ijkAns[0].re*ijkAns[0].re)
+        }
+        // Log progress
+#ifdef _OPENMP
+#pragma omp critical(crava_inversion_progress)
+#endif
+        {
+          planesDone++;
+          if (planesDone >= static_cast<int>(nextMonitor))
           {
-            justfactor = sqrt(ijkAns[0].re*ijkAns[0].re + ijkAns[0].re*ijkAns[0].re)/sqrt(priorVarVp);
+            nextMonitor += monitorSize;
+            std::cout << "^";
+            fflush(stdout);
           }
         }
-
-        postAlpha_->setNextComplex(ijkMean[0]);
-        postBeta_ ->setNextComplex(ijkMean[1]);
-        postRho_  ->setNextComplex(ijkMean[2]);
-        postCovAlpha->setNextComplex(parVar[0][0]);
-        postCovBeta ->setNextComplex(parVar[1][1]);
-        postCovRho  ->setNextComplex(parVar[2][2]);
-        postCrCovAlphaBeta->setNextComplex(parVar[0][1]);
-        postCrCovAlphaRho ->setNextComplex(parVar[0][2]);
-        postCrCovBetaRho  ->setNextComplex(parVar[1][2]);
-
-        for(l=0;l<ntheta_;l++)
-          seisData_[l]->setNextComplex(ijkRes[l]);
       }
     }
-    // Log progress
-    if (k+1 >= static_cast<int>(nextMonitor))
-    {
-      nextMonitor += monitorSize;
-      std::cout << "^";
-      fflush(stdout);
-    }
   }
   std::cout << "\n";
 
-  //  time(&timeend);
-  // LogKit::LogFormatted(LogKit::Low,"\n Core inversion finished after %ld seconds ***\n",timeend-timestart);
   meanAlpha_      = NULL; // the content is taken care of by  postAlpha_
   meanBeta_       = NULL; // the content is taken care of by  postBeta_
   meanRho_        = NULL; // the content is taken care of by  postRho_
@@ -1178,6 +1190,8 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   postCrCovBetaRho  ->endAccess();
   errCorr_          ->endAccess();
 
+  seismicParameters.releasePriorCorr();
+
   postAlpha_->invFFTInPlace();
   postBeta_ ->invFFTInPlace();
   postRho_  ->invFFTInPlace();
@@ -1248,6 +1262,95 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   }
 
   delete [] seisData_;
+  delete    diff1Operator;
+  delete    diff3Operator;
+
+  for(l = 0; l < ntheta_; l++)
+  {
+    delete errorSmooth3[l];
+    delete errorSmooth[l];
+    delete seisWaveletForNorm[l];
+  }
+
+  delete[] errorSmooth3;
+  delete[] errorSmooth;
+  delete[] seisWaveletForNorm;
+
+  Timings::setTimeInversion(wall,cpu);
+  return(0);
+}
+//--------------------------------------------------------------------
+Crava::FrequencySolveBuffers::FrequencySolveBuffers(int ntheta)
+{
+  int i;
+
+  kW          = new fftw_complex[ntheta];
+  errMult1    = new fftw_complex[ntheta];
+  errMult2    = new fftw_complex[ntheta];
+  errMult3    = new fftw_complex[ntheta];
+  ijkData     = new fftw_complex[ntheta];
+  ijkDataMean = new fftw_complex[ntheta];
+  ijkRes      = new fftw_complex[ntheta];
+  ijkMean     = new fftw_complex[3];
+  ijkAns      = new fftw_complex[3];
+
+  K = new fftw_complex*[ntheta];
+  for(i = 0; i < ntheta; i++)
+    K[i] = new fftw_complex[3];
+
+  KS = new fftw_complex*[ntheta];
+  for(i = 0; i < ntheta; i++)
+    KS[i] = new fftw_complex[3];
+
+  KScc = new fftw_complex*[3]; // cc - complex conjugate (and transposed)
+  for(i = 0; i < 3; i++)
+    KScc[i] = new fftw_complex[ntheta];
+
+  parVar = new fftw_complex*[3];
+  for(i = 0; i < 3; i++)
+    parVar[i] = new fftw_complex[3];
+
+  margVar = new fftw_complex*[ntheta];
+  for(i = 0; i < ntheta; i++)
+    margVar[i] = new fftw_complex[ntheta];
+
+  errVar = new fftw_complex*[ntheta];
+  for(i = 0; i < ntheta; i++)
+    errVar[i] = new fftw_complex[ntheta];
+
+  reduceVar = new fftw_complex*[3];
+  for(i = 0; i < 3; i++)
+    reduceVar[i] = new fftw_complex[3];
+
+  ntheta_ = ntheta;
+}
+
+//--------------------------------------------------------------------
+Crava::FrequencySolveBuffers::~FrequencySolveBuffers()
+{
+  int i;
+
+  for(i = 0; i < ntheta_; i++)
+  {
+    delete [] K[i];
+    delete [] KS[i];
+    delete [] margVar[i];
+    delete [] errVar[i];
+  }
+  for(i = 0; i < 3; i++)
+  {
+    delete [] KScc[i];
+    delete [] parVar[i];
+    delete [] reduceVar[i];
+  }
+  delete [] K;
+  delete [] KS;
+  delete [] KScc;
+  delete [] parVar;
+  delete [] margVar;
+  delete [] errVar;
+  delete [] reduceVar;
+
   delete [] kW;
   delete [] errMult1;
   delete [] errMult2;
@@ -1255,61 +1358,195 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   delete [] ijkData;
   delete [] ijkDataMean;
   delete [] ijkRes;
-  delete [] ijkMean ;
+  delete [] ijkMean;
   delete [] ijkAns;
-  delete    diff1Operator;
-  delete    diff3Operator;
+}
 
+//--------------------------------------------------------------------
+Crava::FrequencyRowBuffers::FrequencyRowBuffers(int ntheta, int nCells)
+{
+  mean      = lib_matrBatchAllocCpx(3, 1, nCells);
+  data      = lib_matrBatchAllocCpx(ntheta, 1, nCells);
+  dataMean  = lib_matrBatchAllocCpx(ntheta, 1, nCells);
+  res       = lib_matrBatchAllocCpx(ntheta, 1, nCells);
+  ans       = lib_matrBatchAllocCpx(3, 1, nCells);
+  KS        = lib_matrBatchAllocCpx(ntheta, 3, nCells);
+  KScc      = lib_matrBatchAllocCpx(3, ntheta, nCells);
+  parVar    = lib_matrBatchAllocCpx(3, 3, nCells);
+  margVar   = lib_matrBatchAllocCpx(ntheta, ntheta, nCells);
+  errVar    = lib_matrBatchAllocCpx(ntheta, ntheta, nCells);
+  reduceVar = lib_matrBatchAllocCpx(3, 3, nCells);
+  cholFlag  = new int[nCells];
+}
 
-  for(i = 0; i < ntheta_; i++)
+//--------------------------------------------------------------------
+Crava::FrequencyRowBuffers::~FrequencyRowBuffers()
+{
+  lib_matrBatchFreeCpx(mean);
+  lib_matrBatchFreeCpx(data);
+  lib_matrBatchFreeCpx(dataMean);
+  lib_matrBatchFreeCpx(res);
+  lib_matrBatchFreeCpx(ans);
+  lib_matrBatchFreeCpx(KS);
+  lib_matrBatchFreeCpx(KScc);
+  lib_matrBatchFreeCpx(parVar);
+  lib_matrBatchFreeCpx(margVar);
+  lib_matrBatchFreeCpx(errVar);
+  lib_matrBatchFreeCpx(reduceVar);
+  delete [] cholFlag;
+}
+
+//--------------------------------------------------------------------
+bool
+Crava::setupFrequencyPlane(int                     k,
+                           Wavelet1D             * diff1Operator,
+                           Wavelet1D             * diff3Operator,
+                           Wavelet1D            ** errorSmooth3,
+                           Wavelet1D            ** seisWaveletForNorm,
+                           FrequencySolveBuffers & buffers)
+{
+  //
+  // Fills the forward operator K and the error multipliers for frequency plane k,
+  // and returns whether this frequency is to be inverted.
+  //
+  int l;
+  float realFrequency = static_cast<float>((nz_*1000.0f)/(simbox_->getlz()*nzp_)*std::min(k,nzp_-k)); // the physical frequency
+  fftw_complex kD = diff1Operator->getCAmp(k);         // defines content of kD
+
+  if(simbox_->getIsConstantThick())
   {
-    delete[]  K[i];
-    delete[]  KS[i];
-    delete[]  margVar[i] ;
-    delete[] errVar[i] ;
-    delete errorSmooth3[i];
-    delete errorSmooth[i];
-    delete seisWaveletForNorm[i];
-  }
+    // defines content of K=WDA
+    fillkW(k, buffers.kW, seisWavelet_);
 
-  delete[] K;
-  delete[] KS;
-  delete[] margVar;
-  delete[] errVar  ;
-  delete[] errorSmooth3;
-  delete[] errorSmooth;
-  delete[] seisWaveletForNorm;
+    lib_matrProdScalVecCpx(kD, buffers.kW, ntheta_);
+    lib_matrProdDiagCpxR(buffers.kW, A_, ntheta_, 3, buffers.K);    // defines content of (WDA) K
 
-  for(i = 0; i < 3; i++)
+    // defines error-term multipliers
+    fillkWNorm(k,buffers.errMult1,seisWaveletForNorm);         // defines input of  (kWNorm) errMult1
+    fillkWNorm(k,buffers.errMult2,errorSmooth3);               // defines input of  (kWD3Norm) errMult2
+    lib_matrFillOnesVecCpx(buffers.errMult3,ntheta_);          // defines content of errMult3
+  }
+  else
   {
-    delete[] KScc[i];
-    delete[] parVar[i] ;
-    delete[] reduceVar[i];
+    fftw_complex kD3 = diff3Operator->getCAmp(k);       // defines  kD3
+
+    // defines content of K = DA
+    lib_matrFillValueVecCpx(kD, buffers.errMult1, ntheta_);    // errMult1 used as dummy
+    lib_matrProdDiagCpxR(buffers.errMult1, A_, ntheta_, 3, buffers.K); // defines content of ( K = DA )
+
+    // defines error-term multipliers
+    lib_matrFillOnesVecCpx(buffers.errMult1,ntheta_);          // defines content of errMult1
+    for(l=0; l < ntheta_; l++)
+    {
+      buffers.errMult1[l].re /= seisWavelet_[l]->getNorm();    // defines content of errMult1
+    }
+
+    lib_matrFillValueVecCpx(kD3,buffers.errMult2,ntheta_);     // defines content of errMult2
+    for(l=0; l < ntheta_; l++)
+    {
+      //float errorSmoothMult =  1.0f/errorSmooth3[l]->findNormWithinFrequencyBand(lowCut_,highCut_); // defines scaleFactor;
+      float errorSmoothMult =  1.0f/errorSmooth3[l]->getNorm(); // defines scaleFactor;
+      buffers.errMult2[l].re  *= errorSmoothMult; // defines content of errMult2
+      buffers.errMult2[l].im  *= errorSmoothMult; // defines content of errMult2
+    }
+    fillInverseAbskWRobust(k,buffers.errMult3,seisWaveletForNorm);// defines content of errMult3
   }
-  delete[] KScc;
-  delete[] parVar;
-  delete[] reduceVar;
 
-  Timings::setTimeInversion(wall,cpu);
-  return(0);
+  return(realFrequency > lowCut_*simbox_->getMinRelThick() &&  realFrequency < highCut_);
 }
+
 //--------------------------------------------------------------------
 void
-Crava::getNextErrorVariance(fftw_complex **& errVar,
-                            fftw_complex   * errMult1,
-                            fftw_complex   * errMult2,
-                            fftw_complex   * errMult3,
-                            int              ntheta,
-                            float            wnc,
-                            double        ** errThetaCov,
-                            bool             invert_frequency) const
+Crava::solveFrequencyCell(fftw_complex            ijkErrCorr,
+                          bool                    invert_frequency,
+                          FrequencySolveBuffers & buffers) const
 {
-  fftw_complex ijkErrLam;
-  fftw_complex ijkTmp;
+  //
+  // On input buffers.ijkMean, buffers.ijkData and buffers.parVar hold the prior mean, the data and
+  // the prior covariance of one frequency cell. On output they hold the posterior
+  // mean and covariance, and buffers.ijkRes holds the residual.
+  //
+  for(int l = 0; l < ntheta_; l++ )
+    buffers.ijkRes[l] = buffers.ijkData[l];
+
+  getErrorVariance(buffers.errVar, ijkErrCorr, buffers.errMult1, buffers.errMult2, buffers.errMult3, ntheta_, wnc_, errThetaCov_, invert_frequency);
+
+  if(invert_frequency){
+    lib_matrProdCpx(buffers.K, buffers.parVar , ntheta_, 3 ,3, buffers.KS);            //  KS is defined here
+    lib_matrProdAdjointCpx(buffers.KS, buffers.K, ntheta_, 3 ,ntheta_, buffers.margVar); // margVar = (K)S(K)' is defined here
+    lib_matrAddMatCpx(buffers.errVar, ntheta_,ntheta_, buffers.margVar);         // errVar  is added to margVar = (WDA)S(WDA)'  + errVar
+
+    int cholFlag=lib_matrCholCpx(ntheta_,buffers.margVar);                 // Choleskey factor of margVar is Defined
+
+    if(cholFlag==0)
+    { // then it is ok else posterior is identical to prior
+
+      lib_matrAdjoint(buffers.KS,ntheta_,3,buffers.KScc);                        //  WDAScc is adjoint of WDAS
+      lib_matrAXeqBMatCpx(ntheta_, buffers.margVar, buffers.KS, 3);              // redefines WDAS
+      lib_matrProdCpx(buffers.KScc,buffers.KS,3,ntheta_,3,buffers.reduceVar);          // defines reduceVar
+      lib_matrSubtMatCpx(buffers.reduceVar,3,3,buffers.parVar);                  // redefines parVar as the posterior solution
+
+      lib_matrProdMatVecCpx(buffers.K,buffers.ijkMean, ntheta_, 3, buffers.ijkDataMean); //  defines content of ijkDataMean
+      lib_matrSubtVecCpx(buffers.ijkDataMean, ntheta_, buffers.ijkData);         //  redefines content of ijkData
+
+      lib_matrProdAdjointMatVecCpx(buffers.KS,buffers.ijkData,3,ntheta_,buffers.ijkAns); // defines ijkAns
+
+      lib_matrAddVecCpx(buffers.ijkAns, 3,buffers.ijkMean);                      // redefines ijkMean
+      lib_matrProdMatVecCpx(buffers.K,buffers.ijkMean, ntheta_, 3, buffers.ijkData);   // redefines ijkData
+      lib_matrSubtVecCpx(buffers.ijkData, ntheta_,buffers.ijkRes);               // redefines ijkRes
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+void
+Crava::solveFrequencyRow(FrequencySolveBuffers & buffers,
+                         FrequencyRowBuffers   & row)
+{
+  //
+  // Batched version of solveFrequencyCell() for an inverted frequency plane. On input
+  // row.mean, row.data, row.parVar and row.errVar are filled for all cells, and
+  // buffers.K holds the K of the plane. On output row.mean and row.parVar hold the
+  // posterior, and row.res the residual, for the cells where row.cholFlag is 0.
+  //
+  lib_matrBatchCopyCpx(row.data, row.res);
+
+  lib_matrBatchProdSharedCpx(buffers.K, row.parVar, row.KS);              //  KS is defined here
+  lib_matrBatchProdAdjointSharedCpx(row.KS, buffers.K, row.margVar);      // margVar = (K)S(K)' is defined here
+  lib_matrBatchAddMatCpx(row.errVar, row.margVar);                        // errVar  is added to margVar = (WDA)S(WDA)'  + errVar
+
+  lib_matrBatchCholCpx(row.margVar, row.cholFlag);                        // Choleskey factor of margVar is Defined
 
-  ijkTmp = errCorr_->getNextComplex();
+  lib_matrBatchAdjoint(row.KS, row.KScc);                                 //  WDAScc is adjoint of WDAS
+  lib_matrBatchAXeqBMatCpx(row.margVar, row.KS);                          // redefines WDAS
+  lib_matrBatchProdCpx(row.KScc, row.KS, row.reduceVar);                  // defines reduceVar
+  lib_matrBatchSubtMatCpx(row.reduceVar, row.parVar);                     // redefines parVar as the posterior solution
 
-  ijkErrLam.re        = float( sqrt(ijkTmp.re * ijkTmp.re));
+  lib_matrBatchProdSharedCpx(buffers.K, row.mean, row.dataMean);          //  defines content of dataMean
+  lib_matrBatchSubtMatCpx(row.dataMean, row.data);                        //  redefines content of data
+
+  lib_matrBatchProdAdjointMatVecCpx(row.KS, row.data, row.ans);           // defines ans
+
+  lib_matrBatchAddMatCpx(row.ans, row.mean);                              // redefines mean
+  lib_matrBatchProdSharedCpx(buffers.K, row.mean, row.data);              // redefines data
+  lib_matrBatchSubtMatCpx(row.data, row.res);                             // redefines res
+}
+
+//--------------------------------------------------------------------
+void
+Crava::getErrorVariance(fftw_complex  ** errVar,
+                        fftw_complex     ijkErrCorr,
+                        fftw_complex   * errMult1,
+                        fftw_complex   * errMult2,
+                        fftw_complex   * errMult3,
+                        int              ntheta,
+                        float            wnc,
+                        double        ** errThetaCov,
+                        bool             invert_frequency) const
+{
+  fftw_complex ijkErrLam;
+
+  ijkErrLam.re        = float( sqrt(ijkErrCorr.re * ijkErrCorr.re));
   ijkErrLam.im        = 0.0;
 
 
@@ -1338,8 +1575,9 @@ Crava::fillkW(int k, fftw_complex* kW, Wavelet** seisWavelet)
 {
   for(int l = 0; l < ntheta_; l++)
   {
-    kW[l].re  =  float( seisWavelet[l]->getCAmp(k).re );
-    kW[l].im  = -float( seisWavelet[l]->getCAmp(k).im ); // adjust for complex conjugate in getCAmp(k)
+    fftw_complex w = seisWavelet[l]->getCAmp(k);
+    kW[l].re  =  float( w.re );
+    kW[l].im  = -float( w.im ); // adjust for complex conjugate in getCAmp(k)
   }
 }
 
@@ -1349,8 +1587,9 @@ Crava::fillkWNorm(int k, fftw_complex* kWNorm, Wavelet1D** wavelet )
   int l;
   for(l = 0; l < ntheta_; l++)
   {
-    kWNorm[l].re   =  float( wavelet[l]->getCAmp(k).re/wavelet[l]->getNorm());
-    kWNorm[l].im   = -float( wavelet[l]->getCAmp(k).im/wavelet[l]->getNorm()); // // adjust for complex conjugate in getCAmp(k)
+    fftw_complex w = wavelet[l]->getCAmp(k);
+    kWNorm[l].re   =  float( w.re/wavelet[l]->getNorm());
+    kWNorm[l].im   = -float( w.im/wavelet[l]->getNorm()); // // adjust for complex conjugate in getCAmp(k)
   }
 }
 
@@ -1402,6 +1641,7 @@ Crava::SetComplexVector(NRLib::ComplexVector & V,
 void
 Crava::doPredictionKriging(SeismicParametersHolder & seismicParameters)
 {
+  ProfileScope profile("Crava::doPredictionKriging");
   if(writePrediction_ == true) { //No need to do this if output not requested.
     double wall2=0.0, cpu2=0.0;
     TimeKit::getTime(wall2,cpu2);
@@ -1415,12 +1655,29 @@ Crava::doPredictionKriging(SeismicParametersHolder & seismicParameters)
 int
 Crava::simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomGen)
 {
+  ProfileScope profile("Crava::simulate");
   LogKit::WriteHeader("Simulating from posterior model");
 
   double wall=0.0, cpu=0.0;
   TimeKit::getTime(wall,cpu);
 
-  if(nSim_>0)
+  bool parallel = modelSettings_->getParallelSimulation();
+  if(parallel && fileGrid_) {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Parallel simulation is not available when grids are stored on file.");
+    LogKit::LogFormatted(LogKit::Warning,"\n         The realisations are generated one at a time.\n");
+    parallel = false;
+  }
+
+  // The Cholesky factors of the posterior covariance are the same for all realisations.
+  PostCovCholesky * postCovChol = NULL;
+  if(nSim_>0 && (parallel || modelSettings_->getStoreCholeskyFactors()))
+    postCovChol = new PostCovCholesky(seismicParameters, fileGrid_);
+
+  if(nSim_>0 && parallel)
+  {
+    simulateInParallel(seismicParameters, randomGen, postCovChol);
+  }
+  else if(nSim_>0)
   {
     bool kriging = (krigingParameter_ > 0);
     FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
@@ -1450,6 +1707,10 @@ Crava::simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomG
 
     ijkSeed = new fftw_complex[3];
 
+    lib_matrBatchCpx * rowPostCov  = lib_matrBatchAllocCpx(3, 3, nxp_/2+1);
+    lib_matrBatchCpx * rowSeed     = lib_matrBatchAllocCpx(3, 1, nxp_/2+1);
+    int              * rowCholFlag = new int[nxp_/2+1];
+
     seed0 =  createFFTGrid();
     seed1 =  createFFTGrid();
     seed2 =  createFFTGrid();
@@ -1467,68 +1728,137 @@ Crava::simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomG
       seed1->fillInComplexNoise(randomGen);
       seed2->fillInComplexNoise(randomGen);
 
-      postCovAlpha      ->setAccessMode(FFTGrid::READ);
-      postCovBeta       ->setAccessMode(FFTGrid::READ);
-      postCovRho        ->setAccessMode(FFTGrid::READ);
-      postCrCovAlphaBeta->setAccessMode(FFTGrid::READ);
-      postCrCovAlphaRho ->setAccessMode(FFTGrid::READ);
-      postCrCovBetaRho  ->setAccessMode(FFTGrid::READ);
-      seed0 ->setAccessMode(FFTGrid::READANDWRITE);
-      seed1 ->setAccessMode(FFTGrid::READANDWRITE);
-      seed2 ->setAccessMode(FFTGrid::READANDWRITE);
-
-      int cnxp=nxp_/2+1;
-      int cholFlag;
-      for(k = 0; k < nzp_; k++)
-        for(j = 0; j < nyp_; j++)
-          for(i = 0; i < cnxp; i++)
-          {
-            ijkPostCov[0][0] = postCovAlpha      ->getNextComplex();
-            ijkPostCov[1][1] = postCovBeta       ->getNextComplex();
-            ijkPostCov[2][2] = postCovRho        ->getNextComplex();
-            ijkPostCov[0][1] = postCrCovAlphaBeta->getNextComplex();
-            ijkPostCov[0][2] = postCrCovAlphaRho ->getNextComplex();
-            ijkPostCov[1][2] = postCrCovBetaRho  ->getNextComplex();
-
-            ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
-            ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
-            ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
-            ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
-            ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
-            ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
-
-            ijkSeed[0]=seed0->getNextComplex();
-            ijkSeed[1]=seed1->getNextComplex();
-            ijkSeed[2]=seed2->getNextComplex();
-
-            cholFlag = lib_matrCholCpx(3,ijkPostCov);  // Choleskey factor of posterior covariance write over ijkPostCov
-            if(cholFlag == 0)
-            {
-              lib_matrProdCholVec(3,ijkPostCov,ijkSeed); // write over ijkSeed
-            }
-            else
+      if(postCovChol != NULL)
+      {
+        // The factors were computed once, before the first realisation.
+        postCovChol->multiplyNoise(seed0, seed1, seed2);
+      }
+      else
+      {
+        postCovAlpha      ->setAccessMode(FFTGrid::READ);
+        postCovBeta       ->setAccessMode(FFTGrid::READ);
+        postCovRho        ->setAccessMode(FFTGrid::READ);
+        postCrCovAlphaBeta->setAccessMode(FFTGrid::READ);
+        postCrCovAlphaRho ->setAccessMode(FFTGrid::READ);
+        postCrCovBetaRho  ->setAccessMode(FFTGrid::READ);
+        seed0 ->setAccessMode(FFTGrid::READANDWRITE);
+        seed1 ->setAccessMode(FFTGrid::READANDWRITE);
+        seed2 ->setAccessMode(FFTGrid::READANDWRITE);
+
+        int cnxp=nxp_/2+1;
+        int cholFlag;
+        if(fileGrid_)
+        {
+          for(k = 0; k < nzp_; k++)
+            for(j = 0; j < nyp_; j++)
+              for(i = 0; i < cnxp; i++)
+              {
+                ijkPostCov[0][0] = postCovAlpha      ->getNextComplex();
+                ijkPostCov[1][1] = postCovBeta       ->getNextComplex();
+                ijkPostCov[2][2] = postCovRho        ->getNextComplex();
+                ijkPostCov[0][1] = postCrCovAlphaBeta->getNextComplex();
+                ijkPostCov[0][2] = postCrCovAlphaRho ->getNextComplex();
+                ijkPostCov[1][2] = postCrCovBetaRho  ->getNextComplex();
+
+                ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
+                ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
+                ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
+                ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
+                ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
+                ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
+
+                ijkSeed[0]=seed0->getNextComplex();
+                ijkSeed[1]=seed1->getNextComplex();
+                ijkSeed[2]=seed2->getNextComplex();
+
+                cholFlag = lib_matrCholCpx(3,ijkPostCov);  // Choleskey factor of posterior covariance write over ijkPostCov
+                if(cholFlag == 0)
+                {
+                  lib_matrProdCholVec(3,ijkPostCov,ijkSeed); // write over ijkSeed
+                }
+                else
+                {
+                  for(l=0; l< 3;l++)
+                  {
+                    ijkSeed[l].re =0.0;
+                    ijkSeed[l].im = 0.0;
+                  }
+
+                }
+                seed0->setNextComplex(ijkSeed[0]);
+                seed1->setNextComplex(ijkSeed[1]);
+                seed2->setNextComplex(ijkSeed[2]);
+              }
+        }
+        else
+        {
+          //
+          // Grids are in memory. Factorize and multiply a row of cells at a time,
+          // using the batched versions of lib_matrCholCpx and lib_matrProdCholVec.
+          //
+          for(k = 0; k < nzp_; k++)
+            for(j = 0; j < nyp_; j++)
             {
-              for(l=0; l< 3;l++)
+              int rowStart = j*cnxp + k*cnxp*nyp_;
+              for(i = 0; i < cnxp; i++)
               {
-                ijkSeed[l].re =0.0;
-                ijkSeed[l].im = 0.0;
+                int index = rowStart + i;
+                ijkPostCov[0][0] = postCovAlpha      ->getComplexValue(index);
+                ijkPostCov[1][1] = postCovBeta       ->getComplexValue(index);
+                ijkPostCov[2][2] = postCovRho        ->getComplexValue(index);
+                ijkPostCov[0][1] = postCrCovAlphaBeta->getComplexValue(index);
+                ijkPostCov[0][2] = postCrCovAlphaRho ->getComplexValue(index);
+                ijkPostCov[1][2] = postCrCovBetaRho  ->getComplexValue(index);
+
+                ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
+                ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
+                ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
+                ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
+                ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
+                ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
+                lib_matrBatchSetCpx(rowPostCov, i, ijkPostCov);
+
+                ijkSeed[0]=seed0->getComplexValue(index);
+                ijkSeed[1]=seed1->getComplexValue(index);
+                ijkSeed[2]=seed2->getComplexValue(index);
+                lib_matrBatchSetVecCpx(rowSeed, i, ijkSeed);
               }
 
+              lib_matrBatchCholCpx(rowPostCov, rowCholFlag);  // Choleskey factor of posterior covariance write over rowPostCov
+              lib_matrBatchProdCholVec(rowPostCov, rowSeed);  // write over rowSeed
+
+              for(i = 0; i < cnxp; i++)
+              {
+                int index = rowStart + i;
+                if(rowCholFlag[i] == 0)
+                {
+                  lib_matrBatchGetVecCpx(rowSeed, i, ijkSeed);
+                }
+                else
+                {
+                  for(l=0; l< 3;l++)
+                  {
+                    ijkSeed[l].re = 0.0;
+                    ijkSeed[l].im = 0.0;
+                  }
+                }
+                seed0->setComplexValue(index, ijkSeed[0]);
+                seed1->setComplexValue(index, ijkSeed[1]);
+                seed2->setComplexValue(index, ijkSeed[2]);
+              }
             }
-            seed0->setNextComplex(ijkSeed[0]);
-            seed1->setNextComplex(ijkSeed[1]);
-            seed2->setNextComplex(ijkSeed[2]);
-          }
+        }
 
-          postCovAlpha->endAccess();  //
-          postCovBeta->endAccess();   //
-          postCovRho->endAccess();
-          postCrCovAlphaBeta->endAccess();
-          postCrCovAlphaRho->endAccess();
-          postCrCovBetaRho->endAccess();
-          seed0->endAccess();
-          seed1->endAccess();
-          seed2->endAccess();
+            postCovAlpha->endAccess();  //
+            postCovBeta->endAccess();   //
+            postCovRho->endAccess();
+            postCrCovAlphaBeta->endAccess();
+            postCrCovAlphaRho->endAccess();
+            postCrCovBetaRho->endAccess();
+            seed0->endAccess();
+            seed1->endAccess();
+            seed2->endAccess();
+      }
 
           // time(&timeend);
           // printf("Simulation in FFT domain in %ld seconds \n",timeend-timestart);
@@ -1593,40 +1923,220 @@ Crava::simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomG
     delete [] ijkPostCov;
     delete [] ijkSeed;
 
+    lib_matrBatchFreeCpx(rowPostCov);
+    lib_matrBatchFreeCpx(rowSeed);
+    delete [] rowCholFlag;
   }
+  delete postCovChol;
+
   Timings::setTimeSimulation(wall,cpu);
   return(0);
 }
 
+void
+Crava::simulateInParallel(SeismicParametersHolder & seismicParameters,
+                          RandomGen               * randomGen,
+                          PostCovCholesky         * postCovChol)
+{
+  //
+  // Grids are in memory. The realisations are generated a batch at a time,
+  // one per thread. Each realisation draws its noise from its own random
+  // generator, seeded from the main generator and the realisation number, so
+  // the result does not depend on the number of threads. The Cholesky factors
+  // of the posterior covariance are the same for all realisations, and are
+  // computed once. Kriging and writing are done in realisation order.
+  //
+  // Writing is overlapped with the generation of the next batch: one thread
+  // of the parallel region writes the previous batch while the other threads
+  // generate the current one. Two sets of grids are therefore kept, and the
+  // batch size is one less than the number of threads. Kriging is parallel
+  // in itself, and is done between the parallel regions.
+  //
+  bool kriging  = (krigingParameter_ > 0);
+  int  nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  int  nParallel = std::min(std::max(nThreads - 1, 1), nSim_);
+  bool overlap   = (nThreads > 1 && nSim_ > nParallel);
+  int  nSets     = (overlap ? 2 : 1);
+
+  LogKit::LogFormatted(LogKit::Low,"\nGenerating up to %d realisations at a time.\n",nParallel);
+  if(overlap)
+    LogKit::LogFormatted(LogKit::Low,"Each batch is written while the next batch is generated.\n");
+
+  std::vector<FFTGrid *> seed0(nSets*nParallel);
+  std::vector<FFTGrid *> seed1(nSets*nParallel);
+  std::vector<FFTGrid *> seed2(nSets*nParallel);
+  for(int b = 0; b < nSets*nParallel; b++) {
+    seed0[b] = createFFTGrid();
+    seed1[b] = createFFTGrid();
+    seed2[b] = createFFTGrid();
+    seed0[b]->createComplexGrid();
+    seed1[b]->createComplexGrid();
+    seed2[b]->createComplexGrid();
+  }
+
+  // A single draw, so that a seed file is still updated between runs.
+  unsigned long baseSeed = static_cast<unsigned long>(randomGen->unif01()*4294967296.0);
+
+  //
+  // Pass n generates and kriges batch n, and writes batch n-1. The pass after
+  // the last batch only writes.
+  //
+  int nBatches  = (nSim_ + nParallel - 1)/nParallel;
+  int prevFirst = 0;
+  int prevBatch = 0;
+  for(int pass = 0; pass <= nBatches; pass++)
+  {
+    int first  = pass*nParallel;
+    int nBatch = (pass < nBatches ? std::min(nParallel, nSim_ - first) : 0);
+    int nWrite = (pass > 0 ? prevBatch : 0);
+    int set    = (pass % nSets)*nParallel;
+    int prev   = ((pass + 1) % nSets)*nParallel;
+
+    std::string errText = "";
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      int thread = 0;
+      int nTeam  = 1;
+#ifdef _OPENMP
+      thread = omp_get_thread_num();
+      nTeam  = omp_get_num_threads();
+#endif
+      // With a single thread, it writes before it generates.
+      int writer      = nTeam - 1;
+      int nGenerators = std::max(nTeam - 1, 1);
+      try {
+        if(thread == writer) {
+          for(int b = 0; b < nWrite; b++)
+            ParameterOutput::writeParameters(simbox_, modelGeneral_, modelSettings_, seed0[prev+b], seed1[prev+b], seed2[prev+b],
+                                             outputGridsElastic_, fileGrid_, prevFirst + b, kriging);
+        }
+        if(thread < nGenerators) {
+          for(int b = thread; b < nBatch; b += nGenerators) {
+            NRLib::RandomGenerator ranGen;
+            ranGen.Initialize(baseSeed + static_cast<unsigned long>(first + b));
+            generateRealisation(postCovChol, ranGen, seed0[set+b], seed1[set+b], seed2[set+b]);
+          }
+        }
+      }
+      catch (NRLib::Exception & e) {
+#ifdef _OPENMP
+#pragma omp critical(crava_simulation_error)
+#endif
+        {
+          errText += e.what();
+        }
+      }
+    }
+    if(errText != "")
+      throw NRLib::Exception(errText);
+
+    for(int b = 0; b < nBatch; b++) {
+      if(kriging == true) {
+        double wall2=0.0, cpu2=0.0;
+        TimeKit::getTime(wall2,cpu2);
+        doPostKriging(seismicParameters, *seed0[set+b], *seed1[set+b], *seed2[set+b]);
+        Timings::addToTimeKrigingSim(wall2,cpu2);
+      }
+    }
+    prevFirst = first;
+    prevBatch = nBatch;
+  }
+
+  for(int b = 0; b < nSets*nParallel; b++) {
+    delete seed0[b];
+    delete seed1[b];
+    delete seed2[b];
+  }
+}
+
+void
+Crava::generateRealisation(PostCovCholesky        * postCovChol,
+                           NRLib::RandomGenerator & ranGen,
+                           FFTGrid                * seed0,
+                           FFTGrid                * seed1,
+                           FFTGrid                * seed2)
+{
+  seed0->fillInComplexNoise(ranGen);
+  seed1->fillInComplexNoise(ranGen);
+  seed2->fillInComplexNoise(ranGen);
+
+  postCovChol->multiplyNoise(seed0, seed1, seed2);
+
+  seed0->setAccessMode(FFTGrid::RANDOMACCESS);
+  seed0->invFFTInPlace();
+  seed1->setAccessMode(FFTGrid::RANDOMACCESS);
+  seed1->invFFTInPlace();
+  seed2->setAccessMode(FFTGrid::RANDOMACCESS);
+  seed2->invFFTInPlace();
+
+  if(modelAVOdynamic_->getUseLocalNoise()==true)
+  {
+    for(int j=0;j<ny_;j++)
+      for(int i=0;i<nx_;i++)
+        for(int k=0;k<nz_;k++)
+        {
+          float alpha    = seed0->getRealValue(i,j,k);
+          float beta     = seed1->getRealValue(i,j,k);
+          float rho      = seed2->getRealValue(i,j,k);
+          float alphanew = float((*sigmamdnew_)(i,j)[0][0]*alpha+ (*sigmamdnew_)(i,j)[0][1]*beta+(*sigmamdnew_)(i,j)[0][2]*rho);
+          float betanew  = float((*sigmamdnew_)(i,j)[1][0]*alpha+ (*sigmamdnew_)(i,j)[1][1]*beta+(*sigmamdnew_)(i,j)[1][2]*rho);
+          float rhonew   = float((*sigmamdnew_)(i,j)[2][0]*alpha+ (*sigmamdnew_)(i,j)[2][1]*beta+(*sigmamdnew_)(i,j)[2][2]*rho);
+          seed0->setRealValue(i,j,k,alphanew);
+          seed1->setRealValue(i,j,k,betanew);
+          seed2->setRealValue(i,j,k,rhonew);
+        }
+  }
+
+  seed0->add(postAlpha_);
+  seed0->endAccess();
+  seed1->add(postBeta_);
+  seed1->endAccess();
+  seed2->add(postRho_);
+  seed2->endAccess();
+}
+
 void
 Crava::doPostKriging(SeismicParametersHolder & seismicParameters,
                      FFTGrid                 & postAlpha,
                      FFTGrid                 & postBeta,
                      FFTGrid                 & postRho)
 {
+  ProfileScope profile("Crava::doPostKriging");
 
   LogKit::WriteHeader("Kriging to wells");
 
-  CovGridSeparated covGridAlpha      (*seismicParameters.GetCovAlpha()      );
-  CovGridSeparated covGridBeta       (*seismicParameters.GetCovBeta()       );
-  CovGridSeparated covGridRho        (*seismicParameters.GetCovRho()        );
-  CovGridSeparated covGridCrAlphaBeta(*seismicParameters.GetCrCovAlphaBeta());
-  CovGridSeparated covGridCrAlphaRho (*seismicParameters.GetCrCovAlphaRho() );
-  CovGridSeparated covGridCrBetaRho  (*seismicParameters.GetCrCovBetaRho()  );
-
-  KrigingData3D kd(wells_, nWells_, 1); // 1 = full resolution logs
-
-  std::string baseName = "Raw_" + IO::PrefixKrigingData() + IO::SuffixGeneralData();
-  std::string fileName = IO::makeFullFileName(IO::PathToInversionResults(), baseName);
-  kd.writeToFile(fileName);
-
-  CKrigingAdmin pKriging(*simbox_,
-                         kd.getData(), kd.getNumberOfData(),
-                         covGridAlpha, covGridBeta, covGridRho,
-                         covGridCrAlphaBeta, covGridCrAlphaRho, covGridCrBetaRho,
-                         krigingParameter_);
+  //
+  // The kriging data, the covariances and hence the neighbourhoods and their
+  // Cholesky factors are the same for the prediction and all realisations, so
+  // they are set up at the first call only.
+  //
+  if(krigingAdmin_ == NULL) {
+    krigingCovGrids_.push_back(new CovGridSeparated(*seismicParameters.GetCovAlpha()      ));
+    krigingCovGrids_.push_back(new CovGridSeparated(*seismicParameters.GetCovBeta()       ));
+    krigingCovGrids_.push_back(new CovGridSeparated(*seismicParameters.GetCovRho()        ));
+    krigingCovGrids_.push_back(new CovGridSeparated(*seismicParameters.GetCrCovAlphaBeta()));
+    krigingCovGrids_.push_back(new CovGridSeparated(*seismicParameters.GetCrCovAlphaRho() ));
+    krigingCovGrids_.push_back(new CovGridSeparated(*seismicParameters.GetCrCovBetaRho()  ));
+
+    krigingData_ = new KrigingData3D(wells_, nWells_, 1); // 1 = full resolution logs
+
+    std::string baseName = "Raw_" + IO::PrefixKrigingData() + IO::SuffixGeneralData();
+    std::string fileName = IO::makeFullFileName(IO::PathToInversionResults(), baseName);
+    krigingData_->writeToFile(fileName);
+
+    krigingAdmin_ = new CKrigingAdmin(*simbox_,
+                                      krigingData_->getData(), krigingData_->getNumberOfData(),
+                                      *krigingCovGrids_[0], *krigingCovGrids_[1], *krigingCovGrids_[2],
+                                      *krigingCovGrids_[3], *krigingCovGrids_[4], *krigingCovGrids_[5],
+                                      krigingParameter_);
+  }
 
-  pKriging.KrigAll(postAlpha, postBeta, postRho, false, modelSettings_->getDebugFlag(), modelSettings_->getDoSmoothKriging());
+  krigingAdmin_->KrigAll(postAlpha, postBeta, postRho, false, modelSettings_->getDebugFlag(), modelSettings_->getDoSmoothKriging());
 }
 
 FFTGrid *
@@ -1666,6 +2176,7 @@ Crava::computeSeismicImpedance(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho, i
 void
 Crava::computeSyntSeismic(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho)
 {
+  ProfileScope profile("Crava::computeSyntSeismic");
   LogKit::WriteHeader("Compute Synthetic Seismic and Residuals");
 
   bool fftDomain = alpha->getIsTransformed();
@@ -1675,78 +2186,145 @@ Crava::computeSyntSeismic(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho)
     rho->invFFTInPlace();
   }
 
+  bool writeSynthetic = ((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_SEISMIC_DATA) > 0 ||
+                         modelSettings_->getForwardModeling() == true);
+  bool writeResidual  = ((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_RESIDUAL) > 0);
+
+  int cnzp = nzp_/2 + 1;
+  int rnzp = 2*cnzp;
+
   for(int l=0;l<ntheta_;l++) {
     FFTGrid * imp = computeSeismicImpedance(alpha, beta, rho, l);
     imp->setAccessMode(FFTGrid::RANDOMACCESS);
-    for(int i=0;i<nx_; i++) {
+
+    //
+    // The residuals are found in the same pass as the synthetic seismic,
+    // directly in the grid holding the seismic data.
+    //
+    FFTGrid * seis = NULL;
+    if(writeResidual) {
+      seis = new FFTGrid(nx_, ny_, nz_, nxp_, nyp_, nzp_);
+      std::string fileName = IO::makeFullFileName(IO::PathToSeismicData(), IO::FileTemporarySeismic()+NRLib::ToString(l)+IO::SuffixCrava());
+      std::string errText;
+      seis->readCravaFile(fileName, errText);
+      if(errText == "") {
+        seis->setType(FFTGrid::DATA);
+        seis->setAccessMode(FFTGrid::RANDOMACCESS);
+      }
+      else {
+        errText += "\nFailed to read temporary stored seismic data.\n";
+        LogKit::LogMessage(LogKit::Error,errText);
+        delete seis;
+        seis = NULL;
+      }
+    }
+
+    //
+    // The wavelet must be in the time domain before it is copied.
+    //
+    if(seisWavelet_[l]->getIsReal() == false)
+      seisWavelet_[l]->invFFT1DInPlace();
+    Wavelet1D fftWavelet(seisWavelet_[l]);
+    fftWavelet.fft1DInPlace();
+
+    //
+    // The traces are independent, so rows of traces are computed in parallel.
+    // Each thread makes its work array and local wavelet once, and the traces
+    // of a row are transformed together. The stretch interpolation is only
+    // redone when the stretch differs from that of the previous trace.
+    //
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      Wavelet1D * workWavelet = new Wavelet1D(seisWavelet_[l]);
+      workWavelet->fft1DInPlace();
+
+      fftw_real * rRow = static_cast<fftw_real*>(fftw_malloc(nx_*rnzp*sizeof(fftw_real)));
+
+      std::vector<float> impTrace(nzp_);
+      std::vector<float> wRe(cnzp);
+      std::vector<float> wIm(cnzp);
+      Wavelet::StretchTable stretch;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
       for(int j=0;j<ny_;j++) {
-        Wavelet1D impVec(0,nz_, nzp_);
-        //impVec.setupAsVector();
-        int k;
-        for(k=0;k<nz_;k++){
-          float value = imp->getRealValue(i, j, k, true);
-          impVec.setRAmp(value, k);
-        }
-        //Tapering:
-        float fac = 1.0f/static_cast<float>(nzp_-nz_-1);
-        for(;k<nzp_;k++) {
-          float value = fac*((k-nz_)*impVec.getRAmp(0)+(nzp_-k-1)*impVec.getRAmp(nz_-1));
-          impVec.setRAmp(value, k);
+        for(int i=0;i<nx_; i++) {
+          int k;
+          for(k=0;k<nz_;k++)
+            impTrace[k] = imp->getRealValue(i, j, k, true);
+          //Tapering:
+          float fac = 1.0f/static_cast<float>(nzp_-nz_-1);
+          for(;k<nzp_;k++)
+            impTrace[k] = fac*((k-nz_)*impTrace[0]+(nzp_-k-1)*impTrace[nz_-1]);
+
+          // First order forward difference
+          fftw_real * rData = rRow + i*rnzp;
+          for(k=0;k<nzp_-1;k++)
+            rData[k] = impTrace[k+1] - impTrace[k];
+          rData[nzp_-1] = impTrace[0] - impTrace[nzp_-1];
         }
-        Wavelet1D resultVec(&impVec, Wavelet::FIRSTORDERFORWARDDIFF);
-        resultVec.fft1DInPlace();
 
-        Wavelet1D * localWavelet = seisWavelet_[l]->createLocalWavelet1D(i,j);
+        Utils::fft(rRow, nzp_, nx_);
+
+        for(int i=0;i<nx_; i++) {
+          Wavelet1D * localWavelet = workWavelet;
+          if(seisWavelet_[l]->fillLocalWavelet1D(workWavelet, &fftWavelet, i, j) == false) {
+#ifdef _OPENMP
+#pragma omp critical(crava_local_wavelet)
+#endif
+            {
+              localWavelet = seisWavelet_[l]->createLocalWavelet1D(i,j);
+            }
+          }
 
-        float sf = static_cast<float>(simbox_->getRelThick(i, j))*seisWavelet_[l]->getLocalStretch(i,j);
+          float sf = static_cast<float>(simbox_->getRelThick(i, j))*seisWavelet_[l]->getLocalStretch(i,j);
+          if(stretch.n == 0 || sf != stretch.scale)
+            localWavelet->fillStretchTable(sf, stretch);
+          localWavelet->getCAmpStretched(stretch, &wRe[0], &wIm[0]); // complex conjugate, as getCAmp
 
-        for(int k=0;k<(nzp_/2 +1);k++) {
-          fftw_complex r = resultVec.getCAmp(k);
-          fftw_complex w = localWavelet->getCAmp(k,static_cast<float>(sf));// returns complex conjugate
-          fftw_complex s;
-          s.re = r.re*w.re+r.im*w.im; //Use complex conjugate of w
-          s.im = -r.re*w.im+r.im*w.re;
-          resultVec.setCAmp(s,k);
+          fftw_complex * cData = reinterpret_cast<fftw_complex*>(rRow + i*rnzp);
+          for(int k=0;k<cnzp;k++) {
+            fftw_complex r = cData[k];
+            cData[k].re = r.re*wRe[k]+r.im*wIm[k]; //Use complex conjugate of w
+            cData[k].im = -r.re*wIm[k]+r.im*wRe[k];
+          }
+          if(localWavelet != workWavelet)
+            delete localWavelet;
         }
-        delete localWavelet;
 
-        resultVec.invFFT1DInPlace();
-        for(int k=0;k<nzp_;k++){
-          float value = resultVec.getRAmp(k);
-          imp->setRealValue(i, j, k, value, true);
+        Utils::fftInv(reinterpret_cast<fftw_complex*>(rRow), nzp_, nx_);
+
+        for(int i=0;i<nx_; i++) {
+          fftw_real * rData = rRow + i*rnzp;
+          for(int k=0;k<nzp_;k++)
+            imp->setRealValue(i, j, k, rData[k], true);
+          if(seis != NULL) {
+            for(int k=0;k<nz_;k++) {
+              float residual = seis->getRealValue(i, j, k) - rData[k];
+              seis->setRealValue(i, j, k, residual);
+            }
+          }
         }
       }
+
+      fftw_free(rRow);
+      delete workWavelet;
     }
+
     std::string angle     = NRLib::ToString(thetaDeg_[l],1);
     std::string sgriLabel = " Synthetic seismic for incidence angle "+angle;
     std::string fileName  = IO::PrefixSyntheticSeismicData() + angle;
-    if(((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_SEISMIC_DATA) > 0) ||
-      (modelSettings_->getForwardModeling() == true))
+    if(writeSynthetic)
       imp->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
-    if((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_RESIDUAL) > 0) {
-      FFTGrid seis(nx_, ny_, nz_, nxp_, nyp_, nzp_);
-
-      std::string fileName = IO::makeFullFileName(IO::PathToSeismicData(), IO::FileTemporarySeismic()+NRLib::ToString(l)+IO::SuffixCrava());
-      std::string errText;
-      seis.readCravaFile(fileName, errText);
-      if(errText == "") {
-        seis.setAccessMode(FFTGrid::RANDOMACCESS);
-        for(int k=0;k<nz_;k++) {
-          for(int j=0;j<ny_;j++) {
-            for(int i=0;i<nx_;i++) {
-              float residual = seis.getRealValue(i, j, k) - imp->getRealValue(i,j,k);
-              imp->setRealValue(i, j, k, residual);
-            }
-          }
-        }
-        sgriLabel = "Residual computed from synthetic seismic for incidence angle "+angle;
-        fileName = IO::PrefixSyntheticResiduals() + angle;
-        imp->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
-      }
-      else {
-        errText += "\nFailed to read temporary stored seismic data.\n";
-        LogKit::LogMessage(LogKit::Error,errText);
-      }
+    if(seis != NULL) {
+      sgriLabel = "Residual computed from synthetic seismic for incidence angle "+angle;
+      fileName  = IO::PrefixSyntheticResiduals() + angle;
+      seis->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
+      seis->endAccess();
+      delete seis;
     }
     delete imp;
   }
@@ -1781,8 +2359,9 @@ Crava::fillkW_flens(int                     k,
                     Wavelet              ** seisWavelet)
 {
   for(int l = 0; l < ntheta_; l++) {
-    double kWR =  static_cast<double>( seisWavelet[l]->getCAmp(k).re );
-    double kWI = -static_cast<double>( seisWavelet[l]->getCAmp(k).im ); // adjust for complex conjugate in getCAmp(k)
+    fftw_complex w = seisWavelet[l]->getCAmp(k);
+    double kWR =  static_cast<double>( w.re );
+    double kWI = -static_cast<double>( w.im ); // adjust for complex conjugate in getCAmp(k)
     kW(l) = std::complex<double>(kWR, kWI);
   }
 }
@@ -1794,8 +2373,9 @@ Crava::fillkWNorm_flens(int                     k,
 {
   for (int l = 0; l < ntheta_; l++)
   {
-    double kWNormR =  static_cast<double>(wavelet[l]->getCAmp(k).re/wavelet[l]->getNorm());
-    double kWNormI = -static_cast<double>(wavelet[l]->getCAmp(k).im/wavelet[l]->getNorm()); // // adjust for complex conjugate in getCAmp(k)
+    fftw_complex w = wavelet[l]->getCAmp(k);
+    double kWNormR =  static_cast<double>(w.re/wavelet[l]->getNorm());
+    double kWNormI = -static_cast<double>(w.im/wavelet[l]->getNorm()); // // adjust for complex conjugate in getCAmp(k)
     kWNorm(l) = std::complex<double>(kWNormR, kWNormI);
   }
 }
@@ -1888,6 +2468,7 @@ Crava::computeFaciesProb(SpatialWellFilter             * filteredlogs,
                          bool                            useFilter,
                          SeismicParametersHolder       & seismicParameters)
 {
+  ProfileScope profile("Crava::computeFaciesProb");
   ModelSettings * modelSettings = modelSettings_;
 
   if(modelSettings->getEstimateFaciesProb())
@@ -6,6 +6,7 @@
 #define CRAVA_H
 
 #include "fftw.h"
+#include "lib/lib_matrbatch.h"
 #include "definitions.h"
 #include "libs/nrlib/flens/nrlib_flens.hpp"
 
@@ -27,6 +28,10 @@ class GridMapping;
 class ModelSettings;
 class SpatialWellFilter;
 class SeismicParametersHolder;
+class PostCovCholesky;
+namespace NRLib {
+  class RandomGenerator;
+}
 
 
 class Crava
@@ -63,6 +68,67 @@ public:
   NRLib::Matrix          computeFilter(NRLib::SymmetricMatrix & priorCov,
                                        NRLib::SymmetricMatrix & posteriorCov) const;
 
+  // Work buffers for the posterior solve in one frequency cell. One set per thread.
+  class FrequencySolveBuffers
+  {
+  public:
+    FrequencySolveBuffers(int ntheta);
+    ~FrequencySolveBuffers();
+
+    fftw_complex  * kW;
+    fftw_complex  * errMult1;
+    fftw_complex  * errMult2;
+    fftw_complex  * errMult3;
+    fftw_complex  * ijkData;
+    fftw_complex  * ijkDataMean;
+    fftw_complex  * ijkRes;
+    fftw_complex  * ijkMean;
+    fftw_complex  * ijkAns;
+    fftw_complex ** K;
+    fftw_complex ** KS;
+    fftw_complex ** KScc;
+    fftw_complex ** parVar;
+    fftw_complex ** margVar;
+    fftw_complex ** errVar;
+    fftw_complex ** reduceVar;
+
+  private:
+    FrequencySolveBuffers(const FrequencySolveBuffers &);
+    FrequencySolveBuffers & operator=(const FrequencySolveBuffers &);
+
+    int             ntheta_;
+  };
+
+  // Work buffers for the posterior solve in one row of frequency cells, stored as batches. One set per thread.
+  class FrequencyRowBuffers
+  {
+  public:
+    FrequencyRowBuffers(int ntheta, int nCells);
+    ~FrequencyRowBuffers();
+
+    lib_matrBatchCpx * mean;
+    lib_matrBatchCpx * data;
+    lib_matrBatchCpx * dataMean;
+    lib_matrBatchCpx * res;
+    lib_matrBatchCpx * ans;
+    lib_matrBatchCpx * KS;
+    lib_matrBatchCpx * KScc;
+    lib_matrBatchCpx * parVar;
+    lib_matrBatchCpx * margVar;
+    lib_matrBatchCpx * errVar;
+    lib_matrBatchCpx * reduceVar;
+    int              * cholFlag;  // 0 if the Cholesky factorization of the cell is O.K.
+
+  private:
+    FrequencyRowBuffers(const FrequencyRowBuffers &);
+    FrequencyRowBuffers & operator=(const FrequencyRowBuffers &);
+  };
+
+  // Posterior solve for a row of frequency cells sharing K. Public so that
+  // the benchmark program times the same kernel as the inversion.
+  static void            solveFrequencyRow(FrequencySolveBuffers & buffers,
+                                           FrequencyRowBuffers   & row);
+
 private:
   void                   computeDataVariance(void);
   void                   setupErrorCorrelation(const std::vector<Grid2D *> & noiseScale);
@@ -122,6 +188,15 @@ private:
   void                   multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName);
   void                   doPostKriging(SeismicParametersHolder & seismicParameters, FFTGrid & postAlpha, FFTGrid & postBeta, FFTGrid & postRho);
 
+  void                   simulateInParallel(SeismicParametersHolder & seismicParameters,
+                                            RandomGen               * randomGen,
+                                            PostCovCholesky         * postCovChol);
+  void                   generateRealisation(PostCovCholesky        * postCovChol,
+                                             NRLib::RandomGenerator & ranGen,
+                                             FFTGrid                * seed0,
+                                             FFTGrid                * seed1,
+                                             FFTGrid                * seed2);
+
   void                   correctAlphaBetaRho(ModelSettings * modelSettings);
 
   FFTGrid *              computeSeismicImpedance(FFTGrid * alpha,
@@ -134,14 +209,26 @@ private:
   void                   SetComplexVector(NRLib::ComplexVector & V,
                                           fftw_complex         * v);
 
-  void                   getNextErrorVariance(fftw_complex **& errVar,
-                                              fftw_complex   * errMult1,
-                                              fftw_complex   * errMult2,
-                                              fftw_complex   * errMult3,
-                                              int              ntheta,
-                                              float            wnc,
-                                              double        ** errThetaCov,
-                                              bool             invert_frequency) const;
+  bool                   setupFrequencyPlane(int                     k,
+                                             Wavelet1D             * diff1Operator,
+                                             Wavelet1D             * diff3Operator,
+                                             Wavelet1D            ** errorSmooth3,
+                                             Wavelet1D            ** seisWaveletForNorm,
+                                             FrequencySolveBuffers & buffers);
+
+  void                   solveFrequencyCell(fftw_complex            ijkErrCorr,
+                                            bool                    invert_frequency,
+                                            FrequencySolveBuffers & buffers) const;
+
+  void                   getErrorVariance(fftw_complex  ** errVar,
+                                          fftw_complex     ijkErrCorr,
+                                          fftw_complex   * errMult1,
+                                          fftw_complex   * errMult2,
+                                          fftw_complex   * errMult3,
+                                          int              ntheta,
+                                          float            wnc,
+                                          double        ** errThetaCov,
+                                          bool             invert_frequency) const;
 
   bool               fileGrid_;         // is true if is storage is on file
   const Simbox     * simbox_;           // the simbox
@@ -196,6 +283,10 @@ private:
   std::vector<WellData *> wells_;
   int                     nWells_;
 
+  CKrigingAdmin                  * krigingAdmin_;     // Kept between calls to doPostKriging, so that
+  KrigingData3D                  * krigingData_;      // neighbourhoods and factorisations are reused
+  std::vector<CovGridSeparated *>  krigingCovGrids_;  // by all realisations
+
   int                scaleWarning_;
   std::string        scaleWarningText_;
 
@@ -13,6 +13,7 @@
 #include "src/seismicparametersholder.h"
 #include "src/simbox.h"
 #include "src/gravimetricinversion.h"
+#include "src/profiler.h"
 
 void setupStaticModels(ModelGeneral            *& modelGeneral,
                        ModelAVOStatic          *& modelAVOstatic,
@@ -22,6 +23,7 @@ void setupStaticModels(ModelGeneral            *& modelGeneral,
                        SeismicParametersHolder  & seismicParameters,
                        Simbox                  *& timeBGSimbox)
 {
+  ProfileScope profile("setupStaticModels");
   // Construct ModelGeneral object first.
   // For each data type, construct the static model class before the dynamic.
   modelGeneral    = new ModelGeneral(modelSettings, inputFiles, seismicParameters, timeBGSimbox);
@@ -47,6 +49,7 @@ bool doFirstAVOInversion(ModelSettings           * modelSettings,
                          int                       vintage,
                          Simbox                  * timeBGSimbox)
 {
+  ProfileScope profile("doFirstAVOInversion");
 
   ModelAVODynamic * modelAVOdynamic = NULL;
 
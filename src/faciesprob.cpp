@@ -40,6 +40,7 @@
 #include "src/posteriorelasticpdf3d.h"
 #include "src/posteriorelasticpdf4d.h"
 #include "src/seismicparametersholder.h"
+#include "src/profiler.h"
 
 
 FaciesProb::FaciesProb(FFTGrid                           * alpha,
@@ -1316,35 +1317,31 @@ float FaciesProb::FindDensityFromPosteriorPDF(const double
     return 0.0;
 }
 
-float FaciesProb::findDensity(float                                       alpha,
-                              float                                       beta,
-                              float                                       rho,
-                              const std::vector<std::vector<FFTGrid*> > & density,
-                              int                                         facies,
-                              const std::vector<Simbox *>               & volume,
-                              const std::vector<float>                  & t,
-                              int                                         nAng)
+void FaciesProb::findInterpolationWeights(const Simbox * volume,
+                                          float          alpha,
+                                          float          beta,
+                                          float          rho,
+                                          int          & j1,
+                                          int          & j2,
+                                          float        & wj,
+                                          int          & k1,
+                                          int          & k2,
+                                          float        & wk,
+                                          int          & l1,
+                                          int          & l2,
+                                          float        & wl)
 {
   double jFull, kFull, lFull;
+  volume->getInterpolationIndexes(alpha, beta, rho, jFull, kFull, lFull);
 
-  int i;
-  int dim = static_cast<int>(density.size());
-  std::vector<float> value(dim);
-  for(i=0;i<dim;i++)
-  {
-  volume[i]->getInterpolationIndexes(alpha, beta, rho, jFull, kFull, lFull);
-  int j1,k1,l1;
-  int j2,k2,l2;
-  float wj,wk,wl;
-  j1=k1=l1=j2=k2=l2=0;
   j1 = static_cast<int>(floor(jFull));
   if(j1<0) {
     j1 = 0;
     j2 = 0;
     wj = 0;
   }
-  else if(j1>=volume[i]->getnx()-1) {
-    j1 = volume[i]->getnx()-1;
+  else if(j1>=volume->getnx()-1) {
+    j1 = volume->getnx()-1;
     j2 = j1;
     wj = 0;
   }
@@ -1359,8 +1356,8 @@ float FaciesProb::findDensity(float                                       alpha,
     k2 = 0;
     wk = 0;
   }
-  else if(k1>=volume[i]->getny()-1) {
-    k1 = volume[i]->getny()-1;
+  else if(k1>=volume->getny()-1) {
+    k1 = volume->getny()-1;
     k2 = k1;
     wk = 0;
   }
@@ -1375,8 +1372,8 @@ float FaciesProb::findDensity(float                                       alpha,
     l2 = 0;
     wl = 0;
   }
-  else if(l1>=volume[i]->getnz()-1) {
-    l1 = volume[i]->getnz()-1;
+  else if(l1>=volume->getnz()-1) {
+    l1 = volume->getnz()-1;
     l2 = l1;
     wl = 0;
   }
@@ -1384,56 +1381,119 @@ float FaciesProb::findDensity(float                                       alpha,
     l2 = l1 + 1;
     wl = static_cast<float>(lFull-l1);
   }
+}
 
-
-    density[i][facies]->setAccessMode(FFTGrid::RANDOMACCESS);
-    float value1 = std::max<float>(0,density[i][facies]->getRealValue(j1,k1,l1));
-    float value2 = std::max<float>(0,density[i][facies]->getRealValue(j1,k1,l2));
-    float value3 = std::max<float>(0,density[i][facies]->getRealValue(j1,k2,l1));
-    float value4 = std::max<float>(0,density[i][facies]->getRealValue(j1,k2,l2));
-    float value5 = std::max<float>(0,density[i][facies]->getRealValue(j2,k1,l1));
-    float value6 = std::max<float>(0,density[i][facies]->getRealValue(j2,k1,l2));
-    float value7 = std::max<float>(0,density[i][facies]->getRealValue(j2,k2,l1));
-    float value8 = std::max<float>(0,density[i][facies]->getRealValue(j2,k2,l2));
-    density[i][facies]->endAccess();
-    //float value=0;
-    value[i] = 0;
-    value[i] += (1.0f-wj)*(1.0f-wk)*(1.0f-wl)*value1;
-    value[i] += (1.0f-wj)*(1.0f-wk)*(     wl)*value2;
-    value[i] += (1.0f-wj)*(     wk)*(1.0f-wl)*value3;
-    value[i] += (1.0f-wj)*(     wk)*(     wl)*value4;
-    value[i] += (     wj)*(1.0f-wk)*(1.0f-wl)*value5;
-    value[i] += (     wj)*(1.0f-wk)*(     wl)*value6;
-    value[i] += (     wj)*(     wk)*(1.0f-wl)*value7;
-    value[i] += (     wj)*(     wk)*(     wl)*value8;
+void FaciesProb::packDensities(const std::vector<std::vector<FFTGrid*> > & density,
+                               const std::vector<Simbox *>               & volume,
+                               int                                         nFacies,
+                               DensityTable                              & table)
+{
+  //
+  // Copies the (nonnegative) density grids to one array per volume, with the
+  // facies innermost. The value of facies f in node (j,k,l) is found at
+  //
+  //   ((l*ny + k)*nx + j)*nFacies + f
+  //
+  // so that each corner of a trilinear lookup gives all facies at once.
+  //
+  int dim = static_cast<int>(density.size());
+  table.resize(dim);
+  for(int i=0;i<dim;i++)
+  {
+    int nx = volume[i]->getnx();
+    int ny = volume[i]->getny();
+    int nz = volume[i]->getnz();
+    table[i].resize(static_cast<size_t>(nx)*ny*nz*nFacies);
+    for(int f=0;f<nFacies;f++)
+    {
+      density[i][f]->setAccessMode(FFTGrid::RANDOMACCESS);
+      for(int l=0;l<nz;l++)
+        for(int k=0;k<ny;k++)
+          for(int j=0;j<nx;j++)
+            table[i][((static_cast<size_t>(l)*ny + k)*nx + j)*nFacies + f] = std::max<float>(0,density[i][f]->getRealValue(j,k,l));
+      density[i][f]->endAccess();
+    }
   }
+}
 
-  int factor = 1;
-  float valuesum = 0;
-  for(i=0;i<dim;i++)
+void FaciesProb::findDensities(float                                       alpha,
+                               float                                       beta,
+                               float                                       rho,
+                               const DensityTable                        & table,
+                               const std::vector<Simbox *>               & volume,
+                               const std::vector<float>                  & t,
+                               int                                         nAng,
+                               int                                         nFacies,
+                               float                                     * work,
+                               float                                     * dens)
+{
+  //
+  // Trilinear interpolation of the densities of all facies at (alpha,beta,rho)
+  // in each volume, using the table from packDensities. The volume values are
+  // combined with the angle weights t. The interpolation weights are found
+  // once for all facies.
+  // 'work' must hold nFacies values for each volume.
+  //
+  int dim = static_cast<int>(table.size());
+  for(int i=0;i<dim;i++)
   {
-    factor = 1;
-    for(int j=0;j<nAng;j++)
+    int j1,k1,l1;
+    int j2,k2,l2;
+    float wj,wk,wl;
+    findInterpolationWeights(volume[i], alpha, beta, rho, j1, j2, wj, k1, k2, wk, l1, l2, wl);
+
+    size_t nx = static_cast<size_t>(volume[i]->getnx());
+    size_t ny = static_cast<size_t>(volume[i]->getny());
+    const float * node   = &table[i][0];
+    const float * value1 = node + ((l1*ny + k1)*nx + j1)*nFacies;
+    const float * value2 = node + ((l2*ny + k1)*nx + j1)*nFacies;
+    const float * value3 = node + ((l1*ny + k2)*nx + j1)*nFacies;
+    const float * value4 = node + ((l2*ny + k2)*nx + j1)*nFacies;
+    const float * value5 = node + ((l1*ny + k1)*nx + j2)*nFacies;
+    const float * value6 = node + ((l2*ny + k1)*nx + j2)*nFacies;
+    const float * value7 = node + ((l1*ny + k2)*nx + j2)*nFacies;
+    const float * value8 = node + ((l2*ny + k2)*nx + j2)*nFacies;
+
+    float * value = work + i*nFacies;
+    for(int f=0;f<nFacies;f++)
     {
-      if(j>0)
-        factor*=2;
-      if((i & factor) > 0)
-        value[i]*=t[j];
-      else
-        value[i]*=(1-t[j]);
+      value[f] = 0;
+      value[f] += (1.0f-wj)*(1.0f-wk)*(1.0f-wl)*value1[f];
+      value[f] += (1.0f-wj)*(1.0f-wk)*(     wl)*value2[f];
+      value[f] += (1.0f-wj)*(     wk)*(1.0f-wl)*value3[f];
+      value[f] += (1.0f-wj)*(     wk)*(     wl)*value4[f];
+      value[f] += (     wj)*(1.0f-wk)*(1.0f-wl)*value5[f];
+      value[f] += (     wj)*(1.0f-wk)*(     wl)*value6[f];
+      value[f] += (     wj)*(     wk)*(1.0f-wl)*value7[f];
+      value[f] += (     wj)*(     wk)*(     wl)*value8[f];
     }
-
-    valuesum += value[i];
   }
 
-  if (valuesum > 0.0)
-    return(valuesum);
-  else
-    return 0.0;
+  for(int f=0;f<nFacies;f++)
+  {
+    float valuesum = 0;
+    for(int i=0;i<dim;i++)
+    {
+      float value = work[i*nFacies + f];
+      int factor = 1;
+      for(int j=0;j<nAng;j++)
+      {
+        if(j>0)
+          factor*=2;
+        if((i & factor) > 0)
+          value*=t[j];
+        else
+          value*=(1-t[j]);
+      }
+      valuesum += value;
+    }
+    if (valuesum > 0.0)
+      dens[f] = valuesum;
+    else
+      dens[f] = 0.0;
+  }
 }
 
-
-
 void FaciesProb::resampleAndWriteDensity(const FFTGrid     * const density,
                                     const std::string & fileName,
                                     const Simbox      * origVol,
@@ -1926,10 +1986,11 @@ void FaciesProb::calculateFaciesProb(FFTGrid
                                      const std::vector<Grid2D *>                & noiseScale,
                                      FFTGrid                                    * seismicLH)
 {
+  ProfileScope profile("FaciesProb::calculateFaciesProb");
   float * value = new float[nFacies_];
   int i,j,k,l;
   int nx, ny, nz, rnxp, nyp, nzp, smallrnxp;
-  float alpha, beta, rho, sum;
+  float sum;
 
 
   rnxp = alphagrid->getRNxp();
@@ -1975,7 +2036,6 @@ void FaciesProb::calculateFaciesProb(FFTGrid
   for(i=0;i<int(noiseScale.size());i++)
     if(noiseScale[i]!=NULL)
       nAng++;
-  std::vector<float> t(nAng);
   double maxS;
   double minS;
   std::vector<Grid2D *> tgrid(nAng);
@@ -2000,6 +2060,21 @@ void FaciesProb::calculateFaciesProb(FFTGrid
     << "\n  |    |    |    |    |    |    |    |    |    |    |  "
     << "\n  ^";
 
+  //
+  // The densities of a z-plane are computed for all facies at once, from a
+  // copy of the density grids with the facies innermost. The traces of the
+  // plane are independent, so they are computed in parallel before the
+  // plane is written sequentially.
+  //
+  DensityTable densityTable;
+  packDensities(density, volume, nFacies_, densityTable);
+
+  int dim = static_cast<int>(volume.size());
+  std::vector<float> alphaPlane(static_cast<size_t>(nyp)*rnxp);
+  std::vector<float> betaPlane(static_cast<size_t>(nyp)*rnxp);
+  std::vector<float> rhoPlane(static_cast<size_t>(nyp)*rnxp);
+  std::vector<float> densPlane(static_cast<size_t>(ny)*nx*nFacies_);
+
   float help;
   float dens;
   float undefSum = p_undefined/(volume[0]->getnx()*volume[0]->getny()*volume[0]->getnz());
@@ -2009,23 +2084,46 @@ void FaciesProb::calculateFaciesProb(FFTGrid
     {
       for(k=0;k<rnxp;k++)
       {
-        alpha = alphagrid->getNextReal();
-        beta = betagrid->getNextReal();
-        rho = rhogrid->getNextReal();
-        if(k<smallrnxp && j<ny && i<nz)
+        alphaPlane[j*rnxp+k] = alphagrid->getNextReal();
+        betaPlane[j*rnxp+k]  = betagrid->getNextReal();
+        rhoPlane[j*rnxp+k]   = rhogrid->getNextReal();
+      }
+    }
+    if(i<nz)
+    {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        std::vector<float> tCell(nAng);
+        std::vector<float> work(dim*nFacies_);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+        for(int jj=0;jj<ny;jj++)
+        {
+          for(int kk=0;kk<nx;kk++)
+          {
+            for(int angle = 0;angle<nAng;angle++)
+              tCell[angle] = float((*tgrid[angle])(kk,jj));
+            findDensities(alphaPlane[jj*rnxp+kk], betaPlane[jj*rnxp+kk], rhoPlane[jj*rnxp+kk],
+                          densityTable, volume, tCell, nAng, nFacies_, &work[0],
+                          &densPlane[(static_cast<size_t>(jj)*nx+kk)*nFacies_]);
+          }
+        }
+      }
+
+      for(j=0;j<ny;j++)
+      {
+        for(k=0;k<smallrnxp;k++)
         {
           sum = undefSum;
           for(l=0;l<nFacies_;l++)
           {
             if(k<nx)
-            {
-              for(int angle = 0;angle<nAng;angle++)
-                t[angle] = float((*tgrid[angle])(k,j));
-              dens = findDensity(alpha, beta, rho, density, l,volume, t, nAng);
-            }
-            else{
+              dens = densPlane[(static_cast<size_t>(j)*nx+k)*nFacies_+l];
+            else
               dens = 1.0;
-            }
             if(priorFaciesCubes.size() != 0)
               value[l] = priorFaciesCubes[l]->getNextReal()*dens;
             else
@@ -2098,6 +2196,7 @@ void FaciesProb::CalculateFaciesProbFromPosteriorElasticPDF(FFTGrid
                                                             bool                                                        faciesProbFromRockPhysics,
                                                             CravaTrend                                                & trend_cubes)
 {
+  ProfileScope profile("FaciesProb::CalculateFaciesProbFromPosteriorElasticPDF");
   assert (nDimensions == 3 || nDimensions == 4 || nDimensions == 5);
   float * value = new float[nFacies_];
   //int i,j,k,l;
@@ -2215,12 +2314,12 @@ void FaciesProb::CalculateFaciesProbFromPosteriorElasticPDF(FFTGrid
         }
         if(k<smallrnxp && j<ny && i<nz){
           sum = undefSum;
+          if(k<nx && !faciesProbFromRockPhysics){
+            for(int angle = 0; angle<nAng; angle++)
+              t[angle] = float((*tgrid[angle])(k,j));
+          }
           for(int l=0;l<nFacies_;l++){
             if(k<nx){
-              if(!faciesProbFromRockPhysics){
-                for(int angle = 0; angle<nAng; angle++)
-                  t[angle] = float((*tgrid[angle])(k,j));
-              }
               dens = FindDensityFromPosteriorPDF(alpha, beta, rho, t1, t2, posteriorPdf, l, volume, t, nAng, faciesProbFromRockPhysics);
             }
             else
@@ -111,6 +111,27 @@ public:
   void writeBWFaciesProb(std::vector<WellData *> wells,
                          int                     nWells);
 
+  // All facies densities of the density volumes, with the facies innermost. See packDensities.
+  typedef std::vector<std::vector<float> > DensityTable;
+
+  // The density lookup of calculateFaciesProb. Public so that the benchmark
+  // program times the same kernel as the inversion.
+  static void            packDensities(const std::vector<std::vector<FFTGrid*> > & density,
+                                       const std::vector<Simbox *>               & volume,
+                                       int                                         nFacies,
+                                       DensityTable                              & table);
+
+  static void            findDensities(float                                       alpha,
+                                       float                                       beta,
+                                       float                                       rho,
+                                       const DensityTable                        & table,
+                                       const std::vector<Simbox *>               & volume,
+                                       const std::vector<float>                  & t,
+                                       int                                         nAng,
+                                       int                                         nFacies,
+                                       float                                     * work,
+                                       float                                     * dens);
+
 private:
 
 
@@ -246,14 +267,19 @@ private:
                                             float                    & varBeta,
                                             float                    & varRho);
 
-  float                  findDensity(float                                       alpha,
-                                     float                                       beta,
-                                     float                                       rho,
-                                     const std::vector<std::vector<FFTGrid*> > & density,
-                                     int                                         facies,
-                                     const std::vector<Simbox *>               & volume,
-                                     const std::vector<float>                  & t,
-                                     int                                         nAng);
+  static void            findInterpolationWeights(const Simbox * volume,
+                                                  float          alpha,
+                                                  float          beta,
+                                                  float          rho,
+                                                  int          & j1,
+                                                  int          & j2,
+                                                  float        & wj,
+                                                  int          & k1,
+                                                  int          & k2,
+                                                  float        & wk,
+                                                  int          & l1,
+                                                  int          & l2,
+                                                  float        & wl);
 
   float                  FindDensityFromPosteriorPDF(const double                                          & alpha,
                                                      const double                                          & beta,
@@ -20,12 +20,26 @@
 #include "src/fftfilegrid.h"
 #include "src/simbox.h"
 #include "src/io.h"
+#include "src/profiler.h"
 
 FFTFileGrid::FFTFileGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp) :
 FFTGrid(nx, ny, nz, nxp, nyp, nzp)
 {
   genFileName();
   accMode_=NONE;
+
+  readBuffer_     = NULL;
+  readPos_        = 0;
+  readEnd_        = 0;
+  writeBuffer_    = NULL;
+  writePos_       = 0;
+  nPageIn_        = 0;
+  nPageOut_       = 0;
+  bytesIn_        = 0.0;
+  bytesOut_       = 0.0;
+  locked_         = false;
+  dirty_          = false;
+  lastUse_        = 0;
 }
 
 FFTFileGrid::FFTFileGrid(FFTFileGrid  * fftGrid, bool expTrans) :
@@ -55,6 +69,22 @@ FFTGrid()
   fNameIn_        = "";
   accMode_        = NONE;
 
+  readBuffer_     = NULL;
+  readPos_        = 0;
+  readEnd_        = 0;
+  writeBuffer_    = NULL;
+  writePos_       = 0;
+  nPageIn_        = 0;
+  nPageOut_       = 0;
+  bytesIn_        = 0.0;
+  bytesOut_       = 0.0;
+  locked_         = false;
+  dirty_          = false;
+  lastUse_        = 0;
+  rvalue_         = NULL;
+  cvalue_         = NULL;
+  add_            = true;
+
   setAccessMode(WRITE);
   fftGrid->setAccessMode(READ);
 
@@ -92,6 +122,11 @@ FFTGrid()
 FFTFileGrid::~FFTFileGrid()
 {
   endAccess();
+  if(rvalue_ != NULL)
+    freeValues();
+  if(nPageIn_ > 0 || nPageOut_ > 0)
+    LogKit::LogFormatted(LogKit::DebugLow,"\nTemporary grid %s paged in %d times (%.1f MB) and out %d times (%.1f MB)\n",
+                         fNameOut_.c_str(), nPageIn_, bytesIn_/(1024.0*1024.0), nPageOut_, bytesOut_/(1024.0*1024.0));
   if(fNameIn_ != "")
   {
     remove(fNameIn_.c_str());
@@ -107,14 +142,31 @@ FFTFileGrid::setAccessMode(int mode)
   switch(mode)
   {
   case READ:
-    NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
+    if(useMemory(true))
+      counterForGet_ = 0;
+    else {
+      NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
+      openStreamBuffers(mode);
+    }
     break;
   case WRITE:
-    NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+    if(useMemory(false))
+      counterForSet_ = 0;
+    else {
+      NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+      openStreamBuffers(mode);
+    }
     break;
   case READANDWRITE:
-    NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
-    NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+    if(useMemory(true)) {
+      counterForGet_ = 0;
+      counterForSet_ = 0;
+    }
+    else {
+      NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
+      NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+      openStreamBuffers(mode);
+    }
     break;
   case RANDOMACCESS:
     modified_ = 0;
@@ -127,16 +179,30 @@ FFTFileGrid::setAccessMode(int mode)
 void
 FFTFileGrid::endAccess()
 {
+  int mode = accMode_;
+  accMode_ = NONE;
+
+  if(mode != NONE && rvalue_ != NULL) { // Accessed in memory
+    if(mode == READ || (mode == RANDOMACCESS && modified_ == 0))
+      unload();
+    else
+      save();
+    return;
+  }
+
   std::string tmp("");
-  switch(accMode_)
+  switch(mode)
   {
   case READ:
     inFile_.close();
+    closeStreamBuffers();
     break;
   case READANDWRITE:
     inFile_.close(); //Intentional fallthrough to WRITE
   case WRITE:
+    flushWriteBuffer();
     outFile_.close();
+    closeStreamBuffers();
     tmp = fNameIn_;
     fNameIn_ = fNameOut_;
     if(tmp != "")
@@ -144,14 +210,7 @@ FFTFileGrid::endAccess()
     else
       fNameOut_ = fNameIn_+"b";
     break;
-  case RANDOMACCESS:
-    if(modified_ != 0)
-      save();
-    else
-      unload();
-    break;
   }
-  accMode_ = NONE;
 }
 
 void
@@ -172,9 +231,13 @@ FFTFileGrid::getNextComplex()
 {
   assert(istransformed_==true);
   assert(accMode_ == READ || accMode_ == READANDWRITE);
+  if(rvalue_ != NULL)
+    return(FFTGrid::getNextComplex());
   fftw_complex cVal;
-  char * buffer = reinterpret_cast<char *>(&cVal);
-  inFile_.read(buffer,sizeof(fftw_complex));
+  if(readPos_ + sizeof(fftw_complex) > readEnd_)
+    fillReadBuffer();
+  memcpy(&cVal, readBuffer_ + readPos_, sizeof(fftw_complex));
+  readPos_ += sizeof(fftw_complex);
   return(cVal);
 }
 
@@ -185,9 +248,13 @@ FFTFileGrid::getNextReal()
 {
   assert(istransformed_ == false);
   assert(accMode_ == READ || accMode_ == READANDWRITE);
+  if(rvalue_ != NULL)
+    return(FFTGrid::getNextReal());
   float rVal;
-  char * buffer = reinterpret_cast<char *>(&rVal);
-  inFile_.read(buffer,sizeof(float));
+  if(readPos_ + sizeof(float) > readEnd_)
+    fillReadBuffer();
+  memcpy(&rVal, readBuffer_ + readPos_, sizeof(float));
+  readPos_ += sizeof(float);
   return float(rVal);
 }
 
@@ -252,11 +319,15 @@ FFTFileGrid::SetNextComplex(std::complex<double> & value)
 {
   assert(istransformed_==true);
   assert(accMode_ == READANDWRITE || accMode_ == WRITE);
+  if(rvalue_ != NULL)
+    return(FFTGrid::SetNextComplex(value));
   fftw_complex tmp;
   tmp.re = value.real();
   tmp.im = value.imag();
-  char * buffer = reinterpret_cast<char *>(&tmp);
-  outFile_.write(buffer,sizeof(fftw_complex));
+  if(writePos_ + sizeof(fftw_complex) > streamBufferSize_)
+    flushWriteBuffer();
+  memcpy(writeBuffer_ + writePos_, &tmp, sizeof(fftw_complex));
+  writePos_ += sizeof(fftw_complex);
   return(0);
 }
 
@@ -266,8 +337,12 @@ FFTFileGrid::setNextComplex(fftw_complex value)
 {
   assert(istransformed_==true);
   assert(accMode_ == READANDWRITE || accMode_ == WRITE);
-  char * buffer = reinterpret_cast<char *>(&value);
-  outFile_.write(buffer,sizeof(fftw_complex));
+  if(rvalue_ != NULL)
+    return(FFTGrid::setNextComplex(value));
+  if(writePos_ + sizeof(fftw_complex) > streamBufferSize_)
+    flushWriteBuffer();
+  memcpy(writeBuffer_ + writePos_, &value, sizeof(fftw_complex));
+  writePos_ += sizeof(fftw_complex);
   return(0);
 }
 
@@ -277,8 +352,12 @@ FFTFileGrid::setNextReal(float  value)
 {
   assert(istransformed_== false);
   assert(accMode_ == READANDWRITE || accMode_ == WRITE);
-  char * buffer = reinterpret_cast<char *>(&value);
-  outFile_.write(buffer,sizeof(float));
+  if(rvalue_ != NULL)
+    return(FFTGrid::setNextReal(value));
+  if(writePos_ + sizeof(float) > streamBufferSize_)
+    flushWriteBuffer();
+  memcpy(writeBuffer_ + writePos_, &value, sizeof(float));
+  writePos_ += sizeof(float);
   return(0);
 }
 
@@ -666,57 +745,236 @@ FFTFileGrid::readCravaFile(const std::string & fileName, std::string & error, bo
 
 
 void
-FFTFileGrid::load()
+FFTFileGrid::load(bool readValues)
 {
+  ProfileScope profile("FFTFileGrid::load");
   assert(accMode_ == NONE || accMode_ == RANDOMACCESS);
+  assert(locked_ == false);
+  lastUse_ = ++useCounter_;
+  if(rvalue_ != NULL) { // Kept in memory since last use.
+    locked_  = true;
+    nGrids_ += 1;
+    return;
+  }
+
+  double nBytes = static_cast<double>(rsize_)*sizeof(fftw_real);
+  if(memoryBudget_ > 0.0)
+    makeRoom(nBytes);
   if(!istransformed_)
     FFTGrid::createRealGrid();
   else
     FFTGrid::createComplexGrid();
-  if(fNameIn_ != "") //Something has been saved.
+  locked_ = true;
+  if(memoryBudget_ > 0.0) {
+    residentGrids_.push_back(this);
+    residentBytes_ += nBytes;
+  }
+
+  if(readValues == true && fNameIn_ != "") //Something has been saved.
   {
-    int i, nRead = 1;
     NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
     //Real/complex does not matter in next line, since same meory is used.
-    for(i=0;((i<rsize_) && (nRead == 1));i++)
-    {
-      char * buffer = reinterpret_cast<char *>(&(rvalue_[i]));
-      inFile_.read(buffer,sizeof(float));
-    }
+    readBlock(reinterpret_cast<char *>(rvalue_), rsize_*sizeof(fftw_real));
     inFile_.close();
+    nPageIn_++;
+    totPageIn_++;
   }
 }
 
 void
 FFTFileGrid::save()
 {
+  ProfileScope profile("FFTFileGrid::save");
   assert(accMode_ == NONE || accMode_ == RANDOMACCESS);
+  if(memoryBudget_ > 0.0) {
+    dirty_ = true; // Written to file if it must be spilled
+    unload();
+  }
+  else {
+    writeValues();
+    freeValues();
+  }
+}
+
+void
+FFTFileGrid::unload()
+{
+  if(memoryBudget_ > 0.0) {
+    locked_  = false;
+    nGrids_ -= 1;
+    makeRoom(0.0);
+  }
+  else
+    freeValues();
+}
+
+void
+FFTFileGrid::writeValues()
+{
   NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
   //Real/complex does not matter in next line, since same meory is used.
-  int i, nWritten = 1;
-  for(i=0;((i<rsize_) && (nWritten == 1));i++)
-  {
-    char * buffer = reinterpret_cast<char *>(&(rvalue_[i]));
-    outFile_.write(buffer,sizeof(float));
-  }
+  writeBlock(reinterpret_cast<char *>(rvalue_), rsize_*sizeof(fftw_real));
   outFile_.close();
-  unload();
+  nPageOut_++;
+  totPageOut_++;
   std::string tmp = fNameIn_;
   fNameIn_ = fNameOut_;
   if(tmp != "")
     fNameOut_ = tmp;
   else
     fNameOut_ = fNameIn_+"b";
+  dirty_ = false;
 }
 
 void
-FFTFileGrid::unload()
+FFTFileGrid::freeValues()
 {
   fftw_free(rvalue_); // changed
-  nGrids_ = nGrids_ - 1;
+  if(locked_ == true)
+    nGrids_ = nGrids_ - 1;
 // LogKit::LogFormatted(LogKit::Error,"\nFFTFileGrid unload: nGrids_ = %d\n",nGrids_);
+  FFTMemUse_ -= rsize_ * sizeof(fftw_real);
   rvalue_ = NULL;
   cvalue_ = NULL;
+  locked_ = false;
+
+  for(size_t i=0;i<residentGrids_.size();i++) {
+    if(residentGrids_[i] == this) {
+      residentGrids_.erase(residentGrids_.begin() + i);
+      residentBytes_ -= static_cast<double>(rsize_)*sizeof(fftw_real);
+      break;
+    }
+  }
+}
+
+void
+FFTFileGrid::spill()
+{
+  ProfileScope profile("FFTFileGrid::spill");
+  if(dirty_ == true)
+    writeValues();
+  freeValues();
+  totSpills_++;
+}
+
+bool
+FFTFileGrid::makeRoom(double bytes)
+{
+  //
+  // Spills the least recently used grids that are not in use, until the
+  // grids in memory and the new bytes fit in the budget.
+  //
+  while(residentBytes_ + bytes > memoryBudget_) {
+    FFTFileGrid * oldest = NULL;
+    for(size_t i=0;i<residentGrids_.size();i++) {
+      FFTFileGrid * grid = residentGrids_[i];
+      if(grid->locked_ == false && grid->accMode_ == NONE &&
+         (oldest == NULL || grid->lastUse_ < oldest->lastUse_))
+        oldest = grid;
+    }
+    if(oldest == NULL)
+      return(false);
+    oldest->spill();
+  }
+  return(true);
+}
+
+bool
+FFTFileGrid::useMemory(bool readValues)
+{
+  // Streamed access is done in memory if the grid is there, or there is room for it.
+  if(rvalue_ == NULL) {
+    if(memoryBudget_ <= 0.0 || makeRoom(static_cast<double>(rsize_)*sizeof(fftw_real)) == false)
+      return(false);
+  }
+  load(readValues);
+  return(true);
+}
+
+void
+FFTFileGrid::readBlock(char * buffer, size_t nBytes)
+{
+  //
+  // Large reads and writes let the operating system do read-ahead and
+  // write-back of the temporary files in the background, while we compute.
+  //
+  inFile_.read(buffer, static_cast<std::streamsize>(nBytes));
+  double nRead = static_cast<double>(inFile_.gcount());
+  bytesIn_    += nRead;
+  totBytesIn_ += nRead;
+  Profiler::addBytes(nRead);
+}
+
+void
+FFTFileGrid::writeBlock(const char * buffer, size_t nBytes)
+{
+  outFile_.write(buffer, static_cast<std::streamsize>(nBytes));
+  bytesOut_    += static_cast<double>(nBytes);
+  totBytesOut_ += static_cast<double>(nBytes);
+  Profiler::addBytes(static_cast<double>(nBytes));
+}
+
+void
+FFTFileGrid::fillReadBuffer()
+{
+  // Keep any bytes not yet used, and fill up the rest of the buffer.
+  size_t nLeft = readEnd_ - readPos_;
+  if(nLeft > 0)
+    memmove(readBuffer_, readBuffer_ + readPos_, nLeft);
+  readBlock(readBuffer_ + nLeft, streamBufferSize_ - nLeft);
+  readPos_ = 0;
+  readEnd_ = nLeft + static_cast<size_t>(inFile_.gcount());
+}
+
+void
+FFTFileGrid::flushWriteBuffer()
+{
+  if(writePos_ > 0)
+    writeBlock(writeBuffer_, writePos_);
+  writePos_ = 0;
+}
+
+void
+FFTFileGrid::openStreamBuffers(int mode)
+{
+  if(mode == READ || mode == READANDWRITE) {
+    readBuffer_ = new char[streamBufferSize_];
+    readPos_    = 0;
+    readEnd_    = 0;
+    nPageIn_++;
+    totPageIn_++;
+  }
+  if(mode == WRITE || mode == READANDWRITE) {
+    writeBuffer_ = new char[streamBufferSize_];
+    writePos_    = 0;
+    nPageOut_++;
+    totPageOut_++;
+  }
+}
+
+void
+FFTFileGrid::closeStreamBuffers()
+{
+  delete [] readBuffer_;
+  delete [] writeBuffer_;
+  readBuffer_  = NULL;
+  writeBuffer_ = NULL;
+  readPos_     = 0;
+  readEnd_     = 0;
+  writePos_    = 0;
+}
+
+void
+FFTFileGrid::reportPagingTraffic(LogKit::MessageLevels logLevel)
+{
+  if(totPageIn_ > 0 || totPageOut_ > 0) {
+    LogKit::LogFormatted(logLevel,"\nTemporary grid files were read %d times (%.1f MB) and written %d times (%.1f MB).\n",
+                         totPageIn_, totBytesIn_/(1024.0*1024.0), totPageOut_, totBytesOut_/(1024.0*1024.0));
+  }
+  if(memoryBudget_ > 0.0) {
+    LogKit::LogFormatted(logLevel,"Grids not in use were kept in memory within %.1f MB, and were released %d times to make room.\n",
+                         memoryBudget_/(1024.0*1024.0), totSpills_);
+  }
 }
 
 void
@@ -772,4 +1030,15 @@ FFTFileGrid::setRealTrace(int i, int j, float *value)
 }
 
 
-int FFTFileGrid::gNum = 0; //Starting value
+int    FFTFileGrid::gNum              = 0; //Starting value
+size_t FFTFileGrid::streamBufferSize_ = 1024*1024;
+int    FFTFileGrid::totPageIn_        = 0;
+int    FFTFileGrid::totPageOut_       = 0;
+double FFTFileGrid::totBytesIn_       = 0.0;
+double FFTFileGrid::totBytesOut_      = 0.0;
+
+double                     FFTFileGrid::memoryBudget_  = 0.0;
+double                     FFTFileGrid::residentBytes_ = 0.0;
+unsigned int               FFTFileGrid::useCounter_    = 0;
+int                        FFTFileGrid::totSpills_     = 0;
+std::vector<FFTFileGrid *> FFTFileGrid::residentGrids_;
@@ -6,8 +6,11 @@
 #define FFTFILEGRID_H
 
 #include <string>
+#include <vector>
 #include "fftw.h"
 
+#include "nrlib/iotools/logkit.hpp"
+
 #include "fftgrid.h"
 
 class Wavelet;
@@ -71,11 +74,39 @@ public:
   bool         isFile() {return(1);}
   void         getRealTrace(float * value, int i, int j);
   int          setRealTrace(int i, int j, float *value);
+
+  int          getNumberOfPageIns()  const { return nPageIn_  ;}
+  int          getNumberOfPageOuts() const { return nPageOut_ ;}
+  double       getBytesPagedIn()     const { return bytesIn_  ;}
+  double       getBytesPagedOut()    const { return bytesOut_ ;}
+
+  static void  reportPagingTraffic(LogKit::MessageLevels logLevel);
+
+  // Grids that are not in use are kept in memory as long as all grids kept
+  // in memory fit in the budget. When they do not, the grids that have been
+  // unused for longest are written to file. With no budget, grids are always
+  // written to file after use.
+  static void  setMemoryBudget(double bytes)  { memoryBudget_ = bytes ;}
+  static double getMemoryBudget(void)         { return memoryBudget_ ;}
+
 private:
   void         genFileName();
-  void         load();
+  void         load(bool readValues = true);
   void         unload();
   void         save();
+  void         writeValues();
+  void         freeValues();
+  void         spill();
+  bool         useMemory(bool readValues);
+
+  static bool  makeRoom(double bytes);
+
+  void         readBlock(char * buffer, size_t nBytes);
+  void         writeBlock(const char * buffer, size_t nBytes);
+  void         fillReadBuffer();
+  void         flushWriteBuffer();
+  void         openStreamBuffers(int mode);
+  void         closeStreamBuffers();
 
   int          accMode_;
   int          modified_;   //Tells if grid is modified during RANDOMACCESS.
@@ -84,6 +115,32 @@ private:
   std::ifstream inFile_;
   std::ofstream outFile_;
 
-  static int   gNum; //Number used for generating temporary files.
+  char       * readBuffer_;  // Buffers for READ and WRITE access, so the files are read and written in large blocks.
+  size_t       readPos_;
+  size_t       readEnd_;
+  char       * writeBuffer_;
+  size_t       writePos_;
+
+  int          nPageIn_;     // Number of times the grid has been read from file, as a whole or streamed.
+  int          nPageOut_;    // Number of times the grid has been written to file.
+  double       bytesIn_;     // Bytes read from file.
+  double       bytesOut_;    // Bytes written to file.
+
+  bool         locked_;      // Loaded for use, and counted in nGrids_. Can not be spilled.
+  bool         dirty_;       // The values in memory are newer than those on file.
+  unsigned int lastUse_;     // When the grid was last loaded, for least recently used spilling.
+
+  static int    gNum; //Number used for generating temporary files.
+  static size_t streamBufferSize_;
+  static int    totPageIn_;
+  static int    totPageOut_;
+  static double totBytesIn_;
+  static double totBytesOut_;
+
+  static double                     memoryBudget_;
+  static double                     residentBytes_;  // Bytes of all grids in memory, when there is a budget
+  static unsigned int               useCounter_;
+  static int                        totSpills_;
+  static std::vector<FFTFileGrid *> residentGrids_;
 };
 #endif
@@ -10,12 +10,17 @@
 #include <stdio.h>
 #include <string>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "lib/random.h"
 #include "lib/utils.h"
 #include "lib/timekit.hpp"
 
 #include "fftw.h"
 #include "rfftw.h"
+#include "rfftw_threads.h"
 #include "fftw-int.h"
 #include "f77_func.h"
 
@@ -23,6 +28,7 @@
 #include "nrlib/iotools/logkit.hpp"
 #include "nrlib/iotools/fileio.hpp"
 #include "nrlib/segy/segy.hpp"
+#include "nrlib/random/randomgenerator.hpp"
 
 #include "src/fftgrid.h"
 #include "src/simbox.h"
@@ -32,6 +38,7 @@
 #include "src/io.h"
 #include "src/tasklist.h"
 #include "src/seismicparametersholder.h"
+#include "src/profiler.h"
 
 
 FFTGrid::FFTGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp)
@@ -141,6 +148,7 @@ FFTGrid::fillInSeismicDataFromSegY(const SegY   * segy,
                                    int         & deadTracesSimbox,
                                    std::string & errTxt)
 {
+  ProfileScope profile("FFTGrid::fillInSeismicDataFromSegY");
   assert(cubetype_ != CTMISSING);
 
   createRealGrid();
@@ -167,152 +175,178 @@ FFTGrid::fillInSeismicDataFromSegY(const SegY   * segy,
   float  dz_data   = segy->GetDz();
   float  dz_min    = dz_data/4.0f;
 
-  //
-  // Create FFT plans
-  //
-  rfftwnd_plan fftplan1 = rfftwnd_create_plan(1, &nt, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
-  rfftwnd_plan fftplan2 = rfftwnd_create_plan(1, &mt, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
+  int    cnt       = nt/2 + 1;
+  int    rnt       = 2*cnt;
+  int    cmt       = mt/2 + 1;
+  int    rmt       = 2*cmt;
 
   //
   // Do resampling
   //
+  // The traces are independent, so rows of traces are resampled in parallel.
+  // The FFT plans are shared, each thread makes its own work arrays once,
+  // and writes its traces directly to the grid.
+  //
   missingTracesSimbox  = 0; // Part of simbox is outside seismic data
   missingTracesPadding = 0; // Part of padding is outside seismic data
   deadTracesSimbox     = 0; // Simbox is inside seismic data but trace is missing
 
-  for (int j = 0 ; j < nyp_ ; j++) {
-    for (int i = 0 ; i < rnxp_ ; i++) {
-
-      int refi  = getFillNumber(i, nx_, nxp_ ); // Find index (special treatment for padding)
-      int refj  = getFillNumber(j, ny_, nyp_ ); // Find index (special treatment for padding)
-      int refk  = 0;
-
-      double x, y, z0;
-      timeSimbox->getCoord(refi, refj, refk, x, y, z0);  // Get lateral position and z-start (z0)
-
-      double dz = timeSimbox->getdz(refi, refj);
-      float  xf = static_cast<float>(x);
-      float  yf = static_cast<float>(y);
-
-      if (segy->GetGeometry()->IsInside(xf, yf)) {
-        bool  missing = false;
-        float z0_data = RMISSING;
-
-        std::vector<float> data_trace;
-
-        segy->GetNearestTrace(data_trace, missing, z0_data, xf, yf);
-
-        if (!missing) {
-          int         cnt      = nt/2 + 1;
-          int         rnt      = 2*cnt;
-          int         cmt      = mt/2 + 1;
-          int         rmt      = 2*cmt;
-
-          fftw_real * rAmpData = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rnt));
-          fftw_real * rAmpFine = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rmt));
-
-          float       dz_grid  = static_cast<float>(dz);
-          float       z0_grid  = static_cast<float>(z0);
-
-          float       zn_data  = z0_data + dz_data*static_cast<float>(data_trace.size());
-
-          std::vector<float> grid_trace(nzp_);
-
-          std::string errText = "";
-          smoothTraceInGuardZone(data_trace,
-                                 z0_data,
-                                 zn_data,
-                                 dz_data,
-                                 smooth_length,
-                                 errText);
-          resampleTrace(data_trace,
-                        fftplan1,
-                        fftplan2,
-                        rAmpData,
-                        rAmpFine,
-                        cnt,
-                        rnt,
-                        cmt,
-                        rmt);
-          interpolateGridValues(grid_trace,
-                                z0_grid,     // Centre of first cell
-                                dz_grid,
-                                rAmpFine,
-                                z0_data,     // Time of first data sample
-                                dz_min,
-                                rmt);
-          errTxt += errText;
-
-          if (errText != "") {
-            // Keep for a few weeks until new resampling has been tested extensively.
-            //  if (true) {
-            std::cout << "i j = " << i << " " << j << std::endl;
-            std::cout << errText << std::endl;
-            std::ofstream fout;
-
-            NRLib::OpenWrite(fout,"data.txt");
-            for (size_t k = 0 ; k < data_trace.size() ; k++) {
-              fout << std::fixed
-                   << std::setprecision(2)
-                   << std::setw(6)  << k
-                   << std::setw(10) << z0_data + k*dz_data
-                   << std::setw(12) << data_trace[k] << "\n";
-            }
-            fout.close();
-
-            NRLib::OpenWrite(fout,"fine.txt");
-            for (int k = 0 ; k < static_cast<int>(data_trace.size())*4 ; k++) {
-              fout << std::fixed
-                   << std::setprecision(2)
-                   << std::setw(6)  << k
-                   << std::setw(10) << z0_data + k*dz_min
-                   << std::setw(12) << rAmpFine[k] << "\n";
-            }
-            fout.close();
-
-            NRLib::OpenWrite(fout,"grid.txt");
-            for (size_t k = 0 ; k < grid_trace.size() ; k++) {
-              fout << std::fixed
-                   << std::setprecision(2)
-                   << std::setw(6)  << k
-                   << std::setw(10) << z0_grid + k*dz_grid
-                   << std::setw(12) << grid_trace[k] << "\n";
-            }
-            fout.close();
-            exit(1);
-          }
+  int nMissingSimbox  = 0;
+  int nMissingPadding = 0;
+  int nDeadSimbox     = 0;
+  int nRowsDone       = 0;
 
-          fftw_free(rAmpData);
-          fftw_free(rAmpFine);
+#ifdef _OPENMP
+#pragma omp parallel reduction(+:nMissingSimbox,nMissingPadding,nDeadSimbox)
+#endif
+  {
+    rfftwnd_plan fftplan1 = Utils::getFFTPlan1D(nt, FFTW_REAL_TO_COMPLEX);
+    rfftwnd_plan fftplan2 = Utils::getFFTPlan1D(mt, FFTW_COMPLEX_TO_REAL);
+
+    fftw_real * rAmpData = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rnt));
+    fftw_real * rAmpFine = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rmt));
 
-          setTrace(grid_trace, i, j);
+    std::vector<float> data_trace;
+    std::vector<float> grid_trace(nzp_);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+    for (int j = 0 ; j < nyp_ ; j++) {
+      for (int i = 0 ; i < rnxp_ ; i++) {
+
+        int refi  = getFillNumber(i, nx_, nxp_ ); // Find index (special treatment for padding)
+        int refj  = getFillNumber(j, ny_, nyp_ ); // Find index (special treatment for padding)
+        int refk  = 0;
+
+        double x, y, z0;
+        timeSimbox->getCoord(refi, refj, refk, x, y, z0);  // Get lateral position and z-start (z0)
+
+        double dz = timeSimbox->getdz(refi, refj);
+        float  xf = static_cast<float>(x);
+        float  yf = static_cast<float>(y);
+
+        if (segy->GetGeometry()->IsInside(xf, yf)) {
+          bool  missing = false;
+          float z0_data = RMISSING;
+
+          segy->GetNearestTrace(data_trace, missing, z0_data, xf, yf);
+
+          if (!missing) {
+            float       dz_grid  = static_cast<float>(dz);
+            float       z0_grid  = static_cast<float>(z0);
+
+            float       zn_data  = z0_data + dz_data*static_cast<float>(data_trace.size());
+
+            std::string errText = "";
+            smoothTraceInGuardZone(data_trace,
+                                   z0_data,
+                                   zn_data,
+                                   dz_data,
+                                   smooth_length,
+                                   errText);
+            resampleTrace(data_trace,
+                          fftplan1,
+                          fftplan2,
+                          rAmpData,
+                          rAmpFine,
+                          cnt,
+                          rnt,
+                          cmt,
+                          rmt);
+            interpolateGridValues(grid_trace,
+                                  z0_grid,     // Centre of first cell
+                                  dz_grid,
+                                  rAmpFine,
+                                  z0_data,     // Time of first data sample
+                                  dz_min,
+                                  rmt);
+
+            if (errText != "") {
+#ifdef _OPENMP
+#pragma omp critical(fftgrid_resample_log)
+#endif
+              {
+                errTxt += errText;
+                // Keep for a few weeks until new resampling has been tested extensively.
+                //  if (true) {
+                std::cout << "i j = " << i << " " << j << std::endl;
+                std::cout << errText << std::endl;
+                std::ofstream fout;
+
+                NRLib::OpenWrite(fout,"data.txt");
+                for (size_t k = 0 ; k < data_trace.size() ; k++) {
+                  fout << std::fixed
+                       << std::setprecision(2)
+                       << std::setw(6)  << k
+                       << std::setw(10) << z0_data + k*dz_data
+                       << std::setw(12) << data_trace[k] << "\n";
+                }
+                fout.close();
+
+                NRLib::OpenWrite(fout,"fine.txt");
+                for (int k = 0 ; k < static_cast<int>(data_trace.size())*4 ; k++) {
+                  fout << std::fixed
+                       << std::setprecision(2)
+                       << std::setw(6)  << k
+                       << std::setw(10) << z0_data + k*dz_min
+                       << std::setw(12) << rAmpFine[k] << "\n";
+                }
+                fout.close();
+
+                NRLib::OpenWrite(fout,"grid.txt");
+                for (size_t k = 0 ; k < grid_trace.size() ; k++) {
+                  fout << std::fixed
+                       << std::setprecision(2)
+                       << std::setw(6)  << k
+                       << std::setw(10) << z0_grid + k*dz_grid
+                       << std::setw(12) << grid_trace[k] << "\n";
+                }
+                fout.close();
+                exit(1);
+              }
+            }
+
+            setTrace(grid_trace, i, j);
+          }
+          else {
+            setTrace(0.0f, i, j); // Dead traces (in case we allow them)
+            nDeadSimbox++;
+          }
         }
         else {
-          setTrace(0.0f, i, j); // Dead traces (in case we allow them)
-          deadTracesSimbox++;
+          setTrace(0.0f, i, j);   // Outside seismic data grid
+          if (i < nx_ && j < ny_ )
+            nMissingSimbox++;
+          else
+            nMissingPadding++;
         }
       }
-      else {
-        setTrace(0.0f, i, j);   // Outside seismic data grid
-        if (i < nx_ && j < ny_ )
-          missingTracesSimbox++;
-        else
-          missingTracesPadding++;
-      }
 
-      if (rnxp_*j + i + 1 >= static_cast<int>(nextMonitor)) {
-        nextMonitor += monitorSize;
-        printf("^");
-        fflush(stdout);
+#ifdef _OPENMP
+#pragma omp critical(fftgrid_resample_log)
+#endif
+      {
+        nRowsDone++;
+        while (rnxp_*nRowsDone >= static_cast<int>(nextMonitor)) {
+          nextMonitor += monitorSize;
+          printf("^");
+          fflush(stdout);
+        }
       }
     }
+
+    fftw_free(rAmpData);
+    fftw_free(rAmpFine);
   }
+
+  missingTracesSimbox  = nMissingSimbox;
+  missingTracesPadding = nMissingPadding;
+  deadTracesSimbox     = nDeadSimbox;
+
   LogKit::LogFormatted(LogKit::Low,"\n");
   endAccess();
 
-  fftwnd_destroy_plan(fftplan1);
-  fftwnd_destroy_plan(fftplan2);
-
   Timings::setTimeResamplingSeismic(wall,cpu);
 }
 
@@ -703,6 +737,7 @@ FFTGrid::fillInFromSegY(const SegY              * segy,
                         const std::string       & parName,
                         bool                      padding)
 {
+  ProfileScope profile("FFTGrid::fillInFromSegY");
   assert(cubetype_  !=  CTMISSING);
 
   createRealGrid(!padding);
@@ -727,6 +762,9 @@ FFTGrid::fillInFromSegY(const SegY              * segy,
   meanvalue= static_cast<float*>(fftw_malloc(sizeof(float)*nyp_*nxp_));
 
   int outsideTraces = 0;
+#ifdef _OPENMP
+#pragma omp parallel for private(i,refi,refj,refk,x,y,z,val1,val2) reduction(+:outsideTraces)
+#endif
   for(j=0;j<nyp_;j++) {
     for(i=0;i<nxp_;i++) {
       refi = getXSimboxIndex(i);
@@ -759,8 +797,17 @@ FFTGrid::fillInFromSegY(const SegY              * segy,
   printf("\n  |    |    |    |    |    |    |    |    |    |    |");
   printf("\n  ^");
 
+  //
+  // The values of a z-plane are found in parallel and then written
+  // sequentially, so that file grids are still written in order.
+  //
+  std::vector<fftw_real> plane(static_cast<size_t>(nyp_)*rnxp_);
+
   for( k = 0; k < nzp_; k++)
   {
+#ifdef _OPENMP
+#pragma omp parallel for private(i,refi,refj,refk,x,y,z,distx,disty,distz,mult,value)
+#endif
     for( j = 0; j < nyp_; j++)
     {
       for( i = 0; i < rnxp_; i++)
@@ -786,8 +833,15 @@ FFTGrid::fillInFromSegY(const SegY              * segy,
         else
           value=RMISSING;
 
-        setNextReal(value);
+        plane[j*rnxp_+i] = value;
+      }
+    }
 
+    for( j = 0; j < nyp_; j++)
+    {
+      for( i = 0; i < rnxp_; i++)
+      {
+        setNextReal(plane[j*rnxp_+i]);
       } //for k,j,i
       if (nyp_*k + j + 1 >= static_cast<int>(nextMonitor))
       {
@@ -812,6 +866,7 @@ FFTGrid::fillInFromStorm(const Simbox      * actSimBox,
                          bool                scale,
                          bool                nopadding)
 {
+  ProfileScope profile("FFTGrid::fillInFromStorm");
   assert(cubetype_ != CTMISSING);
   createRealGrid(!nopadding);
   add_ = !nopadding;
@@ -841,6 +896,9 @@ FFTGrid::fillInFromStorm(const Simbox      * actSimBox,
   meanvalue= static_cast<float*>(fftw_malloc(sizeof(float)*nyp_*nxp_));
 
   int outsideTraces = 0;
+#ifdef _OPENMP
+#pragma omp parallel for private(i,refi,refj,x,y,z,val) reduction(+:outsideTraces)
+#endif
   for(j=0;j<nyp_;j++) {
     for(i=0;i<nxp_;i++) {
       refi   = getXSimboxIndex(i);
@@ -872,8 +930,16 @@ FFTGrid::fillInFromStorm(const Simbox      * actSimBox,
   printf("\n  |    |    |    |    |    |    |    |    |    |    |  ");
   printf("\n  ^");
 
+  //
+  // As in fillInFromSegY, each z-plane is found in parallel and written sequentially.
+  //
+  std::vector<fftw_real> plane(static_cast<size_t>(nyp_)*rnxp_);
+
   for( k = 0; k < nzp_; k++)
   {
+#ifdef _OPENMP
+#pragma omp parallel for private(i,refi,refj,refk,x,y,z,distx,disty,distz,mult,value)
+#endif
     for( j = 0; j < nyp_; j++)
     {
       for( i = 0; i < rnxp_; i++)
@@ -904,7 +970,15 @@ FFTGrid::fillInFromStorm(const Simbox      * actSimBox,
         else
           value=RMISSING;
 
-        setNextReal(value);
+        plane[j*rnxp_+i] = value;
+      }
+    }
+
+    for( j = 0; j < nyp_; j++)
+    {
+      for( i = 0; i < rnxp_; i++)
+      {
+        setNextReal(plane[j*rnxp_+i]);
       } //for k,j,i
       if (nyp_*k + j + 1 >= static_cast<int>(nextMonitor))
       {
@@ -1210,10 +1284,10 @@ FFTGrid::fillInGenExpCorr(double Rx,
 }
 
 
+template <class Generator>
 void
-FFTGrid::fillInComplexNoise(RandomGen * ranGen)
+FFTGrid::fillInComplexNoiseFrom(Generator & ranGen)
 {
-  assert(ranGen);
   istransformed_ = true;
   int i;
   cubetype_=PARAMETER;
@@ -1239,13 +1313,13 @@ FFTGrid::fillInComplexNoise(RandomGen * ranGen)
       jkccind = jccind+kccind*nyp_;
       if(jkccind == jkind)             //Number is its own cc, i. e. real
       {
-        cvalue_[i].re = float(ranGen->rnorm01());
+        cvalue_[i].re = float(ranGen.rnorm01());
         cvalue_[i].im = 0;
       }
       else if(jkccind > jkind)         //Have not simulated cc yet.
       {
-        cvalue_[i].re = float(std*ranGen->rnorm01());
-        cvalue_[i].im = float(std*ranGen->rnorm01());
+        cvalue_[i].re = float(std*ranGen.rnorm01());
+        cvalue_[i].im = float(std*ranGen.rnorm01());
       }
       else                             //Look up cc value
       {
@@ -1256,12 +1330,36 @@ FFTGrid::fillInComplexNoise(RandomGen * ranGen)
     }
     else
     {
-      cvalue_[i].re = float(std*ranGen->rnorm01());
-      cvalue_[i].im = float(std*ranGen->rnorm01());
+      cvalue_[i].re = float(std*ranGen.rnorm01());
+      cvalue_[i].im = float(std*ranGen.rnorm01());
     }
   }
 }
 
+void
+FFTGrid::fillInComplexNoise(RandomGen * ranGen)
+{
+  assert(ranGen);
+  fillInComplexNoiseFrom(*ranGen);
+}
+
+// Gives NRLib::RandomGenerator the rnorm01() of RandomGen.
+class NormalFromRandomGenerator
+{
+public:
+  NormalFromRandomGenerator(NRLib::RandomGenerator & ranGen) : ranGen_(ranGen) {}
+  double rnorm01() { return ranGen_.Norm01(); }
+private:
+  NRLib::RandomGenerator & ranGen_;
+};
+
+void
+FFTGrid::fillInComplexNoise(NRLib::RandomGenerator & ranGen)
+{
+  NormalFromRandomGenerator normal(ranGen);
+  fillInComplexNoiseFrom(normal);
+}
+
 void
 FFTGrid::createRealGrid(bool add)
 {
@@ -1310,6 +1408,7 @@ void FFTGrid::createGrid()
     maxFFTMemUse_ = FFTMemUse_;
     LogKit::LogFormatted(LogKit::DebugLow,"\nNew FFT-grid memory peak (%2d): %10.2f MB\n",nGrids_, FFTMemUse_/(1024.f*1024.f));
   }
+  Profiler::setMemoryInUse(FFTMemUse_);
 
 
 
@@ -1808,8 +1907,11 @@ FFTGrid::fftInPlace()
   // scale  by 1/N on the inverse such that it maps between
   // the correlation function and eigen values of the corresponding circular matrix
 
-  time_t timestart, timeend;
-  time(&timestart);
+  ProfileScope profile("FFTGrid::fftInPlace");
+  Profiler::addFlops(getFFTFlops());
+
+  double wall=0.0, cpu=0.0;
+  TimeKit::getTime(wall,cpu);
 
   assert(istransformed_==false);
   assert(cubetype_!= CTMISSING);
@@ -1817,15 +1919,18 @@ FFTGrid::fftInPlace()
   if( cubetype_!= COVARIANCE )
     FFTGrid::multiplyByScalar(1.0f/sqrt(static_cast<float>(nxp_*nyp_*nzp_)));
 
-  int flag;
-  rfftwnd_plan plan;
-  flag = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan= rfftw3d_create_plan(nzp_,nyp_,nxp_,FFTW_REAL_TO_COMPLEX,flag);
-  rfftwnd_one_real_to_complex(plan,rvalue_,cvalue_);
-  fftwnd_destroy_plan(plan);
+  rfftwnd_plan plan = getFFTPlan(nzp_,nyp_,nxp_,FFTW_REAL_TO_COMPLEX);
+  rfftwnd_threads_one_real_to_complex(getNumberOfFFTThreads(),plan,rvalue_,cvalue_);
   istransformed_=true;
-  time(&timeend);
-  LogKit::LogFormatted(LogKit::DebugLow,"\nFFT of grid type %d finished after %ld seconds \n",cubetype_, timeend-timestart);
+
+  // Grids may be transformed concurrently, e.g. when simulating in parallel.
+#ifdef _OPENMP
+#pragma omp critical(fftgrid_fft_log)
+#endif
+  {
+    Timings::addToTimeFFT(wall,cpu);
+    LogKit::LogFormatted(LogKit::DebugLow,"\nFFT of grid type %d finished after %.2f seconds \n",cubetype_, wall);
+  }
 }
 
 void
@@ -1836,29 +1941,93 @@ FFTGrid::invFFTInPlace()
   // scale  by 1/N on the inverse such that it maps between
   // the correlation function and eigen values of the corresponding circular matrix
 
-  time_t timestart, timeend;
-  time(&timestart);
+  ProfileScope profile("FFTGrid::invFFTInPlace");
+  Profiler::addFlops(getFFTFlops());
+
+  double wall=0.0, cpu=0.0;
+  TimeKit::getTime(wall,cpu);
 
   assert(istransformed_==true);
   assert(cubetype_!= CTMISSING);
 
   float scale;
-  int flag;
-  rfftwnd_plan plan;
   if(cubetype_==COVARIANCE)
     scale=float( 1.0/(nxp_*nyp_*nzp_));
   else
     scale=float( 1.0/sqrt(float(nxp_*nyp_*nzp_)));
 
-  flag = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan= rfftw3d_create_plan(nzp_,nyp_,nxp_,FFTW_COMPLEX_TO_REAL,flag);
-  rfftwnd_one_complex_to_real(plan,cvalue_,rvalue_);
-  fftwnd_destroy_plan(plan);
+  rfftwnd_plan plan = getFFTPlan(nzp_,nyp_,nxp_,FFTW_COMPLEX_TO_REAL);
+  rfftwnd_threads_one_complex_to_real(getNumberOfFFTThreads(),plan,cvalue_,rvalue_);
   istransformed_=false;
 
   FFTGrid::multiplyByScalar(scale);
-  time(&timeend);
-  LogKit::LogFormatted(LogKit::DebugLow,"\nInverse FFT of grid type %d finished after %ld seconds \n",cubetype_, timeend-timestart);
+
+#ifdef _OPENMP
+#pragma omp critical(fftgrid_fft_log)
+#endif
+  {
+    Timings::addToTimeFFT(wall,cpu);
+    LogKit::LogFormatted(LogKit::DebugLow,"\nInverse FFT of grid type %d finished after %.2f seconds \n",cubetype_, wall);
+  }
+}
+
+double
+FFTGrid::getFFTFlops() const
+{
+  // The usual estimate for a real transform of N values, 2.5*N*log2(N).
+  double n = static_cast<double>(nxp_)*nyp_*nzp_;
+  return(2.5*n*log(n)/log(2.0));
+}
+
+rfftwnd_plan
+FFTGrid::getFFTPlan(int nzp, int nyp, int nxp, fftw_direction dir)
+{
+  //
+  // Plans only depend on the grid size and direction, and all grids of a run
+  // mostly have the same size. The plans are made thread safe, so each
+  // transform uses its own work arrays, and one plan may be used by several
+  // threads at the same time.
+  //
+  std::vector<int> key(4);
+  key[0] = nzp;
+  key[1] = nyp;
+  key[2] = nxp;
+  key[3] = static_cast<int>(dir);
+
+  rfftwnd_plan plan;
+#ifdef _OPENMP
+#pragma omp critical(fftgrid_plan_cache)
+#endif
+  {
+    FFTPlanCache::iterator it = fftPlans_.find(key);
+    if(it == fftPlans_.end()) {
+      int flag = FFTW_ESTIMATE | FFTW_IN_PLACE | FFTW_THREADSAFE;
+      plan = rfftw3d_create_plan(nzp,nyp,nxp,dir,flag);
+      fftPlans_[key] = plan;
+    }
+    else
+      plan = it->second;
+  }
+  return(plan);
+}
+
+void
+FFTGrid::clearFFTPlanCache()
+{
+  for(FFTPlanCache::iterator it = fftPlans_.begin(); it != fftPlans_.end(); it++)
+    rfftwnd_destroy_plan(it->second);
+  fftPlans_.clear();
+}
+
+int
+FFTGrid::getNumberOfFFTThreads()
+{
+  // Threads are only used when the transform is not itself done in a parallel region.
+#ifdef _OPENMP
+  if(omp_in_parallel() == 0)
+    return(omp_get_max_threads());
+#endif
+  return(1);
 }
 
 void
@@ -2004,16 +2173,12 @@ FFTGrid::fft1DzInPlace(fftw_real*  in, int nzp)
   // in is over vritten by out
   // not norm preservingtransform ifft(fft(funk))=N*funk
 
-  int flag;
-
   rfftwnd_plan plan;
   fftw_complex* out;
   out = reinterpret_cast<fftw_complex*>(in);
 
-  flag    = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan    = rfftwnd_create_plan(1, &nzp ,FFTW_REAL_TO_COMPLEX,flag);
+  plan    = Utils::getFFTPlan1D(nzp, FFTW_REAL_TO_COMPLEX);
   rfftwnd_one_real_to_complex(plan,in ,out);
-  fftwnd_destroy_plan(plan);
 
   return out;
 }
@@ -2024,15 +2189,12 @@ FFTGrid::invFFT1DzInPlace(fftw_complex* in, int nzp)
   // in is over vritten by out
   // not norm preserving transform  ifft(fft(funk))=N*funk
 
-  int flag;
   rfftwnd_plan plan;
   fftw_real*  out;
   out = reinterpret_cast<fftw_real*>(in);
 
-  flag = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan= rfftwnd_create_plan(1,&nzp,FFTW_COMPLEX_TO_REAL,flag);
+  plan= Utils::getFFTPlan1D(nzp, FFTW_COMPLEX_TO_REAL);
   rfftwnd_one_complex_to_real(plan,in,out);
-  fftwnd_destroy_plan(plan);
   return out;
 }
 
@@ -2147,13 +2309,19 @@ FFTGrid::writeStormFile(const std::string & fileName,
     std::ofstream binFile;
     NRLib::OpenWrite(binFile, gfName, std::ios::out | std::ios::binary);
     binFile << header;
-    for(k=0;k<nz;k++)
-      for(j=0;j<ny;j++)
+    //
+    // A z-slice is encoded at a time, as the byte swapping and the write
+    // calls dominate when the floats are written one by one.
+    //
+    std::vector<float> slice(nx*ny);
+    for(k=0;k<nz;k++) {
+      for(j=0;j<ny;j++) {
+        const fftw_real * row = rvalue_ + j*rnxp_ + k*rnxp_*nyp_;
         for(i=0;i<nx;i++)
-        {
-          value = getRealValue(i,j,k,true);
-          NRLib::WriteBinaryFloat(binFile, value);
-        }
+          slice[i+j*nx] = static_cast<float>(row[i]);
+      }
+      NRLib::WriteBinaryFloatArray(binFile, slice.begin(), slice.end());
+    }
     binFile << "0\n";
     binFile.close();
   }
@@ -2369,28 +2537,43 @@ FFTGrid::writeSgriFile(const std::string & fileName, const Simbox *simbox, const
   std::ofstream binFile;
   NRLib::OpenWrite(binFile, fName, std::ios::out | std::ios::binary);
 
+  //
+  // The top, base and cell thickness of each trace are the same for all
+  // slices, so they are found once. A z-slice is encoded at a time.
+  //
   int i,j,k;
-  double x, y, z, zTop, zBot;
-  float value;
+  double x, y;
+  std::vector<double> zTop(nx*ny);
+  std::vector<double> zBot(nx*ny);
+  std::vector<double> thick(nx*ny);
+  for (j=0; j<ny; j++) {
+    for (i=0; i<nx; i++) {
+      simbox->getXYCoord(i, j, x, y);
+      zTop[i+j*nx]  = simbox->getTop(x, y);
+      zBot[i+j*nx]  = simbox->getBot(x, y);
+      thick[i+j*nx] = simbox->getdz()*simbox->getRelThick(i,j);
+    }
+  }
+
+  std::vector<float> slice(nx*ny);
   for(k=0;k<nz;k++) {
+    double z = zMin + k*dz;
     for (j=0; j<ny; j++) {
       for (i=0; i<nx; i++) {
-        simbox->getXYCoord(i, j, x, y);
-        zTop = simbox->getTop(x, y);
-        zBot = simbox->getBot(x, y);
-        z = zMin + k*dz;
-        if (z < zTop || z > zBot)
-          value = RMISSING;
+        int ij = i+j*nx;
+        if (z < zTop[ij] || z > zBot[ij])
+          slice[ij] = RMISSING;
         else {
-           int simboxK = static_cast<int> ((z - zTop)/ (simbox->getdz()*simbox->getRelThick(i,j)) + 0.5);
-          value = getRealValue(i,j,simboxK);        }
+          int simboxK = static_cast<int> ((z - zTop[ij])/thick[ij] + 0.5);
+          slice[ij] = getRealValue(i,j,simboxK);
+        }
+      }
+    }
 #ifndef BIGENDIAN
-        NRLib::WriteBinaryFloat(binFile, value);
+    NRLib::WriteBinaryFloatArray(binFile, slice.begin(), slice.end());
 #else
-        NRLib::WriteBinaryFloat(binFile, value, END_LITTLE_ENDIAN);
+    NRLib::WriteBinaryFloatArray(binFile, slice.begin(), slice.end(), END_LITTLE_ENDIAN);
 #endif
-      }
-    }
   }
   return(0);
 }
@@ -2423,8 +2606,13 @@ FFTGrid::writeCravaFile(const std::string & fileName, const Simbox * simbox)
     NRLib::WriteBinaryInt(binFile, rnxp_);
     NRLib::WriteBinaryInt(binFile, nyp_);
     NRLib::WriteBinaryInt(binFile, nzp_);
-    for(int i=0;i<rsize_;i++)
-      NRLib::WriteBinaryFloat(binFile, rvalue_[i]);
+    std::vector<float> slice(rnxp_*nyp_);
+    for(int k=0;k<nzp_;k++) {
+      const fftw_real * values = rvalue_ + k*rnxp_*nyp_;
+      for(int i=0;i<rnxp_*nyp_;i++)
+        slice[i] = static_cast<float>(values[i]);
+      NRLib::WriteBinaryFloatArray(binFile, slice.begin(), slice.end());
+    }
 
     binFile.close();
   }
@@ -2874,3 +3062,4 @@ int FFTGrid::nGrids_            = 0;
 bool FFTGrid::terminateOnMaxGrid_ = false;
 float FFTGrid::maxFFTMemUse_    = 0;
 float FFTGrid::FFTMemUse_       = 0;
+FFTGrid::FFTPlanCache FFTGrid::fftPlans_;
@@ -8,6 +8,8 @@
 #include <assert.h>
 #include <complex>
 #include <string>
+#include <map>
+#include <vector>
 
 #include "fftw.h"
 #include "rfftw.h"
@@ -18,6 +20,9 @@ class Simbox;
 class RandomGen;
 class GridMapping;
 class SeismicParametersHolder;
+namespace NRLib {
+  class RandomGenerator;
+}
 
 class FFTGrid
 {
@@ -108,6 +113,7 @@ public:
 
 
   virtual void         fillInComplexNoise(RandomGen * ranGen);   // No mode/randomaccess
+  void                 fillInComplexNoise(NRLib::RandomGenerator & ranGen); // Thread safe version, for in memory grids
 
   void                 fillInFromArray(float *value);
   void                 calculateStatistics();                    // min,max, avg
@@ -124,6 +130,8 @@ public:
   fftw_complex         getComplexValue(int i, int j, int k, bool extSimbox = false) const;
   virtual int          setRealValue(int i, int j, int k, float value, bool extSimbox = false);  // Accessmode randomaccess
   int                  setComplexValue(int i, int j ,int k, fftw_complex value, bool extSimbox = false);
+  fftw_complex         getComplexValue(int index) const { return(cvalue_[index]) ;}     // Direct access, no bounds check. In-memory grids only.
+  void                 setComplexValue(int index, fftw_complex value) { cvalue_[index] = value ;}
   fftw_complex         getFirstComplexValue();
   float                getFirstRealValue();                     // No mode/randomaccess
   virtual int          square();                                // No mode/randomaccess
@@ -207,6 +215,8 @@ public:
   static void          setTerminateOnMaxGrid(bool terminate) {terminateOnMaxGrid_ = terminate ;}
   static int           findClosestFactorableNumber(int leastint);
 
+  static void          clearFFTPlanCache();
+
   static fftw_complex* fft1DzInPlace(fftw_real*  in, int nzp);
   static fftw_real*    invFFT1DzInPlace(fftw_complex* in, int nzp);
 
@@ -253,6 +263,13 @@ protected:
   void                 writeSegyFromStorm(StormContGrid *data, std::string fileName);
   void                 makeDepthCubeForSegy(Simbox *simbox,const std::string & fileName);
 
+  template <class Generator>
+  void                 fillInComplexNoiseFrom(Generator & ranGen);
+
+  static rfftwnd_plan  getFFTPlan(int nzp, int nyp, int nxp, fftw_direction dir);
+  static int           getNumberOfFFTThreads();
+  double               getFFTFlops() const;             // Estimated number of floating point operations in one FFT of the grid
+
   int                  cubetype_;          // see enum gridtypes above
   float                theta_;             // angle in angle gather (case of data)
   float                scale_;             // To keep track of the scalings after fourier transforms
@@ -292,5 +309,8 @@ protected:
   static float         maxFFTMemUse_;
   static float         FFTMemUse_;
 
+  typedef std::map<std::vector<int>, rfftwnd_plan> FFTPlanCache;
+  static FFTPlanCache  fftPlans_;          // 3D plans, keyed by (nzp, nyp, nxp, direction). Created once, shared by all grids.
+
 };
 #endif
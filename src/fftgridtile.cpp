@@ -0,0 +1,101 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <assert.h>
+
+#include "src/fftgridtile.h"
+#include "src/fftgrid.h"
+
+FFTGridTile::FFTGridTile(const std::vector<FFTGrid *> & grids,
+                         bool                           streamed)
+  : grids_(grids),
+    streamed_(streamed),
+    nComp_(static_cast<int>(grids.size())),
+    values_(NULL),
+    nextRead_(0),
+    nextWrite_(0)
+{
+  assert(nComp_ > 0);
+
+  cnxp_  = grids_[0]->getCNxp();
+  nRows_ = grids_[0]->getNyp()*grids_[0]->getNzp();
+
+  for(int c = 0 ; c < nComp_ ; c++) {
+    assert(streamed_ || grids_[c]->isFile() == false);
+    assert(grids_[c]->getIsTransformed());
+    assert(grids_[c]->getCNxp() == cnxp_);
+    assert(grids_[c]->getNyp()*grids_[c]->getNzp() == nRows_);
+  }
+
+  values_ = new fftw_complex[nComp_*cnxp_];
+}
+
+FFTGridTile::~FFTGridTile()
+{
+  delete [] values_;
+}
+
+bool
+FFTGridTile::hasFileGrid(const std::vector<FFTGrid *> & grids)
+{
+  for(size_t c = 0 ; c < grids.size() ; c++)
+    if(grids[c]->isFile())
+      return(true);
+  return(false);
+}
+
+void
+FFTGridTile::beginAccess(const std::vector<FFTGrid *> & grids,
+                         int                            mode)
+{
+  for(size_t c = 0 ; c < grids.size() ; c++)
+    grids[c]->setAccessMode(mode);
+}
+
+void
+FFTGridTile::endAccess(const std::vector<FFTGrid *> & grids)
+{
+  for(size_t c = 0 ; c < grids.size() ; c++)
+    grids[c]->endAccess();
+}
+
+void
+FFTGridTile::readRow(int row)
+{
+  if(streamed_) {
+    assert(row == nextRead_);
+    for(int i = 0 ; i < cnxp_ ; i++)
+      for(int c = 0 ; c < nComp_ ; c++)
+        values_[i*nComp_ + c] = grids_[c]->getNextComplex();
+    nextRead_++;
+  }
+  else {
+    int start = row*cnxp_;
+    for(int c = 0 ; c < nComp_ ; c++) {
+      const FFTGrid * grid = grids_[c];
+      for(int i = 0 ; i < cnxp_ ; i++)
+        values_[i*nComp_ + c] = grid->getComplexValue(start + i);
+    }
+  }
+}
+
+void
+FFTGridTile::writeRow(int row)
+{
+  if(streamed_) {
+    assert(row == nextWrite_);
+    for(int i = 0 ; i < cnxp_ ; i++)
+      for(int c = 0 ; c < nComp_ ; c++)
+        grids_[c]->setNextComplex(values_[i*nComp_ + c]);
+    nextWrite_++;
+  }
+  else {
+    int start = row*cnxp_;
+    for(int c = 0 ; c < nComp_ ; c++) {
+      FFTGrid * grid = grids_[c];
+      for(int i = 0 ; i < cnxp_ ; i++)
+        grid->setComplexValue(start + i, values_[i*nComp_ + c]);
+    }
+  }
+}
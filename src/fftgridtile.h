@@ -0,0 +1,63 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef FFTGRIDTILE_H
+#define FFTGRIDTILE_H
+
+#include <vector>
+
+#include "fftw.h"
+
+class FFTGrid;
+
+// A row (fixed j and k) of cnxp Fourier cells from several transformed grids
+// with the same dimensions. The row is gathered into one buffer where the
+// values of a cell are stored next to each other, in the order the grids were
+// given, so that loops walking many grids in lockstep read each grid row as a
+// contiguous block and work on one cell at a time from the buffer.
+//
+// Grids in memory are accessed directly. Each thread should have its own
+// tile, and different threads may then read and write different rows
+// concurrently. If any grid of a loop is on file, all its tiles must be
+// streamed: The rows are then read and written in order by one thread with
+// getNextComplex and setNextComplex, and the access modes are set with
+// beginAccess and endAccess.
+
+class FFTGridTile
+{
+public:
+  FFTGridTile(const std::vector<FFTGrid *> & grids,
+              bool                           streamed = false);
+  ~FFTGridTile();
+
+  static bool           hasFileGrid(const std::vector<FFTGrid *> & grids);
+  static void           beginAccess(const std::vector<FFTGrid *> & grids,
+                                    int                            mode);  // FFTGrid::accessMode
+  static void           endAccess(const std::vector<FFTGrid *> & grids);
+
+  int                   getNRows()      const { return nRows_ ;}      // nyp*nzp
+  int                   getCNxp()       const { return cnxp_  ;}      // Cells in a row
+  int                   getNComp()      const { return nComp_ ;}      // Values in a cell
+
+  void                  readRow(int row);                             // Gathers a row from the grids
+  void                  writeRow(int row);                            // Scatters the row back to the grids
+
+  fftw_complex        * getCell(int i)        { return values_ + i*nComp_ ;}
+  const fftw_complex  * getCell(int i)  const { return values_ + i*nComp_ ;}
+
+private:
+  FFTGridTile(const FFTGridTile &);
+  FFTGridTile & operator=(const FFTGridTile &);
+
+  std::vector<FFTGrid *>  grids_;
+  bool                    streamed_;
+  int                     nComp_;
+  int                     cnxp_;
+  int                     nRows_;
+  fftw_complex          * values_;               // nComp_ values for each of the cnxp_ cells
+  int                     nextRead_;             // Next row to read when streamed
+  int                     nextWrite_;            // Next row to write when streamed
+};
+
+#endif
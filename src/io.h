@@ -43,6 +43,7 @@ public:
   inline static  std::string    FileTemporalCorr(void)             { return std::string("Temporal_Correlation")     ;}
   inline static  std::string    FileTimeToDepthVelocity(void)      { return std::string("Time-To-Depth_Velocity")   ;}
   inline static  std::string    FileTemporarySeismic(void)         { return std::string("Temp_seis")                ;}
+  inline static  std::string    FileProfile(void)                  { return std::string("Profile")                  ;}
 
   // Prefixes
 
@@ -172,7 +173,8 @@ public:
                              ROCK_PHYSICS        = 16,
                              ERROR_FILE          = 32,
                              TASK_FILE           = 64,
-                             ROCK_PHYSICS_TRENDS = 128};
+                             ROCK_PHYSICS_TRENDS = 128,
+                             PROFILE             = 256};
 
   enum           outputWavelets{WELL_WAVELETS    = 1,
                                 GLOBAL_WAVELETS  = 2,
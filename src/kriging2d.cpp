@@ -58,6 +58,78 @@ void Kriging2D::krigSurface(Grid2D              & trend,
   }
 }
 
+void Kriging2D::krigSurfaces(std::vector<Grid2D *>            & trends,
+                             const std::vector<KrigingData2D> & krigingData,
+                             int                                first,
+                             const CovGrid2D                  & cov)
+{
+  int nLayers = static_cast<int>(trends.size());
+  int md      = krigingData[first].getNumberOfData();
+  const std::vector<int> & indexi = krigingData[first].getIndexI();
+  const std::vector<int> & indexj = krigingData[first].getIndexJ();
+
+  int nx = static_cast<int>(trends[0]->GetNI());
+  int ny = static_cast<int>(trends[0]->GetNJ());
+
+  if (md > 0 && md < nx*ny) {
+
+    NRLib::SymmetricMatrix K(md);
+    NRLib::Matrix          X(md, nLayers);
+
+    for (int m = 0 ; m < nLayers ; m++) {
+      const std::vector<float> & data  = krigingData[first + m].getData();
+      const Grid2D             & trend = *trends[m];
+      for (int l = 0 ; l < md ; l++)
+        X(l,m) = data[l] - static_cast<float>(trend(indexi[l],indexj[l]));
+    }
+
+    fillKrigingMatrix(K, cov, indexi, indexj);
+
+    NRLib::CholeskySolve(K, X);
+
+    std::vector<NRLib::Vector> x(nLayers);
+    for (int m = 0 ; m < nLayers ; m++) {
+      x[m].resize(md);
+      x[m] = X(flens::_, m);
+    }
+
+    //
+    // The cells are independent, so columns of cells are kriged in parallel.
+    //
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      NRLib::Vector k(md);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (int i = 0 ; i < nx ; i++) {
+        for (int j = 0 ; j < ny ; j++) {
+
+          fillKrigingVector(k, cov, indexi, indexj, i, j);
+
+          for (int m = 0 ; m < nLayers ; m++)
+            (*trends[m])(i,j) += k * x[m];
+        }
+      }
+    }
+  }
+}
+
+int
+Kriging2D::findNumberOfEqualLayers(const std::vector<KrigingData2D> & krigingData,
+                                   int                                first,
+                                   int                                maxLayers)
+{
+  int nz      = static_cast<int>(krigingData.size());
+  int nLayers = 1;
+  while (first + nLayers < nz && nLayers < maxLayers &&
+         krigingData[first + nLayers].hasSameLocations(krigingData[first]))
+    nLayers++;
+  return nLayers;
+}
+
 void
 Kriging2D::subtractTrend(NRLib::Vector            & residual,
                          const std::vector<float> & data,
@@ -23,6 +23,20 @@ public:
                            const CovGrid2D     & cov,
                            bool                  getResiduals = false);
 
+  // Kriges trends[m] with krigingData[first+m] for all m. The data of these
+  // layers must be in the same locations, so the kriging matrix is factorised
+  // once and the kriging vector of a cell is used for all layers.
+  static void  krigSurfaces(std::vector<Grid2D *>            & trends,
+                            const std::vector<KrigingData2D> & krigingData,
+                            int                                first,
+                            const CovGrid2D                  & cov);
+
+  // Number of layers from first, at most maxLayers, with data in the same
+  // locations as layer first.
+  static int   findNumberOfEqualLayers(const std::vector<KrigingData2D> & krigingData,
+                                       int                                first,
+                                       int                                maxLayers);
+
   static CovGrid2D & makeCovGrid2D(const Simbox * simbox,
                                    Vario        * vario,
                                    int            debugFlag);
@@ -5,8 +5,14 @@
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "nrlib/iotools/logkit.hpp"
+#include "nrlib/exception/exception.hpp"
 
 #include "src/krigingadmin.h"
 #include "src/fftgrid.h"
@@ -16,6 +22,7 @@
 #include "src/simbox.h"
 #include "src/covgridseparated.h"
 #include "src/definitions.h"
+#include "src/profiler.h"
 
 CKrigingAdmin::CKrigingAdmin(const Simbox      & simbox,
                              CBWellPt         ** pBWellPt,
@@ -71,8 +78,6 @@ CKrigingAdmin::~CKrigingAdmin(void)
 }
 
 void CKrigingAdmin::Init() {
-  i_ = j_ = k_ = 0;
-
   //
   // Create indicator grid having 1.0f if data in cell and -1.0f if no data in cell
   // I wonder why Bjørn didn't choose and int grid with 1s and 0s instead?
@@ -170,18 +175,108 @@ void CKrigingAdmin::Init() {
 }
 
 void CKrigingAdmin::KrigAll(Gamma gamma, bool doSmoothing) {
-  // basic set of neighbourhoods
+  ProfileScope profile("CKrigingAdmin::KrigAll(gamma)");
   noCholeskyDecomp_ = noSolvedMatrixEq_ = 0;
   noRMissing_ = 0;
+
+  monitorSize_ = int(3*simbox_.getnx()*simbox_.getny()*simbox_.getnz()*0.02);
+  monitorSize_ = std::max(1,monitorSize_);
+
+  // basic set of neighbourhoods, found the first time this variable is kriged
+  std::vector<KrigingBlock> & blocks = krigingBlocks_[gamma];
+  if (blocks.empty())
+    FindKrigingBlocks(gamma, blocks);
+
+  FFTGrid * pGrid = 0;
+  switch(gamma) {
+  case ALPHA_KRIG :
+    pGrid = trendAlpha_;
+    break;
+  case BETA_KRIG :
+    pGrid = trendBeta_;
+    break;
+  case RHO_KRIG :
+    pGrid = trendRho_;
+    break;
+  default :
+    Require(false, "switch failed");
+  } // end switch
+
+  //
+  // The blocks write disjoint cells, so they are kriged in parallel. Each
+  // thread has its own matrices, and the result does not depend on the
+  // number of threads.
+  //
+  const int   nBlocks          = static_cast<int>(blocks.size());
+  int         noRMissing       = 0;
+  int         noSolvedMatrixEq = 0;
+  int         noCholeskyDecomp = 0;
+  std::string errText          = "";
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1) reduction(+:noRMissing,noSolvedMatrixEq,noCholeskyDecomp)
+#endif
+  for (int b = 0; b < nBlocks; b++) {
+    KrigingBlock & block = blocks[b];
+    try {
+      KrigBlock(gamma, block, pGrid, noRMissing, noSolvedMatrixEq, noCholeskyDecomp);
+    }
+    catch (NRLib::Exception & e) {
+#ifdef _OPENMP
+#pragma omp critical(kriging_admin_error)
+#endif
+      {
+        errText += e.what();
+      }
+    }
+
+    int cellsInBlock = (block.kMax - block.kMin + 1)*(block.jMax - block.jMin + 1)*(block.iMax - block.iMin + 1);
+#ifdef _OPENMP
+#pragma omp critical(kriging_admin_monitor)
+#endif
+    {
+      int nMonitor = (noKrigedCells_ + cellsInBlock)/monitorSize_ - noKrigedCells_/monitorSize_;
+      noKrigedCells_ += cellsInBlock;
+      for (int m = 0; m < nMonitor; m++) {
+        printf("^");
+        fflush(stdout);
+      }
+    }
+  }
+
+  if (errText != "")
+    throw NRLib::Exception(errText);
+
+  noRMissing_       = noRMissing;
+  noSolvedMatrixEq_ = noSolvedMatrixEq;
+  noCholeskyDecomp_ = noCholeskyDecomp;
+
+  noKrigedVariables_++;
+  if (!backgroundModel_ && doSmoothing==true) {
+    //LogKit::LogFormatted(LogKit::Low,"SmoothKrigedResult start\n");
+    SmoothKrigedResult(gamma);
+    //LogKit::LogFormatted(LogKit::Low,"SmoothKrigedResult end\n");
+  }
+
+
+}
+
+void CKrigingAdmin::FindKrigingBlocks(Gamma gamma, std::vector<KrigingBlock> & blocks) {
   const int nxBlock = NBlocks(dxBlock_, simbox_.getnx());
   const int nyBlock = NBlocks(dyBlock_, simbox_.getny());
   const int nzBlock = NBlocks(dzBlock_, simbox_.getnz());
 
-  monitorSize_ = int(3*simbox_.getnx()*simbox_.getny()*simbox_.getnz()*0.02);
-  monitorSize_ = std::max(1,monitorSize_);
+  blocks.resize(nxBlock*nyBlock*nzBlock);
+
+  //
+  // Cholesky factors are kept, in block order, until the memory for them is used
+  //
+  double maxFactorBytes = static_cast<double>(maxFactorCacheMB_)*1024.0*1024.0;
+  double factorBytes    = 0.0;
 
   // loop over all kriging blocks
   int i,j,k;
+  int b = 0;
   for (k = 0; k < nzBlock; k++) {
     int k1 = k*dzBlock_;
     for (j = 0; j < nyBlock; j++) {
@@ -193,27 +288,42 @@ void CKrigingAdmin::KrigAll(Gamma gamma, bool doSmoothing) {
         currDataBox_ = CBox(i1 - dxBlockExt_, j1 - dyBlockExt_, k1 - dzBlockExt_,
           i1 + dxBlock_ + dxBlockExt_ - 1, j1 + dyBlock_ + dyBlockExt_ - 1, k1 + dzBlock_ + dzBlockExt_ - 1,
           &simbox_);
-        KrigBlock(gamma);
+
+        // search for neighbours
+        LogKit::LogFormatted(LogKit::DebugHigh,"FindDataInDataBlockLoop(gamma) called next\n");
+        FindDataInDataBlockLoop(gamma);
+        LogKit::LogFormatted(LogKit::DebugHigh,"sizeAlpha_: %d\n", sizeAlpha_);
+        LogKit::LogFormatted(LogKit::DebugHigh,"sizeBeta_: %d\n", sizeBeta_);
+        LogKit::LogFormatted(LogKit::DebugHigh,"sizeRho_: %d\n", sizeRho_);
+        LogKit::LogFormatted(LogKit::DebugHigh,"totalNoDataInCurrKrigBlock_: %d\n", totalNoDataInCurrKrigBlock_);
+
+        KrigingBlock & block = blocks[b++];
+        currBlock_.GetMin(block.iMin, block.jMin, block.kMin);
+        currBlock_.GetMax(block.iMax, block.jMax, block.kMax);
+        block.indexAlpha.assign(pIndexAlpha_, pIndexAlpha_ + sizeAlpha_);
+        block.indexBeta.assign(pIndexBeta_, pIndexBeta_ + sizeBeta_);
+        block.indexRho.assign(pIndexRho_, pIndexRho_ + sizeRho_);
+
+        int    n     = sizeAlpha_ + sizeBeta_ + sizeRho_;
+        double bytes = static_cast<double>(n)*static_cast<double>(n)*sizeof(double);
+        block.cacheFactor = (factorBytes + bytes <= maxFactorBytes);
+        if (block.cacheFactor)
+          factorBytes += bytes;
       } // end i
     } // end j
   } // end k
-  noKrigedVariables_++;
-  if (!backgroundModel_ && doSmoothing==true) {
-    //LogKit::LogFormatted(LogKit::Low,"SmoothKrigedResult start\n");
-    SmoothKrigedResult(gamma);
-    //LogKit::LogFormatted(LogKit::Low,"SmoothKrigedResult end\n");
-  }
-
-
 }
 
 void CKrigingAdmin::KrigAll(FFTGrid& trendAlpha, FFTGrid& trendBeta, FFTGrid& trendRho,
                             bool trendsAlreadySubtracted, int debugflag, bool doSmoothing) {
+  ProfileScope profile("CKrigingAdmin::KrigAll");
   Require(!trendAlpha.getIsTransformed()
           && !trendBeta.getIsTransformed()
           && !trendRho.getIsTransformed(),
           "!trendAlpha.getIsTransformed() && !trendBeta.getIsTransformed() && !trendRho.getIsTransformed()");
 
+  noKrigedCells_ = noEmptyDataBlocks_ = 0;
+
   if (!trendsAlreadySubtracted)
     SubtractTrends(trendAlpha, trendBeta, trendRho);
   if(debugflag>0)
@@ -275,105 +385,84 @@ void CKrigingAdmin::KrigAll(FFTGrid& trendAlpha, FFTGrid& trendBeta, FFTGrid& tr
   LogKit::LogFormatted(LogKit::DebugHigh,"KrigAll finished\n");
 }
 
-void CKrigingAdmin::KrigBlock(Gamma gamma)
+void CKrigingAdmin::KrigBlock(Gamma          gamma,
+                              KrigingBlock & block,
+                              FFTGrid      * pGrid,
+                              int          & noRMissing,
+                              int          & noSolvedMatrixEq,
+                              int          & noCholeskyDecomp)
 {
-  // search for neighbours
-  LogKit::LogFormatted(LogKit::DebugHigh,"FindDataInDataBlockLoop(gamma) called next\n");
-  FindDataInDataBlockLoop(gamma);
-  LogKit::LogFormatted(LogKit::DebugHigh,"sizeAlpha_: %d\n", sizeAlpha_);
-  LogKit::LogFormatted(LogKit::DebugHigh,"sizeBeta_: %d\n", sizeBeta_);
-  LogKit::LogFormatted(LogKit::DebugHigh,"sizeRho_: %d\n", sizeRho_);
-  LogKit::LogFormatted(LogKit::DebugHigh,"totalNoDataInCurrKrigBlock_: %d\n", totalNoDataInCurrKrigBlock_);
-  //FindDataInDataBlock(gamma); //DEBUG
-
-  int iMin, jMin, kMin, iMax, jMax, kMax;
-  currBlock_.GetMin(iMin, jMin, kMin); currBlock_.GetMax(iMax, jMax, kMax);
-  if (!totalNoDataInCurrKrigBlock_) {
-    int cellsInBlock = (kMax - kMin + 1)*(jMax - jMin + 1)*(iMax - iMin + 1);
-    int i;
-    for (i=noKrigedCells_ ; i<noKrigedCells_+cellsInBlock ; i++) {
-      if (noKrigedCells_ > 0 && i%monitorSize_ == 0) {
-        printf("^");
-        fflush(stdout);
-      }
-    }
-    noKrigedCells_ += cellsInBlock;
+  const int n = static_cast<int>(block.indexAlpha.size() + block.indexBeta.size() + block.indexRho.size());
+
+  if (n == 0) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
     noEmptyDataBlocks_++;
     return;
   }
 
-  int n = sizeAlpha_ + sizeBeta_ + sizeRho_;
-
-  NRLib::Matrix krigMatrix(n, n);
-  NRLib::Vector residual(n);
+  //
+  // Cholesky factorization of the kriging matrix, unless it is kept from an earlier run
+  //
+  std::vector<double>   factorWork;
+  std::vector<double> & factor = (block.cacheFactor ? block.factor : factorWork);
 
-  // Set kriging matrix based on data finds
+  if (factor.empty()) {
+    NRLib::Matrix krigMatrix(n, n);
 
-  SetMatrix(krigMatrix,
-            residual,
-            gamma);
+    // Set kriging matrix based on data finds
+    SetMatrix(krigMatrix, block);
 
-  NRLib::SymmetricMatrix K(n);
+    factor.resize(static_cast<size_t>(n)*n);
+    for (int j = 0 ; j < n ; j++) {
+      for (int i = 0 ; i <= j ; i++) {
+        factor[i + j*n] = krigMatrix(i,j);
+      }
+    }
 
-  for (int j = 0 ; j < n ; j++) {
-    for (int i = 0 ; i <= j ; i++) {
-      K(i,j) = krigMatrix(i,j);
+    // NBNB-PAL: Add try/catch loop around the factorization with a regularization term.
+    int info = flens::potrf(flens::Upper, n, &factor[0], n);
+    if (info != 0) {
+      factor.clear();
+      std::ostringstream oss;
+      oss << "Error in Cholesky: The leading minor of order " << info
+          << " is not positive definite.";
+      throw NRLib::Exception(oss.str());
     }
+    noCholeskyDecomp++;
   }
 
-  FFTGrid * pGrid = 0;
-
-  switch(gamma) {
-  case ALPHA_KRIG :
-    pGrid = trendAlpha_;
-    break;
-  case BETA_KRIG :
-    pGrid = trendBeta_;
-    break;
-  case RHO_KRIG :
-    pGrid = trendRho_;
-    break;
-  default :
-    Require(false, "switch failed");
-  } // end switch
-
   NRLib::Vector x(n);
-  // NBNB-PAL: Add try/catch loop around CholeskySolve call with a regularization term.
-  NRLib::CholeskySolve(K, residual, x);
+  SetResidual(x, block);
+
+  flens::potrs(flens::Upper, n, 1, &factor[0], n, x.data(), n);
 
   NRLib::Vector kVec(n);
 
-  for (k_ = kMin; k_ <= kMax; k_++) {
-    for (j_ = jMin; j_ <= jMax; j_++) {
-      for (i_ = iMin; i_ <= iMax; i_++) {
+  for (int k = block.kMin; k <= block.kMax; k++) {
+    for (int j = block.jMin; j <= block.jMax; j++) {
+      for (int i = block.iMin; i <= block.iMax; i++) {
 
         // set kriging vector
-        SetKrigVector(kVec, gamma);
+        SetKrigVector(kVec, block, gamma, i, j, k);
 
         // kriging
-        float result = pGrid->getRealValue(i_, j_, k_);
+        float result = pGrid->getRealValue(i, j, k);
         if (result == RMISSING) {
-          noRMissing_++;
+          noRMissing++;
         }
         else {
           result += static_cast<float>(kVec * x);
 
-          if(pGrid->setRealValue(i_, j_, k_, result))
+          if(pGrid->setRealValue(i, j, k, result))
             Require(false, "pGrid->setRealValue failed"); // something is serious wrong...
 
-          noSolvedMatrixEq_++;
-        }
-
-        noKrigedCells_++;
-        // return result
-        if (noKrigedCells_%monitorSize_ == 0) {
-          printf("^");
-          fflush(stdout);
+          noSolvedMatrixEq++;
         }
       } // end for i
     } // end for j
   } // end for k
-
 }
 
 FFTGrid* CKrigingAdmin::CreateValidGrid() const
@@ -581,26 +670,25 @@ int CKrigingAdmin::NBlocks(int dBlocks, int lSBox) const {
   return lSBox/dBlocks + 1;
 }
 
-void CKrigingAdmin::SetMatrix(NRLib::Matrix & krigMatrix,
-                              NRLib::Vector & residual,
-                              Gamma           gamma) {
-  assert(gamma >= 0);
-  if (!totalNoDataInCurrKrigBlock_)
-    return;
+void CKrigingAdmin::SetMatrix(NRLib::Matrix      & krigMatrix,
+                              const KrigingBlock & block) const {
+  const int sizeAlpha = static_cast<int>(block.indexAlpha.size());
+  const int sizeBeta  = static_cast<int>(block.indexBeta.size());
+  const int sizeRho   = static_cast<int>(block.indexRho.size());
   int a, b, r;
 
   // set Kriging Matrix
   // for alpha kriging
   int a2, b2, r2;
   // first row
-  for (a = 0; a < sizeAlpha_; a++) {
+  for (a = 0; a < sizeAlpha; a++) {
     int krigRowIndex = a;
-    int indexA = pIndexAlpha_[a];
+    int indexA = block.indexAlpha[a];
     int i,j,k;
     pBWellPt_[indexA]->GetIJK(i, j, k);
     // K_aa
-    for (a2 = 0; a2 < sizeAlpha_; a2++) {
-      int indexA2 = pIndexAlpha_[a2];
+    for (a2 = 0; a2 < sizeAlpha; a2++) {
+      int indexA2 = block.indexAlpha[a2];
       int i2, j2, k2;
       pBWellPt_[indexA2]->GetIJK(i2, j2, k2);
 
@@ -608,106 +696,121 @@ void CKrigingAdmin::SetMatrix(NRLib::Matrix & krigMatrix,
     } // end a2
 
     // K_ab
-    for (b2 = 0; b2 < sizeBeta_; b2++) {
-      int indexB2 = pIndexBeta_[b2];
+    for (b2 = 0; b2 < sizeBeta; b2++) {
+      int indexB2 = block.indexBeta[b2];
       int i2, j2, k2;
       pBWellPt_[indexB2]->GetIJK(i2, j2, k2);
-      krigMatrix(krigRowIndex, b2 + sizeAlpha_) = covCrAlphaBeta_.GetGamma2(i, j, k, i2, j2, k2);
+      krigMatrix(krigRowIndex, b2 + sizeAlpha) = covCrAlphaBeta_.GetGamma2(i, j, k, i2, j2, k2);
     } // end b2
 
     // K_ar
-    for (r2 = 0; r2 < sizeRho_; r2++) {
-      int indexR2 = pIndexRho_[r2];
+    for (r2 = 0; r2 < sizeRho; r2++) {
+      int indexR2 = block.indexRho[r2];
       int i2, j2, k2;
       pBWellPt_[indexR2]->GetIJK(i2, j2, k2);
-      krigMatrix(krigRowIndex, r2 + sizeAlpha_ + sizeBeta_) = covCrAlphaRho_.GetGamma2(i, j, k, i2, j2, k2);
+      krigMatrix(krigRowIndex, r2 + sizeAlpha + sizeBeta) = covCrAlphaRho_.GetGamma2(i, j, k, i2, j2, k2);
     } // end r2
   }// end a
 
   // second row
-  for (b = 0; b < sizeBeta_; b++) {
-    int krigRowIndex = b + sizeAlpha_;
-    int indexB = pIndexBeta_[b];
+  for (b = 0; b < sizeBeta; b++) {
+    int krigRowIndex = b + sizeAlpha;
+    int indexB = block.indexBeta[b];
     int i,j,k;
     pBWellPt_[indexB]->GetIJK(i, j, k);
     // K_ba
-    for (a2 = 0; a2 < sizeAlpha_; a2++) {
-      int indexA2 = pIndexAlpha_[a2];
+    for (a2 = 0; a2 < sizeAlpha; a2++) {
+      int indexA2 = block.indexAlpha[a2];
       int i2, j2, k2;
       pBWellPt_[indexA2]->GetIJK(i2, j2, k2);
       krigMatrix(krigRowIndex,a2) = covCrAlphaBeta_.GetGamma2(i2, j2, k2, i, j, k); // flip
     } // end a2
 
     // K_bb
-    for (b2 = 0; b2 < sizeBeta_; b2++) {
-      int indexB2 = pIndexBeta_[b2];
+    for (b2 = 0; b2 < sizeBeta; b2++) {
+      int indexB2 = block.indexBeta[b2];
       int i2, j2, k2;
       pBWellPt_[indexB2]->GetIJK(i2, j2, k2);
-      krigMatrix(krigRowIndex, b2 + sizeAlpha_) = covBeta_.GetGamma2(i, j, k, i2, j2, k2);
+      krigMatrix(krigRowIndex, b2 + sizeAlpha) = covBeta_.GetGamma2(i, j, k, i2, j2, k2);
     } // end b2
 
     // K_br
-    for (r2 = 0; r2 < sizeRho_; r2++) {
-      int indexR2 = pIndexRho_[r2];
+    for (r2 = 0; r2 < sizeRho; r2++) {
+      int indexR2 = block.indexRho[r2];
       int i2, j2, k2;
       pBWellPt_[indexR2]->GetIJK(i2, j2, k2);
-      krigMatrix(krigRowIndex,r2 + sizeAlpha_ + sizeBeta_) = covCrBetaRho_.GetGamma2(i, j, k, i2, j2, k2);
+      krigMatrix(krigRowIndex,r2 + sizeAlpha + sizeBeta) = covCrBetaRho_.GetGamma2(i, j, k, i2, j2, k2);
     } // end r2
   }// end b
   // third row
-  for (r = 0; r < sizeRho_; r++) {
-    int krigRowIndex = r + sizeAlpha_ + sizeBeta_;
-    int indexR = pIndexRho_[r];
+  for (r = 0; r < sizeRho; r++) {
+    int krigRowIndex = r + sizeAlpha + sizeBeta;
+    int indexR = block.indexRho[r];
     int i,j,k;
     pBWellPt_[indexR]->GetIJK(i, j, k);
     // K_ra
-    for (a2 = 0; a2 < sizeAlpha_; a2++) {
-      int indexA2 = pIndexAlpha_[a2];
+    for (a2 = 0; a2 < sizeAlpha; a2++) {
+      int indexA2 = block.indexAlpha[a2];
       int i2, j2, k2;
       pBWellPt_[indexA2]->GetIJK(i2, j2, k2);
       krigMatrix(krigRowIndex, a2) = covCrAlphaRho_.GetGamma2(i2, j2, k2, i, j, k); // flip
     } // end a2
 
     // K_rb
-    for (b2 = 0; b2 < sizeBeta_; b2++) {
-      int indexB2 = pIndexBeta_[b2];
+    for (b2 = 0; b2 < sizeBeta; b2++) {
+      int indexB2 = block.indexBeta[b2];
       int i2, j2, k2;
       pBWellPt_[indexB2]->GetIJK(i2, j2, k2);
-      krigMatrix(krigRowIndex, b2  + sizeAlpha_) = covCrBetaRho_.GetGamma2(i2, j2, k2, i, j, k); // flip
+      krigMatrix(krigRowIndex, b2  + sizeAlpha) = covCrBetaRho_.GetGamma2(i2, j2, k2, i, j, k); // flip
     } // end b2
 
     // K_rr
-    for (r2 = 0; r2 < sizeRho_; r2++) {
-      int indexR2 = pIndexRho_[r2];
+    for (r2 = 0; r2 < sizeRho; r2++) {
+      int indexR2 = block.indexRho[r2];
       int i2, j2, k2;
       pBWellPt_[indexR2]->GetIJK(i2, j2, k2);
-      krigMatrix(krigRowIndex, r2 + sizeAlpha_ + sizeBeta_) = covRho_.GetGamma2(i, j, k, i2, j2, k2);
+      krigMatrix(krigRowIndex, r2 + sizeAlpha + sizeBeta) = covRho_.GetGamma2(i, j, k, i2, j2, k2);
     } // end r2
   }// end r
+}
+
+void CKrigingAdmin::SetResidual(NRLib::Vector      & residual,
+                                const KrigingBlock & block) const {
+  const int sizeAlpha = static_cast<int>(block.indexAlpha.size());
+  const int sizeBeta  = static_cast<int>(block.indexBeta.size());
+  const int sizeRho   = static_cast<int>(block.indexRho.size());
+  int a, b, r;
 
-  // Also calulates the kriging data vector
-  for (a = 0; a < sizeAlpha_; a++) {
-    int indexA = pIndexAlpha_[a];
+  // the kriging data vector
+  for (a = 0; a < sizeAlpha; a++) {
+    int indexA = block.indexAlpha[a];
     residual(a) = pBWellPt_[indexA]->GetAlpha();
   } // end a
 
-  for (b = 0; b < sizeBeta_; b++) {
-    int indexB = pIndexBeta_[b];
-    residual(sizeAlpha_ + b) = pBWellPt_[indexB]->GetBeta();
+  for (b = 0; b < sizeBeta; b++) {
+    int indexB = block.indexBeta[b];
+    residual(sizeAlpha + b) = pBWellPt_[indexB]->GetBeta();
   } // end b
 
-  for (r = 0; r < sizeRho_; r++) {
-    int indexR = pIndexRho_[r];
-    residual(sizeAlpha_ + sizeBeta_ + r) = pBWellPt_[indexR]->GetRho();
+  for (r = 0; r < sizeRho; r++) {
+    int indexR = block.indexRho[r];
+    residual(sizeAlpha + sizeBeta + r) = pBWellPt_[indexR]->GetRho();
   } // end r
 
 }
 
-void CKrigingAdmin::SetKrigVector(NRLib::Vector & k,
-                                  Gamma           gamma)
+void CKrigingAdmin::SetKrigVector(NRLib::Vector      & kVec,
+                                  const KrigingBlock & block,
+                                  Gamma                gamma,
+                                  int                  i,
+                                  int                  j,
+                                  int                  k) const
 {
+  const int sizeAlpha = static_cast<int>(block.indexAlpha.size());
+  const int sizeBeta  = static_cast<int>(block.indexBeta.size());
+  const int sizeRho   = static_cast<int>(block.indexRho.size());
   int offsetB1, offsetR1;
-  offsetB1 = sizeAlpha_; offsetR1 = sizeAlpha_ + sizeBeta_;
+  offsetB1 = sizeAlpha; offsetR1 = sizeAlpha + sizeBeta;
   const CovGridSeparated *pA = NULL, *pB = NULL, *pR = NULL;
   bool flipA = false, flipB = false, flipR = false;
   switch(gamma) {
@@ -736,29 +839,29 @@ void CKrigingAdmin::SetKrigVector(NRLib::Vector & k,
 
   // k_a
   int a2;
-  for (a2 = 0; a2 < sizeAlpha_; a2++) {
-    int indexA2 = pIndexAlpha_[a2];
+  for (a2 = 0; a2 < sizeAlpha; a2++) {
+    int indexA2 = block.indexAlpha[a2];
     int i2, j2, k2;
     pBWellPt_[indexA2]->GetIJK(i2, j2, k2);
-    k(a2) = (!flipA ? pA->GetGamma2(i_, j_, k_, i2, j2, k2) : pA->GetGamma2(i2, j2, k2, i_, j_, k_));
+    kVec(a2) = (!flipA ? pA->GetGamma2(i, j, k, i2, j2, k2) : pA->GetGamma2(i2, j2, k2, i, j, k));
   } // end a2
 
   // k_b
   int b2;
-  for (b2 = 0; b2 < sizeBeta_; b2++) {
-    int indexB2 = pIndexBeta_[b2];
+  for (b2 = 0; b2 < sizeBeta; b2++) {
+    int indexB2 = block.indexBeta[b2];
     int i2, j2, k2;
     pBWellPt_[indexB2]->GetIJK(i2, j2, k2);
-    k(b2 + offsetB1) = (!flipB ? pB->GetGamma2(i_, j_, k_, i2, j2, k2) : pB->GetGamma2(i2, j2, k2, i_, j_, k_));
+    kVec(b2 + offsetB1) = (!flipB ? pB->GetGamma2(i, j, k, i2, j2, k2) : pB->GetGamma2(i2, j2, k2, i, j, k));
   } // end b2
 
   // k_r
   int r2;
-  for (r2 = 0; r2 < sizeRho_; r2++) {
-    int indexR2 = pIndexRho_[r2];
+  for (r2 = 0; r2 < sizeRho; r2++) {
+    int indexR2 = block.indexRho[r2];
     int i2, j2, k2;
     pBWellPt_[indexR2]->GetIJK(i2, j2, k2);
-    k(r2 + offsetR1) = (!flipR ? pR->GetGamma2(i_, j_, k_, i2, j2, k2) : pR->GetGamma2(i2, j2, k2, i_, j_, k_));
+    kVec(r2 + offsetR1) = (!flipR ? pR->GetGamma2(i, j, k, i2, j2, k2) : pR->GetGamma2(i2, j2, k2, i, j, k));
   } // end r2
 }
 
@@ -11,6 +11,8 @@ class CBWellPt;
 class Simbox;
 class CovGridSeparated;
 
+#include <vector>
+
 #include "nrlib/flens/nrlib_flens.hpp"
 
 #include "src/box.h"
@@ -18,6 +20,16 @@ class CovGridSeparated;
 class CKrigingAdmin
 {
 private: enum DataBoxSize { DBS_TOO_SMALL, DBS_TOO_BIG, DBS_RIGHT};
+  // A kriging block and its data neighbourhood. The neighbourhood and the
+  // Cholesky factor of the kriging matrix only depend on the well positions,
+  // so they are found once and reused every time the block is kriged.
+  struct KrigingBlock
+  {
+    int                 iMin, jMin, kMin, iMax, jMax, kMax;
+    std::vector<int>    indexAlpha, indexBeta, indexRho;   // indexes into pBWellPt_
+    bool                cacheFactor;                       // true if the factor is kept
+    std::vector<double> factor;                            // upper Cholesky factor, column major
+  };
 public:
   CKrigingAdmin(const Simbox& simbox, CBWellPt ** pBWellPt, int noData,
                 CovGridSeparated& covAlpha,
@@ -36,7 +48,9 @@ public:
 private:
   void            Init();
   void            KrigAll(Gamma gamma, bool doSmoothing = false);
-  void            KrigBlock(Gamma gamma);
+  void            FindKrigingBlocks(Gamma gamma, std::vector<KrigingBlock> & blocks);
+  void            KrigBlock(Gamma gamma, KrigingBlock & block, FFTGrid * pGrid,
+                            int & noRMissing, int & noSolvedMatrixEq, int & noCholeskyDecomp);
   /* Finds the data by using the following rule: Cokriging 3 variables X,Y,Z.
   If you are doing kriging on X. Then for each well obs: if you have info on X use it and
   ignore the two others Y,Z. Else use info on Y and Z.
@@ -45,11 +59,16 @@ private:
   void            FindDataInDataBlockLoop(Gamma gamma);
   DataBoxSize     FindDataInDataBlock(Gamma gamma, const CBox & dataBlock);
   int             NBlocks(int dBlocks, int lSBox) const;
-  void            SetMatrix(NRLib::Matrix & krigMatrix,
-                            NRLib::Vector & residual,
-                            Gamma           gamma);
-  void            SetKrigVector(NRLib::Vector & k,
-                                Gamma           gamma);
+  void            SetMatrix(NRLib::Matrix      & krigMatrix,
+                            const KrigingBlock & block) const;
+  void            SetResidual(NRLib::Vector      & residual,
+                              const KrigingBlock & block) const;
+  void            SetKrigVector(NRLib::Vector      & kVec,
+                                const KrigingBlock & block,
+                                Gamma                gamma,
+                                int                  i,
+                                int                  j,
+                                int                  k) const;
   void            EstimateSizeOfBlock();
   void            EstimateSizeOfBlock2();
   float           CalcCPUTime(float dxBlock, float dyBlockExt, float& nd, bool& rapidInc);
@@ -77,7 +96,6 @@ private:
   CBox            currDataBox_, currBlock_;                  // current data neightbourhood and kriging area
   int             dxBlock_, dyBlock_, dzBlock_;              // number of cells to define a kriging block
   int             dxBlockExt_, dyBlockExt_, dzBlockExt_;     // number of additional cells to reach data neighbourhood
-  int             i_, j_, k_;                                // current kriging indexes
   int           * pIndexAlpha_, *pIndexBeta_, *pIndexRho_;  // holds an array of indexes into pBWells_
   int             sizeAlpha_, sizeBeta_, sizeRho_;           // current sizes
   int             noValidAlpha_, noValidBeta_, noValidRho_;  // number of valid a, b og r data
@@ -97,7 +115,10 @@ private:
   enum            { maxDataTolerance_         = 10,          // in % of dataTarget_
                     maxDataBlockLoopCounter_  =  7,          // ca. max number of attempts to find a right data block neighbourhood, not used
                     maxCholeskyLoopCounter_   = 20,          // max number of attempts to cholesky decomposition
-                    switchFailed_             =  1};         // assert flag
+                    switchFailed_             =  1,          // assert flag
+                    maxFactorCacheMB_         = 256};        // memory for Cholesky factors kept between kriging runs
+
+  std::vector<KrigingBlock> krigingBlocks_[3];               // blocks and neighbourhoods for each Gamma, found once
 
   int             totalNoDataInCurrKrigBlock_;               // total number of data in current kriging block
   int             noSolvedMatrixEq_;                         // total number of times we have actually solved the matrix eq, for debug
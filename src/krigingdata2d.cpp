@@ -75,6 +75,13 @@ KrigingData2D::findMeanValues(void)
     data_[k] /= count_[k];
 }
 
+//---------------------------------------------------------------------
+bool
+KrigingData2D::hasSameLocations(const KrigingData2D & other) const
+{
+  return (indexI_ == other.indexI_ && indexJ_ == other.indexJ_);
+}
+
 //---------------------------------------------------------------------
 void
 KrigingData2D::writeToFile(const std::string & fileName)
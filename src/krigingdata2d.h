@@ -18,6 +18,7 @@ public:
                                      int   j,
                                      float value);
   void                       findMeanValues(void);
+  bool                       hasSameLocations(const KrigingData2D & other) const;
 
   const std::vector<float> & getData(void)         const { return data_                          ;}
   const std::vector<int>   & getIndexI(void)       const { return indexI_                        ;}
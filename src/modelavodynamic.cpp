@@ -35,6 +35,7 @@
 #include "src/waveletfilter.h"
 #include "src/tasklist.h"
 #include "src/seismicparametersholder.h"
+#include "src/profiler.h"
 
 #include "lib/utils.h"
 #include "lib/random.h"
@@ -492,6 +493,7 @@ ModelAVODynamic::processSeismic(FFTGrid             **& seisCube,
                                 std::string           & errText,
                                 bool                  & failed)
 {
+  ProfileScope profile("ModelAVODynamic::processSeismic");
   double wall=0.0, cpu=0.0;
   TimeKit::getTime(wall,cpu);
 
@@ -959,6 +961,7 @@ ModelAVODynamic::processWavelets(Wavelet                    **& wavelet,
                                  std::string                  & errText,
                                  bool                         & failed)
 {
+  ProfileScope profile("ModelAVODynamic::processWavelets");
   int error = 0;
   LogKit::WriteHeader("Processing/generating wavelets");
 
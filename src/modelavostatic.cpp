@@ -12,6 +12,10 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "src/definitions.h"
 #include "src/modelgeneral.h"
 #include "src/modelavostatic.h"
@@ -33,6 +37,7 @@
 #include "src/io.h"
 #include "src/waveletfilter.h"
 #include "src/tasklist.h"
+#include "src/parameteroutput.h"
 
 #include "lib/utils.h"
 #include "lib/random.h"
@@ -214,7 +219,12 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
   int nGridFacies       = static_cast<int>(facies_prob.size())+1; // One for each facies, one for undef, unpadded.
   int nGridHistograms   = static_cast<int>(facies_prob.size());   // One for each facies, 2MB.
   int nGridKriging      = 1;                                      // One grid for kriging, unpadded.
-  int nGridCompute      = 1;                                      // Computation grid, padded (for convenience)
+  int attributeFlags    = IO::AI + IO::LAMBDARHO + IO::LAMELAMBDA + IO::LAMEMU + IO::MURHO + IO::POISSONRATIO + IO::SI + IO::VPVSRATIO;
+  int nAttributes       = 0;                                      // Derived attributes written, such as AI and SI
+  for(int flag = 1 ; flag <= attributeFlags ; flag <<= 1)
+    if((modelSettings->getOutputGridsElastic() & attributeFlags & flag) > 0)
+      nAttributes++;
+  int nGridCompute      = std::min(nAttributes, ParameterOutput::getNAttributeGrids()); // Attribute grids of one output pass, padded (for convenience)
   int nGridFileMode     = 1;                                      // One grid for intermediate file storage
 
   int nGrids;
@@ -263,16 +273,32 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
            (modelSettings->getEstimateFaciesProb() == false || modelSettings->getFaciesProbRelative() == false))
           peak2P -= nGridBackground; //Background grids are released before simulation in this case.
         int peak2U = baseU;     //Base level is the same, but may increase.
-        bool computeGridUsed = ((modelSettings->getOutputGridsElastic() & (IO::AI + IO::LAMBDARHO + IO::LAMELAMBDA + IO::LAMEMU + IO::MURHO + IO::POISSONRATIO + IO::SI + IO::VPVSRATIO)) > 0);
-        if(computeGridUsed == true)
-          peak2P += nGridCompute;
-        else if(modelSettings->getKrigingParameter() > 0) //Note the else, since this grid will use same memory as computation grid if both are active.
+        if(nGridCompute > 0)
+          peak2P += nGridCompute; //Attribute grids of writeParameters. With parallel simulation, made by the writer thread while the next batch is generated.
+        else if(modelSettings->getKrigingParameter() > 0) //Note the else, since this grid will use same memory as computation grids if both are active.
           peak2U += nGridKriging;
 
+        int peak2Chol = 0;
+        if(modelSettings->getStoreCholeskyFactors() == true)
+          peak2Chol = 6;                 //Packed Cholesky factors of posterior covariance, as six padded grids.
+        if(modelSettings->getParallelSimulation() == true) {
+          //As Crava::simulateInParallel: One thread writes a batch while the others generate the next,
+          //so two sets of grids are kept when there is more than one batch.
+          int nThreads = 1;
+#ifdef _OPENMP
+          nThreads = omp_get_max_threads();
+#endif
+          int nSim      = modelSettings->getNumberOfSimulations();
+          int nParallel = std::min(std::max(nThreads - 1, 1), nSim);
+          int nSets     = ((nThreads > 1 && nSim > nParallel) ? 2 : 1);
+          peak2P   += 3*nSets*nParallel - 3; //Three parameter grids per realisation generated or written, three counted above.
+          peak2Chol = 6;                     //Packed Cholesky factors of posterior covariance, as six padded grids.
+        }
+
         if(peak2P > peakNGrid)
           peakNGrid = peak2P;
 
-        long long int peak2Mem = peak2P*gridSizePad + peak2U*gridSizeBase;
+        long long int peak2Mem = (peak2P + peak2Chol)*gridSizePad + peak2U*gridSizeBase;
         if(peak2Mem > peakGridMem)
           peakGridMem = peak2Mem;
       }
@@ -317,7 +343,24 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
 
   if(mem2>mem1)
     LogKit::LogFormatted(LogKit::Low,"\n This estimate is too high because seismic data are cut to fit the internal grid\n");
-  if (!modelSettings->getFileGrid()) {
+
+  //
+  // When grids are stored on file, those not in use are still kept in memory
+  // as far as the memory allows, and only the least recently used ones are
+  // moved to file. The memory for this is the given maximum, or what we could
+  // allocate, less the memory used beyond the grids.
+  //
+  float maxMemory = modelSettings->getMaxMemory()*1024.f*1024.f;
+  if (maxMemory > 0.0f) {
+    if (!modelSettings->getFileGrid() && neededMem > maxMemory) {
+      modelSettings->setFileGrid(true);
+      LogKit::LogFormatted(LogKit::Low,"More memory than the maximum of %.1f MB is needed. Using file storage for grids not in use.\n",
+                           modelSettings->getMaxMemory());
+    }
+    if (modelSettings->getFileGrid())
+      FFTFileGrid::setMemoryBudget(std::max(maxMemory - mem0, 0.0f));
+  }
+  else if (!modelSettings->getFileGrid()) {
     //
     // Check if we can hold everything in memory.
     //
@@ -332,7 +375,8 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
     catch (std::bad_alloc& ) //Could not allocate memory
     {
       modelSettings->setFileGrid(true);
-      LogKit::LogFormatted(LogKit::Low,"Not enough memory to hold all grids. Using file storage.\n");
+      FFTFileGrid::setMemoryBudget(std::max(static_cast<float>(i*gridSizePad) - mem0, 0.0f));
+      LogKit::LogFormatted(LogKit::Low,"Not enough memory to hold all grids. Using file storage for grids not in use.\n");
     }
 
     for(int j=0 ; j<i ; j++)
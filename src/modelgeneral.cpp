@@ -41,6 +41,7 @@
 #include "src/cravatrend.h"
 #include "src/seismicparametersholder.h"
 #include "src/parameteroutput.h"
+#include "src/profiler.h"
 
 #include "lib/utils.h"
 #include "lib/random.h"
@@ -305,6 +306,7 @@ ModelGeneral::readSegyFile(const std::string       & fileName,
                            std::string             & errText,
                            bool                      nopadding)
 {
+  ProfileScope profile("ModelGeneral::readSegyFile");
   SegY * segy = NULL;
   bool failed = false;
   target = NULL;
@@ -351,6 +353,7 @@ ModelGeneral::readSegyFile(const std::string       & fileName,
                           onlyVolume,
                           relativePadding);
       segy->CreateRegularGrid();
+      Profiler::addBytes(static_cast<double>(NRLib::FindFileSize(fileName)));
     }
     else {
       errText += errTxt;
@@ -1511,6 +1514,10 @@ ModelGeneral::printSettings(ModelSettings     * modelSettings,
 
 
     LogKit::LogFormatted(LogKit::Low,"  Number of realisations                   : %10d\n",modelSettings->getNumberOfSimulations());
+    if(modelSettings->getParallelSimulation())
+      LogKit::LogFormatted(LogKit::Low,"  Parallel simulation                      : %10s\n","yes");
+    else if(modelSettings->getStoreCholeskyFactors())
+      LogKit::LogFormatted(LogKit::Low,"  Store Cholesky factors                   : %10s\n","yes");
   }
   if(modelSettings->getForwardModeling()==false)
   {
@@ -1645,6 +1652,11 @@ ModelGeneral::printSettings(ModelSettings     * modelSettings,
     LogKit::LogFormatted(LogKit::High,"\nAdvanced settings:\n");
 
   LogKit::LogFormatted(LogKit::Medium, "  Use intermediate disk storage for grids  : %10s\n", (modelSettings->getFileGrid() ? "yes" : "no"));
+  if (modelSettings->getNumberOfThreads() > 0)
+    LogKit::LogFormatted(LogKit::Medium, "  Number of threads                        : %10d\n", modelSettings->getNumberOfThreads());
+  else
+    LogKit::LogFormatted(LogKit::High  , "  Number of threads                        : %10s\n", "all");
+  LogKit::LogFormatted(LogKit::High, "  Use SegY trace index files               : %10s\n", (modelSettings->getUseSegyTraceIndex() ? "yes" : "no"));
 
   if (inputFiles->getReflMatrFile() != "")
     LogKit::LogFormatted(LogKit::Medium, "  Take reflection matrix from file         : %10s\n", inputFiles->getReflMatrFile().c_str());
@@ -50,6 +50,8 @@ ModelSettings::ModelSettings(void)
   krigingParameter_        =        0; // Indicate kriging not set.
   nWells_                  =        0;
   nSimulations_            =        0;
+  parallelSimulation_      =    false;
+  storeCholeskyFactors_    =    false;
   backgroundType_          =       "";
 
   //
@@ -144,6 +146,7 @@ ModelSettings::ModelSettings(void)
   otherFlag_               =        0;
   debugFlag_               =        0;
   fileGrid_                =    false;
+  maxMemory_               =     0.0f;
   waveletFormatManual_     =    false;
   useVerticalVariogram_    =    false;
   do4DInversion_           =    false;
@@ -173,6 +176,8 @@ ModelSettings::ModelSettings(void)
   noSeismicNeeded_         =    false;
   snapGridToSeismicData_   =    false;
   wellGradientFromSeismic_ =    false;
+  nThreads_                =        0;
+  useSegyTraceIndex_       =     true;
 
   priorFaciesProbGiven_    = ModelSettings::FACIES_FROM_WELLS;
 
@@ -92,6 +92,8 @@ public:
   const std::vector<int>         & getIndicatorFilter(void)             const { return indFilter_                                 ;}
   int                              getNumberOfWells(void)               const { return nWells_                                    ;}
   int                              getNumberOfSimulations(void)         const { return nSimulations_                              ;}
+  bool                             getParallelSimulation(void)          const { return parallelSimulation_                        ;}
+  bool                             getStoreCholeskyFactors(void)        const { return storeCholeskyFactors_                      ;}
   float                            getTemporalCorrelationRange(void)    const { return temporalCorrelationRange_                  ;}
   float                            getAlphaMin(void)                    const { return alpha_min_                                 ;}
   float                            getAlphaMax(void)                    const { return alpha_max_                                 ;}
@@ -166,6 +168,7 @@ public:
   int                              getDebugFlag(void)                   const { return debugFlag_                                 ;}
   static int                       getDebugLevel(void)                        { return debugFlag_                                 ;}
   bool                             getFileGrid(void)                    const { return fileGrid_                                  ;}
+  float                            getMaxMemory(void)                   const { return maxMemory_                                 ;}
   bool                             getEstimationMode(void)              const { return estimationMode_                            ;}
   bool                             getForwardModeling(void)             const { return forwardModeling_                           ;}
   bool                             getGenerateSeismicAfterInv(void)     const { return generateSeismicAfterInv_                   ;}
@@ -195,9 +198,12 @@ public:
   double                           getWavelet3DTuningFactor(void)       const { return wavelet3DTuningFactor_                     ;}
   double                           getGradientSmoothingRange(void)      const { return gradientSmoothingRange_                    ;}
   bool                             getEstimateWellGradientFromSeismic() const { return wellGradientFromSeismic_                   ;}
+  int                              getNumberOfThreads(void)             const { return nThreads_                                  ;}
+  bool                             getUseSegyTraceIndex(void)           const { return useSegyTraceIndex_                         ;}
   int                              getLogLevel(void)                    const { return logLevel_                                  ;}
   bool                             getErrorFileFlag()                   const { return ((otherFlag_ & IO::ERROR_FILE)>0)          ;}
   bool                             getTaskFileFlag()                    const { return ((otherFlag_ & IO::TASK_FILE)>0)           ;}
+  bool                             getProfileFlag()                     const { return ((otherFlag_ & IO::PROFILE)>0)             ;}
   int                              getSeed(void)                        const { return seed_                                      ;}
   bool                             getDoInversion(void)                 const;
   bool                             getDoDepthConversion(void)           const;
@@ -313,6 +319,8 @@ public:
   void setInverseVelocity(int i, bool inverse)            { inverseVelocity_[i]       = inverse                  ;}
   void setNumberOfWells(int nWells)                       { nWells_                   = nWells                   ;}
   void setNumberOfSimulations(int nSimulations)           { nSimulations_             = nSimulations             ;}
+  void setParallelSimulation(bool parallelSimulation)     { parallelSimulation_       = parallelSimulation       ;}
+  void setStoreCholeskyFactors(bool storeFactors)         { storeCholeskyFactors_     = storeFactors             ;}
   void setAlphaMin(float alpha_min)                       { alpha_min_                = alpha_min                ;}
   void setAlphaMax(float alpha_max)                       { alpha_max_                = alpha_max                ;}
   void setBetaMin(float beta_min)                         { beta_min_                 = beta_min                 ;}
@@ -387,6 +395,7 @@ public:
   void setOtherOutputFlag(int otherFlag)                  { otherFlag_                = otherFlag                ;}
   void setDebugFlag(int debugFlag)                        { debugFlag_                = debugFlag                ;}
   void setFileGrid(bool fileGrid)                         { fileGrid_                 = fileGrid                 ;}
+  void setMaxMemory(float maxMemory)                      { maxMemory_                = maxMemory                ;}
   void setEstimationMode(bool estimationMode)             { estimationMode_           = estimationMode           ;}
   void setForwardModeling(bool forwardModeling)           { forwardModeling_          = forwardModeling          ;}
   void setGenerateSeismicAfterInv( bool generateSeismic)  { generateSeismicAfterInv_  = generateSeismic          ;}
@@ -484,6 +493,8 @@ public:
   void setWavelet3DTuningFactor(double tuningFactor)      { wavelet3DTuningFactor_    = tuningFactor             ;}
   void setGradientSmoothingRange(double smoothingRange)   { gradientSmoothingRange_   = smoothingRange           ;}
   void setEstimateWellGradientFromSeismic(bool estimate)  { wellGradientFromSeismic_  = estimate                 ;}
+  void setNumberOfThreads(int nThreads)                   { nThreads_                 = nThreads                 ;}
+  void setUseSegyTraceIndex(bool useIndex)                { useSegyTraceIndex_        = useIndex                 ;}
 
   enum          priorFacies{FACIES_FROM_WELLS,
                             FACIES_FROM_MODEL_FILE,
@@ -617,6 +628,8 @@ private:
 
   int                               nWells_;
   int                               nSimulations_;
+  bool                              parallelSimulation_;         ///< Generate realisations concurrently from separate random streams
+  bool                              storeCholeskyFactors_;       ///< Factorize the posterior covariance once for all realisations
 
   float                             alpha_min_;                  ///< Vp - smallest allowed value
   float                             alpha_max_;                  ///< Vp - largest allowed value
@@ -713,6 +726,7 @@ private:
   int                               waveletFormatFlag_;          ///< Decides wavelet output format
   int                               otherFlag_;                  ///< Decides output beyond grids and wells.
   bool                              fileGrid_;                   ///< Indicator telling if grids are to be kept on file
+  float                             maxMemory_;                  ///< Memory CRAVA may use, in MB (0 = no limit)
   bool                              outputGridsDefault_;         ///< Indicator telling if grid output has been actively controlled
   bool                              waveletFormatManual_;        ///< True if wavelet format is decided in the model file
   bool                              useVerticalVariogram_;       ///< True if a vertical variogram is used to estimate temporal correlation
@@ -746,6 +760,8 @@ private:
   double                            wavelet3DTuningFactor_;      ///< Large value forces better fit of wavelet
   double                            gradientSmoothingRange_;     ///< Controls smoothing of gradient used in 3D wavelet estimate/inversion
   bool                              wellGradientFromSeismic_;    ///< Estimate well gradient used for 3D wavelet estimation from seismic?
+  int                               nThreads_;                   ///< Number of threads used in parallel loops (0 = all available)
+  bool                              useSegyTraceIndex_;          ///< Use and write trace index files next to the SegY files
   float                             seismicQualityGridRange_;    ///< Radius value from well-points where wells are used in Seismic Quality Grids
   float                             seismicQualityGridValue_;    ///< Value between wells if range is used.
 
@@ -2,6 +2,8 @@
 *      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
 ***************************************************************************/
 
+#include <algorithm>
+
 #include "src/fftgrid.h"
 #include "src/fftfilegrid.h"
 #include "src/parameteroutput.h"
@@ -40,377 +42,199 @@ ParameterOutput::writeParameters(const Simbox  * simbox,
   if(kriged)
     suffix = "_Kriged"+suffix;
 
-  if((outputFlag & IO::MURHO) > 0)
-  {
-    fileName = prefix+"MuRho"+suffix;
-    computeMuRho(simbox, modelGeneral, modelSettings, alpha, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::LAMBDARHO) > 0)
-  {
-    fileName = prefix+"LambdaRho"+suffix;
-    computeLambdaRho(simbox, modelGeneral, modelSettings, alpha, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::LAMELAMBDA) > 0)
-  {
-    fileName = prefix+"LameLambda"+suffix;
-    computeLameLambda(simbox, modelGeneral, modelSettings, alpha, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::LAMEMU) > 0)
-  {
-    fileName = prefix+"LameMu"+suffix;
-    computeLameMu(simbox, modelGeneral,  modelSettings, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::POISSONRATIO) > 0)
-  {
-    fileName = prefix+"PoissonRatio"+suffix;
-    computePoissonRatio(simbox, modelGeneral, modelSettings, alpha, beta, fileGrid, fileName);
-  }
-  if((outputFlag & IO::AI) > 0)
-  {
-    fileName = prefix+"AI"+suffix;
-    computeAcousticImpedance(simbox, modelGeneral, modelSettings, alpha, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::SI) > 0)
-  {
-    fileName = prefix+"SI"+suffix;
-    computeShearImpedance(simbox, modelGeneral, modelSettings, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::VPVSRATIO) > 0)
-  {
-    fileName = prefix+"VpVsRatio"+suffix;
-    computeVpVsRatio(simbox, modelGeneral, modelSettings, alpha, beta, fileGrid, fileName);
+  const int   attributeFlag[N_ATTR]  = {IO::MURHO, IO::LAMBDARHO, IO::LAMELAMBDA, IO::LAMEMU, IO::POISSONRATIO,
+                                        IO::AI, IO::SI, IO::VPVSRATIO};
+  const char * attributeName[N_ATTR]  = {"MuRho", "LambdaRho", "LameLambda", "LameMu", "PoissonRatio",
+                                         "AI", "SI", "VpVsRatio"};
+  const char * attributeLabel[N_ATTR] = {"Mu rho", "Lambda rho", "Lame lambda", "Lame mu", "Poisson ratio",
+                                         "Acoustic Impedance", "Shear impedance", "Vp-Vs ratio"};
+
+  bool expAlpha = ((outputFlag & IO::VP ) > 0);
+  bool expBeta  = ((outputFlag & IO::VS ) > 0);
+  bool expRho   = ((outputFlag & IO::RHO) > 0);
+
+  std::vector<int> requested;
+  for(int a = 0 ; a < N_ATTR ; a++)
+    if((outputFlag & attributeFlag[a]) > 0)
+      requested.push_back(a);
+
+  if(requested.empty() && !expAlpha && !expBeta && !expRho)
+    return;
+
+  //
+  // The attributes are computed in passes over alpha, beta and rho. Each pass
+  // fills at most getNAttributeGrids() attribute grids, which are written and
+  // deleted before the next pass. Vp, Vs and density are exponentiated in
+  // place in the last pass, and for a prediction transformed back after they
+  // have been written.
+  //
+  int nGroup = getNAttributeGrids();
+  int nPass  = std::max(1, (static_cast<int>(requested.size()) + nGroup - 1)/nGroup);
+  for(int pass = 0 ; pass < nPass ; pass++) {
+    std::vector<FFTGrid *> attribute(N_ATTR, static_cast<FFTGrid *>(NULL));
+    int last = std::min(static_cast<int>(requested.size()), (pass + 1)*nGroup);
+    for(int n = pass*nGroup ; n < last ; n++) {
+      int a = requested[n];
+      attribute[a] = createFFTGrid(alpha, fileGrid);
+      attribute[a]->setType(FFTGrid::PARAMETER);
+      attribute[a]->createRealGrid();
+    }
+
+    bool lastPass = (pass == nPass - 1);
+    computeAttributes(alpha, beta, rho, attribute, lastPass && expAlpha, lastPass && expBeta, lastPass && expRho);
+
+    for(int a = 0 ; a < N_ATTR ; a++) {
+      if(attribute[a] != NULL) {
+        fileName = prefix+attributeName[a]+suffix;
+        writeToFile(simbox, modelGeneral, modelSettings, attribute[a], fileName, attributeLabel[a]);
+        delete attribute[a];
+      }
+    }
   }
-  if((outputFlag & IO::VP) > 0)
+
+  if(expAlpha)
   {
     fileName = prefix+"Vp"+suffix;
-    alpha->setAccessMode(FFTGrid::RANDOMACCESS);
-    alpha->expTransf();
     writeToFile(simbox, modelGeneral, modelSettings, alpha, fileName, "Inverted Vp");
-    if(simNum<0) //prediction, need grid unharmed.
+    if(simNum<0) { //prediction, need grid unharmed.
+      alpha->setAccessMode(FFTGrid::RANDOMACCESS);
       alpha->logTransf();
-    alpha->endAccess();
+      alpha->endAccess();
+    }
   }
-  if((outputFlag & IO::VS) > 0)
+  if(expBeta)
   {
     fileName = prefix+"Vs"+suffix;
-    beta->setAccessMode(FFTGrid::RANDOMACCESS);
-    beta->expTransf();
     writeToFile(simbox, modelGeneral, modelSettings, beta, fileName, "Inverted Vs");
-    if(simNum<0) //prediction, need grid unharmed.
+    if(simNum<0) { //prediction, need grid unharmed.
+      beta->setAccessMode(FFTGrid::RANDOMACCESS);
       beta->logTransf();
-    beta->endAccess();
+      beta->endAccess();
+    }
   }
-  if((outputFlag & IO::RHO) > 0)
+  if(expRho)
   {
     fileName = prefix+"Rho"+suffix;
-    rho->setAccessMode(FFTGrid::RANDOMACCESS);
-    rho->expTransf();
     writeToFile(simbox, modelGeneral, modelSettings, rho, fileName, "Inverted density");
-    if(simNum<0) //prediction, need grid unharmed.
+    if(simNum<0) { //prediction, need grid unharmed.
+      rho->setAccessMode(FFTGrid::RANDOMACCESS);
       rho->logTransf();
-    rho->endAccess();
+      rho->endAccess();
+    }
   }
 }
 
 void
-ParameterOutput::computeAcousticImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                          FFTGrid * Alpha, FFTGrid * Rho ,
-                                          bool fileGrid, const std::string & fileName)
+ParameterOutput::computeAttributes(FFTGrid                * alpha,
+                                   FFTGrid                * beta,
+                                   FFTGrid                * rho,
+                                   std::vector<FFTGrid *> & attribute,
+                                   bool                     expAlpha,
+                                   bool                     expBeta,
+                                   bool                     expRho)
 {
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* prImpedance;
-  prImpedance = createFFTGrid(Alpha, fileGrid);
-  prImpedance->setType(FFTGrid::PARAMETER);
-  prImpedance->createRealGrid();
-  prImpedance->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  prImpedance->getrsize();
-  double ijkA, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
+  if(alpha->getIsTransformed()) alpha->invFFTInPlace();
+  if(beta->getIsTransformed())  beta->invFFTInPlace();
+  if(rho->getIsTransformed())   rho->invFFTInPlace();
+
+  alpha->setAccessMode(expAlpha ? FFTGrid::READANDWRITE : FFTGrid::READ);
+  beta ->setAccessMode(expBeta  ? FFTGrid::READANDWRITE : FFTGrid::READ);
+  rho  ->setAccessMode(expRho   ? FFTGrid::READANDWRITE : FFTGrid::READ);
+  for(int a = 0 ; a < N_ATTR ; a++)
+    if(attribute[a] != NULL)
+      attribute[a]->setAccessMode(FFTGrid::WRITE);
+
+  //
+  // The grids are streamed a row at a time, so alpha, beta and rho are read
+  // once for all attributes of the pass. The values are given by the same
+  // expressions as when each attribute was computed on its own, where
+  // -13.81551 in the exponent divides by 1 000 000.
+  //
+  int rnxp  = alpha->getRNxp();
+  int nRows = alpha->getrsize()/rnxp;
+
+  std::vector<float> rowA(rnxp);
+  std::vector<float> rowB(rnxp);
+  std::vector<float> rowR(rnxp);
+
+  for(int row = 0 ; row < nRows ; row++)
   {
-    ijkA = Alpha->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkA + ijkR);
-    prImpedance->setNextReal(float( compVal));
+    for(int i = 0 ; i < rnxp ; i++) {
+      rowA[i] = alpha->getNextReal();
+      rowB[i] = beta ->getNextReal();
+      rowR[i] = rho  ->getNextReal();
+    }
+
+    if(attribute[MURHO_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkB = rowB[i];
+        double ijkR = rowR[i];
+        attribute[MURHO_ATTR]->setNextReal(static_cast<float>(exp(2.0*(ijkB + ijkR) - 13.81551)));
+      }
+    if(attribute[LAMBDARHO_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkA = rowA[i];
+        double ijkB = rowB[i];
+        double ijkR = rowR[i];
+        attribute[LAMBDARHO_ATTR]->setNextReal(static_cast<float>(exp(2.0*(ijkA + ijkR) - 13.81551) - 2.0*exp(2.0*(ijkB + ijkR) - 13.81551)));
+      }
+    if(attribute[LAMELAMBDA_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkA = rowA[i];
+        double ijkB = rowB[i];
+        double ijkR = rowR[i];
+        attribute[LAMELAMBDA_ATTR]->setNextReal(static_cast<float>(exp(ijkR)*(exp(2*ijkA - 13.81551) - 2*exp(2*ijkB - 13.81551))));
+      }
+    if(attribute[LAMEMU_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkB = rowB[i];
+        double ijkR = rowR[i];
+        attribute[LAMEMU_ATTR]->setNextReal(static_cast<float>(exp(ijkR + 2*ijkB - 13.81551)));
+      }
+    if(attribute[POISSONRATIO_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkA     = rowA[i];
+        double ijkB     = rowB[i];
+        double vRatioSq = exp(2*(ijkA - ijkB));
+        attribute[POISSONRATIO_ATTR]->setNextReal(static_cast<float>(0.5*(vRatioSq - 2)/(vRatioSq - 1)));
+      }
+    if(attribute[AI_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkA = rowA[i];
+        double ijkR = rowR[i];
+        attribute[AI_ATTR]->setNextReal(static_cast<float>(exp(ijkA + ijkR)));
+      }
+    if(attribute[SI_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkB = rowB[i];
+        double ijkR = rowR[i];
+        attribute[SI_ATTR]->setNextReal(static_cast<float>(exp(ijkB + ijkR)));
+      }
+    if(attribute[VPVSRATIO_ATTR] != NULL)
+      for(int i = 0 ; i < rnxp ; i++) {
+        double ijkA = rowA[i];
+        double ijkB = rowB[i];
+        attribute[VPVSRATIO_ATTR]->setNextReal(static_cast<float>(exp(ijkA - ijkB)));
+      }
+
+    // As FFTGrid::expTransf()
+    if(expAlpha)
+      for(int i = 0 ; i < rnxp ; i++)
+        alpha->setNextReal(rowA[i] == RMISSING ? RMISSING : float(exp(rowA[i])));
+    if(expBeta)
+      for(int i = 0 ; i < rnxp ; i++)
+        beta->setNextReal(rowB[i] == RMISSING ? RMISSING : float(exp(rowB[i])));
+    if(expRho)
+      for(int i = 0 ; i < rnxp ; i++)
+        rho->setNextReal(rowR[i] == RMISSING ? RMISSING : float(exp(rowR[i])));
   }
 
-  Alpha->endAccess();
-  Rho->endAccess();
-
-  prImpedance->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, prImpedance, fileName, "Acoustic Impedance");
-  delete prImpedance;
-}
-
-void
-ParameterOutput::computeShearImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                       FFTGrid * Beta, FFTGrid * Rho,
-                                       bool fileGrid, const std::string & fileName)
-{
-
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* shImpedance;
-  shImpedance  = createFFTGrid(Beta, fileGrid);
-  shImpedance->setType(FFTGrid::PARAMETER);
-  shImpedance->createRealGrid();
-  shImpedance->setAccessMode(FFTGrid::WRITE);
-  int i;
-  int rSize =  shImpedance->getrsize();
-  double ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkB + ijkR);
-    shImpedance->setNextReal(float( compVal));
-  }
-
-  Beta->endAccess();
-  Rho->endAccess();
-
-  shImpedance->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, shImpedance, fileName, "Shear impedance");
-  delete shImpedance;
-}
-
-
-void
-ParameterOutput::computeVpVsRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                  FFTGrid * Alpha, FFTGrid * Beta,
-                                  bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed())  Beta->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* ratioVpVs;
-  ratioVpVs = createFFTGrid(Alpha, fileGrid);
-  ratioVpVs->setType(FFTGrid::PARAMETER);
-  ratioVpVs->createRealGrid();
-  ratioVpVs->setAccessMode(FFTGrid::WRITE);
-  int i;
-  int rSize =  ratioVpVs->getrsize();
-  double ijkA, ijkB, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkB = Beta->getNextReal();
-    compVal = exp(ijkA - ijkB);
-    ratioVpVs->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-
-  ratioVpVs->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, ratioVpVs, fileName, "Vp-Vs ratio");
-  delete ratioVpVs;
-}
-
-void
-ParameterOutput::computePoissonRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                     FFTGrid * Alpha, FFTGrid * Beta,
-                                     bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* poiRat;
-  poiRat  = createFFTGrid(Alpha, fileGrid);
-  poiRat->setType(FFTGrid::PARAMETER);
-  poiRat->createRealGrid();
-  poiRat->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  poiRat->getrsize();
-  double ijkA, ijkB, compVal, vRatioSq;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA      = Alpha->getNextReal();
-    ijkB      = Beta->getNextReal();
-    vRatioSq  = exp(2*(ijkA-ijkB));
-    compVal   = 0.5*(vRatioSq - 2)/(vRatioSq - 1);
-    poiRat->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-
-  poiRat->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, poiRat, fileName, "Poisson ratio");
-  delete poiRat;
-}
-
-void
-ParameterOutput::computeLameMu(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                               FFTGrid * Beta, FFTGrid * Rho,
-                               bool fileGrid, const std::string & fileName )
-{
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* mu;
-  mu  = createFFTGrid(Beta, fileGrid);
-  mu->setType(FFTGrid::PARAMETER);
-  mu->createRealGrid();
-  mu->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  mu->getrsize();
-  double ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkR+2*ijkB-13.81551); // -13.81551 in the exponent divides by 1 000 000
-    mu->setNextReal(float( compVal));
-  }
-
-  Beta->endAccess();
-  Rho->endAccess();
-  mu->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, mu, fileName, "Lame mu");
-
-  delete mu;
-}
-
-void
-ParameterOutput::computeLameLambda(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                   FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                   bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* lambda;
-  lambda  = createFFTGrid(Alpha, fileGrid);
-  lambda->setType(FFTGrid::PARAMETER);
-  lambda->createRealGrid();
-  lambda->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  lambda->getrsize();
-  double ijkA, ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkR)*(exp(2*ijkA-13.81551)-2*exp(2*ijkB-13.81551)); // -13.81551 in the exponent divides by 1 000 000
-    lambda->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-  Rho->endAccess();
-
-  lambda->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, lambda, fileName, "Lame lambda");
-
-  delete lambda;
-}
-
-void
-ParameterOutput::computeLambdaRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                  FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                  bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* lambdaRho;
-  lambdaRho  = createFFTGrid(Alpha, fileGrid);
-  lambdaRho->setType(FFTGrid::PARAMETER);
-  lambdaRho->createRealGrid();
-  lambdaRho->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  lambdaRho->getrsize();
-  double ijkA, ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(2.0*(ijkA +ijkR)-13.81551)-2.0*exp(2.0*(ijkB +ijkR)-13.81551); // -13.81551 in the exponent divides by 1e6=(1 000 000)
-    lambdaRho->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-  Rho->endAccess();
-
-  lambdaRho->endAccess();
-
-  writeToFile(simbox, modelGeneral, modelSettings, lambdaRho, fileName, "Lambda rho");
-  delete lambdaRho;
-}
-
-void
-ParameterOutput::computeMuRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                              FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                              bool fileGrid, const std::string & fileName)
-{
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* muRho;
-  muRho = createFFTGrid(Alpha, fileGrid);
-  muRho->setType(FFTGrid::PARAMETER);
-  muRho->createRealGrid();
-  muRho->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  muRho->getrsize();
-  double ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(2.0*(ijkB +ijkR)-13.81551); // -13.81551 in the exponent divides by 1e6=(1 000 000)
-    muRho->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-  Rho->endAccess();
-
-  muRho->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, muRho, fileName, "Mu rho");
-
-  delete muRho;
+  alpha->endAccess();
+  beta ->endAccess();
+  rho  ->endAccess();
+  for(int a = 0 ; a < N_ATTR ; a++)
+    if(attribute[a] != NULL)
+      attribute[a]->endAccess();
 }
 
 FFTGrid*
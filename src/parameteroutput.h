@@ -6,6 +6,7 @@
 #define PARAMETEROUTPUT_H
 
 #include <string>
+#include <vector>
 
 class FFTFileGrid;
 class FFTGrid;
@@ -37,32 +38,21 @@ public:
                                const std::string & sgriLabel,
                                bool padding=false);
 
+  // Number of attribute grids writeParameters holds at the same time.
+  static int       getNAttributeGrids() { return 2 ;}
 
 private:
-  static void      computeAcousticImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                            FFTGrid * Alpha, FFTGrid * Rho,
-                                            bool fileGrid, const std::string & fileName);
-  static void      computeShearImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                         FFTGrid * Beta, FFTGrid * Rho,
-                                         bool fileGrid, const std::string & fileName);
-  static void      computeVpVsRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                    FFTGrid * Alpha, FFTGrid * Beta,
-                                    bool fileGrid, const std::string & fileName);
-  static void      computePoissonRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                       FFTGrid * Alpha, FFTGrid * Beta,
-                                       bool fileGrid, const std::string & fileName);
-  static void      computeLameMu(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                 FFTGrid * Beta, FFTGrid * Rho,
-                                 bool fileGrid, const std::string & FileName);
-  static void      computeLameLambda(const Simbox * simbox,ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                     FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                     bool fileGrid, const std::string & fileName);
-  static void      computeMuRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                bool fileGrid, const std::string & fileName);
-  static void      computeLambdaRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                    FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                    bool fileGrid, const std::string & fileName);
+  // Derived attributes, in the order they are written.
+  enum             Attribute {MURHO_ATTR, LAMBDARHO_ATTR, LAMELAMBDA_ATTR, LAMEMU_ATTR, POISSONRATIO_ATTR,
+                              AI_ATTR, SI_ATTR, VPVSRATIO_ATTR, N_ATTR};
+
+  static void      computeAttributes(FFTGrid                * alpha,
+                                     FFTGrid                * beta,
+                                     FFTGrid                * rho,
+                                     std::vector<FFTGrid *> & attribute,
+                                     bool                     expAlpha,
+                                     bool                     expBeta,
+                                     bool                     expRho);
 
   static FFTGrid * createFFTGrid(FFTGrid * referenceGrid, bool fileGrid);
 };
@@ -0,0 +1,286 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "lib/lib_matrbatch.h"
+#include "lib/timekit.hpp"
+
+#include "nrlib/iotools/fileio.hpp"
+#include "nrlib/iotools/logkit.hpp"
+
+#include "src/postcovcholesky.h"
+#include "src/fftgrid.h"
+#include "src/seismicparametersholder.h"
+#include "src/io.h"
+#include "src/profiler.h"
+
+PostCovCholesky::PostCovCholesky(SeismicParametersHolder & seismicParameters,
+                                 bool                      fileGrid)
+  : fileGrid_(fileGrid),
+    factors_(NULL),
+    fileName_("")
+{
+  ProfileScope profile("PostCovCholesky::PostCovCholesky");
+  FFTGrid * postCovAlpha = seismicParameters.GetCovAlpha();
+
+  cnxp_    = postCovAlpha->getNxp()/2+1;
+  nRows_   = postCovAlpha->getNyp()*postCovAlpha->getNzp();
+  rowSize_ = static_cast<size_t>(12)*cnxp_;
+
+  // About 72 flops for the Cholesky factorization of a complex 3x3 matrix.
+  Profiler::addFlops(72.0*nRows_*cnxp_);
+
+  double wall=0.0, cpu=0.0;
+  TimeKit::getTime(wall,cpu);
+
+  if(fileGrid_)
+    computeOnFile(seismicParameters);
+  else
+    computeInMemory(seismicParameters);
+
+  TimeKit::getTime(wall,cpu);
+  LogKit::LogFormatted(LogKit::DebugLow,"\nCholesky factors of posterior covariance computed in %.2f seconds.\n",wall);
+}
+
+PostCovCholesky::~PostCovCholesky()
+{
+  delete [] factors_;
+  if(fileName_ != "")
+    remove(fileName_.c_str());
+}
+
+void
+PostCovCholesky::multiplyNoise(FFTGrid * seed0,
+                               FFTGrid * seed1,
+                               FFTGrid * seed2)
+{
+  ProfileScope profile("PostCovCholesky::multiplyNoise");
+  Profiler::addFlops(48.0*nRows_*cnxp_);  // Six complex multiply-adds per cell
+
+  if(fileGrid_)
+    multiplyNoiseOnFile(seed0, seed1, seed2);
+  else
+    multiplyNoiseInMemory(seed0, seed1, seed2);
+}
+
+void
+PostCovCholesky::computeInMemory(SeismicParametersHolder & seismicParameters)
+{
+  //
+  // Grids are in memory, and the rows are factorized in parallel.
+  //
+  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
+  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
+  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
+  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
+  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
+  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
+
+  assert( postCovAlpha->getIsTransformed() );
+  assert( postCovBeta->getIsTransformed() );
+  assert( postCovRho->getIsTransformed() );
+  assert( postCrCovAlphaBeta->getIsTransformed() );
+  assert( postCrCovAlphaRho->getIsTransformed() );
+  assert( postCrCovBetaRho->getIsTransformed() );
+
+  factors_ = new float[nRows_*rowSize_];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    fftw_complex ** ijkPostCov = new fftw_complex*[3];
+    for(int l = 0; l < 3; l++)
+      ijkPostCov[l] = new fftw_complex[3];
+    lib_matrBatchCpx * rowPostCov  = lib_matrBatchAllocCpx(3, 3, cnxp_);
+    int              * rowCholFlag = new int[cnxp_];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int r = 0; r < nRows_; r++) {
+      for(int i = 0; i < cnxp_; i++) {
+        int index = r*cnxp_ + i;
+        ijkPostCov[0][0] = postCovAlpha      ->getComplexValue(index);
+        ijkPostCov[1][1] = postCovBeta       ->getComplexValue(index);
+        ijkPostCov[2][2] = postCovRho        ->getComplexValue(index);
+        ijkPostCov[0][1] = postCrCovAlphaBeta->getComplexValue(index);
+        ijkPostCov[0][2] = postCrCovAlphaRho ->getComplexValue(index);
+        ijkPostCov[1][2] = postCrCovBetaRho  ->getComplexValue(index);
+
+        ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
+        ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
+        ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
+        ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
+        ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
+        ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
+        lib_matrBatchSetCpx(rowPostCov, i, ijkPostCov);
+      }
+      lib_matrBatchCholCpx(rowPostCov, rowCholFlag);
+
+      float * rowRe = factors_ + r*rowSize_;
+      float * rowIm = rowRe + 6*cnxp_;
+      lib_matrBatchPackLowerCpx(rowPostCov, rowCholFlag, rowRe, rowIm);
+    }
+
+    lib_matrBatchFreeCpx(rowPostCov);
+    delete [] rowCholFlag;
+    for(int l = 0; l < 3; l++)
+      delete [] ijkPostCov[l];
+    delete [] ijkPostCov;
+  }
+}
+
+void
+PostCovCholesky::computeOnFile(SeismicParametersHolder & seismicParameters)
+{
+  //
+  // Grids are on file. The covariances are streamed, and the factors
+  // written to a temporary file, a row at a time.
+  //
+  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
+  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
+  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
+  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
+  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
+  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
+
+  assert( postCovAlpha->getIsTransformed() );
+  assert( postCovBeta->getIsTransformed() );
+  assert( postCovRho->getIsTransformed() );
+  assert( postCrCovAlphaBeta->getIsTransformed() );
+  assert( postCrCovAlphaRho->getIsTransformed() );
+  assert( postCrCovBetaRho->getIsTransformed() );
+
+  factors_  = new float[rowSize_];
+  fileName_ = IO::makeFullFileName(IO::PathToTmpFiles(), IO::PrefixTmpGrids() + "PostCovCholesky");
+
+  std::ofstream outFile;
+  NRLib::OpenWrite(outFile, fileName_, std::ios::out | std::ios::binary);
+
+  postCovAlpha      ->setAccessMode(FFTGrid::READ);
+  postCovBeta       ->setAccessMode(FFTGrid::READ);
+  postCovRho        ->setAccessMode(FFTGrid::READ);
+  postCrCovAlphaBeta->setAccessMode(FFTGrid::READ);
+  postCrCovAlphaRho ->setAccessMode(FFTGrid::READ);
+  postCrCovBetaRho  ->setAccessMode(FFTGrid::READ);
+
+  fftw_complex ** ijkPostCov = new fftw_complex*[3];
+  for(int l = 0; l < 3; l++)
+    ijkPostCov[l] = new fftw_complex[3];
+  lib_matrBatchCpx * rowPostCov  = lib_matrBatchAllocCpx(3, 3, cnxp_);
+  int              * rowCholFlag = new int[cnxp_];
+
+  for(int r = 0; r < nRows_; r++) {
+    for(int i = 0; i < cnxp_; i++) {
+      ijkPostCov[0][0] = postCovAlpha      ->getNextComplex();
+      ijkPostCov[1][1] = postCovBeta       ->getNextComplex();
+      ijkPostCov[2][2] = postCovRho        ->getNextComplex();
+      ijkPostCov[0][1] = postCrCovAlphaBeta->getNextComplex();
+      ijkPostCov[0][2] = postCrCovAlphaRho ->getNextComplex();
+      ijkPostCov[1][2] = postCrCovBetaRho  ->getNextComplex();
+
+      ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
+      ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
+      ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
+      ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
+      ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
+      ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
+      lib_matrBatchSetCpx(rowPostCov, i, ijkPostCov);
+    }
+    lib_matrBatchCholCpx(rowPostCov, rowCholFlag);
+    lib_matrBatchPackLowerCpx(rowPostCov, rowCholFlag, factors_, factors_ + 6*cnxp_);
+    outFile.write(reinterpret_cast<char *>(factors_), rowSize_*sizeof(float));
+  }
+
+  postCovAlpha      ->endAccess();
+  postCovBeta       ->endAccess();
+  postCovRho        ->endAccess();
+  postCrCovAlphaBeta->endAccess();
+  postCrCovAlphaRho ->endAccess();
+  postCrCovBetaRho  ->endAccess();
+  outFile.close();
+
+  lib_matrBatchFreeCpx(rowPostCov);
+  delete [] rowCholFlag;
+  for(int l = 0; l < 3; l++)
+    delete [] ijkPostCov[l];
+  delete [] ijkPostCov;
+}
+
+void
+PostCovCholesky::multiplyNoiseInMemory(FFTGrid * seed0,
+                                       FFTGrid * seed1,
+                                       FFTGrid * seed2) const
+{
+  fftw_complex       ijkSeed[3];
+  lib_matrBatchCpx * rowSeed = lib_matrBatchAllocCpx(3, 1, cnxp_);
+
+  for(int r = 0; r < nRows_; r++) {
+    for(int i = 0; i < cnxp_; i++) {
+      int index = r*cnxp_ + i;
+      ijkSeed[0] = seed0->getComplexValue(index);
+      ijkSeed[1] = seed1->getComplexValue(index);
+      ijkSeed[2] = seed2->getComplexValue(index);
+      lib_matrBatchSetVecCpx(rowSeed, i, ijkSeed);
+    }
+
+    const float * rowRe = factors_ + r*rowSize_;
+    const float * rowIm = rowRe + 6*cnxp_;
+    lib_matrBatchProdPackedCholVec(rowRe, rowIm, rowSeed);
+
+    for(int i = 0; i < cnxp_; i++) {
+      int index = r*cnxp_ + i;
+      lib_matrBatchGetVecCpx(rowSeed, i, ijkSeed);
+      seed0->setComplexValue(index, ijkSeed[0]);
+      seed1->setComplexValue(index, ijkSeed[1]);
+      seed2->setComplexValue(index, ijkSeed[2]);
+    }
+  }
+  lib_matrBatchFreeCpx(rowSeed);
+}
+
+void
+PostCovCholesky::multiplyNoiseOnFile(FFTGrid * seed0,
+                                     FFTGrid * seed1,
+                                     FFTGrid * seed2)
+{
+  std::ifstream inFile;
+  NRLib::OpenRead(inFile, fileName_, std::ios::in | std::ios::binary);
+
+  seed0->setAccessMode(FFTGrid::READANDWRITE);
+  seed1->setAccessMode(FFTGrid::READANDWRITE);
+  seed2->setAccessMode(FFTGrid::READANDWRITE);
+
+  fftw_complex       ijkSeed[3];
+  lib_matrBatchCpx * rowSeed = lib_matrBatchAllocCpx(3, 1, cnxp_);
+
+  for(int r = 0; r < nRows_; r++) {
+    inFile.read(reinterpret_cast<char *>(factors_), rowSize_*sizeof(float));
+
+    for(int i = 0; i < cnxp_; i++) {
+      ijkSeed[0] = seed0->getNextComplex();
+      ijkSeed[1] = seed1->getNextComplex();
+      ijkSeed[2] = seed2->getNextComplex();
+      lib_matrBatchSetVecCpx(rowSeed, i, ijkSeed);
+    }
+
+    lib_matrBatchProdPackedCholVec(factors_, factors_ + 6*cnxp_, rowSeed);
+
+    for(int i = 0; i < cnxp_; i++) {
+      lib_matrBatchGetVecCpx(rowSeed, i, ijkSeed);
+      seed0->setNextComplex(ijkSeed[0]);
+      seed1->setNextComplex(ijkSeed[1]);
+      seed2->setNextComplex(ijkSeed[2]);
+    }
+  }
+  lib_matrBatchFreeCpx(rowSeed);
+
+  seed0->endAccess();
+  seed1->endAccess();
+  seed2->endAccess();
+  inFile.close();
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef POSTCOVCHOLESKY_H
+#define POSTCOVCHOLESKY_H
+
+#include <string>
+#include <fstream>
+
+class FFTGrid;
+class SeismicParametersHolder;
+
+// Lower triangular Cholesky factors of the 3x3 posterior covariance of
+// (alpha, beta, rho) for all frequency cells, stored packed with six complex
+// values per cell. The factors are the same for all realisations, so they are
+// computed once after the inversion. They are kept in memory, or in a
+// temporary file when the grids are stored on file.
+//
+// The factors are stored a row (fixed j and k) of cnxp cells at a time. The
+// 6*cnxp real parts come first and then the imaginary parts, in the order
+// given by lib_matrBatchPackLowerCpx. Cells where the factorization fails
+// get a zero factor, i.e. no noise.
+
+class PostCovCholesky
+{
+public:
+  PostCovCholesky(SeismicParametersHolder & seismicParameters,
+                  bool                      fileGrid);
+  ~PostCovCholesky();
+
+  // Replaces the complex noise (seed0, seed1, seed2) by L times the noise in
+  // every frequency cell. Thread safe for different seeds when the factors
+  // are in memory.
+  void          multiplyNoise(FFTGrid * seed0,
+                              FFTGrid * seed1,
+                              FFTGrid * seed2);
+
+  bool          getIsOnFile()     const { return fileGrid_ ;}
+
+private:
+  void          computeInMemory(SeismicParametersHolder & seismicParameters);
+  void          computeOnFile(SeismicParametersHolder & seismicParameters);
+
+  void          multiplyNoiseInMemory(FFTGrid * seed0, FFTGrid * seed1, FFTGrid * seed2) const;
+  void          multiplyNoiseOnFile(FFTGrid * seed0, FFTGrid * seed1, FFTGrid * seed2);
+
+  int           cnxp_;           // Number of cells in a row, nxp/2+1
+  int           nRows_;          // Number of rows, nyp*nzp
+  size_t        rowSize_;        // Number of floats in a row, 12*cnxp
+  bool          fileGrid_;       // True if the factors are stored on file
+  float       * factors_;        // All rows when in memory, one row when on file
+  std::string   fileName_;       // Temporary file, if the factors are stored on file
+};
+
+#endif
@@ -0,0 +1,325 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <time.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "nrlib/iotools/fileio.hpp"
+#include "nrlib/iotools/logkit.hpp"
+
+#include "src/definitions.h"
+#include "src/profiler.h"
+
+struct ProfileNode
+{
+  std::string                 name;
+  ProfileNode               * parent;
+  std::vector<ProfileNode *>  children;
+  int                         calls;
+  double                      wall;
+  double                      bytes;
+  double                      flops;
+  double                      peakMemory;
+};
+
+//
+// The sections opened by a thread. Sections nested deeper than
+// maxProfileDepth are not recorded.
+//
+static const int      maxProfileDepth = 64;
+static ProfileNode  * openNodes[maxProfileDepth];
+static double         openTimes[maxProfileDepth];
+static int            openDepth = 0;
+#ifdef _OPENMP
+#pragma omp threadprivate(openNodes, openTimes, openDepth)
+#endif
+
+void
+Profiler::setEnabled(bool enabled)
+{
+  enabled_ = enabled;
+  if(enabled_ == true && root_ == NULL) {
+    root_             = new ProfileNode;
+    root_->name       = "Total";
+    root_->parent     = NULL;
+    root_->calls      = 1;
+    root_->wall       = 0.0;
+    root_->bytes      = 0.0;
+    root_->flops      = 0.0;
+    root_->peakMemory = 0.0;
+    startTime_        = getWallTime();
+  }
+}
+
+void
+Profiler::enter(const char * name)
+{
+  if(root_ == NULL)
+    return;
+
+  if(openDepth < maxProfileDepth) {
+    ProfileNode * parent = (openDepth > 0 ? openNodes[openDepth-1] : root_);
+    ProfileNode * node;
+#ifdef _OPENMP
+#pragma omp critical(profiler)
+#endif
+    {
+      node = findChild(parent, name);
+    }
+    openNodes[openDepth] = node;
+    openTimes[openDepth] = getWallTime();
+  }
+  openDepth++;
+}
+
+void
+Profiler::leave(void)
+{
+  if(root_ == NULL || openDepth == 0)
+    return;
+
+  openDepth--;
+  if(openDepth < maxProfileDepth) {
+    ProfileEvent event;
+    event.node     = openNodes[openDepth];
+    event.start    = openTimes[openDepth] - startTime_;
+    event.duration = getWallTime() - openTimes[openDepth];
+#ifdef _OPENMP
+    event.thread   = omp_get_thread_num();
+#else
+    event.thread   = 0;
+#endif
+#ifdef _OPENMP
+#pragma omp critical(profiler)
+#endif
+    {
+      openNodes[openDepth]->calls++;
+      openNodes[openDepth]->wall += event.duration;
+      if(events_.size() < maxEvents_)
+        events_.push_back(event);
+      else
+        droppedEvents_++;
+    }
+  }
+}
+
+void
+Profiler::addBytes(double bytes)
+{
+  if(root_ == NULL)
+    return;
+
+  int           depth = std::min(openDepth, maxProfileDepth);
+  ProfileNode * node  = (depth > 0 ? openNodes[depth-1] : root_);
+#ifdef _OPENMP
+#pragma omp critical(profiler)
+#endif
+  {
+    node->bytes += bytes;
+  }
+}
+
+void
+Profiler::addFlops(double flops)
+{
+  if(root_ == NULL)
+    return;
+
+  int           depth = std::min(openDepth, maxProfileDepth);
+  ProfileNode * node  = (depth > 0 ? openNodes[depth-1] : root_);
+#ifdef _OPENMP
+#pragma omp critical(profiler)
+#endif
+  {
+    node->flops += flops;
+  }
+}
+
+void
+Profiler::setMemoryInUse(double bytes)
+{
+  if(root_ == NULL)
+    return;
+
+  int depth = std::min(openDepth, maxProfileDepth);
+#ifdef _OPENMP
+#pragma omp critical(profiler)
+#endif
+  {
+    root_->peakMemory = std::max(root_->peakMemory, bytes);
+    for(int i=0;i<depth;i++)
+      openNodes[i]->peakMemory = std::max(openNodes[i]->peakMemory, bytes);
+  }
+}
+
+ProfileNode *
+Profiler::findChild(ProfileNode * parent, const char * name)
+{
+  for(size_t i=0;i<parent->children.size();i++) {
+    if(parent->children[i]->name == name)
+      return(parent->children[i]);
+  }
+  ProfileNode * node = new ProfileNode;
+  node->name       = name;
+  node->parent     = parent;
+  node->calls      = 0;
+  node->wall       = 0.0;
+  node->bytes      = 0.0;
+  node->flops      = 0.0;
+  node->peakMemory = 0.0;
+  parent->children.push_back(node);
+  return(node);
+}
+
+void
+Profiler::report(LogKit::MessageLevels logLevel)
+{
+  if(root_ == NULL)
+    return;
+
+  root_->wall = getWallTime() - startTime_;
+
+  LogKit::WriteHeader("Profile", logLevel);
+  LogKit::LogFormatted(logLevel,"\nSection                                      Calls   Wall time   Share   MB moved   GFlop/s   Peak MB");
+  LogKit::LogFormatted(logLevel,"\n--------------------------------------------------------------------------------------------------------\n");
+  reportNode(root_, 0, root_->wall, logLevel);
+
+  if(droppedEvents_ > 0)
+    LogKit::LogFormatted(LogKit::DebugLow,"\nThe profile trace is full. The last %d calls are only included in the summary.\n",
+                         static_cast<int>(droppedEvents_));
+}
+
+void
+Profiler::reportNode(const ProfileNode     * node,
+                     int                     depth,
+                     double                  wallTot,
+                     LogKit::MessageLevels   logLevel)
+{
+  std::string text = std::string(2*depth,' ') + node->name;
+  if(text.size() > 42)
+    text = text.substr(0,42);
+
+  double percent = (wallTot > 0.0 ? 100.0*node->wall/wallTot : 0.0);
+  double mb      = node->bytes/(1024.0*1024.0);
+  double gflops  = (node->wall > 0.0 ? node->flops/node->wall*1.0e-9 : 0.0);
+  double peakMb  = node->peakMemory/(1024.0*1024.0);
+
+  LogKit::LogFormatted(logLevel,"%-42s %8d  %10.2f  %6.2f  %9.1f  %8.2f  %8.1f\n",
+                       text.c_str(), node->calls, node->wall, percent, mb, gflops, peakMb);
+
+  for(size_t i=0;i<node->children.size();i++)
+    reportNode(node->children[i], depth+1, wallTot, logLevel);
+}
+
+void
+Profiler::writeReport(const std::string & baseName)
+{
+  if(root_ == NULL)
+    return;
+
+  root_->wall = getWallTime() - startTime_;
+
+  std::string fileName = baseName + ".json";
+  std::ofstream file;
+  NRLib::OpenWrite(file, fileName);
+  file << "{\n";
+  file << "  \"sections\" :\n";
+  writeNode(file, root_, 2);
+  file << "\n}\n";
+  file.close();
+
+  writeTrace(baseName + "_trace.json");
+
+  LogKit::LogFormatted(LogKit::Low,"\nProfile written to %s.json and %s_trace.json\n",baseName.c_str(),baseName.c_str());
+}
+
+void
+Profiler::writeNode(std::ofstream     & file,
+                    const ProfileNode * node,
+                    int                 depth)
+{
+  std::string indent(2*depth,' ');
+  file << indent << "{\n";
+  file << indent << "  \"name\"        : \"" << node->name << "\",\n";
+  file << indent << "  \"calls\"       : " << node->calls      << ",\n";
+  file << indent << "  \"wall\"        : " << node->wall       << ",\n";
+  file << indent << "  \"bytes\"       : " << node->bytes      << ",\n";
+  file << indent << "  \"flops\"       : " << node->flops      << ",\n";
+  file << indent << "  \"peak_memory\" : " << node->peakMemory << ",\n";
+  file << indent << "  \"children\"    : [";
+  for(size_t i=0;i<node->children.size();i++) {
+    file << (i == 0 ? "\n" : ",\n");
+    writeNode(file, node->children[i], depth+2);
+  }
+  if(node->children.size() > 0)
+    file << "\n" << indent << "  ";
+  file << "]\n";
+  file << indent << "}";
+}
+
+void
+Profiler::writeTrace(const std::string & fileName)
+{
+  //
+  // Chrome trace event format, with complete ("X") events in microseconds.
+  //
+  std::ofstream file;
+  NRLib::OpenWrite(file, fileName);
+  file << "{\n";
+  file << "  \"displayTimeUnit\" : \"ms\",\n";
+  file << "  \"traceEvents\" : [";
+  file.setf(std::ios::fixed);
+  file.precision(1);
+  for(size_t i=0;i<events_.size();i++) {
+    const ProfileEvent & event = events_[i];
+    file << (i == 0 ? "\n" : ",\n");
+    file << "    {\"name\": \"" << event.node->name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << event.thread
+         << ", \"ts\": " << 1.0e6*event.start << ", \"dur\": " << 1.0e6*event.duration << "}";
+  }
+  file << "\n  ]\n";
+  file << "}\n";
+  file.close();
+}
+
+void
+Profiler::clear(void)
+{
+  if(root_ != NULL)
+    deleteNode(root_);
+  root_ = NULL;
+  events_.clear();
+  droppedEvents_ = 0;
+  enabled_       = false;
+}
+
+void
+Profiler::deleteNode(ProfileNode * node)
+{
+  for(size_t i=0;i<node->children.size();i++)
+    deleteNode(node->children[i]);
+  delete node;
+}
+
+double
+Profiler::getWallTime(void)
+{
+  // Without OpenMP we only have the resolution of clock(), which counts CPU time.
+#ifdef _OPENMP
+  return(omp_get_wtime());
+#else
+  return(static_cast<double>(clock())/CLOCKS_PER_SEC);
+#endif
+}
+
+bool                      Profiler::enabled_       = false;
+ProfileNode             * Profiler::root_          = NULL;
+double                    Profiler::startTime_     = 0.0;
+std::vector<ProfileEvent> Profiler::events_;
+size_t                    Profiler::droppedEvents_ = 0;
+const size_t              Profiler::maxEvents_     = 1000000;
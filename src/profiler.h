@@ -0,0 +1,84 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/definitions.h"
+#include "nrlib/iotools/logkit.hpp"
+
+struct ProfileNode;
+
+struct ProfileEvent                                      // One call of a section, for the Chrome trace
+{
+  const ProfileNode * node;
+  double              start;
+  double              duration;
+  int                 thread;
+};
+
+// Hierarchical profiler. Sections are opened and closed with ProfileScope,
+// and nested sections are collected in a tree keyed by section name. For each
+// section we record the number of calls, the wall time, the bytes moved and
+// an estimate of the number of floating point operations, together with the
+// peak FFT-grid memory use seen while the section was open.
+//
+// The profiler is off unless enabled, in which case a ProfileScope only
+// costs a test of a flag. Sections opened by the threads of a parallel
+// region are recorded under the section the thread itself has open, or at
+// the top level if it has none. Their wall time is summed over the threads.
+//
+// The tree is written to the log by report() and to file as JSON by
+// writeReport(), which also writes the sections as a Chrome trace that can
+// be viewed in chrome://tracing.
+
+class Profiler
+{
+public:
+  static void    setEnabled(bool enabled);
+  static bool    isEnabled(void)           { return enabled_ ;}
+
+  static void    enter(const char * name);
+  static void    leave(void);
+
+  static void    addBytes(double bytes);                 // Bytes read or written in the current section
+  static void    addFlops(double flops);                 // Floating point operations in the current section
+  static void    setMemoryInUse(double bytes);           // Updates peak memory of all open sections
+
+  static void    report(LogKit::MessageLevels logLevel);
+  static void    writeReport(const std::string & baseName);
+  static void    clear(void);
+
+private:
+  static ProfileNode * findChild(ProfileNode * parent, const char * name);
+  static void          reportNode(const ProfileNode * node, int depth, double wallTot, LogKit::MessageLevels logLevel);
+  static void          writeNode(std::ofstream & file, const ProfileNode * node, int depth);
+  static void          writeTrace(const std::string & fileName);
+  static void          deleteNode(ProfileNode * node);
+  static double        getWallTime(void);
+
+  static bool                      enabled_;
+  static ProfileNode             * root_;
+  static double                    startTime_;           // Origin of the trace
+  static std::vector<ProfileEvent> events_;
+  static size_t                    droppedEvents_;       // Calls not stored as the trace was full
+  static const size_t              maxEvents_;
+};
+
+// Opens a profiler section that is closed when the object goes out of scope.
+class ProfileScope
+{
+public:
+  ProfileScope(const char * name) : active_(Profiler::isEnabled()) { if(active_) Profiler::enter(name) ;}
+  ~ProfileScope()                                                  { if(active_) Profiler::leave()     ;}
+
+private:
+  bool active_;
+};
+
+#endif
@@ -20,6 +20,7 @@ SeismicParametersHolder::SeismicParametersHolder(void)
   crCovAlphaBeta_ = NULL;
   crCovAlphaRho_  = NULL;
   crCovBetaRho_   = NULL;
+  priorCorr_      = NULL;
 
   priorVar0_.resize(3,3);
 }
@@ -45,6 +46,9 @@ SeismicParametersHolder::~SeismicParametersHolder(void)
   if(crCovBetaRho_!=NULL)
     delete crCovBetaRho_;
 
+  if(priorCorr_!=NULL && priorCorr_!=covAlpha_)
+    delete priorCorr_;
+
   if(muAlpha_!=NULL)
     delete muAlpha_;
 
@@ -138,7 +142,10 @@ SeismicParametersHolder::setCorrelationParameters(float                    ** pr
   //tmp=priorVar0_;
   //NRLib::ComputeEigenVectors(tmp,eVals,eVec);
 
-  createCorrGrids(nx, ny, nz, nxPad, nyPad, nzPad, false);
+  // The prior covariance is separable, so only the common correlation is stored.
+  priorCorr_ = createFFTGrid(nx, ny, nz, nxPad, nyPad, nzPad, false);
+  priorCorr_->setType(FFTGrid::COVARIANCE);
+  priorCorr_->createRealGrid();
 
   initializeCorrelations(priorCorrXY,
                          priorCorrT,
@@ -203,23 +210,102 @@ SeismicParametersHolder::initializeCorrelations(const Surface            * prior
 {
   fftw_real * circCorrT = computeCircCorrT(priorCorrT, lowIntCut, nzp);
 
-  covAlpha_      ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
-  covBeta_       ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
-  covRho_        ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
-  crCovAlphaBeta_->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
-  crCovAlphaRho_ ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
-  crCovBetaRho_  ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
-
-  covAlpha_      ->multiplyByScalar(static_cast<float>(priorVar0_(0,0)));
-  covBeta_       ->multiplyByScalar(static_cast<float>(priorVar0_(1,1)));
-  covRho_        ->multiplyByScalar(static_cast<float>(priorVar0_(2,2)));
-  crCovAlphaBeta_->multiplyByScalar(static_cast<float>(priorVar0_(0,1)));
-  crCovAlphaRho_ ->multiplyByScalar(static_cast<float>(priorVar0_(0,2)));
-  crCovBetaRho_  ->multiplyByScalar(static_cast<float>(priorVar0_(1,2)));
+  priorCorr_->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
 
   fftw_free(circCorrT);
 }
 
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::expandPriorCorr()
+{
+  // Creates the six prior covariance grids from the correlation. Used when
+  // the covariances are needed as separate grids before the inversion.
+  if(priorCorr_ == NULL || covAlpha_ != NULL)
+    return;
+
+  covBeta_        = new FFTGrid(priorCorr_);
+  covRho_         = new FFTGrid(priorCorr_);
+  crCovAlphaBeta_ = new FFTGrid(priorCorr_);
+  crCovAlphaRho_  = new FFTGrid(priorCorr_);
+  crCovBetaRho_   = new FFTGrid(priorCorr_);
+  covAlpha_       = priorCorr_;
+  priorCorr_      = NULL;
+
+  scaleCovGrid(covAlpha_,       static_cast<float>(priorVar0_(0,0)));
+  scaleCovGrid(covBeta_,        static_cast<float>(priorVar0_(1,1)));
+  scaleCovGrid(covRho_,         static_cast<float>(priorVar0_(2,2)));
+  scaleCovGrid(crCovAlphaBeta_, static_cast<float>(priorVar0_(0,1)));
+  scaleCovGrid(crCovAlphaRho_,  static_cast<float>(priorVar0_(0,2)));
+  scaleCovGrid(crCovBetaRho_,   static_cast<float>(priorVar0_(1,2)));
+}
+
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::scaleCovGrid(FFTGrid * grid,
+                                      float     scale) const
+{
+  if(grid->getIsTransformed() == false)
+    grid->multiplyByScalar(scale);
+  else {
+    for(int i = 0 ; i < grid->getcsize() ; i++) {
+      fftw_complex value = grid->getComplexValue(i);
+      value.re *= scale;
+      value.im *= scale;
+      grid->setComplexValue(i, value);
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::createPostCovGrids()
+{
+  // With a separable prior, the posterior covariance for Vp is written over
+  // the correlation grid, each cell after its prior has been read, and the
+  // five other posterior covariances are allocated here. Must be followed by
+  // releasePriorCorr() when the inversion is done.
+  if(priorCorr_ == NULL || covAlpha_ != NULL)
+    return;
+
+  assert(priorCorr_->getIsTransformed() == true);
+
+  int nx  = priorCorr_->getNx();
+  int ny  = priorCorr_->getNy();
+  int nz  = priorCorr_->getNz();
+  int nxp = priorCorr_->getNxp();
+  int nyp = priorCorr_->getNyp();
+  int nzp = priorCorr_->getNzp();
+
+  covAlpha_       = priorCorr_;
+  covBeta_        = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,false);
+  covRho_         = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,false);
+  crCovAlphaBeta_ = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,false);
+  crCovAlphaRho_  = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,false);
+  crCovBetaRho_   = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,false);
+
+  covBeta_        ->setType(FFTGrid::COVARIANCE);
+  covRho_         ->setType(FFTGrid::COVARIANCE);
+  crCovAlphaBeta_ ->setType(FFTGrid::COVARIANCE);
+  crCovAlphaRho_  ->setType(FFTGrid::COVARIANCE);
+  crCovBetaRho_   ->setType(FFTGrid::COVARIANCE);
+
+  covBeta_        ->createComplexGrid();
+  covRho_         ->createComplexGrid();
+  crCovAlphaBeta_ ->createComplexGrid();
+  crCovAlphaRho_  ->createComplexGrid();
+  crCovBetaRho_   ->createComplexGrid();
+}
+
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::releasePriorCorr()
+{
+  if(priorCorr_ != NULL && priorCorr_ != covAlpha_)
+    delete priorCorr_;
+  priorCorr_ = NULL;
+}
+
 //--------------------------------------------------------------------
 NRLib::Matrix
 SeismicParametersHolder::getPriorVar0(void) const
@@ -304,23 +390,12 @@ SeismicParametersHolder::invFFTCovGrids()
 {
   LogKit::LogFormatted(LogKit::High,"\nBacktransforming correlation grids from FFT domain to time domain...");
 
-  if (covAlpha_->getIsTransformed())
-    covAlpha_->invFFTInPlace();
-
-  if (covBeta_->getIsTransformed())
-    covBeta_->invFFTInPlace();
-
-  if (covRho_->getIsTransformed())
-    covRho_->invFFTInPlace();
-
-  if (crCovAlphaBeta_->getIsTransformed())
-    crCovAlphaBeta_->invFFTInPlace();
+  FFTGrid * grids[7] = {priorCorr_, covAlpha_, covBeta_, covRho_, crCovAlphaBeta_, crCovAlphaRho_, crCovBetaRho_};
 
-  if (crCovAlphaRho_->getIsTransformed())
-    crCovAlphaRho_->invFFTInPlace();
-
-  if (crCovBetaRho_->getIsTransformed())
-    crCovBetaRho_->invFFTInPlace();
+  for(int i = 0 ; i < 7 ; i++) {
+    if (grids[i] != NULL && grids[i]->getIsTransformed())
+      grids[i]->invFFTInPlace();
+  }
 
   LogKit::LogFormatted(LogKit::High,"...done\n");
 }
@@ -330,23 +405,12 @@ SeismicParametersHolder::FFTCovGrids()
 {
   LogKit::LogFormatted(LogKit::High,"Transforming correlation grids from time domain to FFT domain...");
 
-  if (!covAlpha_->getIsTransformed())
-    covAlpha_->fftInPlace();
-
-  if (!covBeta_->getIsTransformed())
-    covBeta_->fftInPlace();
-
-  if (!covRho_->getIsTransformed())
-    covRho_->fftInPlace();
-
-  if (!crCovAlphaBeta_->getIsTransformed())
-    crCovAlphaBeta_->fftInPlace();
+  FFTGrid * grids[7] = {priorCorr_, covAlpha_, covBeta_, covRho_, crCovAlphaBeta_, crCovAlphaRho_, crCovBetaRho_};
 
-  if (!crCovAlphaRho_->getIsTransformed())
-    crCovAlphaRho_->fftInPlace();
-
-  if (!crCovBetaRho_->getIsTransformed())
-    crCovBetaRho_->fftInPlace();
+  for(int i = 0 ; i < 7 ; i++) {
+    if (grids[i] != NULL && !grids[i]->getIsTransformed())
+      grids[i]->fftInPlace();
+  }
 
   LogKit::LogFormatted(LogKit::High,"...done\n");
 }
@@ -355,13 +419,10 @@ SeismicParametersHolder::FFTCovGrids()
 void
 SeismicParametersHolder::getNextParameterCovariance(fftw_complex **& parVar) const
 {
-
-  fftw_complex ii;
-  fftw_complex jj;
-  fftw_complex kk;
-  fftw_complex ij;
-  fftw_complex ik;
-  fftw_complex jk;
+  if(priorCorr_ != NULL) {
+    computeSeparableCovariance(priorCorr_->getNextComplex(), parVar);
+    return;
+  }
 
   fftw_complex iiTmp = covAlpha_      ->getNextComplex();
   fftw_complex jjTmp = covBeta_       ->getNextComplex();
@@ -370,6 +431,47 @@ SeismicParametersHolder::getNextParameterCovariance(fftw_complex **& parVar) con
   fftw_complex ikTmp = crCovAlphaRho_ ->getNextComplex();
   fftw_complex jkTmp = crCovBetaRho_  ->getNextComplex();
 
+  computeParameterCovariance(iiTmp, jjTmp, kkTmp, ijTmp, ikTmp, jkTmp, parVar);
+}
+
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::getParameterCovariance(int index, fftw_complex ** parVar) const
+{
+  // Random access version of getNextParameterCovariance(). Does not touch the
+  // grid iterators, so several threads may read different cells concurrently.
+  if(priorCorr_ != NULL) {
+    computeSeparableCovariance(priorCorr_->getComplexValue(index), parVar);
+    return;
+  }
+
+  fftw_complex iiTmp = covAlpha_      ->getComplexValue(index);
+  fftw_complex jjTmp = covBeta_       ->getComplexValue(index);
+  fftw_complex kkTmp = covRho_        ->getComplexValue(index);
+  fftw_complex ijTmp = crCovAlphaBeta_->getComplexValue(index);
+  fftw_complex ikTmp = crCovAlphaRho_ ->getComplexValue(index);
+  fftw_complex jkTmp = crCovBetaRho_  ->getComplexValue(index);
+
+  computeParameterCovariance(iiTmp, jjTmp, kkTmp, ijTmp, ikTmp, jkTmp, parVar);
+}
+
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::computeParameterCovariance(fftw_complex     iiTmp,
+                                                    fftw_complex     jjTmp,
+                                                    fftw_complex     kkTmp,
+                                                    fftw_complex     ijTmp,
+                                                    fftw_complex     ikTmp,
+                                                    fftw_complex     jkTmp,
+                                                    fftw_complex  ** parVar) const
+{
+  fftw_complex ii;
+  fftw_complex jj;
+  fftw_complex kk;
+  fftw_complex ij;
+  fftw_complex ik;
+  fftw_complex jk;
+
   if(priorVar0_(0,0) != 0)
     iiTmp.re = iiTmp.re / static_cast<float>(priorVar0_(0,0));
 
@@ -426,6 +528,23 @@ SeismicParametersHolder::getNextParameterCovariance(fftw_complex **& parVar) con
   parVar[2][1].im = -jk.im;
 }
 
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::computeSeparableCovariance(fftw_complex     corr,
+                                                    fftw_complex  ** parVar) const
+{
+  // Same as computeParameterCovariance() when all six grids are priorVar0_
+  // times the correlation.
+  float corrAbs = std::abs(corr.re);
+
+  for(int i = 0 ; i < 3 ; i++) {
+    for(int j = 0 ; j < 3 ; j++) {
+      parVar[i][j].re = corrAbs * static_cast<float>(i <= j ? priorVar0_(i,j) : priorVar0_(j,i));
+      parVar[i][j].im = 0.0;
+    }
+  }
+}
+
 //--------------------------------------------------------------------
 fftw_real *
 SeismicParametersHolder::computeCircCorrT(const std::vector<float> & priorCorrT,
@@ -747,22 +866,24 @@ SeismicParametersHolder::writeFilePostCovGrids(Simbox const * simbox) const
 fftw_real *
 SeismicParametersHolder::extractParamCorrFromCovAlpha(int nzp) const
 {
-  assert(covAlpha_->getIsTransformed() == false);
+  FFTGrid * corr = (priorCorr_ != NULL ? priorCorr_ : covAlpha_);
 
-  covAlpha_->setAccessMode(FFTGrid::RANDOMACCESS);
+  assert(corr->getIsTransformed() == false);
+
+  corr->setAccessMode(FFTGrid::RANDOMACCESS);
 
   fftw_real * circCorrT = reinterpret_cast<fftw_real*>(fftw_malloc(2*(nzp/2+1)*sizeof(fftw_real)));
   //int         refk;
-  float       constant = covAlpha_->getRealValue(0,0,0);
+  float       constant = corr->getRealValue(0,0,0);
 
   for(int k = 0 ; k < 2*(nzp/2+1) ; k++ ){
     if(k < nzp)
-      circCorrT[k] = covAlpha_->getRealValue(0,0,k,true)/constant;
+      circCorrT[k] = corr->getRealValue(0,0,k,true)/constant;
     else
       circCorrT[k] = RMISSING;
   }
 
-  covAlpha_->endAccess();
+  corr->endAccess();
 
   return circCorrT;//fftw_free(circCorrT);
 }
@@ -770,6 +891,9 @@ SeismicParametersHolder::extractParamCorrFromCovAlpha(int nzp) const
 void
 SeismicParametersHolder::updatePriorVar()
 {
+  if(covAlpha_ == NULL) // Only the prior correlation, so priorVar0_ is unchanged
+    return;
+
   priorVar0_(0,0) = getOrigin(covAlpha_);
   priorVar0_(1,1) = getOrigin(covBeta_);
   priorVar0_(2,2) = getOrigin(covRho_);
@@ -26,18 +26,21 @@ public:
   FFTGrid                     * GetMuAlpha()                            { return muAlpha_        ;}
   FFTGrid                     * GetMuBeta()                             { return muBeta_         ;}
   FFTGrid                     * GetMuRho()                              { return muRho_          ;}
-  FFTGrid                     * GetCovAlpha()                           { return covAlpha_       ;}
-  FFTGrid                     * GetCovBeta()                            { return covBeta_        ;}
-  FFTGrid                     * GetCovRho()                             { return covRho_         ;}
-  FFTGrid                     * GetCrCovAlphaBeta()                     { return crCovAlphaBeta_ ;}
-  FFTGrid                     * GetCrCovAlphaRho()                      { return crCovAlphaRho_  ;}
-  FFTGrid                     * GetCrCovBetaRho()                       { return crCovBetaRho_   ;}
+  FFTGrid                     * GetCovAlpha()                           { expandPriorCorr(); return covAlpha_       ;}
+  FFTGrid                     * GetCovBeta()                            { expandPriorCorr(); return covBeta_        ;}
+  FFTGrid                     * GetCovRho()                             { expandPriorCorr(); return covRho_         ;}
+  FFTGrid                     * GetCrCovAlphaBeta()                     { expandPriorCorr(); return crCovAlphaBeta_ ;}
+  FFTGrid                     * GetCrCovAlphaRho()                      { expandPriorCorr(); return crCovAlphaRho_  ;}
+  FFTGrid                     * GetCrCovBetaRho()                       { expandPriorCorr(); return crCovBetaRho_   ;}
+  FFTGrid                     * GetPriorCorr()                          { return (priorCorr_ != NULL ? priorCorr_ : covAlpha_) ;}
 
   void                          invFFTAllGrids();
   void                          invFFTCovGrids();
   void                          FFTCovGrids();
   void                          FFTAllGrids();
   void                          updatePriorVar();
+  void                          createPostCovGrids();
+  void                          releasePriorCorr();
 
   void                          setBackgroundParameters(FFTGrid  * muAlpha,
                                                         FFTGrid  * muBeta,
@@ -84,6 +87,9 @@ public:
 
   void                          getNextParameterCovariance(fftw_complex **& parVar) const;
 
+  void                          getParameterCovariance(int             index,
+                                                       fftw_complex ** parVar) const;
+
   void                          writeFilePriorCorrT(fftw_real   * priorCorrT,
                                                     const int   & nzp,
                                                     const float & dt) const;
@@ -105,6 +111,10 @@ public:
 private:
   void                          createCorrGrids(int nx, int ny, int nz, int nxp, int nyp, int nzp, bool fileGrid);
 
+  void                          expandPriorCorr();
+
+  void                          scaleCovGrid(FFTGrid * grid, float scale) const;
+
   void                          initializeCorrelations(const Surface            * priorCorrXY,
                                                        const std::vector<float> & priorCorrT,
                                                        const float              & corrGradI,
@@ -117,6 +127,17 @@ private:
                                               bool fileGrid);
 
 
+  void                          computeParameterCovariance(fftw_complex     iiTmp,
+                                                           fftw_complex     jjTmp,
+                                                           fftw_complex     kkTmp,
+                                                           fftw_complex     ijTmp,
+                                                           fftw_complex     ikTmp,
+                                                           fftw_complex     jkTmp,
+                                                           fftw_complex  ** parVar) const;
+
+  void                          computeSeparableCovariance(fftw_complex     corr,
+                                                           fftw_complex  ** parVar) const;
+
   void                          makeCircCorrTPosDef(fftw_real * circCorrT,
                                                     const int & minIntFq,
                                                     const int & nzp) const;
@@ -139,6 +160,12 @@ private:
   FFTGrid * crCovAlphaRho_ ;
   FFTGrid * crCovBetaRho_  ;
 
+  // With a separable prior, the six prior covariances are priorVar0_ times a common
+  // correlation, and only this correlation grid is kept. The covariance grids above
+  // are then NULL until the posterior is computed or one of them is asked for.
+  // During the inversion priorCorr_ and covAlpha_ share the same grid.
+  FFTGrid * priorCorr_;
+
   NRLib::Matrix priorVar0_;
 
 };
@@ -9,12 +9,15 @@
 #include <assert.h>
 #include <stdio.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "lib/timekit.hpp"
 
 #include "nrlib/iotools/logkit.hpp"
 #include "nrlib/flens/nrlib_flens.hpp"
-
-#include "lib/lib_matr.h"
+#include "nrlib/exception/exception.hpp"
 
 #include "src/spatialwellfilter.h"
 #include "src/definitions.h"
@@ -136,11 +139,6 @@ void SpatialWellFilter::doFilteringSyntWells(std::vector<SyntWellData *>
   double wall=0.0, cpu=0.0;
   TimeKit::getTime(wall,cpu);
 
-  double ** sigmapost;
-  double ** sigmapri;
-  double ** imat;
-  double ** Aw;
-
   int lastn = 0;
 
   // nDim is always 1 for synthetic wells
@@ -162,125 +160,78 @@ void SpatialWellFilter::doFilteringSyntWells(std::vector<SyntWellData *>
 
   NRLib::Matrix priorCov0 = priorVar0;
 
-  bool no_wells_filtered = true;
-
-  for(int w1=0;w1<nWells;w1++){
-    //LogKit::LogFormatted(LogKit::Low,"\nFiltering synthetic well number " + NRLib::ToString(w1+1,1) + "...");
-    no_wells_filtered = false;
-
-    int n = syntWellData[w1]->getWellLength();
-
-    sigmapost = new double * [3*n];
-    for(int i=0;i<3*n;i++) {
-      sigmapost[i] = new double[3*n];
-      for(int j=0; j<3*n; j++)
-        sigmapost[i][j] = RMISSING;
-    }
-    sigmapri = new double * [3*n];
-    for(int i=0;i<3*n;i++)
-      sigmapri[i] = new double[3*n];
-    imat = new double * [3*n];
-    for(int i=0;i<3*n;i++)
-      imat[i] = new double[3*n];
-    Aw = new double * [3*n];
-    for(int i=0;i<3*n;i++)
-      Aw[i] = new double[3*n];
-
-    for(int i=0;i<3*n;i++)
-      for(int j=0;j<3*n;j++)
-        if(i==j)
-          imat[i][j] = 1.0;
-        else
-          imat[i][j] = 0.0;
-    int i1,j1,k1,l1, i2,j2,k2,l2;
-    const int *ipos = syntWellData[w1]->getIpos();
-    const int *jpos = syntWellData[w1]->getJpos();
-    const int *kpos = syntWellData[w1]->getKpos();
-    float regularization = Definitions::SpatialFilterRegularisationValue();
-
-    fillValuesInSigmapostSyntWell(sigmapost, ipos, jpos, kpos, seismicParameters.GetCovAlpha(),       n, 0,   0);
-    fillValuesInSigmapostSyntWell(sigmapost, ipos, jpos, kpos, seismicParameters.GetCovBeta(),        n, n,   n);
-    fillValuesInSigmapostSyntWell(sigmapost, ipos, jpos, kpos, seismicParameters.GetCovRho(),         n, 2*n, 2*n);
-    fillValuesInSigmapostSyntWell(sigmapost, ipos, jpos, kpos, seismicParameters.GetCrCovAlphaBeta(), n, 0,   n);
-    fillValuesInSigmapostSyntWell(sigmapost, ipos, jpos, kpos, seismicParameters.GetCrCovAlphaRho(),  n, 0,   2*n);
-    fillValuesInSigmapostSyntWell(sigmapost, ipos, jpos, kpos, seismicParameters.GetCrCovBetaRho(),   n, 2*n, n);
-
-    // In case the synthetic well is longer than the vertical size of covgrid,
-    // set correlation for the relevant grid points to 0
-    for(l1=0;l1<3*n;l1++){
-      for(l2=0;l2<3*n;l2++){
-        if(sigmapost[l1][l2] == RMISSING)
-          sigmapost[l1][l2] = 0.0;
-      }
-    }
+  bool no_wells_filtered = (nWells == 0);
 
-    for(l1=0;l1<n;l1++){
-      i1 = ipos[l1];
-      j1 = jpos[l1];
-      k1 = kpos[l1];
-      for(l2=0;l2<n;l2++){
-        i2 = ipos[l2];
-        j2 = jpos[l2];
-        k2 = kpos[l2];
-
-        sigmapost[l2 + n  ][l1      ] = sigmapost[l1][n+l2];
-        sigmapost[l2 + 2*n][l1      ] = sigmapost[l1][2*n+l2];
-        sigmapost[l2 + n  ][l1 + 2*n] = sigmapost[2*n+l1][n+l2];
-        sigmapri [l1      ][l2      ] = priorCov0(0,0)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri [l1 + n  ][l2 + n  ] = priorCov0(1,1)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri [l1 + 2*n][l2 + 2*n] = priorCov0(2,2)*priorSpatialCorr_[w1][l1][l2];
-        if(l1==l2){
-          sigmapost[l1      ][l2      ] += regularization*sigmapost[l1][l2]/sigmapri[l1][l2];
-          sigmapost[l1 + n  ][l2 + n  ] += regularization*sigmapost[n+l1][n+l2]/sigmapri[n+l1][n+l2];
-          sigmapost[l1 + 2*n][l2 + 2*n] += regularization*sigmapost[2*n+l1][2*n+l2]/sigmapri[2*n+l1][2*n+l2];
-          sigmapri [l1      ][l2      ] += regularization;
-          sigmapri [l1 + n  ][l2 + n  ] += regularization;
-          sigmapri [l1 + 2*n][l2 + 2*n] += regularization;
-        }
-        sigmapri[l1 + n  ][l2      ] = priorCov0(1,0)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri[l2      ][l1 + n  ] = priorCov0(1,0)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri[l1 + 2*n][l2      ] = priorCov0(2,0)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri[l2      ][l1 + 2*n] = priorCov0(2,0)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri[l1 + n  ][l2 + 2*n] = priorCov0(2,1)*priorSpatialCorr_[w1][l1][l2];
-        sigmapri[l2 + 2*n][l1 + n  ] = priorCov0(2,1)*priorSpatialCorr_[w1][l1][l2];
-      }
+  //
+  // The wells are independent, and are filtered in parallel unless the
+  // covariance grids are on file. The contributions to the error covariance
+  // are added in well order afterwards, so the sum does not depend on the
+  // number of threads.
+  //
+  bool fileGrid = seismicParameters.GetCovAlpha()->isFile();
+
+  std::vector<NRLib::Matrix> sigmaeW(nWells);
+  std::string                errText("");
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1) if(fileGrid == false)
+#endif
+  for(int w1=0 ; w1 < nWells ; w1++) {
+    try {
+      int n = syntWellData[w1]->getWellLength();
+
+      NRLib::Matrix postCov(3*n, 3*n);
+      fillPostCov(postCov,
+                  syntWellData[w1]->getIpos(),
+                  syntWellData[w1]->getJpos(),
+                  syntWellData[w1]->getKpos(),
+                  seismicParameters,
+                  n,
+                  true);
+
+      NRLib::Matrix U;
+      NRLib::Vector lambda;
+      NRLib::Matrix UtPostCov;
+      prepareWellFilter(postCov, U, lambda, UtPostCov, priorSpatialCorr_[w1], priorCov0, n);
+
+      WellFilter filter;
+      filter.par.resize(3);
+      for(int p=0 ; p<3 ; p++)
+        filter.par[p] = p;
+      computeWellFilter(filter, priorCov0, lambda, UtPostCov, n);
+
+      sigmaeW[w1].resize(3,3);
+      NRLib::InitializeMatrix(sigmaeW[w1], 0.0);
+      addErrorCov(sigmaeW[w1], filter, postCov, n);
     }
-
-
-    //LogKit::LogFormatted(LogKit::Low,"\n  Cholesky decomposition ...");
-    lib_matrCholR(3*n, sigmapri);
-    //LogKit::LogFormatted(LogKit::Low,"\n  Equation solving ...");
-    lib_matrAXeqBMatR(3*n, sigmapri, imat, 3*n);
-    //LogKit::LogFormatted(LogKit::Low,"\n  Matrix multiplication ...\n");
-    lib_matr_prod(sigmapost,imat,3*n,3*n,3*n,Aw);
-
-    for(int i=0;i<3*n;i++) {
-      for(int j=0;j<3*n;j++){
-        Aw[i][j] *=-1.0;
-        if(i==j)
-          Aw[i][j]+=1.0;
+    catch (NRLib::Exception & e) {
+#ifdef _OPENMP
+#pragma omp critical(spatial_well_filter_error)
+#endif
+      {
+        errText += e.what();
       }
     }
+  }
 
-    updateSigmaeSynt(Aw, sigmapost, n);
-
-    lastn += n;
-
-    for(int i=0;i<3*n;i++){
-      delete [] Aw[i];
-      delete [] sigmapri[i];
-      delete [] sigmapost[i];
-      delete [] imat[i];
-    }
-    delete [] Aw;
-    delete [] sigmapri;
-    delete [] sigmapost;
-    delete [] imat;
+  if(errText != "")
+    throw NRLib::Exception(errText);
+
+  // The sum is not yet stored in sigmaeSynt_.
+  NRLib::Matrix Se(3,3);// = sigmaeSynt_[0]; Marit
+  NRLib::InitializeMatrix(Se, 0.0);
+  for(int w1=0 ; w1 < nWells ; w1++) {
+    Se(0,0) += sigmaeW[w1](0,0);
+    Se(1,0) += sigmaeW[w1](1,0);
+    Se(2,0) += sigmaeW[w1](2,0);
+    Se(1,1) += sigmaeW[w1](1,1);
+    Se(2,1) += sigmaeW[w1](2,1);
+    Se(2,2) += sigmaeW[w1](2,2);
+    lastn += syntWellData[w1]->getWellLength();
   }
 
   if(no_wells_filtered == false){
     // finds the scale at default inversion (all minimum noise in case of local noise)
-    NRLib::Matrix Se(3,3);// = sigmaeSynt_[0]; Marit
     Se(0,0) /= lastn;
     Se(1,0) /= lastn;
     Se(1,1) /= lastn;
@@ -300,6 +251,7 @@ void SpatialWellFilter::doFilteringSyntWells(std::vector<SyntWellData *>
   Timings::setTimeFiltering(wall,cpu);
 }
 
+
 //--------------------------------------------------------------------------------
 void SpatialWellFilter::doFiltering(std::vector<WellData  *>        wells,
                                     int                             nWells,
@@ -317,11 +269,7 @@ void SpatialWellFilter::doFiltering(std::vector<WellData  *>        wells,
 
   std::vector<NRLib::Matrix> sigmaeVpRho;
 
-  double ** sigmapost;
-  double ** sigmapri;
-
   int lastn = 0;
-  int n = 0;
   int nDim = 1;
   for(int i=0;i<nAngles;i++)
     nDim *= 2;
@@ -341,115 +289,107 @@ void SpatialWellFilter::doFiltering(std::vector<WellData  *>        wells,
 
   bool no_wells_filtered = true;
 
-  for(int w1=0 ; w1 < nWells ; w1++)
-  {
-    n = wells[w1]->getBlockedLogsOrigThick()->getNumberOfBlocks();
-
-    if (wells[w1]->getUseForFiltering() == true)
-    {
+  for(int w1=0 ; w1 < nWells ; w1++) {
+    if (wells[w1]->getUseForFiltering() == true) {
       LogKit::LogFormatted(LogKit::Low,"\nFiltering well "+wells[w1]->getWellname());
       no_wells_filtered = false;
+    }
+  }
 
-      sigmapost = new double * [3*n];
-      for(int i=0;i<3*n;i++)
-        sigmapost[i] = new double[3*n];
-
-      sigmapri = new double * [3*n];
-      for(int i=0;i<3*n;i++)
-        sigmapri[i] = new double[3*n];
-
-      const int *ipos = wells[w1]->getBlockedLogsOrigThick()->getIpos();
-      const int *jpos = wells[w1]->getBlockedLogsOrigThick()->getJpos();
-      const int *kpos = wells[w1]->getBlockedLogsOrigThick()->getKpos();
-
-      float regularization = Definitions::SpatialFilterRegularisationValue();
-
-      fillValuesInSigmapost(sigmapost, ipos, jpos, kpos, seismicParameters.GetCovAlpha()      , n, 0  , 0   );
-      fillValuesInSigmapost(sigmapost, ipos, jpos, kpos, seismicParameters.GetCovBeta()       , n, n  , n   );
-      fillValuesInSigmapost(sigmapost, ipos, jpos, kpos, seismicParameters.GetCovRho()        , n, 2*n, 2*n );
-      fillValuesInSigmapost(sigmapost, ipos, jpos, kpos, seismicParameters.GetCrCovAlphaBeta(), n, 0  , n   );
-      fillValuesInSigmapost(sigmapost, ipos, jpos, kpos, seismicParameters.GetCrCovAlphaRho() , n, 0  , 2*n );
-      fillValuesInSigmapost(sigmapost, ipos, jpos, kpos, seismicParameters.GetCrCovBetaRho()  , n, 2*n, n   );
-
-      for(int l1=0 ; l1 < n ; l1++) {
-        for(int l2=0 ; l2 < n ; l2++) {
-          sigmapost[l2 + n  ][l1      ] = sigmapost[l1      ][l2 + n  ];
-          sigmapost[l2 + 2*n][l1      ] = sigmapost[l1      ][l2 + 2*n];
-          sigmapost[l2 + n  ][l1 + 2*n] = sigmapost[l1 + 2*n][l2 + n  ];
-          sigmapri [l1      ][l2      ] = priorCov0(0,0)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri [l1 + n  ][l2 + n  ] = priorCov0(1,1)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri [l1 + 2*n][l2 + 2*n] = priorCov0(2,2)*priorSpatialCorr_[w1][l1][l2];
-          if(l1==l2)
-          {
-            sigmapost[l1      ][l2      ] += regularization*sigmapost[l1      ][l2      ]/sigmapri[l1      ][l2      ];
-            sigmapost[l1 + n  ][l2 + n  ] += regularization*sigmapost[l1 + n  ][l2 + n  ]/sigmapri[l1 + n  ][l2 + n  ];
-            sigmapost[l1 + 2*n][l2 + 2*n] += regularization*sigmapost[l1 + 2*n][l2 + 2*n]/sigmapri[l1 + 2*n][l2 + 2*n];
-            sigmapri [l1      ][l2      ] += regularization;
-            sigmapri [l1 + n  ][l2 + n  ] += regularization;
-            sigmapri [l1 + 2*n][l2 + 2*n] += regularization;
-          }
-          sigmapri[l1 + n  ][l2      ] = priorCov0(1,0)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri[l2      ][l1 + n  ] = priorCov0(1,0)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri[l1 + 2*n][l2      ] = priorCov0(2,0)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri[l2      ][l1 + 2*n] = priorCov0(2,0)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri[l1 + n  ][l2 + 2*n] = priorCov0(2,1)*priorSpatialCorr_[w1][l1][l2];
-          sigmapri[l2 + 2*n][l1 + n  ] = priorCov0(2,1)*priorSpatialCorr_[w1][l1][l2];
+  //
+  // The wells are independent, and are filtered in parallel unless the
+  // covariance grids are on file. The contributions to the error covariances
+  // are added in well order afterwards, so the sums do not depend on the
+  // number of threads.
+  //
+  bool fileGrid = seismicParameters.GetCovAlpha()->isFile();
+
+  std::vector<NRLib::Matrix> sigmaeW(nWells);
+  std::vector<NRLib::Matrix> sigmaeWVpRho(nWells);
+  std::string                errText("");
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1) if(fileGrid == false)
+#endif
+  for(int w1=0 ; w1 < nWells ; w1++) {
+    if (wells[w1]->getUseForFiltering() == true) {
+      try {
+        BlockedLogs * blockedLogs = wells[w1]->getBlockedLogsOrigThick();
+        int           n           = blockedLogs->getNumberOfBlocks();
+
+        NRLib::Matrix postCov(3*n, 3*n);
+        fillPostCov(postCov,
+                    blockedLogs->getIpos(),
+                    blockedLogs->getJpos(),
+                    blockedLogs->getKpos(),
+                    seismicParameters,
+                    n,
+                    false);
+
+        NRLib::Matrix U;
+        NRLib::Vector lambda;
+        NRLib::Matrix UtPostCov;
+        prepareWellFilter(postCov, U, lambda, UtPostCov, priorSpatialCorr_[w1], priorCov0, n);
+
+        //
+        // Filter = I - Sigma_post * inv(Sigma_prior)
+        //
+        WellFilter filter;
+        filter.par.resize(3);
+        for(int p=0 ; p<3 ; p++)
+          filter.par[p] = p;
+        computeWellFilter(filter, priorCov0, lambda, UtPostCov, n);
+
+        NRLib::Vector residuals(3*n);
+        NRLib::Vector filtered(3*n);
+        makeResiduals(blockedLogs, n, true, residuals);
+        applyWellFilter(filter, U, residuals, filtered);
+        calculateFilteredLogs(filtered, blockedLogs, n, true);
+
+        if(useVpRhoFilter == false) { //Save time, since below is not needed then.
+          sigmaeW[w1].resize(3,3);
+          NRLib::InitializeMatrix(sigmaeW[w1], 0.0);
+          addErrorCov(sigmaeW[w1], filter, postCov, n);
+        }
+        else { //Only additional
+          WellFilter filterVpRho;
+          filterVpRho.par.resize(2);
+          filterVpRho.par[0] = 0;
+          filterVpRho.par[1] = 2;
+          computeWellFilter(filterVpRho, priorCov0, lambda, UtPostCov, n);
+
+          NRLib::Vector residualsVpRho(2*n);
+          NRLib::Vector filteredVpRho(2*n);
+          makeResiduals(blockedLogs, n, false, residualsVpRho);
+          applyWellFilter(filterVpRho, U, residualsVpRho, filteredVpRho);
+          calculateFilteredLogs(filteredVpRho, blockedLogs, n, false);
+
+          sigmaeWVpRho[w1].resize(2,2);
+          NRLib::InitializeMatrix(sigmaeWVpRho[w1], 0.0);
+          addErrorCov(sigmaeWVpRho[w1], filterVpRho, postCov, n);
         }
       }
-
-      NRLib::SymmetricMatrix Sprior(3*n);
-      NRLib::SymmetricMatrix Spost(3*n);
-
-      for(int i = 0 ; i < 3*n ; i++)
-        for(int j = 0 ; j <= i ; j++)
-          Sprior(j,i) = sigmapri[j][i];
-
-      for(int i = 0 ; i < 3*n ; i++)
-        for(int j = 0 ; j <= i ; j++)
-          Spost(j,i) = sigmapost[j][i];
-
-      if(useVpRhoFilter == true) //Only additional
-        doVpRhoFiltering(sigmaeVpRho,
-                         sigmapri,
-                         sigmapost,
-                         n,
-                         wells[w1]->getBlockedLogsOrigThick()); //Must do before Cholesky of sigmapri.
-
-
-      //
-      // Filter = I - Sigma_post * inv(Sigma_prior)
-      //
-      NRLib::Matrix Aw;
-      NRLib::Matrix I = NRLib::IdentityMatrix(3*n);
-      NRLib::CholeskySolve(Sprior, I);
-
-      Aw = Spost * I;
-      Aw = Aw * (-1);
-      for(int i=0 ; i<3*n ; i++) {
-        Aw(i,i) += 1.0;
-      }
-
-      if(useVpRhoFilter == false) { //Save time, since below is not needed then.
-        updateSigmaE(sigmae_[0],
-                     Aw,
-                     Spost,
-                     n);
+      catch (NRLib::Exception & e) {
+#ifdef _OPENMP
+#pragma omp critical(spatial_well_filter_error)
+#endif
+        {
+          errText += e.what();
+        }
       }
+    }
+  }
 
-      calculateFilteredLogs(Aw,
-                            wells[w1]->getBlockedLogsOrigThick(),
-                            n,
-                            true);
-
-      lastn += n;
+  if(errText != "")
+    throw NRLib::Exception(errText);
 
-      for(int i=0;i<3*n;i++)
-      {
-        delete [] sigmapost[i];
-        delete [] sigmapri[i];
-      }
-      delete [] sigmapri;
-      delete [] sigmapost;
+  for(int w1=0 ; w1 < nWells ; w1++) {
+    if (wells[w1]->getUseForFiltering() == true) {
+      if(useVpRhoFilter == false)
+        updateSigmaE(sigmae_[0], sigmaeW[w1]);
+      else
+        updateSigmaEVpRho(sigmaeVpRho, sigmaeWVpRho[w1], static_cast<int>(sigmae_.size()));
+      lastn += wells[w1]->getBlockedLogsOrigThick()->getNumberOfBlocks();
     }
   }
 
@@ -472,9 +412,42 @@ void SpatialWellFilter::doFiltering(std::vector<WellData  *>        wells,
   Timings::setTimeFiltering(wall,cpu);
 }
 
+void
+SpatialWellFilter::fillPostCov(NRLib::Matrix           & postCov,
+                               const int               * ipos,
+                               const int               * jpos,
+                               const int               * kpos,
+                               SeismicParametersHolder & seismicParameters,
+                               int                       n,
+                               bool                      syntWell)
+{
+  FFTGrid * covGrid[6] = {seismicParameters.GetCovAlpha(),
+                          seismicParameters.GetCovBeta(),
+                          seismicParameters.GetCovRho(),
+                          seismicParameters.GetCrCovAlphaBeta(),
+                          seismicParameters.GetCrCovAlphaRho(),
+                          seismicParameters.GetCrCovBetaRho()};
+  int       ni[6]      = {0, n, 2*n, 0, 0  , 2*n};
+  int       nj[6]      = {0, n, 2*n, n, 2*n, n  };
+
+  for(int g=0 ; g < 6 ; g++) {
+    if(syntWell)
+      fillValuesInSigmapostSyntWell(postCov, ipos, jpos, kpos, covGrid[g], n, ni[g], nj[g]);
+    else
+      fillValuesInSigmapost(postCov, ipos, jpos, kpos, covGrid[g], n, ni[g], nj[g]);
+  }
+
+  for(int l1=0 ; l1 < n ; l1++) {
+    for(int l2=0 ; l2 < n ; l2++) {
+      postCov(l2 + n  , l1      ) = postCov(l1      , l2 + n  );
+      postCov(l2 + 2*n, l1      ) = postCov(l1      , l2 + 2*n);
+      postCov(l2 + n  , l1 + 2*n) = postCov(l1 + 2*n, l2 + n  );
+    }
+  }
+}
 
 void
-SpatialWellFilter::fillValuesInSigmapostSyntWell(double **sigmapost, const int *ipos, const int *jpos, const int *kpos, FFTGrid *covgrid, int n, int ni, int nj)
+SpatialWellFilter::fillValuesInSigmapostSyntWell(NRLib::Matrix & sigmapost, const int *ipos, const int *jpos, const int *kpos, FFTGrid *covgrid, int n, int ni, int nj)
 {
   double minValue = std::pow(10.0,-9);
   int nz = covgrid->getNz();
@@ -484,7 +457,9 @@ SpatialWellFilter::fillValuesInSigmapostSyntWell(double **sigmapost, const int *
   // tapering limit at 90%
   double smoothLimit = nz*.9;
 
-  covgrid->setAccessMode(FFTGrid::RANDOMACCESS);
+  bool fileGrid = covgrid->isFile(); // Grids in memory are only read, and may be shared by threads
+  if(fileGrid)
+    covgrid->setAccessMode(FFTGrid::RANDOMACCESS);
   int i1, j1, k1, l1, i2, j2, k2, l2;
   for(l1=0;l1<n;l1++)
   {
@@ -497,29 +472,36 @@ SpatialWellFilter::fillValuesInSigmapostSyntWell(double **sigmapost, const int *
       j2 = jpos[l2];
       k2 = kpos[l2];
       if(abs(k2-k1) > smoothLimit){
-        sigmapost[l1+ni][l2+nj] = std::max(endValue*factorNorm*exp(-(div*(abs(k2-k1)-smoothLimit))*(div*(abs(k2-k1)-smoothLimit))*0.5), minValue);
+        sigmapost(l1+ni,l2+nj) = std::max(endValue*factorNorm*exp(-(div*(abs(k2-k1)-smoothLimit))*(div*(abs(k2-k1)-smoothLimit))*0.5), minValue);
       }
       else{
-        sigmapost[l1+ni][l2+nj] = covgrid->getRealValueCyclic(i1-i2,j1-j2,k1-k2);
+        sigmapost(l1+ni,l2+nj) = covgrid->getRealValueCyclic(i1-i2,j1-j2,k1-k2);
       }
+      // In case the synthetic well is longer than the vertical size of covgrid,
+      // set correlation for the relevant grid points to 0
+      if(sigmapost(l1+ni,l2+nj) == RMISSING)
+        sigmapost(l1+ni,l2+nj) = 0.0;
     }
   }
-  covgrid->endAccess();
+  if(fileGrid)
+    covgrid->endAccess();
 
 
 }
 
 void
-SpatialWellFilter::fillValuesInSigmapost(double    ** sigmapost,
-                                         const int *  ipos,
-                                         const int *  jpos,
-                                         const int *  kpos,
-                                         FFTGrid   *  covgrid,
-                                         int          n,
-                                         int          ni,
-                                         int          nj)
+SpatialWellFilter::fillValuesInSigmapost(NRLib::Matrix &  sigmapost,
+                                         const int     *  ipos,
+                                         const int     *  jpos,
+                                         const int     *  kpos,
+                                         FFTGrid       *  covgrid,
+                                         int              n,
+                                         int              ni,
+                                         int              nj)
 {
-  covgrid->setAccessMode(FFTGrid::RANDOMACCESS);
+  bool fileGrid = covgrid->isFile(); // Grids in memory are only read, and may be shared by threads
+  if(fileGrid)
+    covgrid->setAccessMode(FFTGrid::RANDOMACCESS);
   for (int l1=0 ; l1<n ; l1++) {
     int i1 = ipos[l1];
     int j1 = jpos[l1];
@@ -528,61 +510,186 @@ SpatialWellFilter::fillValuesInSigmapost(double    ** sigmapost,
       int i2 = ipos[l2];
       int j2 = jpos[l2];
       int k2 = kpos[l2];
-      sigmapost[l1+ni][l2+nj] = covgrid->getRealValueCyclic(i1-i2, j1-j2, k1-k2);
+      sigmapost(l1+ni,l2+nj) = covgrid->getRealValueCyclic(i1-i2, j1-j2, k1-k2);
     }
   }
-  covgrid->endAccess();
+  if(fileGrid)
+    covgrid->endAccess();
 }
 
 void
-SpatialWellFilter::updateSigmaeSynt(double ** filter, double ** postCov,  int n)
+SpatialWellFilter::prepareWellFilter(NRLib::Matrix       & postCov,
+                                     NRLib::Matrix       & U,
+                                     NRLib::Vector       & lambda,
+                                     NRLib::Matrix       & UtPostCov,
+                                     double             ** corr,
+                                     const NRLib::Matrix & priorCov0,
+                                     int                   n) const
 {
-  double **sigmaeW;
-  sigmaeW = new double * [3*n];
-  for(int i=0;i<3*n;i++)
-  {
-    sigmaeW[i] = new double[3*n];
+  //
+  // The prior covariance of the well is priorCov0 x corr + r*I, where x is
+  // the Kronecker product and r the regularization. With corr = U*Lambda*U^T
+  // and the eigen decomposition of (a block of) priorCov0, it is diagonalized
+  // by a Kronecker product of eigenvectors. This only needs the eigenvectors
+  // of the n x n matrix corr, which are shared by all parameter subsets.
+  //
+  double regularization = Definitions::SpatialFilterRegularisationValue();
+
+  for(int l=0 ; l < n ; l++) {
+    for(int p=0 ; p < 3 ; p++)
+      postCov(l + p*n, l + p*n) += regularization*postCov(l + p*n, l + p*n)/(priorCov0(p,p)*corr[l][l]);
+  }
+
+  NRLib::SymmetricMatrix C(n);
+  for(int i=0 ; i < n ; i++)
+    for(int j=0 ; j <= i ; j++)
+      C(j,i) = corr[j][i];
+
+  NRLib::ComputeEigenVectorsSymmetric(C, lambda, U);
+
+  // corr is a correlation matrix, and negative eigenvalues are round-off
+  for(int l=0 ; l < n ; l++)
+    lambda(l) = std::max(lambda(l), 0.0);
+
+  //
+  // UtPostCov = (I x U)^T * Sigma_post, one block row at a time
+  //
+  UtPostCov.resize(3*n, 3*n);
+  for(int p=0 ; p < 3 ; p++)
+    flens::gemm(flens::ColMajor, flens::Trans, flens::NoTrans, n, 3*n, n,
+                1.0, U.data(), U.leadingDimension(),
+                postCov.data() + p*n, postCov.leadingDimension(),
+                0.0, UtPostCov.data() + p*n, UtPostCov.leadingDimension());
+}
+
+void
+SpatialWellFilter::computeWellFilter(WellFilter          & filter,
+                                     const NRLib::Matrix & priorCov0,
+                                     const NRLib::Vector & lambda,
+                                     const NRLib::Matrix & UtPostCov,
+                                     int                   n) const
+{
+  //
+  // Sigma_prior = Q*D*Q^T with Q = V x U, where V holds the eigenvectors and mu
+  // the eigenvalues of the parameter block of priorCov0, and D = mu x Lambda + r*I.
+  //
+  int    m              = static_cast<int>(filter.par.size());
+  double regularization = Definitions::SpatialFilterRegularisationValue();
+
+  NRLib::SymmetricMatrix priorPar(m);
+  for(int a=0 ; a < m ; a++)
+    for(int b=0 ; b <= a ; b++)
+      priorPar(b,a) = priorCov0(filter.par[b], filter.par[a]);
+
+  NRLib::Vector mu;
+  NRLib::ComputeEigenVectorsSymmetric(priorPar, mu, filter.V);
+
+  filter.scale.resize(m*n);
+  for(int a=0 ; a < m ; a++)
+    for(int l=0 ; l < n ; l++)
+      filter.scale(a*n + l) = 1.0/sqrt(mu(a)*lambda(l) + regularization);
+
+  //
+  // Z = D^(-1/2) * Q^T * Sigma_post, using the columns of the parameters only
+  //
+  filter.Z.resize(m*n, m*n);
+  for(int c=0 ; c < m ; c++) {
+    for(int j=0 ; j < n ; j++) {
+      const double * col = UtPostCov.data() + static_cast<size_t>(filter.par[c]*n + j)*UtPostCov.leadingDimension();
+      double       * z   = filter.Z.data()  + static_cast<size_t>(c*n + j)*filter.Z.leadingDimension();
+      for(int a=0 ; a < m ; a++) {
+        for(int l=0 ; l < n ; l++) {
+          double sum = 0.0;
+          for(int b=0 ; b < m ; b++)
+            sum += filter.V(b,a)*col[filter.par[b]*n + l];
+          z[a*n + l] = filter.scale(a*n + l)*sum;
+        }
+      }
+    }
   }
+}
 
-  lib_matr_prod(filter,postCov,3*n,3*n,3*n,sigmaeW);
+void
+SpatialWellFilter::applyWellFilter(const WellFilter    & filter,
+                                   const NRLib::Matrix & U,
+                                   const NRLib::Vector & residuals,
+                                   NRLib::Vector       & filtered) const
+{
+  //
+  // filtered = (I - Sigma_post*inv(Sigma_prior))*residuals = residuals - Z^T * D^(-1/2) * Q^T * residuals
+  //
+  int m  = static_cast<int>(filter.par.size());
+  int n  = U.numRows();
+  int mn = m*n;
+
+  NRLib::Vector y(mn);
+  for(int b=0 ; b < m ; b++) {
+    for(int l=0 ; l < n ; l++) {
+      double sum = 0.0;
+      for(int j=0 ; j < n ; j++)
+        sum += U(j,l)*residuals(b*n + j);
+      y(b*n + l) = sum;
+    }
+  }
 
-  for(int i=0; i<n; i++) {
-    NRLib::Matrix Se(3,3); //= sigmaeSynt_[0]; Marit
-    Se(0,0) += sigmaeW[i      ][i     ];
-    Se(1,0) += sigmaeW[i +   n][i     ];
-    Se(2,0) += sigmaeW[i + 2*n][i     ];
-    Se(1,1) += sigmaeW[i +   n][i +  n];
-    Se(2,1) += sigmaeW[i + 2*n][i +  n];
-    Se(2,2) += sigmaeW[i + 2*n][i + 2*n];
+  NRLib::Vector z(mn);
+  for(int a=0 ; a < m ; a++) {
+    for(int l=0 ; l < n ; l++) {
+      double sum = 0.0;
+      for(int b=0 ; b < m ; b++)
+        sum += filter.V(b,a)*y(b*n + l);
+      z(a*n + l) = filter.scale(a*n + l)*sum;
+    }
   }
-  // sigmaeSynt_ Is normalized (1/n) in completeSigmaE, Here well by well is added.
 
-  for(int i=0;i<3*n;i++)
-    delete [] sigmaeW[i];
+  for(int c=0 ; c < mn ; c++) {
+    const double * col = filter.Z.data() + static_cast<size_t>(c)*filter.Z.leadingDimension();
+    double sum = 0.0;
+    for(int r=0 ; r < mn ; r++)
+      sum += col[r]*z(r);
+    filtered(c) = residuals(c) - sum;
+  }
+}
 
-  delete [] sigmaeW;
+void
+SpatialWellFilter::addErrorCov(NRLib::Matrix       & sigmae,
+                               const WellFilter    & filter,
+                               const NRLib::Matrix & postCov,
+                               int                   n) const
+{
+  //
+  // Adds the diagonal of each parameter block of Filter*Sigma_post
+  // = Sigma_post - Z^T*Z to the lower triangle of sigmae.
+  //
+  int m  = static_cast<int>(filter.par.size());
+  int mn = m*n;
+  for(int a=0 ; a < m ; a++) {
+    for(int b=0 ; b <= a ; b++) {
+      for(int i=0 ; i < n ; i++) {
+        const double * za = filter.Z.data() + static_cast<size_t>(a*n + i)*filter.Z.leadingDimension();
+        const double * zb = filter.Z.data() + static_cast<size_t>(b*n + i)*filter.Z.leadingDimension();
+        double sum = 0.0;
+        for(int r=0 ; r < mn ; r++)
+          sum += za[r]*zb[r];
+        sigmae(a,b) += postCov(filter.par[a]*n + i, filter.par[b]*n + i) - sum;
+      }
+    }
+  }
 }
+
 //------------------------------------------------------------------
 void SpatialWellFilter::updateSigmaE(NRLib::Matrix       & sigmae,
-                                     const NRLib::Matrix & Filter,
-                                     const NRLib::Matrix & PostCov,
-                                     int                   n)
+                                     const NRLib::Matrix & sigmaeW)
 //------------------------------------------------------------------
 {
-  NRLib::Matrix sigmaeW = Filter * PostCov;
-
-  for(int i=0 ; i < n ; i++)
-  {
-    sigmae(0,0) += sigmaeW(i      , i      );
-    sigmae(1,0) += sigmaeW(i +   n, i      );
-    sigmae(2,0) += sigmaeW(i + 2*n, i      );
-    sigmae(1,1) += sigmaeW(i +   n, i +   n);
-    sigmae(2,1) += sigmaeW(i + 2*n, i +   n);
-    sigmae(2,2) += sigmaeW(i + 2*n, i + 2*n);
-  }
+  sigmae(0,0) += sigmaeW(0,0);
+  sigmae(1,0) += sigmaeW(1,0);
+  sigmae(2,0) += sigmaeW(2,0);
+  sigmae(1,1) += sigmaeW(1,1);
+  sigmae(2,1) += sigmaeW(2,1);
+  sigmae(2,2) += sigmaeW(2,2);
   // sigmae Is normalized (1/n) in completeSigmaE, Here well by well is added.
 }
-
 //-------------------------------------------------------------------------------
 void SpatialWellFilter::completeSigmaE(std::vector<NRLib::Matrix>  & sigmae,
                                        int                           lastn,
@@ -741,68 +848,10 @@ SpatialWellFilter::computeSigmaEAdjusted(NRLib::Matrix & sigmae,
   sigmaEAdj = T1 * T2;                             // sigmaEAdj = sqrt(sigmaETmp*sigmaE0^-1)*sigmae*sqrt(sigmaE0^-1*sigmaETmp)
 }
 
-//---------------------------------------------------------------------------------
-void SpatialWellFilter::doVpRhoFiltering(std::vector<NRLib::Matrix> &  sigmaeVpRho,
-                                         double                     ** sigmapri,
-                                         double                     ** sigmapost,
-                                         const int                     n,
-                                         BlockedLogs                *  blockedLogs)
-//---------------------------------------------------------------------------------
-{
-  int m = 2*n;
-
-  NRLib::Matrix tmp1(m,m);
-  NRLib::Matrix tmp2(m,m);
-
-  for (int j=0 ; j<n ; j++) {
-    for (int i=0 ; i<n ; i++) {
-      tmp1(i,   j  ) = sigmapri [i  ][j  ];
-      tmp1(i+n, j  ) = sigmapri [i+m][j  ];
-      tmp1(i  , j+n) = sigmapri [i  ][j+m];
-      tmp1(i+n, j+n) = sigmapri [i+m][j+m];
-
-      tmp2(i,   j  ) = sigmapost[i  ][j  ];
-      tmp2(i+n, j  ) = sigmapost[i+m][j  ];
-      tmp2(i,   j+n) = sigmapost[i  ][j+m];
-      tmp2(i+n, j+n) = sigmapost[i+m][j+m];
-    }
-  }
-
-  NRLib::SymmetricMatrix Sprior2(m);
-  NRLib::SymmetricMatrix Spost2(m);
-
-  for(int j = 0 ; j < m ; j++)
-    for(int i = 0 ; i <= j ; i++)
-      Sprior2(i,j) = tmp1(i,j);
-
-  for(int j = 0 ; j < m ; j++)
-    for(int i = 0 ; i <= j ; i++)
-      Spost2(i,j) = tmp2(i,j);
-
-  NRLib::Matrix Aw;
-  NRLib::Matrix I = NRLib::IdentityMatrix(m);
-  NRLib::CholeskySolve(Sprior2, I);
-  Aw = Spost2 * I;
-  Aw = Aw * (-1);
-  for(int i=0 ; i<m ; i++) {
-    Aw(i,i) += 1.0;
-  }
-
-  calculateFilteredLogs(Aw, blockedLogs, n, false);
-
-  updateSigmaEVpRho(sigmaeVpRho,
-                    Aw,
-                    Spost2,
-                    static_cast<int>(sigmae_.size()),
-                    n);
-}
-
 //---------------------------------------------------------------------------------
 void SpatialWellFilter::updateSigmaEVpRho(std::vector<NRLib::Matrix> & sigmaeVpRho,
-                                          const NRLib::Matrix        & Aw,
-                                          const NRLib::Matrix        & Spost,
-                                          int                          nDim,
-                                          int                          n)
+                                          const NRLib::Matrix        & sigmaeW,
+                                          int                          nDim)
 //---------------------------------------------------------------------------------
 {
   if (sigmaeVpRho.size() == 0) { // then first time alocate memory
@@ -816,17 +865,13 @@ void SpatialWellFilter::updateSigmaEVpRho(std::vector<NRLib::Matrix> & sigmaeVpR
     }
   }
 
-  NRLib::Matrix sigma = Aw * Spost;
-
   //
   // NBNB-PAL: Bug? frsteindeksen p sigmaeVpRho[0][0][0] str
   // stille hele tiden. Det er ingen n-avhengighet.
   //
-  for(int i=0 ; i < n ; i++) {
-    sigmaeVpRho[0](0,0) += sigma(i    , i    );
-    sigmaeVpRho[0](1,0) += sigma(i + n, i    );
-    sigmaeVpRho[0](1,1) += sigma(i + n, i + n);
-  }
+  sigmaeVpRho[0](0,0) += sigmaeW(0,0);
+  sigmaeVpRho[0](1,0) += sigmaeW(1,0);
+  sigmaeVpRho[0](1,1) += sigmaeW(1,1);
 }
 
 //------------------------------------------------------------------------------------
@@ -925,35 +970,36 @@ void SpatialWellFilter::completeSigmaEVpRho(std::vector<NRLib::Matrix>  & sigmae
 }
 
 //------------------------------------------------------------------------------
-void SpatialWellFilter::calculateFilteredLogs(const NRLib::Matrix & Aw,
+void SpatialWellFilter::makeResiduals(BlockedLogs   * blockedlogs,
+                                      int             n,
+                                      bool            useVs,
+                                      NRLib::Vector & residuals)
+//------------------------------------------------------------------------------
+{
+  int currentEnd = 0;
+  MakeInterpolatedResiduals(blockedlogs->getAlpha(), blockedlogs->getAlphaHighCutBackground(), n, currentEnd, residuals);
+  currentEnd += n;
+
+  if(useVs == true) {
+    MakeInterpolatedResiduals(blockedlogs->getBeta(), blockedlogs->getBetaHighCutBackground(), n, currentEnd, residuals);
+    currentEnd += n;
+  }
+  MakeInterpolatedResiduals(blockedlogs->getRho(), blockedlogs->getRhoHighCutBackground(), n, currentEnd, residuals);
+}
+
+//------------------------------------------------------------------------------
+void SpatialWellFilter::calculateFilteredLogs(const NRLib::Vector & filteredVal,
                                               BlockedLogs         * blockedlogs,
                                               int                   n,
                                               bool                  useVs)
 //------------------------------------------------------------------------------
 {
-  int nLogs = 2;
-  if(useVs == true)
-    nLogs++;
-
-  NRLib::Vector residuals(nLogs*n);
-
-  int currentEnd = 0;
   const float * alpha   = blockedlogs->getAlpha();
   const float * bgAlpha = blockedlogs->getAlphaHighCutBackground();
-  MakeInterpolatedResiduals(alpha, bgAlpha, n, currentEnd, residuals);
-  currentEnd += n;
-
   const float * beta    = blockedlogs->getBeta();
   const float * bgBeta  = blockedlogs->getBetaHighCutBackground();
-  if(useVs == true) {
-    MakeInterpolatedResiduals(beta, bgBeta, n, currentEnd, residuals);
-    currentEnd += n;
-  }
   const float * rho     = blockedlogs->getRho();
   const float * bgRho   = blockedlogs->getRhoHighCutBackground();
-  MakeInterpolatedResiduals(rho, bgRho, n, currentEnd, residuals);
-
-  NRLib::Vector filteredVal = Aw * residuals;
 
   float * alphaFiltered = new float[n];
   float * betaFiltered  = new float[n];
@@ -56,18 +56,50 @@ public:
 
 private:
 
-  void doVpRhoFiltering(std::vector<NRLib::Matrix> &  sigmaeVpRho,
-                        double                     ** sigmapri,
-                        double                     ** sigmapost,
-                        const int                     n,
-                        BlockedLogs                 * blockedLogs);
+  // Filter for one well and a subset par of the parameters (0 = alpha,
+  // 1 = beta, 2 = rho). The prior covariance is Q*D*Q^T, with Q = V x U.
+  struct WellFilter
+  {
+    std::vector<int> par;
+    NRLib::Matrix    V;       ///< Eigenvectors of the prior covariance of par
+    NRLib::Vector    scale;   ///< D^(-1/2)
+    NRLib::Matrix    Z;       ///< D^(-1/2) * Q^T * Sigma_post, for the par rows and columns
+  };
+
+  void fillPostCov(NRLib::Matrix           & postCov,
+                   const int               * ipos,
+                   const int               * jpos,
+                   const int               * kpos,
+                   SeismicParametersHolder & seismicParameters,
+                   int                       n,
+                   bool                      syntWell);
+
+  void prepareWellFilter(NRLib::Matrix       & postCov,
+                         NRLib::Matrix       & U,
+                         NRLib::Vector       & lambda,
+                         NRLib::Matrix       & UtPostCov,
+                         double             ** corr,
+                         const NRLib::Matrix & priorCov0,
+                         int                   n) const;
+
+  void computeWellFilter(WellFilter          & filter,
+                         const NRLib::Matrix & priorCov0,
+                         const NRLib::Vector & lambda,
+                         const NRLib::Matrix & UtPostCov,
+                         int                   n) const;
+
+  void applyWellFilter(const WellFilter    & filter,
+                       const NRLib::Matrix & U,
+                       const NRLib::Vector & residuals,
+                       NRLib::Vector       & filtered) const;
+
+  void addErrorCov(NRLib::Matrix       & sigmae,
+                   const WellFilter    & filter,
+                   const NRLib::Matrix & postCov,
+                   int                   n) const;
 
   void updateSigmaE(NRLib::Matrix       & sigmae,
-                    const NRLib::Matrix & filter,
-                    const NRLib::Matrix & Spost,
-                    int                   n);
-
-  void updateSigmaeSynt(double ** filter, double ** postCov,  int n);
+                    const NRLib::Matrix & sigmaeW);
 
   void completeSigmaE(std::vector<NRLib::Matrix>  & sigmae,
                       int                           lastn,
@@ -75,24 +107,22 @@ private:
                       const std::vector<Grid2D *> & noiseScale);
 
   void updateSigmaEVpRho(std::vector<NRLib::Matrix> & sigmaeVpRho,
-                         const NRLib::Matrix        & Aw,
-                         const NRLib::Matrix        & Spost,
-                         int                          nDim,
-                         int                          n);
+                         const NRLib::Matrix        & sigmaeW,
+                         int                          nDim);
 
   void completeSigmaEVpRho(std::vector<NRLib::Matrix>  & sigmaeVpRho,
                            int                           lastn,
                            const Crava                 * cravaResult,
                            const std::vector<Grid2D *> & noiseScale);
 
-  void fillValuesInSigmapostSyntWell(double     ** sigmapost,
-                                     const int  *  ipos,
-                                     const int  *  jpos,
-                                     const int  *  kpos,
-                                     FFTGrid    *  covgrid,
-                                     int           n,
-                                     int           ni,
-                                     int           nj);
+  void fillValuesInSigmapostSyntWell(NRLib::Matrix &  sigmapost,
+                                     const int     *  ipos,
+                                     const int     *  jpos,
+                                     const int     *  kpos,
+                                     FFTGrid       *  covgrid,
+                                     int              n,
+                                     int              ni,
+                                     int              nj);
 
   void computeSigmaEAdjusted(NRLib::Matrix & sigmae,
                              NRLib::Matrix & sigmaE0,
@@ -101,7 +131,12 @@ private:
 
   void adjustDiagSigma(NRLib::Matrix & sigmae);
 
-  void calculateFilteredLogs(const NRLib::Matrix & Aw,
+  void makeResiduals(BlockedLogs   * blockedlogs,
+                     int             n,
+                     bool            useVs,
+                     NRLib::Vector & residuals);
+
+  void calculateFilteredLogs(const NRLib::Vector & filteredVal,
                              BlockedLogs         * blockedlogs,
                              int                   n,
                              bool                  useVs);
@@ -112,14 +147,14 @@ private:
                                  const int       offset,
                                  NRLib::Vector & residuals);
 
-  void fillValuesInSigmapost(double    ** sigmapost,
-                             const int *  ipos,
-                             const int *  jpos,
-                             const int *  kpos,
-                             FFTGrid   *  covgrid,
-                             int          n,
-                             int          ni,
-                             int          nj);
+  void fillValuesInSigmapost(NRLib::Matrix &  sigmapost,
+                             const int     *  ipos,
+                             const int     *  jpos,
+                             const int     *  kpos,
+                             FFTGrid       *  covgrid,
+                             int              n,
+                             int              ni,
+                             int              nj);
 
   std::vector<NRLib::Matrix> sigmae_;
   std::vector<double **> sigmaeSynt_;
@@ -1,5 +1,7 @@
 #include "src/state4d.h"
 #include "src/seismicparametersholder.h"
+#include "src/fftgrid.h"
+#include "src/fftgridtile.h"
 #include "src/timeevolution.h"
 #include "src/simbox.h"
 #include "lib/lib_matr.h"
@@ -100,51 +102,48 @@ void State4D::merge(SeismicParametersHolder & current_state )
   mu[2] =  current_state.GetMuRho(); //mu_Rho
 
   for(int i = 0; i<3; i++)
-  {
     mu[i]->setTransformedStatus(true); //Going to fill it with transformed info.
-    mu[i]->setAccessMode(FFTGrid::WRITE);
-    mu_static_[i]->setAccessMode(FFTGrid::READ);
-    mu_dynamic_[i]->setAccessMode(FFTGrid::READ);
-  }
 
-  int nzp = mu[0]->getNzp();
-  int nyp = mu[0]->getNyp();
-  int cnxp = mu[0]->getCNxp();
+  std::vector<FFTGrid *> muFull = getFullMuGrids();
 
-  fftw_complex*  muFullPrior=new fftw_complex[6];
-  fftw_complex*  muCurrentPrior=new fftw_complex[3];
+  // The cells are independent, so the rows are distributed over the threads,
+  // unless some grids are on file and the rows must be taken in order.
+  bool streamed = (FFTGridTile::hasFileGrid(muFull) || FFTGridTile::hasFileGrid(mu));
+  if(streamed) {
+    FFTGridTile::beginAccess(muFull, FFTGrid::READ);
+    FFTGridTile::beginAccess(mu, FFTGrid::WRITE);
+  }
 
-  for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
+#ifdef _OPENMP
+#pragma omp parallel if(!streamed)
+#endif
+  {
+    FFTGridTile muFullTile(muFull, streamed);
+    FFTGridTile muCurrentTile(mu, streamed);
+    int         cnxp = muFullTile.getCNxp();
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int r = 0; r < muFullTile.getNRows(); r++) {
+      muFullTile.readRow(r);
       for (int i = 0; i < cnxp; i++) {
-         muFullPrior[0] = mu_static_[0]->getNextComplex();
-         muFullPrior[1] = mu_static_[1]->getNextComplex();
-         muFullPrior[2] = mu_static_[2]->getNextComplex();
-         muFullPrior[3] = mu_dynamic_[0]->getNextComplex();
-         muFullPrior[4] = mu_dynamic_[1]->getNextComplex();
-         muFullPrior[5] = mu_dynamic_[2]->getNextComplex();
+         const fftw_complex * muFullPrior    = muFullTile.getCell(i);
+         fftw_complex       * muCurrentPrior = muCurrentTile.getCell(i);
          for(int l=0;l<3;l++){
            muCurrentPrior[l].re =muFullPrior[l].re+muFullPrior[l+3].re;
            muCurrentPrior[l].im =muFullPrior[l].im+muFullPrior[l+3].im;
          }
-
-         mu[0]->setNextComplex(muCurrentPrior[0]);
-         mu[1]->setNextComplex(muCurrentPrior[1]);
-         mu[2]->setNextComplex(muCurrentPrior[2]);
       }
+      muCurrentTile.writeRow(r);
     }
   }
 
-  for(int i = 0; i<3; i++)
-  {
-    mu[i]->endAccess();
-    mu_static_[i]->endAccess();
-    mu_dynamic_[i]->endAccess();
+  if(streamed) {
+    FFTGridTile::endAccess(muFull);
+    FFTGridTile::endAccess(mu);
   }
 
-  delete [] muFullPrior;
-  delete [] muCurrentPrior;
-
   //Merge covariances
   std::vector<FFTGrid *> sigma(6);
   sigma[0]=current_state.GetCovAlpha();
@@ -163,52 +162,39 @@ void State4D::mergeCov(std::vector<FFTGrid * > & sigma)
   assert(sigma.size() == 6);
 
   for(int i = 0; i<6; i++)
-  {
     sigma[i]->setTransformedStatus(true); //Going to fill it with transformed info.
-    sigma[i]->setAccessMode(FFTGrid::WRITE);
-    sigma_static_static_[i]->setAccessMode(FFTGrid::READ);
-    sigma_dynamic_dynamic_[i]->setAccessMode(FFTGrid::READ);
-  }
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->setAccessMode(FFTGrid::READ);
-
-  std::vector<std::vector<fftw_complex> > sigmaFullPrior(6);
-  for(int i=0;i<6;i++)
-    sigmaFullPrior[i].resize(6);
 
-  std::vector<std::vector<fftw_complex> > sigmaCurrentPrior(3);
-  for(int i=0;i<3;i++)
-    sigmaCurrentPrior[i].resize(3);
+  std::vector<FFTGrid *> sigmaFull = getFullSigmaGrids();
 
-  int nzp = sigma[0]->getNzp();
-  int nyp = sigma[0]->getNyp();
-  int cnxp = sigma[0]->getCNxp();
+  bool streamed = (FFTGridTile::hasFileGrid(sigmaFull) || FFTGridTile::hasFileGrid(sigma));
+  if(streamed) {
+    FFTGridTile::beginAccess(sigmaFull, FFTGrid::READ);
+    FFTGridTile::beginAccess(sigma, FFTGrid::WRITE);
+  }
 
-  for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
+#ifdef _OPENMP
+#pragma omp parallel if(!streamed)
+#endif
+  {
+    FFTGridTile  sigmaFullTile(sigmaFull, streamed);
+    FFTGridTile  sigmaCurrentTile(sigma, streamed);
+    int          cnxp = sigmaFullTile.getCNxp();
+
+    fftw_complex sigmaFullPrior[6][6];
+    fftw_complex sigmaCurrentPrior[3][3];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int r = 0; r < sigmaFullTile.getNRows(); r++) {
+      sigmaFullTile.readRow(r);
       for (int i = 0; i < cnxp; i++) {
-         sigmaFullPrior[0][0] = sigma_static_static_[0]->getNextComplex();
-         sigmaFullPrior[0][1] = sigma_static_static_[1]->getNextComplex();
-         sigmaFullPrior[0][2] = sigma_static_static_[2]->getNextComplex();
-         sigmaFullPrior[0][3] = sigma_static_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[0][4] = sigma_static_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[0][5] = sigma_static_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[1][1] = sigma_static_static_[3]->getNextComplex();
-         sigmaFullPrior[1][2] = sigma_static_static_[4]->getNextComplex();
-         sigmaFullPrior[1][3] = sigma_static_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[1][4] = sigma_static_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[1][5] = sigma_static_dynamic_[5]->getNextComplex();
-         sigmaFullPrior[2][2] = sigma_static_static_[5]->getNextComplex();
-         sigmaFullPrior[2][3] = sigma_static_dynamic_[6]->getNextComplex();
-         sigmaFullPrior[2][4] = sigma_static_dynamic_[7]->getNextComplex();
-         sigmaFullPrior[2][5] = sigma_static_dynamic_[8]->getNextComplex();
-         sigmaFullPrior[3][3] = sigma_dynamic_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[3][4] = sigma_dynamic_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[3][5] = sigma_dynamic_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[4][4] = sigma_dynamic_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[4][5] = sigma_dynamic_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[5][5] = sigma_dynamic_dynamic_[5]->getNextComplex();
+         const fftw_complex * fullCell = sigmaFullTile.getCell(i);
+         int c = 0;
+         for(int l=0;l<6;l++)
+           for(int m=l;m<6;m++)
+             sigmaFullPrior[l][m] = fullCell[c++];
+
          for(int l=0;l<6;l++)
            for(int m=l+1;m<6;m++)
            {
@@ -227,25 +213,23 @@ void State4D::mergeCov(std::vector<FFTGrid * > & sigma)
              sigmaCurrentPrior[l][m].im += sigmaFullPrior[l+3][m  ].im;
              sigmaCurrentPrior[l][m].im += sigmaFullPrior[l  ][m+3].im;
            }
-         sigma[0]->setNextComplex(sigmaCurrentPrior[0][0]);
-         sigma[1]->setNextComplex(sigmaCurrentPrior[0][1]);
-         sigma[2]->setNextComplex(sigmaCurrentPrior[0][2]);
-         sigma[3]->setNextComplex(sigmaCurrentPrior[1][1]);
-         sigma[4]->setNextComplex(sigmaCurrentPrior[1][2]);
-         sigma[5]->setNextComplex(sigmaCurrentPrior[2][2]);
+
+         fftw_complex * currentCell = sigmaCurrentTile.getCell(i);
+         currentCell[0] = sigmaCurrentPrior[0][0];
+         currentCell[1] = sigmaCurrentPrior[0][1];
+         currentCell[2] = sigmaCurrentPrior[0][2];
+         currentCell[3] = sigmaCurrentPrior[1][1];
+         currentCell[4] = sigmaCurrentPrior[1][2];
+         currentCell[5] = sigmaCurrentPrior[2][2];
       }
+      sigmaCurrentTile.writeRow(r);
     }
   }
 
-  for(int i = 0; i<6; i++)
-  {
-    sigma[i]->endAccess();
-    sigma_static_static_[i]->endAccess();
-    sigma_dynamic_dynamic_[i]->endAccess();
+  if(streamed) {
+    FFTGridTile::endAccess(sigmaFull);
+    FFTGridTile::endAccess(sigma);
   }
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->endAccess();
 }
 
 void State4D::split(SeismicParametersHolder & current_state )
@@ -255,122 +239,107 @@ void State4D::split(SeismicParametersHolder & current_state )
   // initializing
   assert(allGridsAreTransformed());
 
-  std::vector<FFTGrid *> mu(3);
-  mu[0] =  current_state.GetMuAlpha(); //mu_Alpha
-  mu[1] =  current_state.GetMuBeta(); //mu_Beta
-  mu[2] =  current_state.GetMuRho(); //mu_Rho
+  // The current state: mean of (vp, vs, rho) followed by the upper triangle of the covariance.
+  std::vector<FFTGrid *> current(9);
+  current[0] = current_state.GetMuAlpha(); //mu_Alpha
+  current[1] = current_state.GetMuBeta(); //mu_Beta
+  current[2] = current_state.GetMuRho(); //mu_Rho
+  current[3] = current_state.GetCovAlpha();
+  current[4] = current_state.GetCrCovAlphaBeta();
+  current[5] = current_state.GetCrCovAlphaRho();
+  current[6] = current_state.GetCovBeta();
+  current[7] = current_state.GetCrCovBetaRho();
+  current[8] = current_state.GetCovRho();
 
-  for(int i = 0; i<3; i++)
-  {
-    assert(mu[i]->getIsTransformed());
-    mu[i]->setAccessMode(FFTGrid::READ);
-    mu_static_[i]->setAccessMode(FFTGrid::READANDWRITE);
-    mu_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
+  for(int i = 0; i<9; i++)
+    assert(current[i]->getIsTransformed());
+
+  // The full state: mean of static and dynamic parameters followed by the upper triangle of the covariance.
+  std::vector<FFTGrid *> full      = getFullMuGrids();
+  std::vector<FFTGrid *> sigmaFull = getFullSigmaGrids();
+  full.insert(full.end(), sigmaFull.begin(), sigmaFull.end());
+
+  int nCells  = current[0]->getCNxp()*current[0]->getNyp()*current[0]->getNzp();
+  int counter = 0;
+
+  // The cells are independent, so the rows are distributed over the threads,
+  // unless some grids are on file and the rows must be taken in order.
+  bool streamed = (FFTGridTile::hasFileGrid(full) || FFTGridTile::hasFileGrid(current));
+  if(streamed) {
+    FFTGridTile::beginAccess(full, FFTGrid::READANDWRITE);
+    FFTGridTile::beginAccess(current, FFTGrid::READ);
   }
 
-  std::vector<FFTGrid *> sigma(6);
-  sigma[0]=current_state.GetCovAlpha();
-  sigma[1]=current_state.GetCrCovAlphaBeta();
-  sigma[2]=current_state.GetCrCovAlphaRho();
-  sigma[3]=current_state.GetCovBeta();
-  sigma[4]=current_state.GetCrCovBetaRho();
-  sigma[5]=current_state.GetCovRho();
-
-
-
-  for(int i = 0; i<6; i++)
+#ifdef _OPENMP
+#pragma omp parallel if(!streamed)
+#endif
   {
-    assert(sigma[i]->getIsTransformed());
-    sigma[i]->setAccessMode(FFTGrid::READ);
-    sigma_static_static_[i]->setAccessMode(FFTGrid::READANDWRITE);
-    sigma_dynamic_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-  }
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-
-
-  int nzp = mu[0]->getNzp();
-  int nyp = mu[0]->getNyp();
-  int cnxp = mu[0]->getCNxp();
-
-  fftw_complex*  muFullPrior=new fftw_complex[6];
-  fftw_complex*  muFullPosterior=new fftw_complex[6];
-  fftw_complex*  muCurrentPrior=new fftw_complex[3];
-  fftw_complex*  muCurrentPosterior=new fftw_complex[3];
+    FFTGridTile fullTile(full, streamed);
+    FFTGridTile currentTile(current, streamed);
+    int         cnxp = fullTile.getCNxp();
+
+    fftw_complex*  muFullPrior=new fftw_complex[6];
+    fftw_complex*  muFullPosterior=new fftw_complex[6];
+    fftw_complex*  muCurrentPrior=new fftw_complex[3];
+    fftw_complex*  muCurrentPosterior=new fftw_complex[3];
+
+    fftw_complex** sigmaFullPrior          = new fftw_complex*[6];
+    fftw_complex** sigmaFullPosterior      = new fftw_complex*[6];
+    fftw_complex** sigmaFullVsCurrentPrior = new fftw_complex*[6];
+    fftw_complex** adjointSandwich         = new fftw_complex*[6];
+
+    for(int i=0;i<6;i++)
+    {
+      sigmaFullPrior[i]          = new fftw_complex[6];
+      sigmaFullVsCurrentPrior[i] = new fftw_complex[3];
+      sigmaFullPosterior[i]      = new fftw_complex[6];
+      adjointSandwich[i]          = new fftw_complex[3];
+    }
 
-  fftw_complex** sigmaFullPrior          = new fftw_complex*[6];
-  fftw_complex** sigmaFullPosterior      = new fftw_complex*[6];
-  fftw_complex** sigmaFullVsCurrentPrior = new fftw_complex*[6];
-  fftw_complex** adjointSandwich         = new fftw_complex*[6];
+    fftw_complex** sigmaCurrentPrior       = new fftw_complex*[3];
+    fftw_complex** sigmaCurrentPriorChol   = new fftw_complex*[3];
+    fftw_complex** sigmaCurrentPosterior   = new fftw_complex*[3];
+    fftw_complex** sandwich                = new fftw_complex*[3];
+    fftw_complex** helper                  = new fftw_complex*[3];
+
+    for(int i=0;i<3;i++)
+    {
+      sigmaCurrentPrior[i]     = new fftw_complex[3];
+      sigmaCurrentPriorChol[i] = new fftw_complex[3];
+      sigmaCurrentPosterior[i] = new fftw_complex[3];
+      sandwich[i]              = new fftw_complex[6];
+      helper[i]                = new fftw_complex[6];
+    }
 
-  for(int i=0;i<6;i++)
-  {
-    sigmaFullPrior[i]          = new fftw_complex[6];
-    sigmaFullVsCurrentPrior[i] = new fftw_complex[3];
-    sigmaFullPosterior[i]      = new fftw_complex[6];
-    adjointSandwich[i]          = new fftw_complex[3];
-  }
+#ifdef _OPENMP
+#pragma omp for schedule(static) reduction(+:counter)
+#endif
+    for (int r = 0; r < fullTile.getNRows(); r++) {
+      fullTile.readRow(r);
+      currentTile.readRow(r);
+      for (int i = 0; i < cnxp; i++) {
+         // reading from the tiles
+         fftw_complex       * fullCell    = fullTile.getCell(i);
+         const fftw_complex * currentCell = currentTile.getCell(i);
 
-  fftw_complex** sigmaCurrentPrior       = new fftw_complex*[3];
-  fftw_complex** sigmaCurrentPriorChol   = new fftw_complex*[3];
-  fftw_complex** sigmaCurrentPosterior   = new fftw_complex*[3];
-  fftw_complex** sandwich                = new fftw_complex*[3];
-  fftw_complex** helper                  = new fftw_complex*[3];
+         for(int l=0;l<6;l++)
+           muFullPrior[l] = fullCell[l];
 
-  for(int i=0;i<3;i++)
-  {
-    sigmaCurrentPrior[i]     = new fftw_complex[3];
-    sigmaCurrentPriorChol[i] = new fftw_complex[3];
-    sigmaCurrentPosterior[i] = new fftw_complex[3];
-    sandwich[i]              = new fftw_complex[6];
-    helper[i]                = new fftw_complex[6];
-  }
-  int counter =0;
-  for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
-      for (int i = 0; i < cnxp; i++) {
-         // reading from grids
-         muFullPrior[0] = mu_static_[0]->getNextComplex();
-         muFullPrior[1] = mu_static_[1]->getNextComplex();
-         muFullPrior[2] = mu_static_[2]->getNextComplex();
-         muFullPrior[3] = mu_dynamic_[0]->getNextComplex();
-         muFullPrior[4] = mu_dynamic_[1]->getNextComplex();
-         muFullPrior[5] = mu_dynamic_[2]->getNextComplex();
-
-
-         sigmaFullPrior[0][0] = sigma_static_static_[0]->getNextComplex();
-         sigmaFullPrior[0][1] = sigma_static_static_[1]->getNextComplex();
-         sigmaFullPrior[0][2] = sigma_static_static_[2]->getNextComplex();
-         sigmaFullPrior[0][3] = sigma_static_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[0][4] = sigma_static_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[0][5] = sigma_static_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[1][1] = sigma_static_static_[3]->getNextComplex();
-         sigmaFullPrior[1][2] = sigma_static_static_[4]->getNextComplex();
-         sigmaFullPrior[1][3] = sigma_static_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[1][4] = sigma_static_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[1][5] = sigma_static_dynamic_[5]->getNextComplex();
-         sigmaFullPrior[2][2] = sigma_static_static_[5]->getNextComplex();
-         sigmaFullPrior[2][3] = sigma_static_dynamic_[6]->getNextComplex();
-         sigmaFullPrior[2][4] = sigma_static_dynamic_[7]->getNextComplex();
-         sigmaFullPrior[2][5] = sigma_static_dynamic_[8]->getNextComplex();
-         sigmaFullPrior[3][3] = sigma_dynamic_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[3][4] = sigma_dynamic_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[3][5] = sigma_dynamic_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[4][4] = sigma_dynamic_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[4][5] = sigma_dynamic_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[5][5] = sigma_dynamic_dynamic_[5]->getNextComplex();
-
-         muCurrentPosterior[0]=mu[0]->getNextComplex();
-         muCurrentPosterior[1]=mu[1]->getNextComplex();
-         muCurrentPosterior[2]=mu[2]->getNextComplex();
-
-         sigmaCurrentPosterior[0][0]=sigma[0]->getNextComplex();
-         sigmaCurrentPosterior[0][1]=sigma[1]->getNextComplex();
-         sigmaCurrentPosterior[0][2]=sigma[2]->getNextComplex();
-         sigmaCurrentPosterior[1][1]=sigma[3]->getNextComplex();
-         sigmaCurrentPosterior[1][2]=sigma[4]->getNextComplex();
-         sigmaCurrentPosterior[2][2]=sigma[5]->getNextComplex();
+         int c = 6;
+         for(int l=0;l<6;l++)
+           for(int m=l;m<6;m++)
+             sigmaFullPrior[l][m] = fullCell[c++];
+
+         muCurrentPosterior[0]=currentCell[0];
+         muCurrentPosterior[1]=currentCell[1];
+         muCurrentPosterior[2]=currentCell[2];
+
+         sigmaCurrentPosterior[0][0]=currentCell[3];
+         sigmaCurrentPosterior[0][1]=currentCell[4];
+         sigmaCurrentPosterior[0][2]=currentCell[5];
+         sigmaCurrentPosterior[1][1]=currentCell[6];
+         sigmaCurrentPosterior[1][2]=currentCell[7];
+         sigmaCurrentPosterior[2][2]=currentCell[8];
          // compleating matrixes
          sigmaCurrentPosterior[1][0]=sigmaCurrentPosterior[0][1];
          sigmaCurrentPosterior[2][0]=sigmaCurrentPosterior[0][2];
@@ -426,102 +395,63 @@ void State4D::split(SeismicParametersHolder & current_state )
            lib_matrAddVecCpx( muFullPrior, 6, muFullPosterior);
          }else
          {
-          // /*
-          counter++;
-          if(counter==100)
-          {
-            lib_matrDumpCpx("priorFull", sigmaFullPrior, 6,6);
-            lib_matrDumpCpx("priorCurrent", sigmaCurrentPrior, 3,3);
-            lib_matrDumpCpx("posteriorCurrent", sigmaCurrentPosterior, 3,3); // */
-          }
+           counter++;
            lib_matrCopyCpx(sigmaFullPrior, 6, 6, sigmaFullPosterior);
            for(int l=0;l<6;l++)
              muFullPosterior[l]= muFullPrior[l];
 
          }
 
-        // writing to grids
-         sigma_static_static_[0]->setNextComplex(  sigmaFullPosterior[0][0]);
-         sigma_static_static_[1]->setNextComplex(  sigmaFullPosterior[0][1]);
-         sigma_static_static_[2]->setNextComplex(  sigmaFullPosterior[0][2]);
-         sigma_static_dynamic_[0]->setNextComplex( sigmaFullPosterior[0][3]);
-         sigma_static_dynamic_[1]->setNextComplex( sigmaFullPosterior[0][4]);
-         sigma_static_dynamic_[2]->setNextComplex( sigmaFullPosterior[0][5]);
-         sigma_static_static_[3]->setNextComplex(  sigmaFullPosterior[1][1]);
-         sigma_static_static_[4]->setNextComplex(  sigmaFullPosterior[1][2]);
-         sigma_static_dynamic_[3]->setNextComplex( sigmaFullPosterior[1][3]);
-         sigma_static_dynamic_[4]->setNextComplex( sigmaFullPosterior[1][4]);
-         sigma_static_dynamic_[5]->setNextComplex( sigmaFullPosterior[1][5]);
-         sigma_static_static_[5]->setNextComplex(  sigmaFullPosterior[2][2]);
-         sigma_static_dynamic_[6]->setNextComplex( sigmaFullPosterior[2][3]);
-         sigma_static_dynamic_[7]->setNextComplex( sigmaFullPosterior[2][4]);
-         sigma_static_dynamic_[8]->setNextComplex( sigmaFullPosterior[2][5]);
-         sigma_dynamic_dynamic_[0]->setNextComplex(sigmaFullPosterior[3][3]);
-         sigma_dynamic_dynamic_[1]->setNextComplex(sigmaFullPosterior[3][4]);
-         sigma_dynamic_dynamic_[2]->setNextComplex(sigmaFullPosterior[3][5]);
-         sigma_dynamic_dynamic_[3]->setNextComplex(sigmaFullPosterior[4][4]);
-         sigma_dynamic_dynamic_[4]->setNextComplex(sigmaFullPosterior[4][5]);
-         sigma_dynamic_dynamic_[5]->setNextComplex(sigmaFullPosterior[5][5]);
-
-         mu_static_[0]->setNextComplex( muFullPosterior[0]);
-         mu_static_[1]->setNextComplex( muFullPosterior[1]);
-         mu_static_[2]->setNextComplex( muFullPosterior[2]);
-         mu_dynamic_[0]->setNextComplex(muFullPosterior[3]);
-         mu_dynamic_[1]->setNextComplex(muFullPosterior[4]);
-         mu_dynamic_[2]->setNextComplex(muFullPosterior[5]);
+        // writing to the tile
+         for(int l=0;l<6;l++)
+           fullCell[l] = muFullPosterior[l];
+
+         c = 6;
+         for(int l=0;l<6;l++)
+           for(int m=l;m<6;m++)
+             fullCell[c++] = sigmaFullPosterior[l][m];
       }
+      fullTile.writeRow(r);
     }
-  }
 
-  printf("\n\n #of Shortcuts in split = %d, this is  %f of 100 percent \n",counter, double(counter*100.0)/double(cnxp*nyp*nzp));
+    for(int i=0;i<6;i++)
+    {
+      delete [] adjointSandwich[i];
+      delete [] sigmaFullPrior[i];
+      delete [] sigmaFullVsCurrentPrior[i];
+      delete [] sigmaFullPosterior[i];
+    }
+    for(int i=0;i<3;i++)
+    {
+      delete [] sandwich[i];
+      delete [] helper[i];
+      delete [] sigmaCurrentPrior[i];
+      delete [] sigmaCurrentPriorChol[i];
+      delete [] sigmaCurrentPosterior[i];
+    }
 
-  for(int i = 0; i<3; i++)
-  {
-    mu[i]->endAccess();
-    mu_static_[i]->endAccess();
-    mu_dynamic_[i]->endAccess();
+    delete [] muFullPrior;
+    delete [] muFullPosterior;
+    delete [] muCurrentPrior;
+    delete [] muCurrentPosterior;
+
+    delete [] sandwich;
+    delete [] helper;
+    delete [] adjointSandwich;
+    delete [] sigmaFullPrior;
+    delete [] sigmaFullPosterior;
+    delete [] sigmaFullVsCurrentPrior;
+    delete [] sigmaCurrentPrior;
+    delete [] sigmaCurrentPriorChol;
+    delete [] sigmaCurrentPosterior;
   }
-  for(int i = 0; i<6; i++)
-  {
-    sigma[i]->endAccess();
-    sigma_static_static_[i]->endAccess();
-    sigma_dynamic_dynamic_[i]->endAccess();
-  }
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->endAccess();
-
 
-  for(int i=0;i<6;i++)
-  {
-    delete [] adjointSandwich[i];
-    delete [] sigmaFullPrior[i];
-    delete [] sigmaFullVsCurrentPrior[i];
-    delete [] sigmaFullPosterior[i];
-  }
-  for(int i=0;i<3;i++)
-  {
-    delete [] sandwich[i];
-    delete [] helper[i];
-    delete [] sigmaCurrentPrior[i];
-    delete [] sigmaCurrentPriorChol[i];
-    delete [] sigmaCurrentPosterior[i];
+  if(streamed) {
+    FFTGridTile::endAccess(full);
+    FFTGridTile::endAccess(current);
   }
 
-  delete [] muFullPrior;
-  delete [] muFullPosterior;
-  delete [] muCurrentPrior;
-  delete [] muCurrentPosterior;
-
-  delete [] sandwich;
-  delete [] helper;
-  delete [] adjointSandwich;
-  delete [] sigmaFullPrior;
-  delete [] sigmaFullPosterior;
-  delete [] sigmaFullVsCurrentPrior;
-  delete [] sigmaCurrentPrior;
-  delete [] sigmaCurrentPriorChol;
-  delete [] sigmaCurrentPosterior;
+  printf("\n\n #of Shortcuts in split = %d, this is  %f of 100 percent \n",counter, double(counter*100.0)/double(nCells));
 }
 
 void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
@@ -573,28 +503,13 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
 
   // We assume FFT transformed grids
   for(int i = 0; i<6; i++)
-  {
     assert(mu[i]->getIsTransformed());
-    mu[i]->setAccessMode(FFTGrid::READANDWRITE);
-  }
   for(int i = 0; i<21; i++)
-  {
     assert(sigma[i]->getIsTransformed());
-    sigma[i]->setAccessMode(FFTGrid::READANDWRITE);
-  }
-
-  NRLib::Vector mu_real(6);
-  NRLib::Vector mu_imag(6);
-  NRLib::Vector mu_real_next(6);
-  NRLib::Vector mu_imag_next(6);
-
-  NRLib::Matrix sigma_real(6,6);
-  NRLib::Matrix sigma_imag(6,6);
-  NRLib::Matrix sigma_real_next(6,6);
-  NRLib::Matrix sigma_imag_next(6,6);
-  NRLib::Matrix tmp(6,6);
 
-  fftw_complex get_value,return_value;
+  // The means followed by the covariances, in the order above
+  std::vector<FFTGrid *> grids(mu);
+  grids.insert(grids.end(), sigma.begin(), sigma.end());
 
   int nz   = mu[0]->getNz();
   int ny   = mu[0]->getNy();
@@ -620,20 +535,50 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
    //timeIncSpatialCorr.writeAsciiRaw("timeIncSpatialCorr.dat");
 
    timeIncSpatialCorr.fftInPlace();
-   timeIncSpatialCorr.setAccessMode(FFTGrid::READ);
-  // Iterate through all points in the grid and perform forward transition in time
-  for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
+  // Iterate through all points in the grid and perform forward transition in time.
+  // The cells are independent, so the rows are distributed over the threads,
+  // unless some grids are on file and the rows must be taken in order.
+  bool streamed = FFTGridTile::hasFileGrid(grids);
+  if(streamed)
+    FFTGridTile::beginAccess(grids, FFTGrid::READANDWRITE);
+
+#ifdef _OPENMP
+#pragma omp parallel if(!streamed)
+#endif
+  {
+    FFTGridTile tile(grids, streamed);
+
+    NRLib::Vector mu_real(6);
+    NRLib::Vector mu_imag(6);
+    NRLib::Vector mu_real_next(6);
+    NRLib::Vector mu_imag_next(6);
+
+    NRLib::Matrix sigma_real(6,6);
+    NRLib::Matrix sigma_imag(6,6);
+    NRLib::Matrix sigma_real_next(6,6);
+    NRLib::Matrix sigma_imag_next(6,6);
+    NRLib::Matrix tmp(6,6);
+
+    fftw_complex get_value,return_value;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int r = 0; r < tile.getNRows(); r++) {
+      tile.readRow(r);
       for (int i = 0; i < cnxp; i++) {
+        int            index     = r*cnxp + i;
+        fftw_complex * cell      = tile.getCell(i);
+        fftw_complex * sigmaCell = cell + 6;
 
-        fftw_complex ijkLambda = timeIncSpatialCorr.getNextComplex();
-        float realTocomplexScaleFactor =  (i==0 && j==0 && k==0 )? float(std::sqrt(double(nxp*nyp*nzp))): 0.0f;  // note add a constant in real domain is
-                                                                                                                 // just a value on the 0,0,0 in fft domain
-                                                                                                                 // is for the mean what  ijkLambda is for the covariance
+        fftw_complex ijkLambda = timeIncSpatialCorr.getComplexValue(index);
+        float realTocomplexScaleFactor =  (index==0)? float(std::sqrt(double(nxp*nyp*nzp))): 0.0f;  // note add a constant in real domain is
+                                                                                                 // just a value on the 0,0,0 in fft domain
+                                                                                                 // is for the mean what  ijkLambda is for the covariance
 
         // Set up vectors from the FFT grids
         for (int d = 0; d < 6; d++) {
-          get_value  = mu[d]->getNextComplex();
+          get_value  = cell[d];
           mu_real(d) = get_value.re;
           mu_imag(d) = get_value.im;
         }
@@ -646,7 +591,7 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
         for (int d = 0; d < 6; d++) {
           return_value.re = static_cast<float>(mu_real_next(d));
           return_value.im = static_cast<float>(mu_imag_next(d));
-          mu[d]->setNextComplex(return_value);
+          cell[d] = return_value;
         }
         // Set up matrices from the FFT-grids.
         // Note: Here we assume a specific order of the elements in the sigma-vector.
@@ -654,10 +599,10 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
         int counter = 0;
         for (int d1 = 0; d1 < 3; d1++) {
           for (int d2 = d1; d2 < 3; d2++) {
-            get_value  = sigma[counter]->getNextComplex();
+            get_value  = sigmaCell[counter];
             sigma_real(d1, d2) = get_value.re;
             sigma_imag(d1, d2) = get_value.im;
-            get_value  = sigma[counter+6]->getNextComplex();
+            get_value  = sigmaCell[counter+6];
             sigma_real(d1+3, d2+3) = get_value.re;  // d1+3 and d2+3 due to block structure of matrix
             sigma_imag(d1+3, d2+3) = get_value.im;
 
@@ -677,7 +622,7 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
         counter = 12;
         for (int d1 = 0; d1 < 3; d1++) {
           for (int d2 = 3; d2 < 6; d2++) {
-            get_value=sigma[counter]->getNextComplex();
+            get_value=sigmaCell[counter];
             sigma_real(d1, d2) = get_value.re;
             sigma_imag(d1, d2) = get_value.im;
             counter++;
@@ -699,11 +644,11 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
           for (int d2 = d1; d2 < 3; d2++) {// Static and dynamic parts.
             return_value.re = static_cast<float>(sigma_real_next(d1, d2));
             return_value.im = static_cast<float>(sigma_imag_next(d1, d2));
-            sigma[counter]->setNextComplex(return_value);
+            sigmaCell[counter] = return_value;
 
             return_value.re = static_cast<float>(sigma_real_next(d1+3, d2+3));  //d1+3 and d2+3 due to block structure of matrix
             return_value.im = static_cast<float>(sigma_imag_next(d1+3, d2+3));
-            sigma[counter+6]->setNextComplex(return_value);
+            sigmaCell[counter+6] = return_value;
 
             counter++;
           }
@@ -714,18 +659,54 @@ void State4D::evolve(int time_step, const TimeEvolution timeEvolution )
           for (int d2 = 3; d2 < 6; d2++) {
             return_value.re = static_cast<float>(sigma_real_next(d1, d2));
             return_value.im = static_cast<float>(sigma_imag_next(d1, d2));
-            sigma[counter]->setNextComplex(return_value);
+            sigmaCell[counter] = return_value;
             counter++;
           }
         }
       }
+      tile.writeRow(r);
     }
   }
 
-  for(int i = 0; i<6; i++)
-    mu[i]->endAccess();
-  for(int i = 0; i<21; i++)
-    sigma[i]->endAccess();
+  if(streamed)
+    FFTGridTile::endAccess(grids);
+}
+
+std::vector<FFTGrid *>
+State4D::getFullMuGrids()
+{
+  std::vector<FFTGrid *> muFull(mu_static_);
+  muFull.insert(muFull.end(), mu_dynamic_.begin(), mu_dynamic_.end());
+  return muFull;
+}
+
+std::vector<FFTGrid *>
+State4D::getFullSigmaGrids()
+{
+  // The upper triangle of the 6x6 covariance of (static, dynamic), row by row.
+  std::vector<FFTGrid *> sigmaFull(21);
+  sigmaFull[0]  = sigma_static_static_[0];
+  sigmaFull[1]  = sigma_static_static_[1];
+  sigmaFull[2]  = sigma_static_static_[2];
+  sigmaFull[3]  = sigma_static_dynamic_[0];
+  sigmaFull[4]  = sigma_static_dynamic_[1];
+  sigmaFull[5]  = sigma_static_dynamic_[2];
+  sigmaFull[6]  = sigma_static_static_[3];
+  sigmaFull[7]  = sigma_static_static_[4];
+  sigmaFull[8]  = sigma_static_dynamic_[3];
+  sigmaFull[9]  = sigma_static_dynamic_[4];
+  sigmaFull[10] = sigma_static_dynamic_[5];
+  sigmaFull[11] = sigma_static_static_[5];
+  sigmaFull[12] = sigma_static_dynamic_[6];
+  sigmaFull[13] = sigma_static_dynamic_[7];
+  sigmaFull[14] = sigma_static_dynamic_[8];
+  sigmaFull[15] = sigma_dynamic_dynamic_[0];
+  sigmaFull[16] = sigma_dynamic_dynamic_[1];
+  sigmaFull[17] = sigma_dynamic_dynamic_[2];
+  sigmaFull[18] = sigma_dynamic_dynamic_[3];
+  sigmaFull[19] = sigma_dynamic_dynamic_[4];
+  sigmaFull[20] = sigma_dynamic_dynamic_[5];
+  return sigmaFull;
 }
 
 bool
@@ -92,6 +92,8 @@ public:
 
 private:
   bool allGridsAreTransformed();
+  std::vector<FFTGrid *> getFullMuGrids();      // Static followed by dynamic
+  std::vector<FFTGrid *> getFullSigmaGrids();   // Upper triangle of the full 6x6 covariance, row by row
   std::vector<FFTGrid *> mu_static_;            // [0] = vp, [1] = vs, [2] = rho
   std::vector<FFTGrid *> mu_dynamic_;           // [0] = vp, [1] = vs, [2] = rho
   std::vector<FFTGrid *> sigma_static_static_;  // [0] = vp_vp, [1] = vp_vs, [2] = vp_rho ,[3] = vs_vs, [4] = vs_rho, [5] = rho_rho (all static)
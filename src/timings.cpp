@@ -50,6 +50,11 @@ Timings::reportAll(LogKit::MessageLevels logLevel)
   reportOne("Miscellaneous            ", c_rest_             , w_rest_             , c_total_, w_total_,logLevel);
   LogKit::LogFormatted(logLevel,  "---------------------------------------------------------------------\n");
   reportOne("Total                    ", c_total_            , w_total_            , c_total_, w_total_,logLevel);
+
+  if (n_fft_ > 0) {
+    LogKit::LogFormatted(logLevel,"\nOf the above, %d FFTs of grids used:\n",n_fft_);
+    reportOne("FFT of grids             ", c_fft_              , w_fft_              , c_total_, w_total_,logLevel);
+  }
 }
 
 void
@@ -256,6 +261,15 @@ Timings::addToTimeKrigingSim(double& wall, double& cpu)
   c_kriging_sim_ += cpu;
 }
 
+void
+Timings::addToTimeFFT(double& wall, double& cpu)
+{
+  TimeKit::getTime(wall,cpu);
+  w_fft_ += wall;
+  c_fft_ += cpu;
+  n_fft_++;
+}
+
 
 double Timings::w_total_             = 0.0;
 double Timings::c_total_             = 0.0;
@@ -301,3 +315,7 @@ double Timings::c_kriging_pred_      = 0.0;
 
 double Timings::w_kriging_sim_       = 0.0;
 double Timings::c_kriging_sim_       = 0.0;
+
+double Timings::w_fft_               = 0.0;
+double Timings::c_fft_               = 0.0;
+int    Timings::n_fft_               = 0;
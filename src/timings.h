@@ -28,6 +28,7 @@ public:
   static void    setTimeFaciesProb(double& wall, double& cpu);
   static void    setTimeKrigingPred(double& wall, double& cpu);
   static void    addToTimeKrigingSim(double& wall, double& cpu);
+  static void    addToTimeFFT(double& wall, double& cpu);
 
 private:
   static void    reportOne(const std::string & text, double cpuThis, double wallThis,
@@ -78,6 +79,10 @@ private:
 
   static double  w_kriging_sim_;
   static double  c_kriging_sim_;
+
+  static double  w_fft_;            // Time used by 3D FFTs of grids. Included in the other sections.
+  static double  c_fft_;
+  static int     n_fft_;            // Number of 3D FFTs of grids
 };
 
 #endif
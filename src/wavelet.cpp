@@ -33,6 +33,8 @@
 #include "src/vario.h"
 #include "src/io.h"
 
+#include "lib/utils.h"
+
 Wavelet::Wavelet(int dim)
   : cnzp_(0),
     rnzp_(0),
@@ -247,15 +249,11 @@ void Wavelet::fft1DInPlace()
 {
   // use the operator version of the fourier transform
   if(isReal_) {
-    int flag;
-    rfftwnd_plan plan;
-    flag    = FFTW_ESTIMATE | FFTW_IN_PLACE;
-    plan    = rfftwnd_create_plan(1, &nzp_ ,FFTW_REAL_TO_COMPLEX,flag);
+    rfftwnd_plan plan = Utils::getFFTPlan1D(nzp_, FFTW_REAL_TO_COMPLEX);
     //
     // NBNB-PAL: The call rfftwnd_on_real_to_complex is causing UMRs in Purify.
     //
     rfftwnd_one_real_to_complex(plan,rAmp_,cAmp_);
-    fftwnd_destroy_plan(plan);
     isReal_ = false;
   }
 }
@@ -265,13 +263,8 @@ void Wavelet::invFFT1DInPlace()
 {
   // use the operator version of the fourier transform
   if(!isReal_) {
-    int flag;
-    rfftwnd_plan plan;
-
-    flag = FFTW_ESTIMATE | FFTW_IN_PLACE;
-    plan= rfftwnd_create_plan(1,&nzp_,FFTW_COMPLEX_TO_REAL,flag);
+    rfftwnd_plan plan = Utils::getFFTPlan1D(nzp_, FFTW_COMPLEX_TO_REAL);
     rfftwnd_one_complex_to_real(plan,cAmp_,rAmp_);
-    fftwnd_destroy_plan(plan);
     isReal_=true;
     double scale= static_cast<double>(1.0/static_cast<double>(nzp_));
     for(int i=0; i < nzp_; i++)
@@ -384,6 +377,62 @@ Wavelet::getCAmp(int    k,
   return value;
 }
 
+void
+Wavelet::fillStretchTable(float          scale,
+                          StretchTable & table) const
+{
+  //
+  // As getCAmp(k, scale). Omega increases with k, so the cells with
+  // omega >= cnzp are the last ones.
+  //
+  table.scale = scale;
+  table.lower.resize(cnzp_);
+  table.upper.resize(cnzp_);
+  table.wLower.resize(cnzp_);
+  table.wUpper.resize(cnzp_);
+
+  int k;
+  for(k=0;k<cnzp_;k++) {
+    float omega = float(k) / scale;
+    if(omega >= cnzp_)
+      break;
+    int omL = int(floor( omega ));
+    int omU = omL + 1;
+    if(omU >= cnzp_)
+      omU -= 1;
+    float dOmega    = omega - float(omL);
+    table.lower[k]  = omL;
+    table.upper[k]  = omU;
+    table.wLower[k] = 1.0f - dOmega;
+    table.wUpper[k] = dOmega;
+  }
+  table.n = k;
+}
+
+void
+Wavelet::getCAmpStretched(const StretchTable & table,
+                          float              * re,
+                          float              * im) const
+{
+  assert(!isReal_);
+
+  const int   * lower  = &table.lower[0];
+  const int   * upper  = &table.upper[0];
+  const float * wLower = &table.wLower[0];
+  const float * wUpper = &table.wUpper[0];
+  float         scale  = table.scale;
+
+  int k;
+  for(k=0;k<table.n;k++) {
+    re[k] = (cAmp_[lower[k]].re * wLower[k] + cAmp_[upper[k]].re * wUpper[k]) / scale;
+    im[k] = (cAmp_[lower[k]].im * wLower[k] + cAmp_[upper[k]].im * wUpper[k]) / scale;
+  }
+  for(;k<cnzp_;k++) {
+    re[k] = 0.0f;
+    im[k] = 0.0f;
+  }
+}
+
 void
 Wavelet::setRAmp(float  value,
                  int    k)
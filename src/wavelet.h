@@ -5,6 +5,8 @@
 #ifndef WAVELET_H
 #define WAVELET_H
 
+#include <vector>
+
 #include "nrlib/surface/regularsurface.hpp"
 
 #include "fftw.h"
@@ -68,6 +70,28 @@ public:
   fftw_complex  getCAmp(int   k,
                         float scale) const;
 
+  // The interpolation done by getCAmp(k, scale) for k < cnzp. It depends only
+  // on the stretch and the length of the wavelet, so one table serves all
+  // traces with the same stretch, also when their local wavelets differ.
+  struct StretchTable
+  {
+    StretchTable() : scale(0.0f), n(0) {}
+    float              scale;
+    int                n;            // getCAmp(k, scale) is zero for k >= n
+    std::vector<int>   lower;
+    std::vector<int>   upper;
+    std::vector<float> wLower;
+    std::vector<float> wUpper;
+  };
+
+  void          fillStretchTable(float          scale,
+                                 StretchTable & table) const;
+
+  // Real and imaginary parts of getCAmp(k, table.scale) for k < cnzp.
+  void          getCAmpStretched(const StretchTable & table,
+                                 float              * re,
+                                 float              * im) const;
+
   void          setRAmp(float value,
                         int   k);
 
@@ -111,6 +135,15 @@ public:
 
   virtual Wavelet1D * createLocalWavelet1D(int /*i*/,
                                            int /*j*/) {return 0;} // note Not robust towards padding
+
+  // As createLocalWavelet1D, but fills localWavelet, which must be in the Fourier
+  // domain, from fftWavelet, which is this wavelet in the Fourier domain. No FFT
+  // plans are made, so threads may fill different local wavelets at the same time.
+  // Returns false if the local wavelet can not be found this way.
+  virtual bool        fillLocalWavelet1D(Wavelet1D       * /*localWavelet*/,
+                                         const Wavelet1D * /*fftWavelet*/,
+                                         int               /*i*/,
+                                         int               /*j*/) {return false;}
   virtual Wavelet1D * createWavelet1DForErrorNorm() {return 0;}
   virtual Wavelet1D * getGlobalWavelet(){return 0;}
 
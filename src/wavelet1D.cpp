@@ -504,6 +504,20 @@ Wavelet1D::createLocalWavelet1D(int i,
   return localWavelet;
 }
 
+bool
+Wavelet1D::fillLocalWavelet1D(Wavelet1D       * localWavelet,
+                              const Wavelet1D * fftWavelet,
+                              int               i,
+                              int               j)
+{
+  assert(!localWavelet->getIsReal());
+  for(int k=0;k < cnzp_;k++)
+    localWavelet->setCAmp(fftWavelet->getCAmp(k),k);
+  doLocalShiftAndScale1D(localWavelet,i,j);
+
+  return true;
+}
+
 Wavelet1D *
 Wavelet1D::createWavelet1DForErrorNorm()
 {
@@ -60,6 +60,10 @@ Wavelet1D(const ModelSettings * modelSettings,
   Wavelet1D * createWavelet1DForErrorNorm(void);
   Wavelet1D * createLocalWavelet1D(int i,
                                    int j);
+  bool        fillLocalWavelet1D(Wavelet1D       * localWavelet,
+                                 const Wavelet1D * fftWavelet,
+                                 int               i,
+                                 int               j);
   Wavelet1D * getGlobalWavelet(){ return this;}
 
   float         findGlobalScaleForGivenWavelet(const ModelSettings        * modelSettings,
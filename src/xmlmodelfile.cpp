@@ -239,6 +239,8 @@ XmlModelFile::parseSimulation(TiXmlNode * node, std::string & errTxt)
   legalCommands.push_back("seed");
   legalCommands.push_back("seed-file");
   legalCommands.push_back("number-of-simulations");
+  legalCommands.push_back("parallel");
+  legalCommands.push_back("store-cholesky-factors");
 
   int seed;
   bool seedGiven = parseValue(root, "seed", seed, errTxt);
@@ -260,6 +262,14 @@ XmlModelFile::parseSimulation(TiXmlNode * node, std::string & errTxt)
   else
     modelSettings_->setNumberOfSimulations(1);
 
+  bool parallel = false;
+  if(parseBool(root, "parallel", parallel, errTxt) == true)
+    modelSettings_->setParallelSimulation(parallel);
+
+  bool storeFactors = false;
+  if(parseBool(root, "store-cholesky-factors", storeFactors, errTxt) == true)
+    modelSettings_->setStoreCholeskyFactors(storeFactors);
+
   checkForJunk(root, errTxt, legalCommands);
   return(true);
 }
@@ -5188,6 +5198,7 @@ XmlModelFile::parseOtherOutput(TiXmlNode * node, std::string & errTxt)
   legalCommands.push_back("error-file");
   legalCommands.push_back("task-file");
   legalCommands.push_back("rock-physics-trends");
+  legalCommands.push_back("profile");
 
   bool value;
   int otherFlag = 0;
@@ -5207,6 +5218,8 @@ XmlModelFile::parseOtherOutput(TiXmlNode * node, std::string & errTxt)
     otherFlag += IO::TASK_FILE;
   if(parseBool(root, "rock-physics-trends", value, errTxt) == true && value == true)
     otherFlag += IO::ROCK_PHYSICS_TRENDS;
+  if(parseBool(root, "profile", value, errTxt) == true && value == true)
+    otherFlag += IO::PROFILE;
 
   modelSettings_->setOtherOutputFlag(otherFlag);
 
@@ -5227,6 +5240,7 @@ XmlModelFile::parseAdvancedSettings(TiXmlNode * node, std::string & errTxt)
   legalCommands.push_back("vp-vs-ratio");
   legalCommands.push_back("vp-vs-ratio-from-wells");
   legalCommands.push_back("use-intermediate-disk-storage");
+  legalCommands.push_back("maximum-memory");
   legalCommands.push_back("maximum-relative-thickness-difference");
   legalCommands.push_back("frequency-band");
   legalCommands.push_back("energy-threshold");
@@ -5246,6 +5260,8 @@ XmlModelFile::parseAdvancedSettings(TiXmlNode * node, std::string & errTxt)
   legalCommands.push_back("3d-wavelet-tuning-factor");
   legalCommands.push_back("gradient-smoothing-range");
   legalCommands.push_back("estimate-well-gradient-from-seismic");
+  legalCommands.push_back("number-of-threads");
+  legalCommands.push_back("segy-trace-index");
 
   parseFFTGridPadding(root, errTxt);
 
@@ -5266,6 +5282,14 @@ XmlModelFile::parseAdvancedSettings(TiXmlNode * node, std::string & errTxt)
   if(parseBool(root, "use-intermediate-disk-storage", fileGrid, errTxt) == true)
     modelSettings_->setFileGrid(fileGrid);
 
+  float maxMemory;
+  if(parseValue(root, "maximum-memory", maxMemory, errTxt) == true) {
+    if(maxMemory > 0.0f)
+      modelSettings_->setMaxMemory(maxMemory);
+    else
+      errTxt += "The maximum memory must be larger than zero\n";
+  }
+
   double limit;
   if(parseValue(root,"maximum-relative-thickness-difference", limit, errTxt) == true)
     modelSettings_->setLzLimit(limit);
@@ -5332,6 +5356,18 @@ XmlModelFile::parseAdvancedSettings(TiXmlNode * node, std::string & errTxt)
   if(parseBool(root, "estimate-well-gradient-from-seismic", estimate, errTxt) == true)
     modelSettings_->setEstimateWellGradientFromSeismic(estimate);
 
+  int nThreads = 0;
+  if(parseValue(root, "number-of-threads", nThreads, errTxt) == true) {
+    if(nThreads >= 0)
+      modelSettings_->setNumberOfThreads(nThreads);
+    else
+      errTxt += "The number of threads must be larger than or equal to zero\n";
+  }
+
+  bool useIndex = true;
+  if(parseBool(root, "segy-trace-index", useIndex, errTxt) == true)
+    modelSettings_->setUseSegyTraceIndex(useIndex);
+
   checkForJunk(root, errTxt, legalCommands);
   return(true);
 }